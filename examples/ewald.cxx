@@ -18,6 +18,9 @@
 #endif
 using namespace exafmm;
 
+typedef HOTMPI<Bodies,Multipoles> BasicMPI;
+typedef Traversal<BasicMPI> TreeTraversal;                      // The LET comes from TreeMPI, not from a communicator
+
 int main(int argc, char ** argv) {
   const int ksize = 11;
   const real_t cycle = 2 * M_PI;
@@ -35,9 +38,10 @@ int main(int argc, char ** argv) {
   BuildTree globalTree(1, args.nspawn);
   Cells cells, jcells;
   Dataset data;
+  Expansions M, L, jM, jL;
   Ewald ewald(ksize, alpha, sigma, cutoff, cycle);
   Partition partition(baseMPI.mpirank, baseMPI.mpisize);
-  Traversal traversal(args.nspawn, args.images);
+  TreeTraversal traversal(args.nspawn, args.images);
   TreeMPI treeMPI(baseMPI.mpirank, baseMPI.mpisize, args.images);
   UpDownPass upDownPass(args.theta, args.useRmax, args.useRopt);
   Verify verify;
@@ -47,7 +51,7 @@ int main(int argc, char ** argv) {
   args.verbose &= baseMPI.mpirank == 0;
   logger::verbose = args.verbose;
   logger::printTitle("Ewald Parameters");
-  args.print(logger::stringLength, P);
+  args.print(logger::stringLength, P, std::cout);
   ewald.print(logger::stringLength);
   bodies = data.initBodies(args.numBodies, args.distribution, baseMPI.mpirank, baseMPI.mpisize);
   for (B_iter B=bodies.begin(); B!=bodies.end(); B++) {
@@ -65,30 +69,32 @@ int main(int argc, char ** argv) {
     bodies = treeMPI.commBodies(bodies);
 
     cells = localTree.buildTree(bodies, buffer, localBounds);
-    upDownPass.upwardPass(cells);
+    upDownPass.upwardPass(cells, M, L);
     treeMPI.allgatherBounds(localBounds);
-    treeMPI.setLET(cells, cycle);
+    treeMPI.setLET(cells, M, cycle);
     treeMPI.commBodies();
     treeMPI.commCells();
 
     traversal.initListCount(cells);
     traversal.initWeight(cells);
-    traversal.traverse(cells, cells, cycle, args.dual, args.mutual);
+    traversal.traverse(cells, M, L, cells, M, L, cycle, args.dual, args.mutual);
     if (baseMPI.mpisize > 1) {
       if (args.graft) {
 	treeMPI.linkLET();
 	gbodies = treeMPI.root2body();
 	jcells = globalTree.buildTree(gbodies, buffer, globalBounds);
-	treeMPI.attachRoot(jcells);
-	traversal.traverse(cells, jcells, cycle, args.dual, false);
+	treeMPI.attachRoot(jcells, jM);
+	jL.resize(jcells.size());
+	traversal.traverse(cells, M, L, jcells, jM, jL, cycle, args.dual, false);
       } else {
 	for (int irank=0; irank<baseMPI.mpisize; irank++) {
-	  treeMPI.getLET(jcells, (baseMPI.mpirank+irank)%baseMPI.mpisize);
-	  traversal.traverse(cells, jcells, cycle, args.dual, false);
+	  treeMPI.getLET(jcells, jM, (baseMPI.mpirank+irank)%baseMPI.mpisize);
+	  jL.resize(jcells.size());
+	  traversal.traverse(cells, M, L, jcells, jM, jL, cycle, args.dual, false);
 	}
       }
     }
-    upDownPass.downwardPass(cells);
+    upDownPass.downwardPass(cells, M, L);
     vec3 localDipole = upDownPass.getDipole(bodies,0);
     vec3 globalDipole = baseMPI.allreduceVec3(localDipole);
     int numBodies = baseMPI.allreduceInt(bodies.size());
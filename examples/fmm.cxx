@@ -8,6 +8,9 @@
 #include "verify.h"
 using namespace exafmm;
 
+typedef HOTMPI<Bodies,Multipoles> BasicMPI;
+typedef Traversal<BasicMPI> TreeTraversal;                      // Only the local traversal is used, without a communicator
+
 int main(int argc, char ** argv) {
   const real_t cycle = 2 * M_PI;
   Args args(argc, argv);
@@ -17,7 +20,8 @@ int main(int argc, char ** argv) {
   BuildTree buildTree(args.ncrit, args.nspawn);
   Cells cells, jcells;
   Dataset data;
-  Traversal traversal(args.nspawn, args.images);
+  Expansions M, L, jM, jL;
+  TreeTraversal traversal(args.nspawn, args.images);
   UpDownPass upDownPass(args.theta, args.useRmax, args.useRopt);
   Verify verify;
   num_threads(args.threads);
@@ -26,10 +30,11 @@ int main(int argc, char ** argv) {
 #if EXAFMM_HELMHOLTZ
   kernel::wavek = complex_t(10.,1.) / real_t(2 * M_PI);
 #endif
+  if (args.order) kernel::order = args.order;
   kernel::setup();
   logger::verbose = args.verbose;
   logger::printTitle("FMM Parameters");
-  args.print(logger::stringLength, P);
+  args.print(logger::stringLength, kernel::order, std::cout);
   bodies = data.initBodies(args.numBodies, args.distribution, 0);
   buffer.reserve(bodies.size());
   if (args.IneJ) {
@@ -53,18 +58,18 @@ int main(int argc, char ** argv) {
       bounds = boundBox.getBounds(jbodies, bounds);
     }
     cells = buildTree.buildTree(bodies, buffer, bounds);
-    upDownPass.upwardPass(cells);
+    upDownPass.upwardPass(cells, M, L);
     traversal.initListCount(cells);
     traversal.initWeight(cells);
     if (args.IneJ) {
       jcells = buildTree.buildTree(jbodies, buffer, bounds);
-      upDownPass.upwardPass(jcells);
-      traversal.traverse(cells, jcells, cycle, args.dual, false);
+      upDownPass.upwardPass(jcells, jM, jL);
+      traversal.traverse(cells, M, L, jcells, jM, jL, cycle, args.dual, false);
     } else {
-      traversal.traverse(cells, cells, cycle, args.dual, args.mutual);
+      traversal.traverse(cells, M, L, cells, M, L, cycle, args.dual, args.mutual);
       jbodies = bodies;
     }
-    upDownPass.downwardPass(cells);
+    upDownPass.downwardPass(cells, M, L);
     logger::printTitle("Total runtime");
     logger::stopDAG();
     logger::stopPAPI();
@@ -8,7 +8,7 @@
 #include "hilbert_wrapper.h"
 #include "hot_partitioner.h"
 #include "traversal.h"
-#include "build_tree_tbb.h"
+#include "build_tree_from_keys.h"
 #include "hot_mpi.h"
 
 #define DIRECT 1
@@ -18,11 +18,7 @@ using namespace exafmm;
 using namespace std;
 
 
-#if SEND_MULTIPOLES
 typedef HOTMPI<Bodies,Multipoles> BasicMPI;
-#else 
-typedef HOTMPI<Bodies,Cells> BasicMPI;
-#endif
 typedef Traversal<BasicMPI> TreeTraversal;
 
 
@@ -34,16 +30,19 @@ int main(int argc, char ** argv) {
   BaseMPI baseMPI;
   Verify verify;
   BoundBox boundBox(args.nspawn);  
+  BuildTreeFromKeys buildTree(args.ncrit);                       // Reused every step, the key depth is passed per step
   int rank = baseMPI.mpirank;
   int size = baseMPI.mpisize;  
   args.verbose &= rank == 0;
   args.numBodies /= baseMPI.mpisize;  
   logger::verbose = args.verbose;
   logger::printTitle("FMM Parameters"); 
-  args.print(logger::stringLength, P, std::cout);  
+  if (args.order) kernel::order = args.order;
+  args.print(logger::stringLength, kernel::order, std::cout);  
   double commtime = 0.0;
   num_threads(args.threads);  
   Cells cells,jcells;
+  Expansions M,L;
   Bodies jbodies;
   kernel::eps2 = 0.0;
 #if EXAFMM_HELMHOLTZ
@@ -58,8 +57,9 @@ int main(int argc, char ** argv) {
     auto&& globalBounds = baseMPI.allreduceBounds(localBounds);
     uint32_t depth; 
     auto&& hilbertBounds = generateHilbertKey(bodies,globalBounds,depth);         
-    BasicMPI* hotMPI = new BasicMPI(rank, size, depth,args.grain);    
-    auto&& globalHilbertBounds = hotMPI->allReduceHilbertBounds(hilbertBounds);  
+    BasicMPI hotMPI(rank, size, depth, args.grain);              // Released with its request communicator at the end of the step
+    if (args.cache) hotMPI.setCacheBudget(size_t(args.cache) << 20);
+    auto&& globalHilbertBounds = hotMPI.allReduceHilbertBounds(hilbertBounds);  
     HOTPartition partitioner(hilbertBounds,globalHilbertBounds,rank,size,args.numBodies);
     logger::stopTimer("Total FMM",0);    
     logger::startTimer("Partition");
@@ -67,25 +67,36 @@ int main(int argc, char ** argv) {
     if(args.balance == 0 || t == 0) {
       logger::stopTimer("Load-balance",0);
       partitioner.partitionSort(bodies);
-      bodies = hotMPI->asyncGlobalCommunication(bodies,1,false);
+      bodies = hotMPI.asyncGlobalCommunication(bodies,1,true);
       logger::stopTimer("Partition");
     }
     if(args.balance != 0 && t > 0) {
       logger::stopTimer("Partition",0);      
       partitioner.migrateWork(bodies);
-      bodies = hotMPI->asyncGlobalCommunication(bodies,1,false);
+      bodies = hotMPI.asyncGlobalCommunication(bodies,1,true);
       logger::stopTimer("Load-balance");
     }
     logger::startTimer("Total FMM");  
     localBounds = boundBox.getBounds(bodies);
-    BuildTree buildTree(args.ncrit,depth);
-    cells = buildTree(bodies,localBounds);  
+    BodiesSoA bodiesSoA;
+    BodiesSoA * soa = NULL;                                      // SoA bodies, filled while the tree is built
+#if EXAFMM_LAPLACE
+    if (args.soa) soa = &bodiesSoA;
+#endif
+    cells = buildTree(bodies,globalBounds,depth,soa);
     localBounds = boundBox.getBounds(cells, localBounds);
     UpDownPass upDownPass(args.theta, args.useRmax, false);
-    upDownPass.upwardPass(cells);
-    TreeTraversal traversal(args.nspawn, 0, hotMPI);    
-    traversal.traverse(cells, cells, cycle, true, args.mutual);
-    traversal.dualTreeTraversalRemote(cells,rank,size,BuildTree::indexer,upDownPass);        
+    upDownPass.upwardPass(cells, M, L);
+    hotMPI.initDispatcher(cells, M, buildTree.indexer);             // Serve peers during local traversal if threaded
+    TreeTraversal traversal(args.nspawn, 0, &hotMPI);    
+    traversal.startTraversalRemote(cells,M,L,rank,size,buildTree.indexer);// Requests for remote cells overlap the local traversal
+    traversal.setBodiesSoA(soa, soa);
+    traversal.traverse(cells, M, L, cells, M, L, cycle, true, args.mutual);
+    if (soa) {
+      soa->addToBodies(bodies);                                  // Local P2P results go back to the bodies once
+      traversal.setBodiesSoA(NULL, NULL);
+    }
+    traversal.dualTreeTraversalRemote(cells,M,L,rank,size,buildTree.indexer,upDownPass);        
 
 #if CALC_COM_COMP
     logger::printTime("Communication");
@@ -102,7 +113,7 @@ int main(int argc, char ** argv) {
     logger::startTimer("Total Direct");
     for (int i=0; i<baseMPI.mpisize; i++) {
       if (args.verbose) std::cout << "Direct loop          : " << i+1 << "/" << baseMPI.mpisize << std::endl;      
-      hotMPI->shiftBodies(jbodies);      
+      hotMPI.shiftBodies(jbodies);      
       traversal.direct(bodies, jbodies, cycle);      
     }
     traversal.normalize(bodies);
@@ -156,7 +167,7 @@ int main(int argc, char ** argv) {
 
   if(rank == 0) {
     std::ofstream configFile("config.dat");                 // Open list log file
-    args.print(logger::stringLength, P, configFile);  
+    args.print(logger::stringLength, kernel::order, configFile);  
     logger::logFixed("Communication Size",size,configFile);
 #if HILBERT_CODE
     configFile<<"using Hilbert partitioning"<<std::endl;
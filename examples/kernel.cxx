@@ -1,15 +1,20 @@
+#include "args.h"
 #include <fstream>
 #include "kernel.h"
 #include <vector>
 #include "verify.h"
 using namespace exafmm;
 
-int main() {
+int main(int argc, char ** argv) {
+  Args args(argc, argv);
   Bodies bodies(1), bodies2(1), jbodies(1);
   kernel::eps2 = 0.0;
   kernel::Xperiodic = 0;
+  if (args.order) kernel::order = args.order;
+  kernel::setup();
 
   Cells cells(4);
+  Expansions M(4), L(4);
   Verify verify;
   jbodies[0].X = 0;
 #if EXAFMM_BIOTSAVART
@@ -24,41 +29,41 @@ int main() {
   Cj->X = 3. / 16;
   Cj->BODY = jbodies.begin();
   Cj->NBODY = jbodies.size();
-  Cj->M = 0;
-  kernel::P2M(Cj);
+  M[0] = 0;
+  kernel::P2M(Cj, M[0]);
 
 #if 1
   C_iter CJ = cells.begin()+1;
   CJ->ICHILD = Cj-cells.begin();
   CJ->NCHILD = 1;
   CJ->X = 3. / 8;
-  CJ->M = 0;
-  kernel::M2M(CJ, cells.begin());
+  M[1] = 0;
+  kernel::M2M(CJ, cells.begin(), &M[0]);
 
   C_iter CI = cells.begin()+2;
   CI->X = 21. / 8;
-  CI->M = 1;
-  CI->L = 0;
+  M[2] = 1;
+  L[2] = 0;
 #if EXAFMM_MASS
-  for (int i=1; i<NTERM; i++) CJ->M[i] /= CJ->M[0];
+  for (int i=1; i<NTERM; i++) M[1][i] /= M[1][0];
 #endif
-  kernel::M2L(CI, CJ, false);
+  kernel::M2L(CI, CJ, M[2], L[2], M[1], NULL);
 
   C_iter Ci = cells.begin()+3;
   Ci->X = 45. / 16;
   Ci->IPARENT = 2;
-  Ci->M = 1;
-  Ci->L = 0;
-  kernel::L2L(Ci, cells.begin());
+  M[3] = 1;
+  L[3] = 0;
+  kernel::L2L(Ci, cells.begin(), &M[0], &L[0]);
 #else
   C_iter Ci = cells.begin()+3;
   Ci->X = 45. / 16;
-  Ci->M = 1;
-  Ci->L = 0;
+  M[3] = 1;
+  L[3] = 0;
 #if EXAFMM_MASS
-  for (int i=1; i<NTERM; i++) Cj->M[i] /= Cj->M[0];
+  for (int i=1; i<NTERM; i++) M[0][i] /= M[0][0];
 #endif
-  kernel::M2L(Ci, Cj, false);
+  kernel::M2L(Ci, Cj, M[3], L[3], M[0], NULL);
 #endif
 
   bodies[0].X = 3;
@@ -66,7 +71,7 @@ int main() {
   bodies[0].TRG = 0;
   Ci->BODY = bodies.begin();
   Ci->NBODY = bodies.size();
-  kernel::L2P(Ci);
+  kernel::L2P(Ci, L[3]);
 
   for (B_iter B=bodies2.begin(); B!=bodies2.end(); B++) {
     *B = bodies[B-bodies2.begin()];
@@ -87,10 +92,10 @@ int main() {
   double potNrm = verify.getNrmScalar(bodies);
   double accDif = verify.getDifVector(bodies, bodies2);
   double accNrm = verify.getNrmVector(bodies);
-  std::cout << P << " " << std::sqrt(potDif/potNrm) << "  " << std::sqrt(accDif/accNrm) << std::endl;
+  std::cout << kernel::order << " " << std::sqrt(potDif/potNrm) << "  " << std::sqrt(accDif/accNrm) << std::endl;
   verify.print("Rel. L2 Error (pot)",std::sqrt(potDif/potNrm));
   verify.print("Rel. L2 Error (acc)",std::sqrt(accDif/accNrm));
-  file << P << " " << std::sqrt(potDif/potNrm) << "  " << std::sqrt(accDif/accNrm) << std::endl;
+  file << kernel::order << " " << std::sqrt(potDif/potNrm) << "  " << std::sqrt(accDif/accNrm) << std::endl;
   file.close();
   return 0;
 }
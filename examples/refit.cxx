@@ -0,0 +1,127 @@
+#include "base_mpi.h"
+#include "args.h"
+#include "bound_box.h"
+#include "build_tree.h"
+#include "dataset.h"
+#include "logger.h"
+#include "refit_tree.h"
+#include "traversal.h"
+#include "up_down_pass.h"
+#include "verify.h"
+using namespace exafmm;
+
+typedef HOTMPI<Bodies,Multipoles> BasicMPI;
+typedef Traversal<BasicMPI> TreeTraversal;
+
+//! Motion of the bodies between two steps, each chosen to exercise one path of RefitTree
+enum Motion {
+  JITTER,                                                       //!< Every body moves by 2% of its leaf, few change leaf
+  CROWD,                                                        //!< 3 x ncrit bodies gather in one leaf, more than 2 x ncrit
+  DRAIN,                                                        //!< The second leaf spreads over the first, and is left empty
+  SCATTER                                                       //!< Every 10th body jumps anywhere, more than 5% change leaf
+};
+
+//! Evaluate the FMM on one tree, and return the targets in the order of the caller
+Bodies evaluate(Bodies & bodies, Cells & cells, UpDownPass & upDownPass, TreeTraversal & traversal, bool mutual) {
+  Expansions M, L;
+  for (B_iter B=bodies.begin(); B!=bodies.end(); B++) B->TRG = 0;// Not initTarget, which renumbers IBODY
+  upDownPass.upwardPass(cells, M, L);
+  traversal.traverse(cells, M, L, cells, M, L, 0, true, mutual);
+  upDownPass.downwardPass(cells, M, L);
+  Bodies result(bodies.size());
+  for (B_iter B=bodies.begin(); B!=bodies.end(); B++) result[B->IBODY] = *B;
+  return result;
+}
+
+int main(int argc, char ** argv) {
+  const Motion motions[] = {JITTER, JITTER, CROWD, JITTER, DRAIN, JITTER, SCATTER, JITTER};
+  const int numMotions = sizeof(motions) / sizeof(motions[0]);
+  Args args(argc, argv);
+  BaseMPI baseMPI;
+  Bodies buffer;
+  BoundBox boundBox(args.nspawn);
+  BuildTree buildTree(args.ncrit, args.nspawn);
+  Dataset data;
+  RefitTree refitTree(args.ncrit);
+  TreeTraversal traversal(args.nspawn, 0);
+  UpDownPass upDownPass(args.theta, args.useRmax, false);
+  Verify verify;
+  logger::verbose = args.verbose;
+  logger::printTitle("FMM Parameters");
+  if (args.order) kernel::order = args.order;
+  args.print(logger::stringLength, kernel::order, std::cout);
+  num_threads(args.threads);
+  kernel::eps2 = 0.0;
+  kernel::setup();
+
+  const int numBodies = args.numBodies;
+  Bodies input = data.initBodies(numBodies, args.distribution, 0, 1);// Bodies in the order of the caller, as in the MD wrappers
+  std::vector<int> treeOrder;                                   // Body index of each body in the last tree
+  std::vector<vec3> leafX(numBodies);                           // Center of the leaf of each body in the last tree
+  std::vector<real_t> leafR(numBodies);                         // Radius of the leaf of each body in the last tree
+  std::vector<int> leafN(numBodies);                            // Number of bodies in the leaf of each body in the last tree
+  srand48(1);
+  for (int t=0; t<args.repeat; t++) {
+    logger::printTitle("Step " + std::to_string(t));
+    bool expected = false;                                      // Whether the refit should be taken
+    if (t > 0) {                                                // Move bodies as an MD step would
+      Motion motion = motions[(t-1) % numMotions];
+      expected = motion == JITTER;
+      if (motion == JITTER) {
+        for (int i=0; i<numBodies; i++) {
+          for (int d=0; d<3; d++) input[i].X[d] += (drand48() * 2 - 1) * 0.02 * leafR[i];
+        }
+      } else if (motion == CROWD) {
+        vec3 X0 = input[treeOrder[0]].X;                        //  Into the leaf of the first body in the tree
+        for (int i=0; i<3*args.ncrit; i++) {
+          for (int d=0; d<3; d++) input[treeOrder[i]].X[d] = X0[d] + (drand48() * 2 - 1) * 0.01 * leafR[treeOrder[0]];
+        }
+      } else if (motion == DRAIN) {
+        int n0 = leafN[treeOrder[0]];                           //  Bodies of the first leaf
+        for (int i=n0; i<n0+leafN[treeOrder[n0]]; i++) {        //  Loop over bodies of the second leaf
+          for (int d=0; d<3; d++) input[treeOrder[i]].X[d] = leafX[treeOrder[0]][d] + (drand48() * 2 - 1) * 0.9 * leafR[treeOrder[0]];
+        }
+      } else {
+        Bounds bounds = boundBox.getBounds(input);
+        for (int i=0; i<numBodies; i+=10) {
+          for (int d=0; d<3; d++) input[i].X[d] = bounds.Xmin[d] + drand48() * (bounds.Xmax[d] - bounds.Xmin[d]);
+        }
+      }
+    }
+    Bodies bodies(numBodies);
+    bool reuse = refitTree.size() == numBodies;                 // Bodies can be laid out as in the last tree
+    for (int i=0; i<numBodies; i++) {
+      bodies[i] = input[reuse ? treeOrder[i] : i];
+      bodies[i].IBODY = reuse ? treeOrder[i] : i;
+    }
+    Bodies jbodies = bodies;                                    // Same bodies for a fresh build
+    Cells cells;
+    bool refit = refitTree.refit(bodies, cells);                // Refit the last tree if bodies moved little
+    if (!refit) {
+      cells = buildTree.buildTree(bodies, buffer, boundBox.getBounds(bodies));// Else rebuild it
+      refitTree.setTree(cells);                                 //  And refit this one in the next steps
+    }
+    treeOrder.resize(numBodies);
+    for (B_iter B=bodies.begin(); B!=bodies.end(); B++) treeOrder[B-bodies.begin()] = B->IBODY;
+    for (C_iter C=cells.begin(); C!=cells.end(); C++) {
+      if (C->NCHILD == 0) {
+        for (B_iter B=C->BODY; B!=C->BODY+C->NBODY; B++) {
+          leafX[B->IBODY] = C->X;
+          leafR[B->IBODY] = C->R;
+          leafN[B->IBODY] = C->NBODY;
+        }
+      }
+    }
+    Cells jcells = buildTree.buildTree(jbodies, buffer, boundBox.getBounds(jbodies));
+    Bodies result = evaluate(bodies, cells, upDownPass, traversal, args.mutual);
+    Bodies result2 = evaluate(jbodies, jcells, upDownPass, traversal, args.mutual);
+    std::cout << std::setw(logger::stringLength) << std::left << "Tree expected" << " : "
+              << (t == 0 ? "build" : expected ? "refit" : "rebuild") << std::endl;
+    std::cout << std::setw(logger::stringLength) << std::left << "Tree built" << " : "
+              << (refit ? "refit" : t == 0 ? "build" : "rebuild") << std::endl;
+    logger::printTitle("Refit vs. fresh build");
+    verify.print("Rel. L2 Error (pot)", std::sqrt(verify.getDifScalar(result, result2) / verify.getNrmScalar(result2)));
+    verify.print("Rel. L2 Error (acc)", std::sqrt(verify.getDifVector(result, result2) / verify.getNrmVector(result2)));
+  }
+  return 0;
+}
@@ -17,7 +17,7 @@ int main(int argc, char ** argv) {
 
   logger::verbose = args.verbose;
   logger::printTitle("FMM Parameters");
-  args.print(logger::stringLength, P);
+  args.print(logger::stringLength, P, std::cout);
   buffer.reserve(args.numBodies);
   double * grow1 = new double [args.repeat+1];
   double * link1 = new double [args.repeat+1];
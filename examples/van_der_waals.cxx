@@ -0,0 +1,61 @@
+#include <iomanip>
+#include "thread.h"
+#include "van_der_waals.h"
+using namespace exafmm;
+
+//! Evaluate the Van der Waals kernel between two leaves, and print pot and acc of each target
+//! Built with and without EXAFMM_USE_SIMD, so that run_van_der_waals_kernel can compare the two paths
+int main() {
+  const int numTypes = 4;
+  const int ni = 13;                                            // Not a multiple of NSIMD, so the last lanes are partial
+  const int nj = 64;
+  const double cuton = 4.0;
+  const double cutoff = 5.0;
+  const double cycle = 100.0;                                   // Far enough that no periodic image is a neighbor
+  srand48(0);
+  std::vector<double> rscale(numTypes*numTypes), gscale(numTypes*numTypes), fgscale(numTypes*numTypes);
+  for (int i=0; i<numTypes; i++) {
+    for (int j=0; j<=i; j++) {                                  // Symmetric tables, as in the MD wrappers
+      rscale[i*numTypes+j] = rscale[j*numTypes+i] = 1 / (3.0 + drand48());
+      gscale[i*numTypes+j] = gscale[j*numTypes+i] = 0.5 + drand48();
+      fgscale[i*numTypes+j] = fgscale[j*numTypes+i] = 6 * gscale[i*numTypes+j];
+    }
+  }
+  VanDerWaals VdW(cuton, cutoff, cycle, numTypes, &rscale[0], &gscale[0], &fgscale[0]);
+
+  Bodies bodies(ni), jbodies(nj);
+  for (B_iter B=bodies.begin(); B!=bodies.end(); B++) {         // Targets in a small box around the origin
+    for (int d=0; d<3; d++) B->X[d] = drand48() * 0.1;
+    B->SRC = int(drand48() * numTypes);
+    B->TRG = 0;
+  }
+  for (B_iter B=jbodies.begin(); B!=jbodies.end(); B++) {       // Sources in shells around cuton and cutoff
+    int k = B-jbodies.begin();
+    double R = (k % 2 ? cutoff : cuton) * (0.95 + drand48() * 0.1);
+    vec3 dX;
+    for (int d=0; d<3; d++) dX[d] = drand48() * 2 - 1;
+    B->X = dX * R / std::sqrt(norm(dX));
+    B->SRC = int(drand48() * numTypes);
+  }
+  bodies[ni-1].X = 10;                                          // A coincident pair away from the others, which must be skipped
+  jbodies[0].X = bodies[ni-1].X;
+
+  Cells cells(1), jcells(1);
+  C_iter Ci = cells.begin();
+  Ci->X = 0;
+  Ci->NCHILD = 0;
+  Ci->BODY = bodies.begin();
+  Ci->NBODY = bodies.size();
+  C_iter Cj = jcells.begin();
+  Cj->X = 0;
+  Cj->ICHILD = 0;
+  Cj->NCHILD = 0;
+  Cj->BODY = jbodies.begin();
+  Cj->NBODY = jbodies.size();
+  VdW.evaluate(cells, jcells);
+  for (B_iter B=bodies.begin(); B!=bodies.end(); B++) {
+    std::cout << std::setprecision(17) << std::scientific
+	      << B->TRG[0] << " " << B->TRG[1] << " " << B->TRG[2] << " " << B->TRG[3] << std::endl;
+  }
+  return 0;
+}
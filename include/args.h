@@ -32,6 +32,10 @@ static struct option long_options[] = {
 	{"balance",      required_argument, 0, 'b'},
   {"weight",       required_argument, 0, 'W'},
   {"grain",        required_argument, 0, 'a'},
+  {"soa",          no_argument,       0, 'S'},
+  {"cache",        required_argument, 0, 'M'},
+  {"fft",          no_argument,       0, 'F'},
+  {"order",        required_argument, 0, 'P'},
 	{0, 0, 0, 0}
 };
 #endif
@@ -58,6 +62,10 @@ public:
 	int balance;
 	double weight;
 	uint16_t grain;
+	int soa;
+	int cache;
+	int fft;
+	int order;
 
 private:
 	void usage(char * name) {
@@ -84,7 +92,15 @@ private:
 		        " --useRmax (-x)                : Use maximum distance for MAC (%d)\n"
 		        " --balance (-b)                : Loadbalance input (%d)\n"
 		        " --weight (-W)                 : remote weight (%f)\n"
-		        " --grain (-a)                  : grain size for remote communication (%d)\n" ,
+		        " --grain (-a)                  : grain size for remote communication (%d)\n"
+		        " --soa (-S)                    : Use SoA bodies for local P2P (%d)\n"
+		        " --cache (-M)                  : Remote body cache budget in MB, 0 for unlimited (%d)\n"
+		        " --fft (-F)                    : Use FFT based M2L in the uniform FMM (%d)\n"
+		        "                                 needs 8*(MTERM+LTERM)*nf^3 complex values at the finest level,\n"
+		        "                                 about 0.8 GB at P=6 with 6 levels and 5 GB with 7\n"
+		        " --order (-P)                  : Expansion order of the kernels, 0 for the compiled P (%d)\n"
+		        "                                 Cartesian: 2 to the compiled P, spherical: the compiled P only;\n"
+		        "                                 expansion storage and the wire format stay sized by the compiled P\n" ,
 		        name,
 		        ncrit,
 		        distribution,
@@ -105,7 +121,11 @@ private:
 		        useRmax,
 		        balance,
 		        weight,
-		        grain );
+		        grain,
+		        soa,
+		        cache,
+		        fft,
+		        order );
 	}
 
 	const char * parse(const char * arg) {
@@ -150,15 +170,19 @@ public:
 		useRmax(0),
 		balance(0),
 		weight(1.0),
-		grain(1)
+		grain(1),
+		soa(0),
+		cache(0),
+		fft(0),
+		order(0)
 	{
 		while (1) {
 #if _SX
 #warning SX does not have getopt_long
-			int c = getopt(argc, argv, "c:d:DgGhi:jmn:or:s:t:T:b:W:a:vwx");
+			int c = getopt(argc, argv, "c:d:DFgGhi:jmM:n:oP:r:s:St:T:b:W:a:vwx");
 #else
 			int option_index;
-			int c = getopt_long(argc, argv, "c:d:DgGhi:jmn:or:s:t:T:b:W:a:vwx", long_options, &option_index);
+			int c = getopt_long(argc, argv, "c:d:DFgGhi:jmM:n:oP:r:s:St:T:b:W:a:vwx", long_options, &option_index);
 #endif
 			if (c == -1) break;
 			switch (c) {
@@ -225,6 +249,18 @@ public:
 			case 'a':
 				grain = atoi(optarg);
 				break;
+			case 'S':
+				soa = 1;
+				break;
+			case 'M':
+				cache = atoi(optarg);
+				break;
+			case 'F':
+				fft = 1;
+				break;
+			case 'P':
+				order = atoi(optarg);
+				break;
 			default:
 				usage(argv[0]);
 				exit(0);
@@ -257,6 +293,8 @@ public:
 			          << std::setw(stringLength)
 			          << "P" << " : " << PP << std::endl
 			          << std::setw(stringLength)
+			          << "order" << " : " << order << std::endl
+			          << std::setw(stringLength)
 			          << "repeat" << " : " << repeat << std::endl
 			          << std::setw(stringLength)
 			          << "nspawn" << " : " << nspawn << std::endl
@@ -275,7 +313,13 @@ public:
     						<< std::setw(stringLength)
     						<< "remote weight" << " : " << weight << std::endl
 						    << std::setw(stringLength)
-						    << "comm grain" << " : " << int(grain) << std::endl;
+						    << "comm grain" << " : " << int(grain) << std::endl
+						    << std::setw(stringLength)
+						    << "soa" << " : " << soa << std::endl
+						    << std::setw(stringLength)
+						    << "cache" << " : " << cache << std::endl
+						    << std::setw(stringLength)
+						    << "fft" << " : " << fft << std::endl;
 		}
 	}
 };
@@ -24,7 +24,12 @@ namespace exafmm {
       int argc(0);                                              // Dummy argument count
       char **argv;                                              // Dummy argument value
       MPI_Initialized(&external);                               // Check if MPI_Init has been called
+#if INTERNAL_THREADING
+      int provided;                                             // Thread support provided by MPI
+      if (!external) MPI_Init_thread(&argc, &argv, MPI_THREAD_MULTIPLE, &provided);// Dispatcher runs on its own thread
+#else
       if (!external) MPI_Init(&argc, &argv);                    // Initialize MPI communicator
+#endif
       MPI_Comm_rank(MPI_COMM_WORLD, &mpirank);                  // Get rank of current MPI process
       MPI_Comm_size(MPI_COMM_WORLD, &mpisize);                  // Get number of MPI processes
     }
@@ -0,0 +1,173 @@
+#ifndef bodies_soa_h
+#define bodies_soa_h
+#include "align.h"
+#include "types.h"
+
+namespace exafmm {
+  //! Structure of arrays copy of the P2P fields of Bodies, kept in the same (tree) order
+  //! Once layout is called, each leaf starts at a multiple of NSIMD, so SIMD loads of a cell are aligned
+  class BodiesSoA {
+  public:
+    typedef std::vector<real_t,AlignedAllocator<real_t,SIMD_BYTES> > Array;// Aligned array of reals
+    Array x;                                                    //!< Position x
+    Array y;                                                    //!< Position y
+    Array z;                                                    //!< Position z
+    Array q;                                                    //!< Source (charge/mass)
+    Array pot;                                                  //!< Target potential
+    Array ax;                                                   //!< Target acceleration x
+    Array ay;                                                   //!< Target acceleration y
+    Array az;                                                   //!< Target acceleration z
+    std::vector<int> entry;                                     //!< Entry of each body in the arrays
+
+  private:
+    Array buffer;                                               //!< Scratch array for permutation
+
+    //! Reorder one array according to permutation
+    void permuteArray(Array & a, const int * permutation) {
+      int n = a.size();                                         // Number of elements
+      buffer.resize(n);                                         // Resize scratch array
+      for (int i=0; i<n; i++) {                                 // Loop over elements
+        buffer[i] = a[permutation[i]];                          //  Copy permuted element to buffer
+      }                                                         // End loop over elements
+      a.swap(buffer);                                           // Swap buffer with array
+    }
+
+    //! Move one array to the entries of a new layout, with zero padding
+    void layoutArray(Array & a, const std::vector<int> & newEntry, int n) {
+      buffer.assign(n, 0);                                      // Zero scratch array
+      for (int i=0; i<int(entry.size()); i++) {                 // Loop over bodies
+        buffer[newEntry[i]] = a[entry[i]];                      //  Copy body to its new entry
+      }                                                         // End loop over bodies
+      a.swap(buffer);                                           // Swap buffer with array
+    }
+
+  public:
+    //! Round n up to a multiple of NSIMD
+    static int pad(int n) {
+      return (n + NSIMD - 1) / NSIMD * NSIMD;
+    }
+
+    //! Number of entries, including padding
+    int size() const {
+      return x.size();
+    }
+
+    //! First entry of the bodies of cell C
+    int begin(C_iter C) const {
+      return C->NBODY ? entry[C->IBODY] : 0;
+    }
+
+    //! Number of entries of cell C including padding, a multiple of NSIMD after layout
+    int count(C_iter C) const {
+      return C->NBODY ? pad(entry[C->IBODY + C->NBODY - 1] + 1) - entry[C->IBODY] : 0;
+    }
+
+    //! Resize all arrays to n bodies without padding, which set and permute fill until layout pads the leaves
+    void resize(int n) {
+      x.resize(n);                                              // Resize x
+      y.resize(n);                                              // Resize y
+      z.resize(n);                                              // Resize z
+      q.resize(n);                                              // Resize q
+      pot.resize(n);                                            // Resize pot
+      ax.resize(n);                                             // Resize ax
+      ay.resize(n);                                             // Resize ay
+      az.resize(n);                                             // Resize az
+      entry.resize(n);                                          // Resize entries
+      for (int i=0; i<n; i++) entry[i] = i;                     // Body i is entry i
+    }
+
+    //! Pad the arrays so that the first body of each leaf of cells is at a multiple of NSIMD
+    //! The padding has zero charge, so the kernels can run over whole vectors of a cell and add nothing
+    void layout(const Cells & cells) {
+      int n = entry.size();                                     // Number of bodies
+      std::vector<int> newEntry(n, 0);                          // Entries of the padded layout
+      for (int c=0; c<int(cells.size()); c++) {                 // Loop over cells
+        if (cells[c].NCHILD == 0 && cells[c].NBODY > 0) newEntry[cells[c].IBODY] = 1;// Mark first body of leaf
+      }                                                         // End loop over cells
+      int e = 0;                                                // Next free entry
+      for (int i=0; i<n; i++) {                                 // Loop over bodies in tree order
+        if (newEntry[i]) e = pad(e);                            //  Leaf starts at a multiple of NSIMD
+        newEntry[i] = e++;                                      //  Entry of body
+      }                                                         // End loop over bodies
+      e = pad(e);                                               // Whole vectors for the last leaf
+      layoutArray(x, newEntry, e);                              // Lay out x
+      layoutArray(y, newEntry, e);                              // Lay out y
+      layoutArray(z, newEntry, e);                              // Lay out z
+      layoutArray(q, newEntry, e);                              // Lay out q
+      layoutArray(pot, newEntry, e);                            // Lay out pot
+      layoutArray(ax, newEntry, e);                             // Lay out ax
+      layoutArray(ay, newEntry, e);                             // Lay out ay
+      layoutArray(az, newEntry, e);                             // Lay out az
+      entry.swap(newEntry);                                     // Use the padded entries
+    }
+
+    //! Zero the target arrays
+    void initTarget() {
+      std::fill(pot.begin(), pot.end(), 0);                     // Zero potential
+      std::fill(ax.begin(), ax.end(), 0);                       // Zero acceleration x
+      std::fill(ay.begin(), ay.end(), 0);                       // Zero acceleration y
+      std::fill(az.begin(), az.end(), 0);                       // Zero acceleration z
+    }
+
+    //! Copy position and source of one body to entry i, and zero its targets
+    void set(int i, const Body & body) {
+      x[i] = body.X[0];                                         // Copy position x
+      y[i] = body.X[1];                                         // Copy position y
+      z[i] = body.X[2];                                         // Copy position z
+#if EXAFMM_LAPLACE
+      q[i] = body.SRC;                                          // Copy source
+#endif
+      pot[i] = ax[i] = ay[i] = az[i] = 0;                       // Zero targets
+    }
+
+    //! Copy position and source of entry j of B to entry i, and zero its targets
+    void set(int i, const BodiesSoA & B, int j) {
+      x[i] = B.x[j];                                            // Copy position x
+      y[i] = B.y[j];                                            // Copy position y
+      z[i] = B.z[j];                                            // Copy position z
+      q[i] = B.q[j];                                            // Copy source
+      pot[i] = ax[i] = ay[i] = az[i] = 0;                       // Zero targets
+    }
+
+    //! Add the targets of entry j of B to entry i
+    void addTarget(int i, const BodiesSoA & B, int j) {
+      pot[i] += B.pot[j];                                       // Add potential
+      ax[i] += B.ax[j];                                         // Add acceleration x
+      ay[i] += B.ay[j];                                         // Add acceleration y
+      az[i] += B.az[j];                                         // Add acceleration z
+    }
+
+    //! Copy positions and sources from bodies, and zero the targets (call layout before the kernels)
+    void copyFromBodies(const Bodies & bodies) {
+      int n = bodies.size();                                    // Number of bodies
+      resize(n);                                                // Resize arrays
+      for (int i=0; i<n; i++) set(i, bodies[i]);                // Copy each body
+    }
+
+    //! Accumulate targets into bodies (same order as copyFromBodies)
+    void addToBodies(Bodies & bodies) const {
+      int n = bodies.size();                                    // Number of bodies
+      assert(n == int(entry.size()));                           // Both containers hold the same bodies
+      for (int i=0; i<n; i++) {                                 // Loop over bodies
+        int e = entry[i];                                       //  Entry of body
+        bodies[i].TRG[0] += pot[e];                             //  Add potential
+        bodies[i].TRG[1] += ax[e];                              //  Add acceleration x
+        bodies[i].TRG[2] += ay[e];                              //  Add acceleration y
+        bodies[i].TRG[3] += az[e];                              //  Add acceleration z
+      }                                                         // End loop over bodies
+    }
+
+    //! Reorder all arrays with the permutation used for bodies (new[i] = old[permutation[i]]), before layout
+    void permute(const int * permutation) {
+      permuteArray(x, permutation);                             // Permute x
+      permuteArray(y, permutation);                             // Permute y
+      permuteArray(z, permutation);                             // Permute z
+      permuteArray(q, permutation);                             // Permute q
+      permuteArray(pot, permutation);                           // Permute pot
+      permuteArray(ax, permutation);                            // Permute ax
+      permuteArray(ay, permutation);                            // Permute ay
+      permuteArray(az, permutation);                            // Permute az
+    }
+  };
+}
+#endif
@@ -0,0 +1,180 @@
+#ifndef build_tree_from_keys_h
+#define build_tree_from_keys_h
+#include <algorithm>
+#include "cell_index.h"
+#include "hilbert_wrapper.h"
+#include "logger.h"
+#include "sort.h"
+#include "types.h"
+
+namespace exafmm {
+  //! Builds the local tree bottom up from the space filling curve keys that generateHilbertKey stored in Body::ICELL
+  //! A cell is a key prefix shared by its bodies, so cells are found by splitting sorted key ranges; bodies are not moved
+  class BuildTreeFromKeys {
+  private:
+    typedef CellIndex::KeyIndex KeyIndex;                       //!< Pair of cell key and cell index
+
+    const int ncrit;                                            //!< Number of bodies per leaf cell
+    int order;                                                  //!< Number of key bits per dimension of the keys being built
+    int maxlevel;                                               //!< Maximum level of tree
+    std::vector<uint64_t> keys;                                 //!< Copy of the sorted body keys
+    Sort sort;                                                  //!< Radix sort for bodies that are not in key order
+
+    //! Key prefix of a cell at global level (level 0 is the whole key cube)
+    inline uint64_t prefix(uint64_t key, int level) const {
+      return key >> 3 * (order - level);
+    }
+
+    //! Grid coordinates of the finest cell containing key
+    hilbert_arr decode(uint64_t key) const {
+#if HILBERT_CODE
+      hilbert_arr iX = unflattenKey<hilbert_arr>(key, order);   // Transposed Hilbert key
+      TransposetoAxes(iX, order, DIM);                          // Hilbert transpose to axes
+#else
+      hilbert_arr iX = {{0, 0, 0}};                             // Initialize coordinates
+      for (int l=0; l<order; l++) {                             // Loop over bits
+        for (int d=0; d<3; d++) iX[d] |= ((key >> (3 * l + d)) & 1) << l;// Deinterleave Morton key
+      }                                                         // End loop over bits
+#endif
+      return iX;                                                // Return coordinates
+    }
+
+    //! Number of children of a cell, i.e. distinct key prefixes at the next level in its body range
+    int countChildren(int begin, int end, int level) const {
+      int nchild = 0;                                           // Initialize child counter
+      for (int i=begin; i<end; nchild++) {                      // Loop over child ranges
+        uint64_t p = prefix(keys[i], level + 1);                //  Prefix of child
+        i = std::upper_bound(keys.begin() + i, keys.begin() + end, ((p + 1) << 3 * (order - level - 1)) - 1) - keys.begin();// End of child range
+      }                                                         // End loop over child ranges
+      return nchild;                                            // Return number of children
+    }
+
+    //! Set the key, center and radius of a cell from its first body
+    void setCell(C_iter C, const hilbert_arr & rootX, int rootLevel, real_t Xmin, real_t unit) const {
+      int level = rootLevel + C->LEVEL;                         // Global level of cell
+      hilbert_arr iX = decode(keys[C->IBODY]);                  // Grid coordinates of first body
+      real_t side = unit * (uint64_t(1) << (order - level));    // Side length of cell
+      uint64_t index = ((uint64_t(1) << 3 * C->LEVEL) - 1) / 7; // Levelwise offset
+      for (int d=0; d<3; d++) {                                 // Loop over dimensions
+        iX[d] >>= order - level;                                //  Coordinates at cell level
+        C->X[d] = Xmin + (iX[d] + 0.5) * side;                  //  Cell center
+        uint64_t jX = iX[d] - (rootX[d] << C->LEVEL);           //  Coordinates relative to root cell
+        for (int l=0; l<C->LEVEL; l++) index += ((jX >> l) & 1) << (3 * l + d);// Interleave bits into Morton key
+      }                                                         // End loop over dimensions
+      C->R = side / 2;                                          // Cell radius
+      C->ICELL = index;                                         // Same key convention as BuildTree
+    }
+
+  public:
+    CellIndex indexer;                                          //!< Index from cell key to cell, per level
+
+    //! Constructed once and reused every step, which keeps the key, sort and index buffers
+    BuildTreeFromKeys(int _ncrit) : ncrit(_ncrit), order(0), maxlevel(0) {}
+
+    //! Build tree structure from the keys of bodies; bounds and order must be the ones the keys were generated with
+    //! If bodiesSoA is given it is filled in tree order in the same pass that reads the sorted keys, and padded once the leaves are known
+    Cells operator() (Bodies & bodies, Bounds bounds, int _order, BodiesSoA * bodiesSoA = NULL) {
+      logger::startTimer("Grow tree");                          // Start timer
+      Cells cells;                                              // Initialize cell array
+      order = _order;                                           // Key bits per dimension of this step
+      maxlevel = 0;                                             // Initialize maximum level
+      int numBodies = bodies.size();                            // Number of bodies
+      if (numBodies == 0) {                                     // If bodies vector is empty
+        indexer.build(cells);                                   //  Empty index
+        logger::stopTimer("Grow tree");                         //  Stop timer
+        return cells;                                           //  Return empty cells
+      }                                                         // End if for empty bodies
+      keys.resize(numBodies);                                   // Allocate keys
+      bool sorted = true;                                       // Whether bodies are in key order
+      for (int i=1; i<numBodies && sorted; i++) {               // Loop over bodies until one is out of order
+        if (bodies[i].ICELL < bodies[i-1].ICELL) sorted = false;//  Check order
+      }                                                         // End loop over bodies
+      if (!sorted) sort.sortICELL(bodies);                      // Radix sort bodies by key
+      if (bodiesSoA) bodiesSoA->resize(numBodies);              // Allocate SoA bodies
+      for (int i=0; i<numBodies; i++) {                         // Loop over bodies in key order
+        keys[i] = bodies[i].ICELL;                              //  Copy key
+        if (bodiesSoA) bodiesSoA->set(i, bodies[i]);            //  Copy body to SoA bodies
+      }                                                         // End loop over bodies
+      real_t Xmin = min(bounds.Xmin);                           // Origin of key grid, as in generateHilbertKey
+      real_t unit = (max(bounds.Xmax) - Xmin) / ((1 << order) - 1);// Side length of finest grid cell
+      int rootLevel = 0;                                        // Deepest level containing all bodies
+      while (rootLevel < order && prefix(keys[0], rootLevel + 1) == prefix(keys[numBodies-1], rootLevel + 1)) rootLevel++;
+      hilbert_arr rootX = decode(keys[0]);                      // Grid coordinates of root cell
+      for (int d=0; d<3; d++) rootX[d] >>= order - rootLevel;   // Coordinates at root level
+      cells.resize(1);                                          // Root cell
+      C_iter C0 = cells.begin();                                // Root cell iterator
+      C0->IPARENT = 0;                                          // Root is its own parent
+      C0->LEVEL = 0;                                            // Levels are relative to root
+      C0->IBODY = 0;                                            // Index of first body
+      C0->NBODY = numBodies;                                    // Number of bodies
+      setCell(C0, rootX, rootLevel, Xmin, unit);                // Key, center and radius of root
+      std::vector<int> offset;                                  // Child offsets of one level
+      std::vector<KeyIndex> pairs(1, KeyIndex(C0->ICELL, 0));   // Keys of root level
+      indexer.resize(0);                                        // Levels are appended as they are built
+      indexer.setLevel(0, pairs);                               // Index root level
+      int begin = 0, end = 1;                                   // Cells of current level
+      for (int level=0; begin<end; level++) {                   // Loop over levels
+        offset.resize(end - begin + 1);                         //  One offset per cell of level
+        offset[0] = 0;                                          //  First child offset
+#ifdef _OPENMP
+#pragma omp parallel for schedule(dynamic, 64)
+#endif
+        for (int i=begin; i<end; i++) {                         //  Loop over cells of level
+          Cell & C = cells[i];                                  //   Current cell
+          bool split = C.NBODY > ncrit && rootLevel + level < order;// Split unless small or at finest grid
+          offset[i-begin+1] = split ? countChildren(C.IBODY, C.IBODY + C.NBODY, rootLevel + level) : 0;
+        }                                                       //  End loop over cells of level
+        for (int i=0; i<end-begin; i++) offset[i+1] += offset[i];//  Inclusive scan of child counts
+        cells.resize(end + offset[end-begin]);                  //  Append next level
+        pairs.resize(offset[end-begin]);                        //  Keys of next level
+#ifdef _OPENMP
+#pragma omp parallel for schedule(dynamic, 64)
+#endif
+        for (int i=begin; i<end; i++) {                         //  Loop over cells of level
+          C_iter C = cells.begin() + i;                         //   Current cell
+          C->ICHILD = end + offset[i-begin];                    //   Index of first child cell
+          C->NCHILD = offset[i-begin+1] - offset[i-begin];      //   Number of child cells
+          C->BODY = bodies.begin() + C->IBODY;                  //   Iterator of first body
+          C->WEIGHT = 0;                                        //   Initialize weight
+          int ibody = C->IBODY;                                 //   First body of child
+          for (int c=0; c<C->NCHILD; c++) {                     //   Loop over children
+            C_iter Cc = cells.begin() + C->ICHILD + c;          //    Child cell
+            uint64_t p = prefix(keys[ibody], rootLevel + level + 1);// Prefix of child
+            int jbody = std::upper_bound(keys.begin() + ibody, keys.begin() + C->IBODY + C->NBODY,
+                                         ((p + 1) << 3 * (order - rootLevel - level - 1)) - 1) - keys.begin();
+            Cc->IPARENT = i;                                    //    Index of parent cell
+            Cc->LEVEL = level + 1;                              //    Level relative to root
+            Cc->IBODY = ibody;                                  //    Index of first body
+            Cc->NBODY = jbody - ibody;                          //    Number of bodies
+            setCell(Cc, rootX, rootLevel, Xmin, unit);          //    Key, center and radius
+            pairs[Cc - cells.begin() - end] = KeyIndex(Cc->ICELL, Cc - cells.begin());
+            ibody = jbody;                                      //    Next child starts here
+          }                                                     //   End loop over children
+        }                                                       //  End loop over cells of level
+        if (end < int(cells.size())) {                          //  If there is a next level
+          indexer.setLevel(level + 1, pairs);                   //   Index next level
+          maxlevel = level + 1;                                 //   Update maximum level
+        }                                                       //  End if for next level
+        begin = end;                                            //  Next level starts here
+        end = cells.size();                                     //  And ends here
+      }                                                         // End loop over levels
+      if (bodiesSoA) bodiesSoA->layout(cells);                  // Pad SoA bodies so that leaves start aligned
+      logger::stopTimer("Grow tree");                           // Stop timer
+      return cells;                                             // Return cells array
+    }
+
+    //! Print tree structure statistics
+    void printTreeData(Cells & cells) {
+      if (logger::verbose && !cells.empty()) {                  // If verbose flag is true
+        logger::printTitle("Tree stats");                       //  Print title
+        std::cout  << std::setw(logger::stringLength) << std::left//  Set format
+                   << "Bodies"     << " : " << cells.front().NBODY << std::endl// Print number of bodies
+                   << std::setw(logger::stringLength) << std::left//  Set format
+                   << "Cells"      << " : " << cells.size() << std::endl// Print number of cells
+                   << std::setw(logger::stringLength) << std::left//  Set format
+                   << "Tree depth" << " : " << maxlevel << std::endl;//  Print number of levels
+      }                                                         // End if for verbose flag
+    }
+  };
+}
+#endif
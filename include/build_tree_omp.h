@@ -4,45 +4,108 @@
 #include "thread.h"
 #include <vector>
 #include <array>
+#ifdef _OPENMP
+#include <omp.h>
+#endif
 #include "types.h"
+#include "bodies_soa.h"
+#include "cell_index.h"
 
 namespace exafmm {
 class BuildTree {
 private:
 	const int ncrit;                                            //!< Number of bodies per leaf cell
 	int numLevels;                                              //!< Number of level
+	std::vector<std::array<int,10> > nodes;                     //!< Node array, kept across builds
+	std::vector<int> permutation;                               //!< Permutation of bodies, kept across builds
+	std::vector<int> iwork;                                     //!< Work array of integers, kept across builds
+	std::vector<vec3> Xj;                                       //!< Coordinates of bodies, kept across builds
 private:
 	//! Get permutation index for reordering bodies
 	void reorder(Box box, int level, int * iX, vec3 * Xj,
 	             int * permutation, int n, int * iwork, int * nbody) {
 		int offset[9];                                            // Offset of bodies per octant
+		int count[8];                                             // Local octant counter (does not alias permutation)
 		vec3 X;                                                   // Declare temporary coordinates
 		real_t R = box.R / (1 << level);                          // Current cell radius
 		for (int d = 0; d < 3; d++) {                             // Loop over dimensions
 			X[d] = box.X[d] - box.R + iX[d] * R * 2 + R;            //  Coordinate of current cell center
 		}                                                         // End loop over dimensions
-		for (int i = 0; i < 8; i++) nbody[i] = 0;                 // Initialize nbody array
+		for (int i = 0; i < 8; i++) count[i] = 0;                 // Initialize counter
 		for (int i = 0; i < n; i++) {                             // Loop over bodies
 			int j = permutation[i];                                 //  Current body index
 			int octant = (Xj[j][2] > X[2]) * 4 + (Xj[j][1] > X[1]) * 2 + (Xj[j][0] > X[0]);// Octant of current body
-			nbody[octant]++;                                        //  Increment nbody counter for current octant
+			count[octant]++;                                        //  Increment counter for current octant
 		}                                                         // End loop over bodies
 		offset[0] = 0;                                            // Initialize offset array
 		for (int i = 0; i < 8; i++) {                             // Loop over octants
-			offset[i + 1] = offset[i] + nbody[i];                   //  Calculate offset from nbody
-			nbody[i] = 0;                                           //  Initialize nbody again
+			offset[i + 1] = offset[i] + count[i];                   //  Calculate offset from counter
+			nbody[i] = count[i];                                    //  Store number of bodies in octant
+			count[i] = 0;                                           //  Initialize counter again
 		}                                                         // End loop over octants
 		for (int i = 0; i < n; i++) {                             // Loop over bodies
 			int j = permutation[i];                                 //  Current body index
 			int octant = (Xj[j][2] > X[2]) * 4 + (Xj[j][1] > X[1]) * 2 + (Xj[j][0] > X[0]);// Octant of current body
-			iwork[offset[octant] + nbody[octant]] = permutation[i]; //  Put permutation index into temporary buffer
-			nbody[octant]++;                                        //  Increment nbody counter for current octant
+			iwork[offset[octant] + count[octant]] = permutation[i]; //  Put permutation index into temporary buffer
+			count[octant]++;                                        //  Increment counter for current octant
 		}                                                         // End loop over bodies
 		for (int i = 0; i < n; i++) {                             // Loop over bodies
 			permutation[i] = iwork[i];                              //  Copy back permutation array
 		}                                                         // End loop over bodies
 	}
 
+#ifdef _OPENMP
+	//! Get permutation index for reordering the bodies of one large cell using all threads
+	void reorderParallel(Box box, int level, int * iX, vec3 * Xj,
+	                     int * permutation, int n, int * iwork, int * nbody) {
+		vec3 X;                                                   // Declare temporary coordinates
+		real_t R = box.R / (1 << level);                          // Current cell radius
+		for (int d = 0; d < 3; d++) {                             // Loop over dimensions
+			X[d] = box.X[d] - box.R + iX[d] * R * 2 + R;            //  Coordinate of current cell center
+		}                                                         // End loop over dimensions
+		std::vector<std::array<int,8> > offset(omp_get_max_threads());// Offset of bodies per octant for each thread
+#pragma omp parallel
+		{
+			int numThreads = omp_get_num_threads();                 //  Number of threads
+			int ithread = omp_get_thread_num();                     //  Current thread
+			int begin = int(int64_t(n) * ithread / numThreads);     //  First body of this thread
+			int end = int(int64_t(n) * (ithread + 1) / numThreads); //  Last body of this thread
+			int count[8] = {0, 0, 0, 0, 0, 0, 0, 0};                //  Local octant counter
+			for (int i = begin; i < end; i++) {                     //  Loop over bodies of this thread
+				int j = permutation[i];                               //   Current body index
+				int octant = (Xj[j][2] > X[2]) * 4 + (Xj[j][1] > X[1]) * 2 + (Xj[j][0] > X[0]);// Octant of current body
+				count[octant]++;                                      //   Increment counter for current octant
+			}                                                       //  End loop over bodies of this thread
+			for (int i = 0; i < 8; i++) offset[ithread][i] = count[i];// Publish counters
+#pragma omp barrier
+#pragma omp single
+			{
+				int sum = 0;                                          //   Running offset
+				for (int i = 0; i < 8; i++) {                         //   Loop over octants
+					nbody[i] = 0;                                       //    Initialize nbody
+					for (int t = 0; t < numThreads; t++) {              //    Loop over threads in order (keeps reorder stable)
+						int c = offset[t][i];                             //     Bodies of thread t in octant i
+						offset[t][i] = sum;                               //     Offset of thread t in octant i
+						sum += c;                                         //     Increment running offset
+						nbody[i] += c;                                    //     Increment nbody
+					}                                                   //    End loop over threads
+				}                                                     //   End loop over octants
+			}                                                       //  End single (implicit barrier)
+			for (int i = 0; i < 8; i++) count[i] = offset[ithread][i];//  Start of this thread in each octant
+			for (int i = begin; i < end; i++) {                     //  Loop over bodies of this thread
+				int j = permutation[i];                               //   Current body index
+				int octant = (Xj[j][2] > X[2]) * 4 + (Xj[j][1] > X[1]) * 2 + (Xj[j][0] > X[0]);// Octant of current body
+				iwork[count[octant]++] = j;                           //   Put permutation index into temporary buffer
+			}                                                       //  End loop over bodies of this thread
+#pragma omp barrier
+#pragma omp for
+			for (int i = 0; i < n; i++) {                           //  Loop over bodies
+				permutation[i] = iwork[i];                            //   Copy back permutation array
+			}                                                       //  End loop over bodies
+		}                                                         // End parallel region
+	}
+#endif
+
 	//! Get Morton key
 	uint64_t getKey(ivec3 iX, int level) {
 		uint64_t index = ((1 << 3 * level) - 1) / 7;              // Level offset
@@ -87,10 +150,11 @@ private:
 		logger::startTimer("Grow tree");                          // Start timer
 		const int maxLevel = 30;                                  // Maximum levels in tree
 		const int numBodies = bodies.size();                      // Number of bodies
-		int nbody8[8];                                            // Number of bodies per octant
-		int * iwork = new int [numBodies];                        // Allocate temporary work array of integers
-		int * levelOffset = new int [maxLevel];                   // Allocate level offset array
-		vec3 * Xj = new vec3 [numBodies];                         // Allocate temporary coordinate array
+		int levelOffset[maxLevel + 2];                            // Level offset array
+		if (int(iwork.size()) < numBodies) iwork.resize(numBodies);// Enlarge work array if necessary
+		if (int(Xj.size()) < numBodies) Xj.resize(numBodies);     // Enlarge coordinate array if necessary
+		std::vector<std::array<int,8> > nbody8;                   // Number of bodies per octant for each cell in level
+		std::vector<int> childOffset;                             // Index of first child for each cell in level
 		nodes[0][0] = 0;                                          // Initialize level
 		nodes[0][1] = 0;                                          // Initialize ix
 		nodes[0][2] = 0;                                          // Initialize iy
@@ -102,6 +166,9 @@ private:
 		nodes[0][8] = numBodies;                                  // Initialize nbody
 		levelOffset[0] = 0;                                       // Offset for level 0
 		levelOffset[1] = 1;                                       // Offset for level 1
+#ifdef _OPENMP
+#pragma omp parallel for
+#endif
 		for (int i = 0; i < numBodies; i++) {                     // Loop over bodies
 			permutation[i] = i;                                     //  Copy index
 			Xj[i] = bodies[i].X;                                    //  Copy coordinates
@@ -109,46 +176,80 @@ private:
 		numCells = 1;                                             // Initialize number of cells
 		numLevels = 0;                                            // Initialize number of levels
 		for (int level = 0; level < maxLevel; level++) {          // Loop over levels
-			for (int iparent = levelOffset[level]; iparent < levelOffset[level + 1]; iparent++) { // Loop over cells in level
+			const int begin = levelOffset[level];                   //  First cell in level
+			const int numParents = levelOffset[level + 1] - begin;  //  Number of cells in level
+			nbody8.resize(numParents);                              //  Resize octant counters
+			childOffset.resize(numParents + 1);                     //  Resize child offsets
+#ifdef _OPENMP
+			if (numParents < omp_get_max_threads()) {               //  If there are fewer cells than threads
+				for (int i = 0; i < numParents; i++) {                //   Loop over cells in level
+					int iparent = begin + i;                            //    Index of current cell
+					int nbody = nodes[iparent][8];                      //    Number of bodies in current cell
+					nbody8[i].fill(0);                                  //    Initialize octant counters
+					if (nbody > ncrit) {                                //    If number of bodies is larger than threshold
+						int ibody = nodes[iparent][7];                    //     Index of first body in cell
+						reorderParallel(box, level, &nodes[iparent][1], Xj.data(), &permutation[ibody], nbody, &iwork[ibody], &nbody8[i][0]);// Sort bodies
+					}                                                   //    End if for number of bodies threshold
+				}                                                     //   End loop over cells in level
+			} else {                                                //  Else parallelize over cells
+#pragma omp parallel for schedule(dynamic)
+#endif
+			for (int i = 0; i < numParents; i++) {                  //  Loop over cells in level
+				int iparent = begin + i;                              //   Index of current cell
 				int nbody = nodes[iparent][8];                        //   Number of bodies in current cell
+				nbody8[i].fill(0);                                    //   Initialize octant counters
 				if (nbody > ncrit) {                                  //   If number of bodies is larger than threshold
 					int ibody = nodes[iparent][7];                      //    Index of first body in cell
-					reorder(box, level, &nodes[iparent][1], Xj, &permutation[ibody], nbody, iwork, nbody8);// Sort bodies
-					int nchild = 0;                                     //    Initialize number of child cells
-					int offset = ibody;                                 //    Initialize offset
-					nodes[iparent][5] = numCells;                       //    Store cell counter as ichild
-					for (int i = 0; i < 8; i++) {                       //    Loop over octants
-						if (nbody8[i] <= 0) continue;                     //     Don't create a cell for empty octant
-						nodes[numCells][0] = level + 1;                   //     Store level
-						nodes[numCells][1] = nodes[iparent][1] * 2 + i % 2;//    Store ix
-						nodes[numCells][2] = nodes[iparent][2] * 2 + (i / 2) % 2;// Store iy
-						nodes[numCells][3] = nodes[iparent][3] * 2 + i / 4;//    Store iz
-						nodes[numCells][4] = iparent;                     //     Store iparent
-						nodes[numCells][5] = 0;                           //     Initialize ichild
-						nodes[numCells][6] = 0;                           //     Initialize nchild
-						nodes[numCells][7] = offset;                      //     Store ibody
-						nodes[numCells][8] = nbody8[i];                   //     Store nbody
-						nchild++;                                         //     Increment number of child cells
-						offset += nbody8[i];                              //     Increment octant offset
-						numCells++;                                       //     Increment number of cells
-						numLevels = level + 1;                            //     Update number of levels
-					}                                                   //    End loop over octants
-					nodes[iparent][6] = nchild;                         //    Store nchild
+					reorder(box, level, &nodes[iparent][1], Xj.data(), &permutation[ibody], nbody, &iwork[ibody], &nbody8[i][0]);// Sort bodies
 				}                                                     //   End if for number of bodies threshold
 			}                                                       //  End loop over cells in level
+#ifdef _OPENMP
+			}                                                       //  End if for fewer cells than threads
+#endif
+			childOffset[0] = numCells;                              //  Children of this level start after current cells
+			for (int i = 0; i < numParents; i++) {                  //  Loop over cells in level
+				int nchild = 0;                                       //   Initialize number of child cells
+				for (int j = 0; j < 8; j++) nchild += nbody8[i][j] > 0;//  Count non-empty octants
+				childOffset[i + 1] = childOffset[i] + nchild;         //   Prefix sum of child counts
+			}                                                       //  End loop over cells in level
+#ifdef _OPENMP
+#pragma omp parallel for
+#endif
+			for (int i = 0; i < numParents; i++) {                  //  Loop over cells in level
+				int iparent = begin + i;                              //   Index of current cell
+				int nchild = childOffset[i + 1] - childOffset[i];     //   Number of child cells
+				if (nchild == 0) continue;                            //   Skip leaf cells
+				int ichild = childOffset[i];                          //   Index of first child cell
+				int offset = nodes[iparent][7];                       //   Initialize body offset
+				nodes[iparent][5] = ichild;                           //   Store ichild
+				nodes[iparent][6] = nchild;                           //   Store nchild
+				for (int j = 0; j < 8; j++) {                         //   Loop over octants
+					if (nbody8[i][j] <= 0) continue;                    //    Don't create a cell for empty octant
+					nodes[ichild][0] = level + 1;                       //    Store level
+					nodes[ichild][1] = nodes[iparent][1] * 2 + j % 2;   //    Store ix
+					nodes[ichild][2] = nodes[iparent][2] * 2 + (j / 2) % 2;// Store iy
+					nodes[ichild][3] = nodes[iparent][3] * 2 + j / 4;   //    Store iz
+					nodes[ichild][4] = iparent;                         //    Store iparent
+					nodes[ichild][5] = 0;                               //    Initialize ichild
+					nodes[ichild][6] = 0;                               //    Initialize nchild
+					nodes[ichild][7] = offset;                          //    Store ibody
+					nodes[ichild][8] = nbody8[i][j];                    //    Store nbody
+					offset += nbody8[i][j];                             //    Increment octant offset
+					ichild++;                                           //    Increment child index
+				}                                                     //   End loop over octants
+			}                                                       //  End loop over cells in level
+			if (childOffset[numParents] > numCells) numLevels = level + 1;// Update number of levels
+			numCells = childOffset[numParents];                     //  Update number of cells
 			levelOffset[level + 2] = numCells;                      //  Update level offset
 			if (levelOffset[level + 1] == levelOffset[level + 2]) break; //  If no cells were added then exit loop
 		}                                                         // End loop over levels
-		delete[] Xj;                                              // Deallocate temporary coordinate array
-		delete[] levelOffset;                                     // Deallocate level offset array
-		delete[] iwork;                                           // Deallocate temporary work array of integers
 		logger::stopTimer("Grow tree");                           // Stop timer
 	}
 
 	//! Convert nodes to cells
 	template<typename NodeType>
 	Cells linkTree(Bodies & bodies, Bodies & buffer, NodeType&& nodes, int numCells,
-	               int * permutation, Box box) {
+	               int * permutation, Box box, BodiesSoA * bodiesSoA) {
 		logger::startTimer("Link tree");                          // Start timer
 		int numBodies = bodies.size();                            // Number of bodies
 		Cells cells(numCells);                                    // Instantiate cells vector
@@ -165,6 +266,7 @@ private:
 			C->NCHILD  = nodes[i][6];                               //  Copy nchild
 			C->IBODY   = nodes[i][7];                               //  Copy ibody
 			C->NBODY   = nodes[i][8];                               //  Copy nbody
+			C->LEVEL   = level;                                     //  Copy level
 			real_t R = box.R / (1 << level);                        //  Cell radius
 			C->R = R;                                               //  Store cell radius
 			for (int d = 0; d < 3; d++) {                           //  Loop over dimensions
@@ -172,33 +274,37 @@ private:
 			}                                                       //  End loop over dimensions
 		}                                                         // End loop over cells
 		buffer.resize(numBodies);                                 // Resize buffer
+#ifdef _OPENMP
+#pragma omp parallel for
+#endif
 		for (int i = 0; i < numBodies; i++) {                     // Loop over bodies
 			buffer[i] = bodies[permutation[i]];                     //  Copy permuted bodies to buffer
 		}                                                         // End loop over bodies
 		bodies = buffer;                                          // Copy back to bodies
+		if (bodiesSoA) bodiesSoA->permute(permutation);           // Apply the same permutation to SoA bodies
 		B_iter B = bodies.begin();                                // Iterator of first body
 		for (C_iter C = cells.begin(); C != cells.end(); C++) {   // Loop over cells
 			C->BODY = B + C->IBODY;                                 //  Store iterator of first body in cell
 		}                                                         // End loop over cells
+		indexer.build(cells);                                     // Index cells by level and key
 		logger::stopTimer("Link tree");                           // Stop timer
 		return cells;                                             // Return cells
 	}
 
 public:
+	CellIndex indexer;                                          //!< Index from cell key to cell, per level
 	BuildTree(int _ncrit, int ) : ncrit(_ncrit) {}              // Constructor
 
-	//! Build tree structure
-	Cells buildTree(Bodies & bodies, Bodies & buffer, Bounds bounds) {
+	//! Build tree structure (bodiesSoA, if given, must hold the same bodies and is reordered with them)
+	Cells buildTree(Bodies & bodies, Bodies & buffer, Bounds bounds, BodiesSoA * bodiesSoA = NULL) {
 		int numCells;                                             // Number of cells
 		int numBodies = bodies.size();                            // Number of bodies
-		//int (* nodes)[10] = new int [numBodies][10]();            // Allocate nodes array
-		std::vector<std::array<int,10>> nodes(numBodies);
-		int * permutation = new int [numBodies];                  // Allocate permutation array
+		if (int(nodes.size()) < numBodies) nodes.resize(numBodies);// Enlarge nodes array if necessary
+		if (int(permutation.size()) < numBodies) permutation.resize(numBodies);// Enlarge permutation array if necessary
 		Box box = bounds2box(bounds);                             // Bounding box
-		growTree(bodies, nodes, numCells, permutation, numLevels, box);// Grow tree as link between node structures
-		Cells cells = linkTree(bodies, buffer, nodes, numCells, permutation, box);// Convert nodes to cells
-		delete[] permutation;                                     // Deallocate permutation array
-		//delete[] nodes;                                           // Deallocate nodes array
+		growTree(bodies, nodes, numCells, permutation.data(), numLevels, box);// Grow tree as link between node structures
+		Cells cells = linkTree(bodies, buffer, nodes, numCells, permutation.data(), box, bodiesSoA);// Convert nodes to cells
+		if (bodiesSoA) bodiesSoA->layout(cells);                  // Pad SoA bodies so that leaves start aligned
 		return cells;                                             // Return cells
 	}
 
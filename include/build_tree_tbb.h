@@ -1,9 +1,11 @@
 #ifndef build_tree_h
 #define build_tree_h
+#include <atomic>
 #include "logger.h"
+#include <mutex>
 #include "thread.h"
 #include "types.h"
-#include "cell_mutex.h"
+#include "cell_index.h"
 
 namespace exafmm {
 class BuildTree {
@@ -27,11 +29,57 @@ private:
     vec3         X;                                             //!< Coordinate at center
   };
 
+  //! Storage for octree nodes that is kept across builds
+  //! Nodes are handed out from fixed size blocks and are all released at once by reset()
+  class NodePool {
+  private:
+    static const int NODEBLOCK = 4096;                          //!< Number of nodes per block
+    static const int MAXBLOCK = 1 << 14;                        //!< Maximum number of blocks
+    std::vector<OctreeNode*> blocks;                            //!< Pointers to blocks, never reallocated
+    std::atomic<int> numBlocks;                                 //!< Number of allocated blocks
+    std::atomic<size_t> numNodes;                               //!< Number of nodes handed out since reset
+    std::mutex mutex;                                           //!< Serializes allocation of new blocks
+
+    //! Allocate blocks until there are n of them
+    void grow(int n) {
+      assert(n <= MAXBLOCK);                                    // Bounds checking for block count
+      std::lock_guard<std::mutex> lock(mutex);                  // Other tasks may be growing too
+      for (int b=numBlocks; b<n; b++) {                         // Loop over missing blocks
+        blocks[b] = new OctreeNode[NODEBLOCK];                  //  Allocate block
+        numBlocks = b + 1;                                      //  Publish block after it is set
+      }                                                         // End loop over missing blocks
+    }
+
+  public:
+    NodePool() : blocks(MAXBLOCK, NULL), numBlocks(0), numNodes(0) {}
+    ~NodePool() {
+      for (int b=0; b<numBlocks; b++) delete[] blocks[b];       // Free all blocks
+    }
+    //! Release all nodes; blocks are kept for the next build
+    void reset() {
+      numNodes = 0;
+    }
+    //! Make sure n nodes can be handed out without allocation
+    void reserve(size_t n) {
+      grow((n + NODEBLOCK - 1) / NODEBLOCK);
+    }
+    //! Hand out one node (thread safe)
+    OctreeNode * allocate() {
+      size_t i = numNodes++;                                    // Claim a slot
+      int b = i / NODEBLOCK;                                    // Block of slot
+      if (b >= numBlocks) grow(b + 1);                          // Allocate block if it is new
+      return blocks[b] + i % NODEBLOCK;                         // Pointer to slot
+    }
+  };
+
   const int    ncrit;                                           //!< Number of bodies per leaf cell
   const int    nspawn;                                          //!< Threshold of NBODY for spawning new threads
   int          maxlevel;                                        //!< Maximum level of tree
   B_iter       B0;                                              //!< Iterator of first body
   OctreeNode * N0;                                              //!< Pointer to octree root node
+  NodePool     pool;                                            //!< Storage of octree nodes
+  Bodies       bodyBuffer;                                      //!< Buffer for bodies, kept across builds
+  std::vector<BinaryTreeNode> binNodes;                         //!< Binary tree nodes, kept across builds
 
 private:
   //! Recursive functor for counting bodies in each octant using binary tree
@@ -120,6 +168,7 @@ private:
   //! Recursive functor for building nodes of an octree adaptively using a top-down approach
   struct BuildNodes {
     OctreeNode *& octNode;                                      //!< Reference to a double pointer of an octree node
+    NodePool & pool;                                            //!< Storage of octree nodes
     Bodies & bodies;                                            //!< Vector of bodies
     Bodies & buffer;                                            //!< Buffer for bodies
     int begin;                                                  //!< Body begin index
@@ -133,15 +182,15 @@ private:
     int level;                                                  //!< Current tree level
     bool direction;                                             //!< Direction of buffer copying
     //! Constructor
-    BuildNodes(OctreeNode *& _octNode, Bodies & _bodies,
+    BuildNodes(OctreeNode *& _octNode, NodePool & _pool, Bodies & _bodies,
 	       Bodies & _buffer, int _begin, int _end, BinaryTreeNode * _binNode,
 	       vec3 _X, real_t _R0, int _ncrit, int _nspawn, logger::Timer & _timer, int _level=0, bool _direction=false) :
-      octNode(_octNode), bodies(_bodies), buffer(_buffer),      // Initialize variables
+      octNode(_octNode), pool(_pool), bodies(_bodies), buffer(_buffer),// Initialize variables
       begin(_begin), end(_end), binNode(_binNode), X(_X), R0(_R0),
       ncrit(_ncrit), nspawn(_nspawn), timer(_timer), level(_level), direction(_direction) {}
     //! Create an octree node
     OctreeNode * makeOctNode(int begin, int end, vec3 X, bool nochild) const {
-      OctreeNode * octNode = new OctreeNode();                  // Allocate memory for single node
+      OctreeNode * octNode = pool.allocate();                   // Take a single node from the pool
       octNode->IBODY = begin;                                   // Index of first body in node
       octNode->NBODY = end - begin;                             // Number of bodies in node
       octNode->NNODE = 1;                                       // Initialize counter for decendant nodes
@@ -207,7 +256,7 @@ private:
       	binNodeChild[i].END = binNodeOffset + maxBinNode;       //    Keep track of last memory address
       	tic = logger::get_time();
       	timer["Get node range"] += tic - toc;
-      	BuildNodes buildNodes(octNode->CHILD[i], buffer, bodies,//    Instantiate recursive functor
+      	BuildNodes buildNodes(octNode->CHILD[i], pool, buffer, bodies,// Instantiate recursive functor
 			      octantOffset[i], octantOffset[i] + binNode->NBODY[i],
 			      &binNodeChild[i], Xchild, R0, ncrit, nspawn, timer, level+1, !direction);
       	create_taskc(buildNodes);                               //    Create new task for recursive call
@@ -249,14 +298,6 @@ private:
       }                                                         // End loop over levels
       return index;                                             // Return Morton key
     }
-    inline void insertCell(size_t level, uint64_t key, size_t index) {
-    lock_mutex
-      if(indexer.find(level) == indexer.end()){
-        indexer.emplace(level,TreeLevelMap());
-      }
-      indexer[level][key] = index;
-    unlock_mutex
-    }
     void operator() () {                                        // Overload operator()
       C->IPARENT = iparent;                                     //  Index of parent cell
       C->R       = R0 / (1 << level);                           //  Cell radius
@@ -268,7 +309,6 @@ private:
       C->ICELL   = getKey(C->X, X0-R0, 2*C->R, level);          //  Get Morton key
       C->WEIGHT  =  0;                                          // Initialize weigh to 0
       C->LEVEL   = level;
-      insertCell(level,C->ICELL, C-C0);
       if (octNode->NNODE == 1) {                                //  If node has no children
       	C->ICHILD = 0;                                          //   Set index of first child cell to zero
       	C->NCHILD = 0;                                          //   Number of child cells
@@ -299,10 +339,6 @@ private:
       	  CN += octNode->CHILD[octant]->NNODE - 1;              //    Increment next free memory address
       	}                                                       //   End loop over children
       	wait_tasks;                                             //   Synchronize tasks
-      	for (int i=0; i<nchild; i++) {                          //   Loop over children
-      	  int octant = octants[i];                              //    Get octant from child index
-      	  delete octNode->CHILD[octant];                        //    Free child pointer to avoid memory leak
-      	}                                                       //   End loop over children
       	maxlevel = std::max(maxlevel, level+1);                 //   Update maximum level of tree
       }                                                         //  End if for child existance
     }                                                           // End overload operator()
@@ -328,15 +364,17 @@ private:
     assert(box.R > 0);                                          // Check for bounds validity
     logger::startTimer("Grow tree");                            // Start timer
     B0 = bodies.begin();                                        // Bodies iterator
+    pool.reset();                                               // Nodes of the previous tree are no longer used
+    pool.reserve(2 * bodies.size() / ncrit + 1);                // Expected number of nodes
     BinaryTreeNode binNode[1];                                  // Allocate root node of binary tree
-    int maxBinNode = (4 * bodies.size()) / nspawn;              // Get maximum size of binary tree
-    binNode->BEGIN = new BinaryTreeNode[maxBinNode];            // Allocate array for binary tree nodes
+    size_t maxBinNode = (4 * bodies.size()) / nspawn;           // Get maximum size of binary tree
+    if (binNodes.size() < maxBinNode + 1) binNodes.resize(maxBinNode + 1);// Enlarge binary tree array if necessary
+    binNode->BEGIN = &binNodes[0];                              // First binary tree node
     binNode->END = binNode->BEGIN + maxBinNode;                 // Set end pointer
     logger::Timer timer;
-    BuildNodes buildNodes(N0, bodies, buffer, 0, bodies.size(),
+    BuildNodes buildNodes(N0, pool, bodies, buffer, 0, bodies.size(),
 			  binNode, box.X, box.R, ncrit, nspawn, timer);// Instantiate recursive functor
     buildNodes();                                               // Recursively build octree nodes
-    delete[] binNode->BEGIN;                                    // Deallocate binary tree array
 #if 0
     logger::printTitle("Grow tree");
     std::cout << std::setw(logger::stringLength) << std::left
@@ -366,14 +404,14 @@ private:
       C_iter C0 = cells.begin();                                //  Cell begin iterator
       Nodes2cells nodes2cells(N0, B0, C0, C0, C0+1, box.X, box.R, nspawn, maxlevel);// Instantiate recursive functor
       nodes2cells();                                            //  Convert nodes to cells recursively
-      delete N0;                                                //  Deallocate nodes
     }                                                           // End if for empty node tree
+    indexer.build(cells);                                       // Index cells by level and key
     logger::stopTimer("Link tree");                             // Stop timer
     return cells;                                               // Return cells array
   }
 
 public:
-  static TreeType indexer;
+  CellIndex indexer;                                            //!< Index from cell key to cell, per level
   BuildTree(int _ncrit, int _nspawn) : ncrit(_ncrit), nspawn(_nspawn), maxlevel(0) {}
 
   //! Build tree structure top down
@@ -391,8 +429,7 @@ public:
   //! Build tree structure top down
   Cells operator() (Bodies & bodies, Bounds bounds) {   
     logger::startTimer("Local Morton Tree"); 
-    Bodies buffer(bodies.size());
-    auto&& cells = buildTree(bodies,buffer,bounds);
+    auto&& cells = buildTree(bodies,bodyBuffer,bounds);         // Buffer is enlarged only when bodies grow
     logger::stopTimer("Local Morton Tree"); 
     return cells;
   }
@@ -410,7 +447,5 @@ public:
     }                                                           // End if for verbose flag
   }
 };
-
-TreeType BuildTree::indexer = TreeType();
 }
 #endif
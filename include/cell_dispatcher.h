@@ -1,11 +1,14 @@
 #ifndef CELL_DISPATCHER
 #define CELL_DISPATCHER
+#include <atomic>
 #include <chrono>
 #include <thread>
 #include "logger.h"
 #include "cell_mutex.h"
 #include "lightweight_vector.h"
-#define INTERNAL_THREADING 0
+#ifndef INTERNAL_THREADING
+#define INTERNAL_THREADING 0                                    // Set to 1 to serve requests on a progress thread
+#endif
 template <typename CellVec, typename HOT>
 class DispatcherWrapper  {
 
@@ -13,31 +16,70 @@ class DispatcherWrapper  {
     typedef typename CellVec::const_iterator iter_type;
     int rank;
     int size;
-    TaskTrigger trigger;
     CellVec const& cells;
+    const vecP * M;                                             // Multipoles of the cells, indexed like cells
     HOT const& hot; 
-    uint64_t timeout;
-    int terminated;
+    MPI_Comm comm;                                              // Requests arrive here, replies go to MPI_COMM_WORLD
     iter_type begin;
     size_t hitCount; 
-    size_t index;
-    lightweight_vector<Multipole> sendingBuffer;     
+    SendQueue<int> batchSends;
+    SendQueue<int> replySends;                                  // Packed replies to single-key requests
+
+    //! Append the header of one requested cell to a BATCHTAG reply, and its packed children or bodies to the matching part
+    void appendBatchEntry(std::vector<int>& headers, std::vector<int>& children, std::vector<int>& bodies,
+                          uint64_t key, int level, int type) {
+      BatchHeader header;
+      header.type = type;
+      header.level = level;
+      header.key = key;
+      header.count = 0;
+      header.pad = 0;
+      auto&& location = hot.find(level, key);
+      if(location != HOT::npos) {
+        auto&& cell = cells[location];
+        if(type == CHILDCELLTAG && cell.NCHILD > 0) {
+          header.count = cell.NCHILD;
+          packCells(children, begin + cell.ICHILD, M + cell.ICHILD, header.count);
+        } else if(type == BODYTAG && cell.NBODY > 0) {
+          header.count = cell.NBODY;
+          packBodies(bodies, cell.BODY, header.count);
+        }
+      }
+      const int* head = (const int*)&header;
+      headers.insert(headers.end(), head, head + BATCHHEADERWORD);
+    }
 
   public:    
-    CellDispatcher(int _rank, int _size, TaskTrigger _taskRunning, CellVec const& _cells, HOT const& _hot, uint64_t _timeout)
-      :rank(_rank),size(_size),trigger(_taskRunning),cells(_cells),hot(_hot), timeout(_timeout), terminated(0), begin(_cells.begin()), hitCount(0),index(0){ }    
+    CellDispatcher(int _rank, int _size, CellVec const& _cells, const Expansions& _M, HOT const& _hot, MPI_Comm _comm)
+      :rank(_rank),size(_size),cells(_cells),M(&_M[0]),hot(_hot),comm(_comm),begin(_cells.begin()), hitCount(0){ }    
     
-    void operator()() {     
-      int ready; 
+    //! Serve one pending request if there is any
+    bool serve() {
+      int ready = 0;
       MPI_Status status;      
-      while(GETTRIG(trigger) && terminated < (size - 1)) { 
-        ready = 0;
-        MPI_Iprobe(MPI_ANY_SOURCE,MPI_ANY_TAG,MPI_COMM_WORLD,&ready,&status); 
-        if(ready) {
-          tryReceive(status.MPI_TAG, status.MPI_SOURCE);          
-        }
+      MPI_Iprobe(MPI_ANY_SOURCE,MPI_ANY_TAG,comm,&ready,&status); 
+      if(ready) tryReceive(status.MPI_TAG, status.MPI_SOURCE);          
+      return ready;
+    }
+
+    //! Serve requests until the barrier request completes, then wait for the replies to be delivered
+    void serveUntil(MPI_Request& barrier) {
+      int done = 0;
+      while(!done) {
+        serve();
+        MPI_Test(&barrier,&done,MPI_STATUS_IGNORE);
       }
-      logger::logFixed("hit count", hitCount, std::cout);      
+      flush();
+    }
+
+    //! Wait for all replies in flight
+    void flush() {
+      batchSends.wait();
+      replySends.wait();
+    }
+
+    size_t get_hit_count() const {
+      return hitCount;
     }
 
     inline bool tryReceive(int tag, int source) {
@@ -51,68 +93,72 @@ class DispatcherWrapper  {
       char null; 
       if (msgType==CELLTAG || msgType==CHILDCELLTAG || msgType==BODYTAG) { 
         int level = getMessageLevel(tag);
-        MPI_Recv(&recvBuff,1,MPI_UNSIGNED_LONG_LONG, source, tag, MPI_COMM_WORLD,MPI_STATUS_IGNORE);  
+        MPI_Recv(&recvBuff,1,MPI_UNSIGNED_LONG_LONG, source, tag, comm,MPI_STATUS_IGNORE);  
         TOGGLEDIRECTION(tag)
-        auto&& levelData = hot.at(level);
-        auto&& end       = levelData.end();
-        auto&& location  = levelData.find(recvBuff);
-        if(location != end) {
-          auto&& cell = cells[location->second];
+        auto&& location  = hot.find(level, recvBuff);
+        std::vector<int> reply;                                 // Kept alive by replySends until delivered
+        if(location != HOT::npos) {
+          auto&& cell = cells[location];
           if(msgType == CELLTAG) {
-#if SEND_MULTIPOLES
-            Multipole multipole = cell;
-            MPI_Isend(&multipole,MULTIPOLEWORD,MPI_INT,source,tag,MPI_COMM_WORLD,&request);      
-#else 
-            MPI_Isend(&cell,CELLWORD,MPI_INT,source,tag,MPI_COMM_WORLD,&request);
-#endif                          
-            return true;                               
+            beginWire(reply);
+            packCells(reply, &cell, M + location, 1);
           } else if (msgType == CHILDCELLTAG && cell.NCHILD > 0) {
-            auto grainSize = getGrainSize(tag);
+            beginWire(reply);
 #if SEND_MULTIPOLES
+            auto grainSize = getGrainSize(tag);
+            Multipoles subtree;
             size_t sendingSize = 0;
-            updateChildMultipoles(sendingBuffer,begin, cell,grainSize,sendingSize);            
-            MPI_Isend(&sendingBuffer[index],  MULTIPOLEWORD*sendingSize,MPI_INT,source,tag,MPI_COMM_WORLD,&request);
-            index += sendingSize;            
-            // assuming MPI will deallocate sendingBuffer[0]
-            //delete[] sendingBuffer;
+            updateChildMultipoles(subtree,begin,M,cell,grainSize,sendingSize);
+            for(size_t i = 0; i < sendingSize; ++i)
+              packCells(reply, subtree.begin() + i, &subtree[i].M, 1);
 #else
-            MPI_Isend(&cells[cell.ICHILD],      CELLWORD*cell.NCHILD,MPI_INT,source,tag,MPI_COMM_WORLD,&request);            
+            packCells(reply, begin + cell.ICHILD, M + cell.ICHILD, cell.NCHILD);
 #endif             
-            return true;
           } else if(msgType == BODYTAG && cell.NBODY > 0) {
-            MPI_Isend(&(*cell.BODY), BODYWORD*cell.NBODY,MPI_INT,source,tag,MPI_COMM_WORLD,&request);
-          } else {
-            MPI_Isend(&null,1,MPI_CHAR,source,nullTag,MPI_COMM_WORLD,&request);
+            beginWire(reply);
+            packBodies(reply, cell.BODY, cell.NBODY);
           }
-        } else {              
-          MPI_Isend(&null,1,MPI_CHAR,source,nullTag,MPI_COMM_WORLD,&request);                          
         }
+        if(reply.empty()) {
+          MPI_Isend(&null,1,MPI_CHAR,source,nullTag,MPI_COMM_WORLD,&request);
+          MPI_Request_free(&request);
+          return false;
+        }
+        replySends.isend(reply, MPI_INT, source, tag);
+        return true;
       }
       else if(msgType == LEVELTAG) {
         int level = (tag >> DIRECTIONSHIFT) & LEVELMASK;
-        MPI_Recv(&recvBuff,1,MPI_UNSIGNED_LONG_LONG, source, tag, MPI_COMM_WORLD,MPI_STATUS_IGNORE);
+        MPI_Recv(&recvBuff,1,MPI_UNSIGNED_LONG_LONG, source, tag, comm,MPI_STATUS_IGNORE);
         TOGGLEDIRECTION(tag) 
-        auto&& levelData = hot.at(level);
-        auto&& dataSize = levelData.size();
-#if SEND_MULTIPOLES
-        Multipoles sendCells;
-#else 
-        Cells sendCells;
-#endif  
-        sendCells.reserve(dataSize);      
+        auto&& dataSize = hot.size(level);
         assert(dataSize > 0);        
-        for(auto&& pairData: levelData) 
-          sendCells.push_back(cells[pairData.second]);            
-#if SEND_MULTIPOLES
-        MPI_Isend(RAWPTR(sendCells), MULTIPOLEWORD*dataSize,MPI_INT,source,tag,MPI_COMM_WORLD,&request);
-#else 
-        MPI_Isend(RAWPTR(sendCells),      CELLWORD*dataSize,MPI_INT,source,tag,MPI_COMM_WORLD,&request);
-#endif        
+        std::vector<int> sendCells;                             // Kept alive by replySends until delivered
+        beginWire(sendCells);
+        for(size_t i = 0; i < dataSize; ++i)
+          packCells(sendCells, begin + hot.at(level, i), M + hot.at(level, i), 1);
+        replySends.isend(sendCells, MPI_INT, source, tag);
         return true;                     
       }
-      else if(msgType == FLUSHTAG) {
-        MPI_Recv(&null,1,MPI_CHAR, source, tag, MPI_COMM_WORLD,MPI_STATUS_IGNORE);
-        terminated++;
+      else if(msgType == BATCHTAG) {
+        MPI_Status status;
+        int count;
+        MPI_Probe(source, tag, comm, &status);
+        MPI_Get_count(&status, MPI_UNSIGNED_LONG_LONG, &count);
+        std::vector<uint64_t> keys(count);
+        MPI_Recv(RAWPTR(keys), count, MPI_UNSIGNED_LONG_LONG, source, tag, comm, MPI_STATUS_IGNORE);
+        TOGGLEDIRECTION(tag)
+        std::vector<int> headers, children, bodies;
+        beginWire(children);
+        beginWire(bodies);
+        for(int i = 0; i < count; i += 3)                      // (key, level, type) per requested cell
+          appendBatchEntry(headers, children, bodies, keys[i], keys[i+1], keys[i+2]);
+        batchSends.isend(headers, MPI_INT, source, tag);        // Headers first, they give the size of the parts
+        if(wireCount(children.data()) > 0)
+          batchSends.isend(children, MPI_INT, source, encryptMessage(1,BATCHTAG,BATCHCELLPART,RECEIVEBIT));
+        if(wireCount(bodies.data()) > 0)
+          batchSends.isend(bodies, MPI_INT, source, encryptMessage(1,BATCHTAG,BATCHBODYPART,RECEIVEBIT));
+        return true;
       }
       return false;
     }
@@ -120,86 +166,72 @@ class DispatcherWrapper  {
     int get_rank() const {
       return rank;
     }
+
+    MPI_Comm get_comm() const {
+      return comm;
+    }
   };
 
+  //! Start the progress thread if the build and the MPI library support it
+  void startThread() {
+#if INTERNAL_THREADING
+    int provided;
+    MPI_Query_thread(&provided);
+    if(provided == MPI_THREAD_MULTIPLE) {
+      running = true;
+      thread = std::thread([this]() {
+        while(running) {
+          if(!dispatcher.serve()) std::this_thread::yield();
+        }
+      });
+      threaded = true;
+    } else if(dispatcher.get_rank() == 0) {
+      std::cerr << "MPI_THREAD_MULTIPLE is not provided, serving requests from the traversal" << std::endl;
+    }
+#endif
+  }
+
 public:
-  TaskTrigger taskTrigger;
   CellDispatcher dispatcher;
-  bool taskCreated;
-#if INTERNAL_THREADING  
+  bool threaded;                                                // Requests are served by the progress thread
+  bool finished;
+#if INTERNAL_THREADING
   std::thread thread;
+  std::atomic<bool> running;
 #endif
-  bool taskKilled;
-  DispatcherWrapper(int _rank, int _size, CellVec const& _cells, HOT const& _hot)
-      :taskTrigger(NEWTRIGGER),dispatcher(_rank,_size,taskTrigger,_cells,_hot,TIMEOUT)
-      ,taskCreated(false), taskKilled(false){ 
-      }
+  DispatcherWrapper(int _rank, int _size, CellVec const& _cells, const Expansions& _M, HOT const& _hot, MPI_Comm _comm)
+      :dispatcher(_rank,_size,_cells,_M,_hot,_comm),threaded(false),finished(false) {
+    startThread();
+  }
 
   ~DispatcherWrapper() {
-    stopDispatcher();
+    finishDispatcher();
   }
 
-  void stopDispatcher(){
-    if(!taskKilled) { 
-      MPI_Barrier(MPI_COMM_WORLD);
-      DELTRIGGER(taskTrigger);      
-#if INTERNAL_THREADING      
-      thread.join();
-#endif      
-      taskKilled = true;
-    }
+  //! Serve one incoming request from the caller's thread (no-op when the progress thread serves them)
+  void processIncomingMessage() {
+    if(!threaded) dispatcher.serve();
   }
 
-  void waitDispatcher(){
-#if INTERNAL_THREADING      
-    if(!taskKilled) {
+  //! Termination: each rank enters a non-blocking barrier once it needs no more remote data,
+  //! and keeps serving requests until every rank has entered it
+  void finishDispatcher() {
+    if(finished) return;
+    MPI_Comm comm = dispatcher.get_comm();
+    MPI_Request barrier;
+    MPI_Ibarrier(comm, &barrier);
+    if(threaded) {
+#if INTERNAL_THREADING
+      MPI_Wait(&barrier, MPI_STATUS_IGNORE);
+      running = false;
       thread.join();
-      taskKilled = true;
-    }
-#endif  
-  }
-
-  void processIncomingMessage(int tag, int source) {
-    dispatcher.tryReceive(tag,source);
-  }
-
-  void callDispatcher() {
-    taskCreated = true;
-    TRIGGER(taskTrigger); 
-    dispatcher();
-    taskCreated = false;
-  }
-
-  void untriggerDispatcher() {
-    UNTRIGGER(taskTrigger);
-  }
-
-  void startDispatcher() {
-    if(!taskCreated) {  //remove when multiple threads supported 
-      TRIGGER(taskTrigger); 
-#if INTERNAL_THREADING      
-      thread = std::thread(dispatcher);
-#else       
-      dispatcher();
+      dispatcher.flush();
 #endif
-      taskCreated = true;                         
+    } else {
+      dispatcher.serveUntil(barrier);
     }
-  }
-  void finalizeDispatcher() {
-    #if INTERNAL_THREADING
-      UNTRIGGER(taskTrigger);
-      try {
-        thread.join();
-        std::cout<<"joined successfully"<<std::endl;
-      }
-      catch(...)
-      {
-
-      }
-      TRIGGER(taskTrigger); 
-      dispatcher();
-      MPI_Barrier(MPI_COMM_WORLD);
-    #endif
+    logger::logFixed("hit count", dispatcher.get_hit_count(), std::cout);
+    finished = true;
   }
 };
 
@@ -0,0 +1,112 @@
+#ifndef cell_index_h
+#define cell_index_h
+#include <algorithm>
+#include <utility>
+#include <vector>
+#include "types.h"
+
+namespace exafmm {
+  //! Per-level index from cell key (ICELL) to position in the cell vector
+  //! Keys of each level are stored sorted in Eytzinger (BFS) layout and searched without branches
+  class CellIndex {
+  public:
+    static const size_t npos = size_t(-1);                      //!< Returned when a key is not found
+    typedef std::pair<uint64_t,size_t> KeyIndex;                //!< Pair of key and cell index
+
+  private:
+    std::vector<std::vector<uint64_t> > keys;                   //!< Keys per level in Eytzinger order (1-based)
+    std::vector<std::vector<size_t> > index;                    //!< Cell index per level, same order as keys
+
+    //! Copy sorted pairs into Eytzinger order by in-order traversal of the implicit tree
+    size_t eytzinger(const std::vector<KeyIndex> & sorted, std::vector<uint64_t> & key,
+                     std::vector<size_t> & value, size_t i, size_t k) {
+      if (k < key.size()) {                                     // If node exists
+        i = eytzinger(sorted, key, value, i, 2 * k);            //  Fill left subtree
+        key[k] = sorted[i].first;                               //  Store key
+        value[k] = sorted[i].second;                            //  Store cell index
+        i = eytzinger(sorted, key, value, i + 1, 2 * k + 1);    //  Fill right subtree
+      }                                                         // End if for node
+      return i;                                                 // Return next sorted position
+    }
+
+  public:
+    CellIndex() {}                                              //!< Empty index
+    CellIndex(const Cells & cells) {                            //!< Build index for cells
+      build(cells);
+    }
+
+    //! Build the index for all cells in bulk (uses Cell::LEVEL and Cell::ICELL)
+    void build(const Cells & cells) {
+      int numLevels = 0;                                        // Number of levels
+      for (size_t i=0; i<cells.size(); i++) {                   // Loop over cells
+        numLevels = std::max(numLevels, cells[i].LEVEL + 1);    //  Update number of levels
+      }                                                         // End loop over cells
+      std::vector<std::vector<KeyIndex> > sorted(numLevels);    // Key and index pairs per level
+      for (size_t i=0; i<cells.size(); i++) {                   // Loop over cells
+        sorted[cells[i].LEVEL].push_back(KeyIndex(cells[i].ICELL, i));// Append to its level
+      }                                                         // End loop over cells
+      resize(numLevels);                                        // Reset all levels
+      for (int l=0; l<numLevels; l++) {                         // Loop over levels
+        setLevel(l, sorted[l]);                                 //  Index cells of level
+      }                                                         // End loop over levels
+    }
+
+    //! Reset the index to numLevels empty levels
+    void resize(int numLevels) {
+      keys.assign(numLevels, std::vector<uint64_t>(1, 0));      // Slot 0 is unused
+      index.assign(numLevels, std::vector<size_t>(1, npos));    // Returned when search falls off the tree
+    }
+
+    //! Index the cells of one level from their key and cell index pairs; pairs are sorted here unless they already are
+    void setLevel(int level, std::vector<KeyIndex> & pairs) {
+      if (level >= numLevels()) {                               // If level is past the last one
+        keys.resize(level + 1, std::vector<uint64_t>(1, 0));    //  Append levels
+        index.resize(level + 1, std::vector<size_t>(1, npos));
+      }                                                         // End if for new level
+      if (!std::is_sorted(pairs.begin(), pairs.end()))          // If pairs are not in key order
+        std::sort(pairs.begin(), pairs.end());                  //  Sort pairs by key
+      keys[level].resize(pairs.size() + 1);                     // Slot 0 is unused
+      index[level].resize(pairs.size() + 1);                    // Slot 0 is unused
+      eytzinger(pairs, keys[level], index[level], 0, 1);        // Lay out in Eytzinger order
+    }
+
+    //! Number of levels
+    int numLevels() const {
+      return keys.size();
+    }
+
+    //! Number of cells in level
+    size_t size(int level) const {
+      if (level < 0 || level >= int(keys.size())) return 0;     // No cells outside of tree
+      return keys[level].size() - 1;                            // Exclude unused slot
+    }
+
+    //! Cell index of the i-th cell in level (in index order)
+    size_t at(int level, size_t i) const {
+      return index[level][i + 1];                               // Skip unused slot
+    }
+
+    //! Find the cell index of key in level, or npos
+    size_t find(int level, uint64_t key) const {
+      if (level < 0 || level >= int(keys.size())) return npos;  // No cells outside of tree
+      const uint64_t * K = &keys[level][0];                     // Keys of this level
+      const size_t n = keys[level].size();                      // Number of slots
+      size_t k = 1;                                             // Start from root
+      while (k < n) {                                           // Descend until leaving the tree
+#if __GNUC__
+        __builtin_prefetch(K + 8 * k);                          //  Prefetch great-great-grandchildren
+#endif
+        k = 2 * k + (K[k] < key);                               //  Go right if key is larger
+      }                                                         // End while loop
+#if __GNUC__
+      k >>= __builtin_ctzll(~k) + 1;                            // Undo the right turns and the last left turn
+#else
+      while (k & 1) k >>= 1;                                    // Undo the right turns
+      k >>= 1;                                                  // Undo the last left turn
+#endif
+      if (k != 0 && K[k] == key) return index[level][k];        // Found lower bound equal to key
+      return npos;                                              // Key is not in level
+    }
+  };
+}
+#endif
@@ -2,9 +2,11 @@
 #define CELL_MUTEX
 #include "base_mpi.h"
 #include "minicircle.h"
+#include "wire_format.h"
 #include <mutex>
 #include <iostream>
 #include <queue>
+#include <list>
 using namespace exafmm;
 
 #define NULLTAG 1
@@ -15,7 +17,9 @@ using namespace exafmm;
 #define PARTICLETAG 6
 #define LEVELTAG 7
 #define BODYTAG 8
-#define FLUSHTAG 9
+#define BATCHTAG 10
+#define BATCHCELLPART 1                                         // Level field of the reply part carrying cells
+#define BATCHBODYPART 2                                         // Level field of the reply part carrying bodies
 #define MAXTAG  15
 
 #define LEVELSHIFT 5
@@ -115,6 +119,56 @@ public:
 };
 size_t CellCounter::cellQueue = 0;
 
+//! Non-blocking sends whose buffers are kept alive until the sends complete
+template <typename T>
+class SendQueue {
+	struct Send {
+		MPI_Request request;
+		std::vector<T> buffer;
+	};
+	std::list<Send> sends;
+public:
+	//! Start sending buffer (its contents are taken over, buffer is left empty)
+	void isend(std::vector<T>& buffer, MPI_Datatype type, int rank, int tag, MPI_Comm comm = MPI_COMM_WORLD) {
+		test();
+		sends.push_back(Send());
+		Send& send = sends.back();
+		send.buffer.swap(buffer);
+		MPI_Isend(send.buffer.data(), send.buffer.size(), type, rank, tag, comm, &send.request);
+	}
+
+	//! Release the buffers of completed sends
+	void test() {
+		for (auto it = sends.begin(); it != sends.end();) {
+			int done = 0;
+			MPI_Test(&it->request, &done, MPI_STATUS_IGNORE);
+			if (done) it = sends.erase(it);
+			else ++it;
+		}
+	}
+
+	//! Wait for all sends to complete
+	void wait() {
+		for (auto it = sends.begin(); it != sends.end(); ++it)
+			MPI_Wait(&it->request, MPI_STATUS_IGNORE);
+		sends.clear();
+	}
+
+	size_t size() const {
+		return sends.size();
+	}
+};
+
+//! Header of one entry in a BATCHTAG reply; the count cells or bodies follow, packed, in the cell or body part
+struct BatchHeader {
+	int type;
+	int level;
+	uint64_t key;
+	int count;
+	int pad;
+};
+const int BATCHHEADERWORD = sizeof(BatchHeader) / 4;
+
 
 
 
@@ -122,13 +176,13 @@ size_t CellCounter::cellQueue = 0;
 #if SEND_MULTIPOLES
 
 template <typename CellVec>
-inline Multipoles getMultipoles(CellVec const& cells) {
+inline Multipoles getMultipoles(CellVec const& cells, Expansions const& M) {
 	size_t const& size = cells.size();
 	Multipoles multipoles(size);
 	for (size_t i = 0; i < size; ++i)
 	{
 		multipoles[i].X 		= cells[i].X;
-		multipoles[i].M 		= cells[i].M;
+		multipoles[i].M 		= M[i];
 		multipoles[i].ICELL = cells[i].ICELL;
 		multipoles[i].NCHILD = cells[i].NCHILD;
 		multipoles[i].R = cells[i].R;
@@ -141,14 +195,14 @@ inline Multipoles getMultipoles(CellVec const& cells) {
 }
 
 template <typename Iter>
-inline Multipoles getMultipoles(Iter const& begin, Iter const& end) {
+inline Multipoles getMultipoles(Iter const& begin, Iter const& end, const vecP * M) {
 	size_t const& size = end - begin; 
 	assert(size > 0);
 	Multipoles multipoles(size);
 	for (size_t i = 0; i < size; ++i) {	
 		auto&& current =  begin + i;
 		multipoles[i].X 		= current->X;
-		multipoles[i].M 		= current->M;
+		multipoles[i].M 		= M[i];
 		multipoles[i].ICELL = current->ICELL;
 		multipoles[i].NCHILD = current->NCHILD;
 		multipoles[i].R = current->R;
@@ -160,7 +214,7 @@ inline Multipoles getMultipoles(Iter const& begin, Iter const& end) {
 }
 #if DFS
 template <typename VecType, typename Iter, typename GrainType>
-inline void updateChildMultipoles(VecType& multipoles, Iter const& C0, Cell const& C, GrainType const& grainSize, size_t& index) {
+inline void updateChildMultipoles(VecType& multipoles, Iter const& C0, const vecP * M, Cell const& C, GrainType const& grainSize, size_t& index) {
 	auto&& begin = C0 + C.ICHILD;
   auto&& end   = C0 + C.ICHILD + C.NCHILD;
   typedef typename VecType::value_type val_type;
@@ -169,7 +223,7 @@ inline void updateChildMultipoles(VecType& multipoles, Iter const& C0, Cell cons
 		auto&& current =  begin + i;
 		val_type m;
 		m.X 		= current->X;
-		m.M 		= current->M;
+		m.M 		= M[current - C0];
 		m.ICELL = current->ICELL;
 		m.NCHILD = current->NCHILD;
 		m.R = current->R;				
@@ -180,27 +234,28 @@ inline void updateChildMultipoles(VecType& multipoles, Iter const& C0, Cell cons
 		index++;
 	}	
 	for(auto&& cc = begin; cc<end; ++cc) 
-		if(index < grainSize) updateChildMultipoles(multipoles,C0,*cc,grainSize,index);				
+		if(index < grainSize) updateChildMultipoles(multipoles,C0,M,*cc,grainSize,index);				
 }
 #else
 template <typename VecType, typename Iter, typename GrainType>
-inline void updateChildMultipoles(VecType& multipoles, Iter const& C0, Cell const& root, GrainType const& grainSize, size_t& index) {		
-	std::queue<Cell> cell_queue;
+inline void updateChildMultipoles(VecType& multipoles, Iter const& C0, const vecP * M, Cell const& root, GrainType const& grainSize, size_t& index) {		
+	std::queue<std::pair<Cell,size_t>> cell_queue;                // Copy of cell with its index in C0
 	auto begin = C0 + root.ICHILD;  
 	auto size = root.NCHILD;
 	for (size_t i = 0; i < size; ++i) {							
 	  auto&& current =  begin + i;	  
-		cell_queue.push(*current);				
+		cell_queue.push(std::make_pair(*current, size_t(current - C0)));
 	}	
 	typedef typename VecType::value_type val_type;
 	while(cell_queue.size() > 0) {
-		auto C = cell_queue.front();
+		auto C = cell_queue.front().first;
+		auto icell = cell_queue.front().second;
 		cell_queue.pop();
 		begin = C0 + C.ICHILD;  	
 		size = C.NCHILD;		
 		val_type m;
 		m.X 		= C.X;
-		m.M 		= C.M;
+		m.M 		= M[icell];
 		m.ICELL = C.ICELL;
 		m.NCHILD = C.NCHILD;
 		m.R = C.R;				
@@ -214,8 +269,8 @@ inline void updateChildMultipoles(VecType& multipoles, Iter const& C0, Cell cons
 		if(index < grainSize) {
 			for (size_t i = 0; i < size; ++i) {							
 			  auto&& current =  begin + i;			  
-				cell_queue.push(*current);	
-				cell_queue.back().IPARENT = m.ICHILD;	
+				cell_queue.push(std::make_pair(*current, size_t(current - C0)));
+				cell_queue.back().first.IPARENT = m.ICHILD;	
 			}	
 		}
 	}	
@@ -1,7 +1,12 @@
 #ifndef HILBERT_WRAPPER
 #define HILBERT_WRAPPER
 
+#include <algorithm>
+#include <array>
 #include <unordered_set>
+#if defined(__BMI2__)
+#include <immintrin.h>
+#endif
 #include "hilbert.h"
 #include "logger.h"
 #include "types.h"
@@ -10,7 +15,7 @@ using namespace exafmm;
 #define cast_uint32(V)               static_cast<uint32_t>(V)
 #define COUNT_COLLISIONS 0	
 #define DIM 3
-#define ACCURACY 10000							  							// multiplier to maintain accuracy 		
+#define MAXORDER 21                                             // bits per dimension, 3 x 21 bits fit in a 64-bit key
 
 
 //! Output one 64-bit Hilbert order from the 3D transposed key as per Skilling's paper
@@ -46,28 +51,78 @@ inline bool isNeighbor(hilbert_t const& key1, hilbert_t const& key2, int order,
 	auto&& arr1 = unflattenKey<hilbert_arr>(key1,order);
 	auto&& arr2 = unflattenKey<hilbert_arr>(key2,order);
 	for (int i = 0; i < DIM; ++i)
-		if (std::abs(arr1[i] - arr2[i]) > distance)
+		if (std::abs(int64_t(arr1[i]) - int64_t(arr2[i])) > distance)
 			return false;
 	//std::cout << key1 << " and " << key2 << " were detected as neigbors" << std::endl;
 	return true;
 }
 
-//! Next power of 2 such that 2^p > val
-template<typename T>
-uint32_t nextPow2(T&& val) {
-	return uint32_t(ceil(log(val)/log(2)));
+//! Hilbert state machine: entry [state][octant] is next state * 8 + Hilbert digit
+//! Octants are in Morton order (x is the lowest bit); the curve is the one of AxestoTranspose for any order
+static const uint8_t hilbertTable[24][8] = {
+	{  8, 23, 27, 36, 41, 54,  2,  5},
+	{ 56, 67, 73, 10, 87, 44, 94, 13},
+	{100,111, 21, 78, 51,112, 18, 89},
+	{110, 79, 29,124,113, 88, 26,  3},
+	{ 72, 57,123, 34, 95, 86,  4, 37},
+	{ 32,131,143, 12,  1, 42,150, 45},
+	{156, 31, 19,160, 53,  6, 50,145},
+	{  0, 33,151,142,171, 58, 76, 61},
+	{126, 69,177, 66, 39,132,136, 11},
+	{ 40, 55,  9, 22,107, 60, 74, 77},
+	{188, 85, 91, 82,127, 38,176,137},
+	{116, 83, 93, 90, 71, 96, 14, 17},
+	{ 98,121,101,182,155, 24, 20,167},
+	{ 30,  7,161,144,109,172,106, 75},
+	{114,187,117, 92, 25,120,166,183},
+	{ 70, 97,125,122, 15, 16, 28, 35},
+	{174,133, 63, 68,185,130, 80, 43},
+	{180,141,175, 62,147,138,184, 81},
+	{164,139,135,152,149,146, 46, 49},
+	{154,169, 99,104,157,190, 52,119},
+	{162,179,105,168,165,148,118,191},
+	{134,153, 47, 48,173,170,108, 59},
+	{178,181, 65,102,163,140,128,159},
+	{186,189,115, 84,129,158, 64,103}
+};
+
+//! Spread the lowest 21 bits of x so that two zero bits separate them
+inline uint64_t spreadBits(uint32_t x) {
+#if defined(__BMI2__)
+	return _pdep_u64(x, 0x1249249249249249ull);                   // deposit bits into every third position
+#else
+	uint64_t v = x & 0x1fffff;                                    // keep 21 bits
+	v = (v | v << 32) & 0x1f00000000ffffull;
+	v = (v | v << 16) & 0x1f0000ff0000ffull;
+	v = (v | v << 8)  & 0x100f00f00f00f00full;
+	v = (v | v << 4)  & 0x10c30c30c30c30c3ull;
+	v = (v | v << 2)  & 0x1249249249249249ull;
+	return v;
+#endif
 }
+
 //! Get Morton order for a specific posision
 template<typename ArrayType>
-inline uint64_t getMoronKey(ArrayType position, size_t order, size_t dim) {	
-	uint64_t id = 0;
-	for (size_t i = 0; i < order; ++i) {
-		for (size_t j = 0; j < dim; ++j) {
-			id += (position[j] & 1) << (3 * i + j); 
-			position[j] >>= 1;
-		}
+inline uint64_t getMoronKey(ArrayType const& position, size_t order, size_t dim) {	
+	assert(dim == DIM && order <= MAXORDER);
+	uint32_t mask = (1u << order) - 1;                            // bits of each coordinate
+	return spreadBits(position[0] & mask)
+	    | (spreadBits(position[1] & mask) << 1)
+	    | (spreadBits(position[2] & mask) << 2);
+}
+
+//! Get Hilbert order for a specific position by walking the state table over the Morton octants
+template<typename ArrayType>
+inline uint64_t getHilbertKey(ArrayType const& position, size_t order) {
+	uint64_t morton = getMoronKey(position, order, DIM);          // octants of all levels
+	uint64_t key = 0;
+	int state = 0;
+	for (int l = int(order) - 1; l >= 0; --l) {                   // loop from the coarsest level
+		uint8_t entry = hilbertTable[state][(morton >> (3 * l)) & 7];
+		key = (key << 3) | (entry & 7);                             // append Hilbert digit
+		state = entry >> 3;                                         // orientation of the child
 	}
-	return id;	
+	return key;
 }
 
 //! Generate Hilbert order from given the particles structure 
@@ -79,27 +134,25 @@ std::pair<hilbert_t,hilbert_t> generateHilbertKey(BodyType& bodies, BoundsType c
 	logger::startTimer("Hkey Generation");													// start Hilbert generation timer
 	auto&& _min = min(bounds.Xmin);																	// get min of all dimensions
 	auto&& _max = max(bounds.Xmax);																	// get max of all dimensions 	
-	hilbert_t min_h = 0ull;																					// initialize min Hilbert order
+	hilbert_t min_h = ~0ull;																				// initialize min Hilbert order
 	hilbert_t max_h = 0ull;																					// initialize max Hilbert order	
-	order  = nextPow2(ACCURACY);			  					 							    // get needed bits to represent Hilbert order in each dimension 	
+	order  = MAXORDER;																							// use every bit of the key in each dimension
 	real_t diameter = _max - _min;
-	assert(order <= 21);																						// maximum key is 63 bits	
+	if (diameter == 0) diameter = 1;																// all bodies at one point
+	real_t gridSize = (1 << order) - 1;															// positions fill the whole key grid
 #if COUNT_COLLISIONS
   std::unordered_set<hilbert_t> myset;
 	size_t collisions = 0;	
 #endif 
-#pragma omp parallel shared(max_h, min_h)
-{
-#pragma omp for reduction (max: max_h), reduction(min: min_h)
+#pragma omp parallel for reduction(max: max_h) reduction(min: min_h)
 	for(size_t i = 0; i < bodies.size(); ++i) {											// loop over bodies
 		auto&& body = bodies[i];
 		hilbert_arr position 	  											// initialize shifted position 
-		{{ cast_uint32((body.X[0] - _min)/diameter * ACCURACY),
-		 	 cast_uint32((body.X[1] - _min)/diameter * ACCURACY), 
-		   cast_uint32((body.X[2] - _min)/diameter * ACCURACY)}};  
+		{{ cast_uint32((body.X[0] - _min)/diameter * gridSize),
+		 	 cast_uint32((body.X[1] - _min)/diameter * gridSize), 
+		   cast_uint32((body.X[2] - _min)/diameter * gridSize)}};  
 #if HILBERT_CODE
-		AxestoTranspose(position,order,DIM);														// get transposed Hilbert order
-		body.ICELL = flattenTransposedKey(position,order);			      	// generate 1 flat Hilbert order (useful for efficient sorting)		
+		body.ICELL = getHilbertKey(position,order);			      					// generate 1 flat Hilbert order (useful for efficient sorting)		
 #else 
 		body.ICELL = getMoronKey(position,order,DIM);			      				// generate 1 flat Morton order (useful for efficient sorting)	
 #endif		
@@ -115,18 +168,10 @@ lock_mutex
 			collisions++;
 unlock_mutex					
 #endif 		
-		if(min_h != 0ull) {
-			if(body.ICELL > max_h)	  																// update min/max hilbert orders 
-				max_h = body.ICELL;																				
-			else if (body.ICELL < min_h)
-				min_h = body.ICELL;
-	  }
-	  else {
-	  	min_h = max_h = body.ICELL;
-	  	assert(min_h != 0ull);
-	  }
-	}
-}																																// end loop																														 
+		min_h = std::min(min_h, hilbert_t(body.ICELL));									// update min/max hilbert orders
+		max_h = std::max(max_h, hilbert_t(body.ICELL));
+	}																																// end loop
+	if (bodies.size() == 0) min_h = 0ull;														// no bodies, empty range
 	logger::stopTimer("Hkey Generation");														// stop Hilbert generation timer
 	return std::make_pair(min_h,max_h);														  // return min/max tuple
 }
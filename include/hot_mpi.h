@@ -9,7 +9,14 @@
 #include <chrono>
 #include "cell_mutex.h"
 #include "cell_dispatcher.h"
+#include "sort.h"
+#include "cell_index.h"
 #include <queue>
+#include <functional>
+#include <mutex>
+#include <numeric>
+#include "remote_arena.h"
+#include "remote_cache.h"
 
 using namespace std;
 
@@ -20,19 +27,20 @@ template <typename BodiesType, typename ReceiveCellsType>
 class HOTMPI {	
 public:
   typedef typename ReceiveCellsType::value_type CellType;
+  typedef ReceiveCellsType                      RemoteCells;              //!< Type of received cell vector
+  typedef typename ReceiveCellsType::iterator   CellIterator;             //!< Iterator of received cells
 	typedef std::vector<std::array<real_t,3>>     GlobalBoundsVector;        //!< Type of Vector of Global Bounds
   typedef std::vector<hilbert_t>                GlobalHilbertBoundsVector; //!< Type of Global Hilbert Bounds Vector 
   typedef std::pair<hilbert_t,hilbert_t>        KeyPair;                   //!< Type of Key Pair
   typedef std::vector<KeyPair>                  KeyPairVector;             //!< Type of Key Pair Vector
   typedef std::vector<size_t>                   RankList;                  //!< Type of Rank list
   typedef std::vector<KeyPairVector>            BoundsBreadthMap;
-  typedef std::vector<std::unordered_map<hilbert_t,BodiesType>> VectorBodyMap;
   typedef std::vector<std::unordered_map<hilbert_t,ReceiveCellsType>> VectorCellMap;
-  typedef std::vector<std::unordered_map<hilbert_t,CellType>> VectorMap;
-  typedef std::vector<VectorMap>                VectorVectorMap;
-  typedef std::vector<VectorCellMap>            VectorVectorCellMap;
-  typedef std::vector<VectorBodyMap>            VectorVectorBodyMap;
-  typedef DispatcherWrapper<Cells,TreeType>     Dispatcher;
+  typedef DispatcherWrapper<Cells,CellIndex>    Dispatcher;
+  typedef RemoteArena<ReceiveCellsType>         CellArena;                 //!< Storage of received cells
+  typedef RemoteArena<BodiesType>               BodyArena;                 //!< Storage of received bodies
+  typedef typename CellArena::Span              CellSpan;                  //!< View of received children
+  typedef typename BodyArena::Span              BodySpan;                  //!< View of received bodies
   typedef std::vector<int> VecInt;
 
   
@@ -51,12 +59,107 @@ private:
 	GlobalBoundsVector allBoundsXmax;                                        //!< Array for local Xmax for all ranks
   GlobalHilbertBoundsVector allHilbertBoundsMin;                           //!< Vector of Hilbert bounds min of all ranks
   GlobalHilbertBoundsVector allHilbertBoundsMax;                           //!< Vector of Hilbert bounds max of all ranks
-  VectorVectorMap cellsMap;                                                //!< A cache for the requested keys 
-  VectorVectorCellMap childrenMap;
-  VectorVectorBodyMap bodyMap;                        
+  RemoteCache<CellType> cellCache;                                         //!< Cache of single remote cells
+  RemoteCache<CellSpan> childCache;                                        //!< Cache of children of remote cells
+  RemoteCache<BodySpan> bodyCache;                                         //!< Cache of bodies of remote leaf cells
+  CellArena cellArena;                                                     //!< Received cells, referred to by childCache
+  BodyArena bodyArena;                                                     //!< Received bodies, referred to by bodyCache
+  size_t cacheBudget;                                                      //!< Bytes of remote data kept between rounds
   Dispatcher* dispatcher;
+  MPI_Comm requestComm;                                                    //!< Communicator for requests (replies use MPI_COMM_WORLD)
   BoundsBreadthMap boundsPerBreadth;                                       //!< Vector of Bounds per Level  
   int receivingTask;                                                       //!< Set current receiving thread
+  Sort bodySort;                                                           //!< Radix sort for received bodies
+  std::vector<std::vector<uint64_t>> batchRequests;                        //!< Queued (key, level, type) per rank
+  VecInt pendingReplies;                                                   //!< Batched replies in flight per rank
+  SendQueue<uint64_t> requestSends;                                        //!< Batched requests being sent
+  std::mutex batchMutex;                                                   //!< Guards batchRequests, pendingReplies, requestSends
+  std::mutex receiveMutex;                                                 //!< One thread receives replies at a time
+
+  //! Receive one packed part of a reply from rank into buffer
+  void receivePart(int rank, int tag, VecInt& buffer) {
+    MPI_Status status;
+    int recvCount;
+    MPI_Probe(rank, tag, MPI_COMM_WORLD, &status);
+    MPI_Get_count(&status, MPI_INT, &recvCount);
+    buffer.resize(recvCount);
+    MPI_Recv(RAWPTR(buffer), recvCount, MPI_INT, rank, tag, MPI_COMM_WORLD, MPI_STATUS_IGNORE);
+  }
+
+  //! Receive one BATCHTAG reply; packed cells and bodies are unpacked into the arenas
+  void receiveBatch(MPI_Status& status) {
+    int rank = status.MPI_SOURCE;
+    int recvCount;
+    MPI_Get_count(&status, MPI_INT, &recvCount);
+    VecInt recvData(recvCount);
+    MPI_Recv(RAWPTR(recvData), recvCount, MPI_INT, rank, status.MPI_TAG, MPI_COMM_WORLD, MPI_STATUS_IGNORE);
+    const int numHeaders = recvCount / BATCHHEADERWORD;
+    std::vector<BatchHeader> headers(numHeaders);
+    std::memcpy(RAWPTR(headers), RAWPTR(recvData), numHeaders * sizeof(BatchHeader));
+    size_t numCells = 0, numBodies = 0;
+    int cellSpans = 0, bodySpans = 0;
+    for(int i = 0; i < numHeaders; ++i) {                                   // Size the parts
+      if(headers[i].type == CHILDCELLTAG) {
+        numCells += headers[i].count;
+        cellSpans += headers[i].count > 0;
+      } else {
+        numBodies += headers[i].count;
+        bodySpans += headers[i].count > 0;
+      }
+    }
+    typename CellArena::Chunk* cellChunk = NULL;
+    typename BodyArena::Chunk* bodyChunk = NULL;
+    if(numCells > 0) {
+      cellChunk = cellArena.allocate(rank, numCells, cellSpans);
+      receivePart(rank, encryptMessage(1,BATCHTAG,BATCHCELLPART,RECEIVEBIT), recvData);
+      assert(wireCount(RAWPTR(recvData)) == int(numCells));
+      unpackCells(RAWPTR(recvData), cellChunk->data.begin());
+    }
+    if(numBodies > 0) {
+      bodyChunk = bodyArena.allocate(rank, numBodies, bodySpans);
+      receivePart(rank, encryptMessage(1,BATCHTAG,BATCHBODYPART,RECEIVEBIT), recvData);
+      assert(wireCount(RAWPTR(recvData)) == int(numBodies));
+      unpackBodies(RAWPTR(recvData), bodyChunk->data.begin());
+    }
+    size_t cellOffset = 0, bodyOffset = 0;
+    for(int i = 0; i < numHeaders; ++i) {
+      const BatchHeader& header = headers[i];
+      if(header.type == CHILDCELLTAG) {
+        CellSpan children = header.count > 0 ? CellSpan(cellChunk, cellOffset, header.count) : CellSpan();
+        cellOffset += header.count;
+        childCache.insert(rank, header.level, header.key, children);
+        cellArena.release(rank, children);                                  // Previous children, if any
+      } else {
+        assert(header.type == BODYTAG);
+        BodySpan bodies = header.count > 0 ? BodySpan(bodyChunk, bodyOffset, header.count) : BodySpan();
+        bodyOffset += header.count;
+        bodyCache.insert(rank, header.level, header.key, bodies);
+        bodyArena.release(rank, bodies);                                    // Previous bodies, if any
+      }
+    }
+    std::lock_guard<std::mutex> lock(batchMutex);
+    pendingReplies[rank]--;
+  }
+
+  //! Copy children received by the single-key path into the cell arena and cache them
+  void insertChildren(int rank, int level, hilbert_t key, ReceiveCellsType const& cells) {
+    CellSpan children;
+    if(!cells.empty()) {
+      auto&& chunk = cellArena.allocate(rank, cells.size(), 1);
+      std::copy(cells.begin(), cells.end(), chunk->data.begin());
+      children = CellSpan(chunk, 0, cells.size());
+    }
+    childCache.insert(rank, level, key, children);
+    cellArena.release(rank, children);
+  }
+
+  //! Queue a request for the next sendRequests()
+  void queueRequest(hilbert_t key, size_t level, int rank, int requestType) {
+    std::lock_guard<std::mutex> lock(batchMutex);
+    batchRequests[rank].push_back(key);
+    batchRequests[rank].push_back(level);
+    batchRequests[rank].push_back(requestType);
+  }
   
 	
   inline void prepareBodyCounts(BodiesType const& bodies, VecInt& counts) {
@@ -105,31 +208,40 @@ private:
     return recvBodies;
 	}
 
-	//! merge the sorted bodies to form a big sorted list
+	//! merge the sorted bodies from all ranks to form a big sorted list
+	//! Ranks send their bodies in key order, so the received runs are merged with a heap of run heads
 	inline BodiesType mergeBodies(BodiesType& bodies) {
     auto dataSize = recvBodyDispl[mpisize-1]+recvBodyCount[mpisize-1];
     if(bodies.size() == sendBodyCount[mpirank] && dataSize == sendBodyCount[mpirank])   // Nothing to send to other ranks
       return bodies;                                            // return current value
-    int irank = 0;
-    while(recvBodyCount[irank] == 0 && irank < mpisize) 
-      irank++;
-    if(irank < mpisize) { 
-      auto&& compare   = [&](Body body1, Body body2){return (body1.ICELL<body2.ICELL);};
-      auto&& recvBegin = bodies.begin();   
-      BodiesType sortedBodies(recvBegin + recvBodyDispl[irank], recvBegin + recvBodyDispl[irank] + recvBodyCount[irank]);
-      irank++;
-      for (; irank<mpisize; ++irank) {
-      	size_t currentSize = recvBodyDispl[irank] + recvBodyCount[irank];
-      	BodiesType output(currentSize);
-      	std::merge(sortedBodies.begin(), sortedBodies.end(), recvBegin + recvBodyDispl[irank], recvBegin + currentSize, output.begin(),compare);
-      	sortedBodies = std::move(output);
+    if(dataSize == 0) return bodies;
+    bool runsSorted = true;                                     // Whether every received run is in key order
+    for (int irank=0; irank<mpisize; ++irank) {                 // Loop over runs
+      for (int i=recvBodyDispl[irank]+1; i<recvBodyDispl[irank]+recvBodyCount[irank]; ++i) {
+        if(bodies[i].ICELL < bodies[i-1].ICELL) runsSorted = false;
+      }
+    }                                                           // End loop over runs
+    BodiesType sortedBodies(dataSize);
+    if(runsSorted) {                                            // If runs are sorted, merge them
+      typedef std::pair<hilbert_t,int> RunHead;                 // Key of the next body of a run, and its rank
+      std::priority_queue<RunHead, std::vector<RunHead>, std::greater<RunHead> > heads;// Smallest key first, ties in rank order
+      VecInt next(recvBodyDispl);                               // Next body of each run
+      for (int irank=0; irank<mpisize; ++irank) {
+        if(recvBodyCount[irank] > 0) heads.push(RunHead(bodies[next[irank]].ICELL, irank));
       }
-      localBounds.first = sortedBodies.front().ICELL;
-      localBounds.second = sortedBodies.back().ICELL;
-      return sortedBodies; 
-    } else {
-      return bodies;
+      for (int i=0; i<dataSize; ++i) {                          // Loop over merged bodies
+        int irank = heads.top().second;                         //  Run with the smallest key
+        heads.pop();
+        sortedBodies[i] = bodies[next[irank]++];                //  Take its head
+        if(next[irank] < recvBodyDispl[irank] + recvBodyCount[irank]) heads.push(RunHead(bodies[next[irank]].ICELL, irank));
+      }                                                         // End loop over merged bodies
+    } else {                                                    // Else runs came from an unsorted partition
+      std::copy(bodies.begin(), bodies.begin() + dataSize, sortedBodies.begin());
+      bodySort.sortICELL(sortedBodies);                         //  Stable radix sort of all bodies
     }
+    localBounds.first = sortedBodies.front().ICELL;
+    localBounds.second = sortedBodies.back().ICELL;
+    return sortedBodies;
 	}
 
 
@@ -194,10 +306,21 @@ public:
     ,mpisize(size),order(_order), grainSize(granularity), sendBodyCount(size)
 		,sendBodyDispl(size),recvBodyCount(size),recvBodyDispl(size)
     ,allBoundsXmin(size),allBoundsXmax(size),allHilbertBoundsMin(size*(_order+1))
-    ,allHilbertBoundsMax(size*(_order+1)),cellsMap(size,VectorMap(_order+1)), childrenMap(size,VectorCellMap(_order+1))
-    ,bodyMap(size,VectorBodyMap(_order+1)) { }
+    ,allHilbertBoundsMax(size*(_order+1)),cellCache(size,_order+1), childCache(size,_order+1)
+    ,bodyCache(size,_order+1), cellArena(size), bodyArena(size), cacheBudget(size_t(-1))
+    ,batchRequests(size), pendingReplies(size) {
+    dispatcher = NULL;
+    MPI_Comm_dup(MPI_COMM_WORLD, &requestComm);
+  }
 
-  ~HOTMPI() { }	
+  ~HOTMPI() {
+    int finalized;
+    MPI_Finalized(&finalized);
+    if(!finalized) {
+      delete dispatcher;
+      MPI_Comm_free(&requestComm);
+    }
+  }	
 
 	KeyPair allReduceHilbertBounds(KeyPair& local) {		
     logger::startTimer("Hilbert bounds");
@@ -286,30 +409,26 @@ public:
     }
   }
 
-  template <typename HOT>
-  void initDispatcher(Cells const& cells, HOT const& indexer) {
-    dispatcher = new Dispatcher(mpirank, mpisize, cells, indexer);      
+  //! Start serving requests for local cells and their multipoles M (once per tree; call after the upward pass)
+  void initDispatcher(Cells const& cells, Expansions const& M, CellIndex const& indexer) {
+    if(!dispatcher) dispatcher = new Dispatcher(mpirank, mpisize, cells, M, indexer, requestComm);
   }
 
-  void startDispatcher(){
-    dispatcher->callDispatcher();
+  //! Keep serving requests until all ranks are done with their remote traversal
+  void finishDispatcher() {
+    dispatcher->finishDispatcher();
   }
 
-  void flushDispatcher() {
-    MPI_Request request;    
-    int tag = encryptMessage(1,FLUSHTAG,0,SENDBIT);                
-    char null;   
-    for(int i=0; i < mpisize; ++i)
-      if(i!=mpirank)
-        MPI_Isend(&null, 1, MPI_CHAR,i,tag,MPI_COMM_WORLD,&request);
-  }
-   
-  void stopDispatcher() {    
-    delete dispatcher;
-  }
-  void finalizeDispatcher(){
-     dispatcher->finalizeDispatcher();
-     delete dispatcher;
+  //! Spin until the reply to tag (or a NULLTAG reply) from rank arrives, serving incoming requests meanwhile
+  void waitReply(int rank, int tag, MPI_Status& status) {
+    int nullTag = encryptMessage(1,NULLTAG,0,RECEIVEBIT);
+    TOGGLEDIRECTION(tag)
+    int ready = 0;
+    while(!ready) {
+      MPI_Iprobe(rank,tag,MPI_COMM_WORLD,&ready,&status);
+      if(!ready) MPI_Iprobe(rank,nullTag,MPI_COMM_WORLD,&ready,&status);
+      if(!ready) dispatcher->processIncomingMessage();
+    }
   }
 
   BodiesType getBodies(hilbert_t key, size_t level, int rank, int requestType, double& commtime) {
@@ -319,41 +438,37 @@ public:
 #endif        
     commtime = 0.0;
     BodiesType recvData;
-    auto&& bodyRankMap = bodyMap[rank][level];
-    if(requestType == BODYTAG && bodyRankMap.find(key) ==  bodyRankMap.end()) { 
+    BodySpan* cached = bodyCache.find(rank, level, key);
+    if(requestType == BODYTAG && !cached) { 
       MPI_Request request;
       int tag = encryptMessage(1,requestType,level,SENDBIT);
 #if CALC_COM_COMP      
       logger::startTimer("Communication");
 #endif    
-      MPI_Isend(&key,1,MPI_UNSIGNED_LONG_LONG, rank, tag, MPI_COMM_WORLD,&request); 
+      MPI_Isend(&key,1,MPI_UNSIGNED_LONG_LONG, rank, tag, requestComm,&request); 
+      MPI_Request_free(&request);
       MPI_Status status;         
       int recvRank = rank;
       int receivedTag;      
-      TOGGLEDIRECTION(tag)
-      int ready = 0;
-      while(!ready) {
-        MPI_Iprobe(MPI_ANY_SOURCE,MPI_ANY_TAG,MPI_COMM_WORLD,&ready,&status); 
-        if(ready) {
-          if(tag != status.MPI_TAG || rank != status.MPI_SOURCE) {           
-            dispatcher->processIncomingMessage(status.MPI_TAG, status.MPI_SOURCE);          
-            ready = 0;
-          }
-        }
-      }    
+      waitReply(rank, tag, status);
       receivedTag = status.MPI_TAG;  
       int responseType = getMessageType(receivedTag);
       int recvCount = 0;
       assert(responseType == BODYTAG || responseType == NULLTAG);
       if(responseType == BODYTAG) { 
         MPI_Get_count(&status, MPI_INT, &recvCount);
-        int bodyCount = recvCount/BODYWORD;
-        recvData.resize(bodyCount);
-        MPI_Recv(RAWPTR(recvData), recvCount, MPI_INT, recvRank, receivedTag, MPI_COMM_WORLD, MPI_STATUS_IGNORE);
+        VecInt packed(recvCount);
+        MPI_Recv(RAWPTR(packed), recvCount, MPI_INT, recvRank, receivedTag, MPI_COMM_WORLD, MPI_STATUS_IGNORE);
+        int bodyCount = wireCount(RAWPTR(packed));
+        auto&& chunk = bodyArena.allocate(rank, bodyCount, 1);
+        unpackBodies(RAWPTR(packed), chunk->data.begin());
 #if CALC_COM_COMP      
         commtime = logger::stopTimer("Communication",0);
 #endif    
-        bodyRankMap.emplace(key,recvData);
+        BodySpan bodies(chunk, 0, bodyCount);
+        recvData.assign(bodies.begin(), bodies.end());
+        bodyCache.insert(rank, level, key, bodies);
+        bodyArena.release(rank, bodies);
       } else {
           std::cout << "bodies not found for cell "<<key << std::endl;
           char null;
@@ -364,7 +479,7 @@ public:
       }
     }
     else if(requestType == BODYTAG) {
-      recvData = bodyRankMap[key];
+      recvData.assign(cached->begin(), cached->end());
     }
 #if THREADED_REMOTE    
     unlock_mutex;
@@ -380,7 +495,7 @@ public:
       int level = parent.LEVEL;
       id = index;
       if(parent.NCHILD > 0) {        
-        map[level].emplace(parent.ICELL,CellsType(cells.begin()+index,cells.begin()+index+parent.NCHILD));        
+        map[level].emplace(parent.ICELL,CellsType(cells.begin()+index,cells.begin()+index+parent.NCHILD));
         index += parent.NCHILD;        
         for(size_t i = 0; i < parent.NCHILD; ++i) {
           appendDataToCellMapper(map, cells,index, id++);
@@ -414,10 +529,10 @@ public:
 #endif
     commtime = 0.0;
     ReceiveCellsType recvData;
-    auto&& cellRankMap = cellsMap[rank][level];
-    auto&& childRankMap = childrenMap[rank][level];    
-    if((requestType == CHILDCELLTAG && childRankMap.find(key) == childRankMap.end()) ||
-       (requestType == CELLTAG      &&  cellRankMap.find(key) ==  cellRankMap.end()) || 
+    CellType* cachedCell = requestType == CELLTAG ? cellCache.find(rank, level, key) : NULL;
+    CellSpan* cachedChildren = requestType == CHILDCELLTAG ? childCache.find(rank, level, key) : NULL;
+    if((requestType == CHILDCELLTAG && !cachedChildren) ||
+       (requestType == CELLTAG      && !cachedCell) || 
         requestType ==LEVELTAG) { 
       MPI_Request request;      
       assert(requestType <= MAXTAG);      
@@ -425,51 +540,45 @@ public:
 #if CALC_COM_COMP      
         logger::startTimer("Communication");
 #endif 
-      MPI_Isend(&key,1,MPI_UNSIGNED_LONG_LONG, rank, tag, MPI_COMM_WORLD,&request); 
+      MPI_Isend(&key,1,MPI_UNSIGNED_LONG_LONG, rank, tag, requestComm,&request); 
+      MPI_Request_free(&request);
       MPI_Status status;          
       int recvRank = rank;
       int receivedTag;       
-      TOGGLEDIRECTION(tag)   
-      int ready = 0;
-      while(!ready) {
-        MPI_Iprobe(MPI_ANY_SOURCE,MPI_ANY_TAG,MPI_COMM_WORLD,&ready,&status); 
-        if(ready) {
-          if(tag != status.MPI_TAG || rank != status.MPI_SOURCE) {           
-            dispatcher->processIncomingMessage(status.MPI_TAG, status.MPI_SOURCE);          
-            ready = 0;
-          }
-        }
-      }
+      waitReply(rank, tag, status);
       receivedTag = status.MPI_TAG;                
       int responseType = getMessageType(receivedTag);
       int recvCount = 0;
       assert(responseType != BODYTAG);
       if(responseType == CHILDCELLTAG || responseType == CELLTAG || responseType == LEVELTAG) { 
         MPI_Get_count(&status, MPI_INT, &recvCount);
-#if SEND_MULTIPOLES        
-        int cellCount = recvCount/MULTIPOLEWORD;
-#else 
-        int cellCount = recvCount/CELLWORD;
-#endif         
-        recvData.resize(cellCount);
-        MPI_Recv(RAWPTR(recvData), recvCount, MPI_INT, recvRank, receivedTag, MPI_COMM_WORLD, MPI_STATUS_IGNORE);
+        VecInt packed(recvCount);
+        MPI_Recv(RAWPTR(packed), recvCount, MPI_INT, recvRank, receivedTag, MPI_COMM_WORLD, MPI_STATUS_IGNORE);
+        recvData.resize(wireCount(RAWPTR(packed)));
+        unpackCells(RAWPTR(packed), recvData.begin());
 #if CALC_COM_COMP      
         commtime = logger::stopTimer("Communication",0);
 #endif          
-        if(responseType == CELLTAG) cellRankMap.emplace(key, recvData[0]);
+        if(responseType == CELLTAG) {
+          CellType cell = recvData[0];
+          cellCache.insert(rank, level, key, cell);
+        }
         else if(responseType == CHILDCELLTAG)  { 
           if(grainSize > 1) {
+            VectorCellMap map(order+1);                                    // Children of every cell in the received subtree
 #if DFS            
-            childRankMap.emplace(key,ReceiveCellsType(recvData.begin(), recvData.begin()+nchild));  
+            map[level].emplace(key,ReceiveCellsType(recvData.begin(), recvData.begin()+nchild));  
             int index = nchild;
-            for (int i = 0; i < nchild; ++i) appendDataToCellMapper(childrenMap[rank],recvData,index,i);  
-            recvData = childRankMap[key];  
+            for (int i = 0; i < nchild; ++i) appendDataToCellMapper(map,recvData,index,i);  
 #else
-            appendDataToCellMapper(childrenMap[rank],recvData, level,nchild, key);        
-            recvData = childRankMap[key];  
+            appendDataToCellMapper(map,recvData, level,nchild, key);        
 #endif            
+            recvData = map[level][key];  
+            for(int l = 0; l < order+1; ++l)
+              for(auto&& it = map[l].begin(); it != map[l].end(); ++it)
+                insertChildren(rank, l, it->first, it->second);
           }
-          else childRankMap.emplace(key,recvData);
+          else insertChildren(rank, level, key, recvData);
         }
       } else if(responseType == NULLTAG) {
           char null;
@@ -480,10 +589,10 @@ public:
       }
     }
     else if(requestType == CELLTAG) {
-      recvData.push_back(cellRankMap[key]);
+      recvData.push_back(*cachedCell);
     }
     else if(requestType == CHILDCELLTAG) {
-      recvData = childRankMap[key];
+      recvData.assign(cachedChildren->begin(), cachedChildren->end());
     }
 #if THREADED_REMOTE    
     unlock_mutex;
@@ -491,10 +600,102 @@ public:
     return recvData;
   }
 
+  //! Children of a remote cell if they have been received, NULL otherwise
+  //! The span points into the cell arena and stays valid until clearCellCache(rank)
+  CellSpan* findChildren(hilbert_t key, size_t level, int rank) {
+    return childCache.find(rank, level, key);
+  }
+
+  //! Bodies of a remote leaf cell if they have been received, NULL otherwise
+  //! The span points into the body arena and stays valid until the next evictCache()
+  BodySpan* findBodies(hilbert_t key, size_t level, int rank) {
+    return bodyCache.find(rank, level, key);
+  }
+
+  //! Queue a request for the children of a remote cell, sent by sendRequests()
+  //! Only the first of several threads asking for the same key sends a request
+  void requestChildren(hilbert_t key, size_t level, int rank) {
+    assert(rank!=mpirank);
+    if(childCache.reserve(rank, level, key)) queueRequest(key, level, rank, CHILDCELLTAG);
+  }
+
+  //! Queue a request for the bodies of a remote leaf cell, sent by sendRequests()
+  void requestBodies(hilbert_t key, size_t level, int rank) {
+    assert(rank!=mpirank);
+    if(bodyCache.reserve(rank, level, key)) queueRequest(key, level, rank, BODYTAG);
+  }
+
+  //! Send the queued requests as one message per rank
+  void sendRequests() {
+    std::lock_guard<std::mutex> lock(batchMutex);
+    int tag = encryptMessage(1,BATCHTAG,0,SENDBIT);
+    for(int i = 0; i < mpisize; ++i) {
+      if(!batchRequests[i].empty()) {
+        requestSends.isend(batchRequests[i], MPI_UNSIGNED_LONG_LONG, i, tag, requestComm);
+        pendingReplies[i]++;
+      }
+    }
+  }
+
+  //! Number of batched replies in flight
+  int numPendingReplies() {
+    std::lock_guard<std::mutex> lock(batchMutex);
+    return std::accumulate(pendingReplies.begin(), pendingReplies.end(), 0);
+  }
+
+  //! Set the number of bytes of remote data kept between rounds (see evictCache)
+  void setCacheBudget(size_t bytes) {
+    cacheBudget = bytes;
+  }
+
+  //! Start a new round and evict least recently used remote bodies over the budget
+  //! Must be called when no thread holds pointers returned by findBodies
+  void evictCache() {
+    bodyCache.nextRound();
+    size_t cellBytes = cellCache.size() + childCache.size();
+    bodyCache.evict(cacheBudget > cellBytes ? cacheBudget - cellBytes : 0,
+                    [this](int rank, BodySpan const& bodies) { bodyArena.release(rank, bodies); });
+  }
+
+  //! Serve incoming requests until at least one batched reply has been received
+  //! Returns false if no replies are in flight
+  bool waitReplies(double& commtime) {
+    commtime = 0.0;
+    if(numPendingReplies() == 0) return false;
+    std::lock_guard<std::mutex> lock(receiveMutex);
+#if CALC_COM_COMP
+    logger::startTimer("Communication");
+#endif
+    int replyTag = encryptMessage(1,BATCHTAG,0,RECEIVEBIT);
+    int received = 0;
+    int ready = 1;
+    MPI_Status status;
+    while(!received || ready) {                                  // Block for the first reply, then drain
+      MPI_Iprobe(MPI_ANY_SOURCE,replyTag,MPI_COMM_WORLD,&ready,&status);
+      if(ready) {
+        receiveBatch(status);
+        received++;
+      } else {
+        dispatcher->processIncomingMessage();
+      }
+    }
+    {
+      std::lock_guard<std::mutex> lock(batchMutex);
+      requestSends.test();
+    }
+#if CALC_COM_COMP
+    commtime = logger::stopTimer("Communication",0);
+#endif
+    return true;
+  }
+
+  //! Drop all cached data of rank
   void clearCellCache(int rank) {
-    cellsMap[rank].clear();
-    bodyMap[rank].clear();  
-    childrenMap[rank].clear();  
+    cellCache.clear(rank);
+    childCache.clear(rank);
+    bodyCache.clear(rank);
+    cellArena.clear(rank);
+    bodyArena.clear(rank);
   }
 
   //! Global synchronization for particles in all partitions 
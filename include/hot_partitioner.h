@@ -2,8 +2,10 @@
 #define HOT_PARTITIONER
 #include <unordered_map>
 #include <algorithm>
+#include <numeric>
 #include <vector>
 #include <set>
+#include "sort.h"
 
 namespace exafmm{
 class HOTPartition{
@@ -24,6 +26,7 @@ class HOTPartition{
 	const int64_t hilbertDistance = 750000000000;                 								 //!< key acceptance criteria 
 	const float sampleRate = 0.001f;																							 //!< sample rate for workload sampling 
 	const float lamda  = 0.05f;
+	Sort bodySort;																																 //!< radix sort for bodies by ICELL/IRANK
 
 	void partitionSort(RangeType& keys, hilbert_t lbound, hilbert_t rbound, RangeType&rq, hilbert_t pivot=0, size_t depth = 0) {
 		RangeType right;
@@ -162,7 +165,7 @@ class HOTPartition{
 		}
 		if(sort) {
 			logger::startTimer("Sort Hilbert");																  					// start HOT partitioning timer
-			std::sort(bodies.begin(),bodies.end(),[&](Body a,Body b){return (a.ICELL<b.ICELL);});
+			bodySort.sortICELL(bodies);
 			logger::stopTimer("Sort Hilbert");																						// start HOT partitioning timer
 		}
 		for(auto&& body: bodies) {																										// loop over bodies																								
@@ -231,7 +234,10 @@ public:
 			assert(body.IRANK >=0 && body.IRANK <commsize);															// make sure rank is within size
 		}
 	  logger::startTimer("Sort");
-		std::sort(bodies.begin(),bodies.end(),[&](Body a,Body b){return (a.IRANK<b.IRANK);});
+		bool sorted = true;																														// ranks grow with keys, so key order groups ranks
+		for(size_t i = 1; i < bodies.size() && sorted; ++i)
+			sorted = bodies[i-1].ICELL <= bodies[i].ICELL;
+		if(!sorted) bodySort.sortICELL(bodies);																				// every rank then receives sorted runs to merge
 		logger::stopTimer("Sort");
 	}
 
@@ -250,7 +256,7 @@ public:
 			assert(body.IRANK >=0 && body.IRANK <commsize);														// make sure rank is within size
 		}
 	  logger::startTimer("Sort");
-		std::sort(bodies.begin(),bodies.end(),[&](Body a,Body b){return (a.IRANK<b.IRANK);});
+		bodySort.sortIRANK(bodies);
 		logger::stopTimer("Sort");		
 	}
 
@@ -322,7 +328,7 @@ public:
 	    balanceTraverse(cells.begin(),cells.begin(), bodies.begin(),wbalanced,wg);
 
 	    logger::startTimer("Sort");
-		  std::sort(bodies.begin(),bodies.end(),[&](Body a,Body b){return (a.IRANK<b.IRANK);});
+		  bodySort.sortIRANK(bodies);
 		  logger::stopTimer("Sort");
   	}
 	}
@@ -365,7 +371,7 @@ public:
 	    }
 
 	    logger::startTimer("Sort");
-		  std::sort(bodies.begin(),bodies.end(),[&](Body a,Body b){return (a.IRANK<b.IRANK);});
+		  bodySort.sortIRANK(bodies);
 		  logger::stopTimer("Sort");
   	}
 	}
@@ -378,7 +384,7 @@ public:
 		WorkloadType wq[commsize];
 		assert(bodyCount > 1);
 		logger::startTimer("Sort");
-		std::sort(bodies.begin(),bodies.end(),[&](Body a,Body b){return (a.ICELL<b.ICELL);});
+		bodySort.sortICELL(bodies);
 		logger::stopTimer("Sort");		
 		std::vector<WorkloadType> workPerLeaf(bodyCount, 0);		
 		for(int i = 0; i < bodyCount; ++i)
@@ -428,10 +434,8 @@ public:
 
 	template <typename BodyType>
 	void partitionMasterSlave(BodyType& bodies) {	
-		auto&& begin = bodies.begin();																								// bodies begin iterator 
-		auto&& end   = bodies.end();																									// bodies end iterator 
 		logger::startTimer("Sort Hilbert");																						// start sort timer		
-		std::sort(begin,end,[&](Body a, Body b){return (a.ICELL<b.ICELL);});				  // sort based on Hilbert key
+		bodySort.sortICELL(bodies);																										// sort based on Hilbert key
 		logger::stopTimer("Sort Hilbert");																		        // stop sort timer
 		logger::startTimer("HOT Partitioning");																				// start HOT partitioning timer
 		auto&& numBodies  = bodies.size();																					  // number of bodies
@@ -464,19 +468,19 @@ public:
 	//! Partition non-uniformly distributed particles using HOT and workload sampling  
 	template <typename BodyType>
 	void partitionNonUniform(BodyType& bodies) {					
-		auto&& begin = bodies.begin();																								// bodies begin iterator 
-		auto&& end   = bodies.end();																									// bodies end iterator 
 		logger::startTimer("Sort Hilbert");																						// start sort timer		
-		std::sort(begin,end,[&](Body a, Body b){return (a.ICELL<b.ICELL);}); // sort based on Hilbert key
+		bodySort.sortICELL(bodies);																										// sort based on Hilbert key
 		logger::stopTimer("Sort Hilbert");																		        // stop sort timer
+		auto&& begin = bodies.begin();																								// bodies begin iterator 
+		auto&& end   = bodies.end();																									// bodies end iterator 
 		logger::startTimer("HOT Partitioning");																				// start HOT partitioning timer
 		auto&& numBodies  = bodies.size();																					  // number of bodies
 		if(numBodies < commsize) {
 			std::cout<< "insufficient problem size";
 			MPI_Abort(MPI_COMM_WORLD,0);
 		}						
-		auto&& compareLower = [&,this](Body body1,Body body2){return (std::abs(body1.ICELL-body2.ICELL) > hilbertDistance);}; // lambda expression for lower bounds of neighbors
-		auto&& compareUpper = [&,this](Body body1,Body body2){return (std::abs(body1.ICELL-body2.ICELL) < hilbertDistance);}; // lambda expression for upper bounds of neighbors 
+		auto&& compareLower = [&,this](Body body1,Body body2){return (std::abs(int64_t(body1.ICELL-body2.ICELL)) > hilbertDistance);}; // lambda expression for lower bounds of neighbors
+		auto&& compareUpper = [&,this](Body body1,Body body2){return (std::abs(int64_t(body1.ICELL-body2.ICELL)) < hilbertDistance);}; // lambda expression for upper bounds of neighbors 
 		size_t numSamples = numBodies * sampleRate;																		// number of samples
 		size_t stepSize = 1;																													// step size between samples
 		if(numSamples > 1) stepSize = numBodies / numSamples;													// evaluate step size 
@@ -1,24 +1,44 @@
 #ifndef kernel_h
 #define kernel_h
 #include <cmath>
+#include <cstdlib>
+#include <iostream>
 #include "types.h"
+#include "bodies_soa.h"
 
 namespace exafmm {
   namespace kernel {
     extern real_t eps2;                                         //!< Epslion squared
     extern complex_t wavek;                                     //!< Helmholtz wave number
     extern vec3 Xperiodic;                                      //!< Periodic coordinate offset
+    extern int order;                                           //!< Expansion order used at run time, at most P
+
+    //! Stop with a message unless the run time order is between minOrder and maxOrder
+    inline void checkOrder(int minOrder, int maxOrder) {
+      if (order < minOrder || order > maxOrder) {               // If kernels were not built for this order
+        std::cerr << "Expansion order " << order << " is not supported, use "
+                  << minOrder << " to " << maxOrder << std::endl;
+        exit(1);
+      }                                                         // End if for order
+    }
 
     void setup();                                               //!< Setup phase for kernels
     template <typename J_iter>
     void P2P(C_iter Ci, J_iter Cj, bool mutual);                //!< P2P kernel between cells Ci and Cj
     void P2P(C_iter C);                                         //!< P2P kernel for cell C
-    void P2M(C_iter C);                                         //!< P2M kernel for cell C
-    void M2M(C_iter Ci, C_iter C0);                             //!< M2M kernel for one parent cell Ci
+#if EXAFMM_LAPLACE
+    void P2P(C_iter Ci, C_iter Cj, BodiesSoA & Bi, BodiesSoA & Bj, bool mutual);//!< P2P kernel on SoA bodies
+    void P2P(C_iter C, BodiesSoA & B);                          //!< P2P kernel on SoA bodies for cell C
+#endif
+    void P2M(C_iter C, vecP & M);                               //!< P2M kernel for cell C into its multipole M
+    void M2M(C_iter Ci, C_iter C0, vecP * M);                   //!< M2M kernel for one parent cell Ci, M[k] belongs to C0+k
     template <typename J_iter>
-    void M2L(C_iter Ci, J_iter Cj, bool mutual);                //!< M2L kernel between cells Ci and Cj
-    void L2L(C_iter Ci, C_iter C0);                             //!< L2L kernel for one child cell Ci
-    void L2P(C_iter Ci);                                        //!< L2P kernel for cell Ci
+    void M2L(C_iter Ci, J_iter Cj, const vecP & Mi, vecP & Li,
+             const vecP & Mj, vecP * Lj);                       //!< M2L kernel between cells Ci and Cj, mutual if Lj is given
+    void M2LBatch(C_iter Ci, const C_iter * Cj, int numCj, C_iter Cj0,
+                  const vecP & Mi, vecP & Li, const vecP * Mj); //!< M2L kernel from numCj source cells to Ci, Mj[k] belongs to Cj0+k
+    void L2L(C_iter Ci, C_iter C0, const vecP * M, vecP * L);   //!< L2L kernel for one child cell Ci, M[k] and L[k] belong to C0+k
+    void L2P(C_iter Ci, const vecP & L);                        //!< L2P kernel for cell Ci from its local L
   }
 }
 #endif
@@ -2,8 +2,8 @@
 #define macros_h
 
 // Detect SIMD Byte length of architecture
-#if __MIC__
-const int SIMD_BYTES = 64;                                      //!< SIMD byte length of MIC
+#if __MIC__ | __AVX512F__
+const int SIMD_BYTES = 64;                                      //!< SIMD byte length of MIC and AVX-512
 #elif __AVX__ | __bgq__
 const int SIMD_BYTES = 32;                                      //!< SIMD byte length of AVX and BG/Q
 #elif __SSE__ | __sparc_v9__ | _SX
@@ -23,7 +23,7 @@ const int SIMD_BYTES = 16;                                      //!< SIMD byte l
 
 // Bluegene/Q and K computer don't have single precision arithmetic
 #if __bgq__ | __sparc_v9__
-#ifdef EXAFMM_SINGLE
+#if defined EXAFMM_SINGLE || EXAFMM_MIXED
 #error Please use double precision for BG/Q, FX10, FX100
 #endif
 #endif
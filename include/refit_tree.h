@@ -0,0 +1,161 @@
+#ifndef refit_tree_h
+#define refit_tree_h
+#include <algorithm>
+#include "logger.h"
+#include "types.h"
+
+namespace exafmm {
+  //! Reuses the topology of the last built tree for timesteps in which bodies move only a little
+  //! Bodies that left their leaf are moved to the leaf they are in now; cell centers stay and radii grow to cover the bodies
+  class RefitTree {
+  private:
+    const int    ncrit;                                         //!< Number of bodies per leaf cell of the built tree
+    const real_t maxImbalance;                                  //!< Rebuild if a leaf gets more than maxImbalance * ncrit bodies
+    const real_t maxCrossing;                                   //!< Rebuild if more than this fraction of bodies changed leaf
+    Cells        cells0;                                        //!< Cells of the last build, before the upward pass changed R
+    std::vector<int> leaves;                                    //!< Leaf cells in the order of their bodies
+    std::vector<int> leafIndex;                                 //!< Position of each leaf cell in leaves
+    std::vector<int> leafOf;                                    //!< Leaf of each body
+    std::vector<int> offset;                                    //!< First body of each leaf after re-binning
+    Bodies       buffer;                                        //!< Buffer for re-binning bodies
+
+    //! Whether X lies in the box of cell C
+    inline bool inside(const Cell & C, const vec3 & X) const {
+      for (int d=0; d<3; d++) {                                 // Loop over dimensions
+        if (std::abs(X[d] - C.X[d]) > C.R) return false;        //  Outside in this dimension
+      }                                                         // End loop over dimensions
+      return true;                                              // Inside in all dimensions
+    }
+
+    //! Distance from X to the box of cell C in the max norm
+    inline real_t distance(const Cell & C, const vec3 & X) const {
+      real_t dist = 0;                                          // Initialize distance
+      for (int d=0; d<3; d++) {                                 // Loop over dimensions
+        dist = std::max(dist, std::abs(X[d] - C.X[d]) - C.R);   //  Distance in this dimension
+      }                                                         // End loop over dimensions
+      return dist;                                              // Return distance
+    }
+
+    //! Leaf whose box contains X, or the one closest to it where the tree has no cell
+    int findLeaf(const vec3 & X) const {
+      int icell = 0;                                            // Start from root
+      while (cells0[icell].NCHILD > 0) {                        // Descend until leaf
+        const Cell & C = cells0[icell];                         //  Current cell
+        int jcell = C.ICHILD;                                   //  Closest child so far
+        real_t dmin = distance(cells0[jcell], X);               //  Distance to closest child
+        for (int j=C.ICHILD+1; j<C.ICHILD+C.NCHILD && dmin>0; j++) {// Loop over other children
+          real_t dist = distance(cells0[j], X);                 //   Distance to child
+          if (dist < dmin) {                                    //   If child is closer
+            dmin = dist;                                        //    Update distance
+            jcell = j;                                          //    Update closest child
+          }                                                     //   End if for closer child
+        }                                                       //  End loop over children
+        icell = jcell;                                          //  Go down to closest child
+      }                                                         // End while loop
+      return icell;                                             // Return leaf
+    }
+
+  public:
+    //! Constructor
+    RefitTree(int _ncrit, real_t _maxImbalance=2, real_t _maxCrossing=0.05) :
+      ncrit(_ncrit), maxImbalance(_maxImbalance), maxCrossing(_maxCrossing) {}
+
+    //! Forget the tree so that the next step is rebuilt
+    void clear() {
+      cells0.clear();
+    }
+
+    //! Number of bodies in the tree that can be refit
+    int size() const {
+      return cells0.empty() ? 0 : cells0.front().NBODY;
+    }
+
+    //! Remember a tree right after it was built, before the upward pass
+    void setTree(const Cells & cells) {
+      cells0 = cells;                                           // Copy topology and geometry
+      leaves.clear();                                           // Reset leaf list
+      for (int i=0; i<int(cells0.size()); i++) {                // Loop over cells
+        if (cells0[i].NCHILD == 0) leaves.push_back(i);         //  Collect leaf cells
+      }                                                         // End loop over cells
+      std::sort(leaves.begin(), leaves.end(), [this](int i, int j) {// Sort leaves by their first body
+        return cells0[i].IBODY < cells0[j].IBODY;
+      });
+      leafIndex.assign(cells0.size(), -1);                      // Non-leaf cells have no position
+      for (int l=0; l<int(leaves.size()); l++) leafIndex[leaves[l]] = l;// Position of each leaf
+    }
+
+    //! Fit the remembered tree to bodies that are in the order of the last tree but have moved
+    //! Returns false, leaving bodies and cells untouched, if the tree must be rebuilt instead,
+    //! i.e. if too many bodies changed leaf, or a leaf became empty or overfull
+    bool refit(Bodies & bodies, Cells & cells) {
+      if (cells0.empty() || int(bodies.size()) != size()) return false;// Tree does not fit these bodies
+      logger::startTimer("Refit tree");                         // Start timer
+      const int numBodies = bodies.size();                      // Number of bodies
+      const int numLeaves = leaves.size();                      // Number of leaf cells
+      leafOf.resize(numBodies);                                 // Leaf of each body
+      int numCrossed = 0;                                       // Number of bodies that changed leaf
+#ifdef _OPENMP
+#pragma omp parallel for reduction(+:numCrossed) schedule(dynamic)
+#endif
+      for (int l=0; l<numLeaves; l++) {                         // Loop over leaves
+        const Cell & C = cells0[leaves[l]];                     //  Leaf cell
+        for (int b=C.IBODY; b<C.IBODY+C.NBODY; b++) {           //  Loop over bodies of leaf
+          if (inside(C, bodies[b].X)) {                         //   If body is still in its leaf
+            leafOf[b] = l;                                      //    Keep it there
+          } else {                                              //   Else body crossed a cell boundary
+            leafOf[b] = leafIndex[findLeaf(bodies[b].X)];       //    Move it to the leaf it is in now
+            numCrossed++;                                       //    Count crossing
+          }                                                     //   End if for crossing
+        }                                                       //  End loop over bodies of leaf
+      }                                                         // End loop over leaves
+      offset.assign(numLeaves + 1, 0);                          // Initialize body counts
+      for (int b=0; b<numBodies; b++) offset[leafOf[b]+1]++;    // Count bodies per leaf
+      bool balanced = true;                                     // Whether no leaf is empty or overfull
+      for (int l=0; l<numLeaves; l++) {                         // Loop over leaves
+        if (offset[l+1] == 0) balanced = false;                 //  Leaf lost all its bodies
+        if (offset[l+1] > maxImbalance * ncrit) balanced = false;//  Leaf has too many bodies
+        offset[l+1] += offset[l];                               //  Prefix sum of counts
+      }                                                         // End loop over leaves
+      if (!balanced || numCrossed > maxCrossing * numBodies) {  // If the tree no longer fits the bodies
+        logger::stopTimer("Refit tree");                        //  Stop timer
+        return false;                                           //  Rebuild instead
+      }                                                         // End if for rebuild
+      if (numCrossed > 0) {                                     // If any body changed leaf
+        buffer.resize(numBodies);                               //  Enlarge buffer if necessary
+        std::vector<int> next(offset.begin(), offset.end() - 1);//  Next free slot per leaf
+        for (int b=0; b<numBodies; b++) {                       //  Loop over bodies
+          buffer[next[leafOf[b]]++] = bodies[b];                //   Stable scatter to its leaf
+        }                                                       //  End loop over bodies
+        bodies.swap(buffer);                                    //  Re-binned bodies
+      }                                                         // End if for changed leaves
+      for (int l=0; l<numLeaves; l++) {                         // Loop over leaves
+        Cell & C = cells0[leaves[l]];                           //  Leaf cell, whose bodies the next refit checks
+        C.IBODY = offset[l];                                    //  First body
+        C.NBODY = offset[l+1] - offset[l];                      //  Number of bodies
+      }                                                         // End loop over leaves
+      cells = cells0;                                           // Topology and centers of the built tree
+      for (int l=0; l<numLeaves; l++) {                         // Loop over leaves
+        Cell & C = cells[leaves[l]];                            //  Leaf cell
+        for (B_iter B=bodies.begin()+C.IBODY; B!=bodies.begin()+C.IBODY+C.NBODY; B++) {// Loop over bodies
+          for (int d=0; d<3; d++) C.R = std::max(C.R, std::abs(B->X[d] - C.X[d]));// Grow radius to cover body
+        }                                                       //  End loop over bodies
+      }                                                         // End loop over leaves
+      for (int i=cells.size()-1; i>=0; i--) {                   // Loop over cells bottom up (children follow parents)
+        Cell & C = cells[i];                                    //  Current cell
+        if (C.NCHILD > 0) {                                     //  If cell is not a leaf
+          C.IBODY = cells[C.ICHILD].IBODY;                      //   Initialize first body
+          C.NBODY = 0;                                          //   Initialize number of bodies
+          for (int j=C.ICHILD; j<C.ICHILD+C.NCHILD; j++) {      //   Loop over children
+            C.IBODY = std::min(C.IBODY, cells[j].IBODY);        //    First body of all children
+            C.NBODY += cells[j].NBODY;                          //    Add bodies of child
+            for (int d=0; d<3; d++) C.R = std::max(C.R, std::abs(cells[j].X[d] - C.X[d]) + cells[j].R);// Grow radius to cover child
+          }                                                     //   End loop over children
+        }                                                       //  End if for leaf
+        C.BODY = bodies.begin() + C.IBODY;                      //  Iterator of first body
+      }                                                         // End loop over cells
+      logger::stopTimer("Refit tree");                          // Stop timer
+      return true;                                              // Tree was refit
+    }
+  };
+}
+#endif
@@ -0,0 +1,80 @@
+#ifndef remote_arena_h
+#define remote_arena_h
+#include <list>
+#include <mutex>
+#include <vector>
+#include "types.h"
+
+namespace exafmm {
+  //! Received elements of one reply
+  template <typename VecType>
+  struct RemoteChunk {
+    VecType data;                                               //!< Elements, unpacked from the reply
+    int live;                                                   //!< Number of spans still referring to data
+    typename std::list<RemoteChunk>::iterator self;             //!< Position in the arena
+  };
+
+  //! Non-owning view of the elements of one remote cell inside a chunk
+  template <typename VecType>
+  struct RemoteSpan {
+    typedef typename VecType::iterator iterator;                //!< Iterator of elements
+    iterator first;                                             //!< First element
+    size_t count;                                               //!< Number of elements
+    RemoteChunk<VecType> * chunk;                               //!< Chunk holding the elements
+    RemoteSpan() : count(0), chunk(NULL) {}
+    RemoteSpan(RemoteChunk<VecType> * _chunk, size_t offset, size_t _count) :
+      first(_chunk->data.begin() + offset), count(_count), chunk(_chunk) {}
+    iterator begin() const { return first; }
+    iterator end() const { return first + count; }
+    size_t size() const { return count; }
+  };
+
+  //! Bytes viewed by a span
+  template <typename VecType>
+  inline size_t remoteBytes(const RemoteSpan<VecType> & span) {
+    return span.count * sizeof(typename VecType::value_type);
+  }
+
+  //! Per-rank storage for received cells or bodies
+  //! Each reply is unpacked into one chunk, and cache entries are spans into the chunks
+  template <typename VecType>
+  class RemoteArena {
+  public:
+    typedef RemoteChunk<VecType> Chunk;                         //!< Type of chunk
+    typedef RemoteSpan<VecType> Span;                           //!< Type of span
+
+  private:
+    typedef std::list<Chunk> ChunkList;                         //!< Chunks never move once allocated
+    std::vector<ChunkList> chunks;                              //!< Chunks per rank
+    std::vector<std::mutex> mutex;                              //!< Guards the chunks of each rank
+
+  public:
+    //! Constructor
+    RemoteArena(int numRanks) : chunks(numRanks), mutex(numRanks) {}
+
+    //! Allocate a chunk of n elements for rank with live spans; the caller unpacks into chunk->data
+    Chunk * allocate(int rank, size_t n, int live) {
+      std::lock_guard<std::mutex> lock(mutex[rank]);            // Lock chunks of rank
+      chunks[rank].push_back(Chunk());                          // Append chunk
+      Chunk * chunk = &chunks[rank].back();                     // Pointer to chunk
+      chunk->data.resize(n);                                    // Allocate elements
+      chunk->live = live;                                       // Number of spans that will be created
+      chunk->self = --chunks[rank].end();                       // Remember position for release
+      return chunk;                                             // Return chunk
+    }
+
+    //! Drop a span; the chunk is freed when its last span is dropped
+    void release(int rank, const Span & span) {
+      if (!span.chunk) return;                                  // Empty span
+      std::lock_guard<std::mutex> lock(mutex[rank]);            // Lock chunks of rank
+      if (--span.chunk->live == 0) chunks[rank].erase(span.chunk->self);// Free chunk after its last span
+    }
+
+    //! Free all chunks of rank
+    void clear(int rank) {
+      std::lock_guard<std::mutex> lock(mutex[rank]);            // Lock chunks of rank
+      chunks[rank].clear();                                     // Free chunks
+    }
+  };
+}
+#endif
@@ -0,0 +1,166 @@
+#ifndef remote_cache_h
+#define remote_cache_h
+#include <algorithm>
+#include <atomic>
+#include <pthread.h>
+#include <unordered_map>
+#include <vector>
+#include "types.h"
+
+namespace exafmm {
+  //! Bytes held by a cached vector
+  template <typename T, typename A>
+  inline size_t remoteBytes(const std::vector<T,A> & value) {
+    return value.size() * sizeof(T);
+  }
+
+  //! Bytes held by a cached object
+  template <typename T>
+  inline size_t remoteBytes(const T &) {
+    return sizeof(T);
+  }
+
+  //! Thread-safe cache of data received from remote ranks, sharded per rank and level
+  //! Lookups take a shared lock on one shard, so threads working on different shards never contend
+  template <typename ValueType>
+  class RemoteCache {
+  private:
+    //! Cached data of one remote cell
+    struct Entry {
+      ValueType value;                                          //!< Received data
+      bool ready;                                               //!< False while the request is in flight
+      size_t bytes;                                             //!< Bytes held by value
+      std::atomic<uint64_t> stamp;                              //!< Round of last use
+      Entry() : ready(false), bytes(0), stamp(0) {}
+    };
+    typedef std::unordered_map<uint64_t,Entry> EntryMap;        //!< Map from cell key to entry
+
+    //! Entries of one rank and level with their lock
+    struct Shard {
+      pthread_rwlock_t lock;                                    //!< Reader-writer lock
+      EntryMap entries;                                         //!< Entries of this shard
+    };
+
+    int numLevels;                                              //!< Number of levels per rank
+    std::vector<Shard> shards;                                  //!< Shards indexed by rank * numLevels + level
+    std::atomic<size_t> bytes;                                  //!< Bytes held by all ready entries
+    std::atomic<uint64_t> round;                                //!< Current round, used for LRU eviction
+
+    //! Shard of rank and level
+    Shard & shard(int rank, int level) {
+      return shards[rank * numLevels + level];
+    }
+
+  public:
+    //! Constructor
+    RemoteCache(int numRanks, int _numLevels) : numLevels(_numLevels), shards(numRanks * _numLevels),
+                                                bytes(0), round(0) {
+      for (size_t i=0; i<shards.size(); i++) {                  // Loop over shards
+        pthread_rwlock_init(&shards[i].lock, NULL);             //  Initialize lock
+      }                                                         // End loop over shards
+    }
+
+    //! Destructor
+    ~RemoteCache() {
+      for (size_t i=0; i<shards.size(); i++) {                  // Loop over shards
+        pthread_rwlock_destroy(&shards[i].lock);                //  Destroy lock
+      }                                                         // End loop over shards
+    }
+
+    //! Received data of key, or NULL if it is missing or still in flight
+    //! The pointer stays valid until the entry is cleared or evicted
+    ValueType * find(int rank, int level, uint64_t key) {
+      Shard & S = shard(rank, level);                           // Shard of rank and level
+      ValueType * value = NULL;                                 // Pointer to data
+      pthread_rwlock_rdlock(&S.lock);                           // Shared lock
+      typename EntryMap::iterator it = S.entries.find(key);     // Find entry
+      if (it != S.entries.end() && it->second.ready) {          // If data has arrived
+        it->second.stamp.store(round.load(std::memory_order_relaxed), std::memory_order_relaxed);// Mark as used
+        value = &it->second.value;                              //  Point to data
+      }                                                         // End if for arrived data
+      pthread_rwlock_unlock(&S.lock);                           // Release lock
+      return value;                                             // Return pointer to data
+    }
+
+    //! Mark key as in flight; returns true only for the first caller, who must send the request
+    bool reserve(int rank, int level, uint64_t key) {
+      Shard & S = shard(rank, level);                           // Shard of rank and level
+      pthread_rwlock_wrlock(&S.lock);                           // Exclusive lock
+      bool first = S.entries.find(key) == S.entries.end();      // Nobody has requested key yet
+      if (first) S.entries[key];                                // Insert in-flight entry
+      pthread_rwlock_unlock(&S.lock);                           // Release lock
+      return first;                                             // Return whether to send request
+    }
+
+    //! Store received data for key; value is swapped with the previous data (empty if there was none)
+    ValueType & insert(int rank, int level, uint64_t key, ValueType & value) {
+      Shard & S = shard(rank, level);                           // Shard of rank and level
+      pthread_rwlock_wrlock(&S.lock);                           // Exclusive lock
+      Entry & E = S.entries[key];                               // Entry of key
+      if (E.ready) bytes -= E.bytes;                            // Replace previous data
+      std::swap(E.value, value);                                // Swap data into cache
+      E.ready = true;                                           // Data has arrived
+      E.bytes = remoteBytes(E.value);                           // Account size
+      E.stamp = round.load();                                   // Mark as used
+      bytes += E.bytes;                                         // Add to total size
+      pthread_rwlock_unlock(&S.lock);                           // Release lock
+      return E.value;                                           // Return cached data
+    }
+
+    //! Drop all entries of rank
+    void clear(int rank) {
+      for (int level=0; level<numLevels; level++) {             // Loop over levels
+        Shard & S = shard(rank, level);                         //  Shard of rank and level
+        pthread_rwlock_wrlock(&S.lock);                         //  Exclusive lock
+        for (typename EntryMap::iterator it=S.entries.begin(); it!=S.entries.end(); it++) {// Loop over entries
+          if (it->second.ready) bytes -= it->second.bytes;      //   Subtract size
+        }                                                       //  End loop over entries
+        S.entries.clear();                                      //  Drop entries
+        pthread_rwlock_unlock(&S.lock);                         //  Release lock
+      }                                                         // End loop over levels
+    }
+
+    //! Start a new round; entries not used in the current round become candidates for eviction
+    void nextRound() {
+      round++;
+    }
+
+    //! Evict least recently used entries until at most budget bytes are held, calling release(rank, value) for each
+    //! Only entries not used in the current round are evicted; call when no pointers are held
+    template <typename Release>
+    void evict(size_t budget, Release && release) {
+      if (bytes <= budget) return;                              // Nothing to do under budget
+      typedef std::pair<uint64_t,std::pair<size_t,uint64_t> > Candidate;// (stamp, (shard, key))
+      std::vector<Candidate> candidates;                        // Eviction candidates
+      const uint64_t current = round.load();                    // Current round
+      for (size_t s=0; s<shards.size(); s++) {                  // Loop over shards
+        pthread_rwlock_rdlock(&shards[s].lock);                 //  Shared lock
+        for (typename EntryMap::iterator it=shards[s].entries.begin(); it!=shards[s].entries.end(); it++) {
+          uint64_t stamp = it->second.stamp.load();             //   Round of last use
+          if (it->second.ready && stamp < current) {            //   If not used in this round
+            candidates.push_back(Candidate(stamp, std::make_pair(s, it->first)));// Add to candidates
+          }                                                     //   End if for unused entry
+        }                                                       //  End loop over entries
+        pthread_rwlock_unlock(&shards[s].lock);                 //  Release lock
+      }                                                         // End loop over shards
+      std::sort(candidates.begin(), candidates.end());          // Oldest first
+      for (size_t i=0; i<candidates.size() && bytes > budget; i++) {// Loop until under budget
+        Shard & S = shards[candidates[i].second.first];         //  Shard of candidate
+        pthread_rwlock_wrlock(&S.lock);                         //  Exclusive lock
+        typename EntryMap::iterator it = S.entries.find(candidates[i].second.second);// Find entry again
+        if (it != S.entries.end() && it->second.ready && it->second.stamp.load() < current) {// If still unused
+          bytes -= it->second.bytes;                            //   Subtract size
+          release(int(candidates[i].second.first / numLevels), it->second.value);// Release data
+          S.entries.erase(it);                                  //   Evict entry
+        }                                                       //  End if for unused entry
+        pthread_rwlock_unlock(&S.lock);                         //  Release lock
+      }                                                         // End loop over candidates
+    }
+
+    //! Bytes held by all ready entries
+    size_t size() const {
+      return bytes;
+    }
+  };
+}
+#endif
@@ -1,7 +1,11 @@
 #ifndef simdvec_h
 #define simdvec_h
+#include <climits>
 
 namespace exafmm {
+  const int P2P_TILE_I = 4;                                     //!< Target vectors per P2P register tile
+  const int P2P_TILE_J = 2;                                     //!< Sources per P2P register tile
+
   template<typename T, int D, int N>
   struct SIMD {
     static inline T setBody(B_iter, int) {
@@ -174,7 +178,90 @@ namespace exafmm {
   };
 #endif
 
-  kreal_t transpose(ksimdvec v, int i) {
+  //! Vector of n <= N consecutive bodies starting at i; lanes past n are zero
+  template<typename T, int D, int N>
+  struct SIMDPartial {
+    static inline T setBody(B_iter B, int i, int n) {
+      if (n == N) return SIMD<T,D,N>::setBody(B,i);
+      T v = 0;
+      for (int k=0; k<n; k++) v[k] = B[i+k].X[D];
+      return v;
+    }
+  };
+  template<typename T, int N>
+  struct SIMDPartial<T,3,N> {
+    static inline T setBody(B_iter B, int i, int n) {
+      if (n == N) return SIMD<T,3,N>::setBody(B,i);
+      T v = 0;
+      for (int k=0; k<n; k++) v[k] = B[i+k].SRC;
+      return v;
+    }
+  };
+#if EXAFMM_HELMHOLTZ
+  template<typename T, int N>
+  struct SIMDPartial<T,4,N> {
+    static inline T setBody(B_iter B, int i, int n) {
+      if (n == N) return SIMD<T,4,N>::setBody(B,i);
+      T v = 0;
+      for (int k=0; k<n; k++) v[k] = std::real(B[i+k].SRC);
+      return v;
+    }
+  };
+  template<typename T, int N>
+  struct SIMDPartial<T,5,N> {
+    static inline T setBody(B_iter B, int i, int n) {
+      if (n == N) return SIMD<T,5,N>::setBody(B,i);
+      T v = 0;
+      for (int k=0; k<n; k++) v[k] = std::imag(B[i+k].SRC);
+      return v;
+    }
+  };
+#endif
+
+  //! Load n <= NSIMD contiguous values; lanes past n are zero, and p must be aligned to SIMD_BYTES if n == NSIMD
+  inline simdvec loadPartial(const real_t * p, int n) {
+    simdvec v = 0;
+    if (n == NSIMD) v.load_a(p);
+    else for (int k=0; k<n; k++) v[k] = p[k];
+    return v;
+  }
+
+  //! Add the first n <= NSIMD lanes of v to contiguous values, aligned to SIMD_BYTES if n == NSIMD
+  inline void addPartial(const simdvec & v, real_t * p, int n) {
+    simdvec w = loadPartial(p, n) + v;
+    if (n == NSIMD) w.store_a(p);
+    else for (int k=0; k<n; k++) p[k] = w[k];
+  }
+
+  //! Gather table[index[k]] into the lanes of a SIMD vector (hardware gather with AVX2/AVX-512)
+  inline simdvec gather(const real_t * table, const int * index) {
+#if __AVX512F__ && !__MIC__
+#if EXAFMM_SINGLE
+    return simdvec(lookup<INT_MAX>(Vec16i().load(index), table));
+#else
+    return simdvec(lookup<INT_MAX>(Vec8q(index[0],index[1],index[2],index[3],
+					 index[4],index[5],index[6],index[7]), table));
+#endif
+#elif __AVX__ && !__MIC__
+#if EXAFMM_SINGLE
+    return simdvec(lookup<INT_MAX>(Vec8i().load(index), table));
+#else
+    return simdvec(lookup<INT_MAX>(Vec4q(index[0],index[1],index[2],index[3]), table));
+#endif
+#elif __SSE__ && !__MIC__
+#if EXAFMM_SINGLE
+    return simdvec(lookup<INT_MAX>(Vec4i().load(index), table));
+#else
+    return simdvec(lookup<INT_MAX>(Vec2q(index[0],index[1]), table));
+#endif
+#else
+    simdvec v;
+    for (int k=0; k<NSIMD; k++) v[k] = table[index[k]];
+    return v;
+#endif
+  }
+
+  inline kreal_t transpose(ksimdvec v, int i) {
 #if EXAFMM_USE_KAHAN
     kreal_t temp;
     temp.s = v.s[i];
@@ -185,7 +272,7 @@ namespace exafmm {
 #endif
   }
 
-  kcomplex_t transpose(ksimdvec v_r, ksimdvec v_i, int i) {
+  inline kcomplex_t transpose(ksimdvec v_r, ksimdvec v_i, int i) {
 #if EXAFMM_USE_KAHAN
     kcomplex_t temp;
     temp.s = complex_t(v_r.s[i], v_i.s[i]);
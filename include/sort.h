@@ -1,12 +1,22 @@
 #ifndef sort_h
 #define sort_h
 #include "types.h"
+#include "bodies_soa.h"
+#ifdef _OPENMP
+#include <omp.h>
+#endif
 
 namespace exafmm {
   //! Custom radix sort for body and structures
   class Sort {
   private:
-    Bodies output;                                              //!< Output buffer
+    std::vector<int> bucket;                                    //!< Bucket per thread
+    std::vector<uint64_t> keys;                                 //!< 64-bit keys to sort
+    std::vector<uint64_t> keyBuffer;                            //!< Buffer for 64-bit keys
+    std::vector<int> ikeys;                                     //!< 32-bit keys to sort
+    std::vector<int> index;                                     //!< Permutation index
+    std::vector<int> indexBuffer;                               //!< Buffer for permutation index
+    std::vector<int> destination;                               //!< Destination of each key in one pass
 
   private:
     //! Radixsorts the values using the keys
@@ -15,9 +25,11 @@ namespace exafmm {
       const int stride = 1 << bitStride;                        // Size of stride in decimal
       const int mask = stride - 1;                              // Mask the bits in one stride
       int maxKey = 0;                                           // Maximum value of key
-      int bucket[stride];                                       // Bucket
-      int * buffer = new int [size];                            // Buffer for both key and value
-      int * permutation = new int [size];                       // Permutation index
+      bucket.resize(stride);                                    // Bucket
+      indexBuffer.resize(size);                                 // Buffer for both key and value
+      destination.resize(size);                                 // Permutation index
+      int * buffer = indexBuffer.data();                        // Buffer for both key and value
+      int * permutation = destination.data();                   // Permutation index
       for (int i=0; i<size; i++)                                // Loop over keys
 	if (key[i] > maxKey)                                    //  If key is larger than maxKey
 	  maxKey = key[i];                                      //   Update maxKey per thread
@@ -40,53 +52,163 @@ namespace exafmm {
 	  key[i] = buffer[i] >> bitStride;                      //    Copy back from buffer and bit shift keys
 	maxKey >>= bitStride;                                   //   Bit shift maxKey
       }                                                         //  End while for bits in maxKey
-      delete[] buffer;                                          // Deallocate buffer
-      delete[] permutation;                                     // Deallocate permutation index
+    }
+
+    //! Parallel radixsort of the first size entries of keys, sets index such that keys[index[i]] is sorted
+    void radixsort(int size) {
+      const int bitStride = 8;                                  // Number of bits in one stride
+      const int stride = 1 << bitStride;                        // Size of stride in decimal
+      const int mask = stride - 1;                              // Mask the bits in one stride
+      int maxThreads = 1;                                       // Maximum number of threads
+#ifdef _OPENMP
+      maxThreads = omp_get_max_threads();                       // Get maximum number of threads
+#endif
+      bucket.resize(maxThreads * stride);                       // Bucket per thread
+      index.resize(size);                                       // Permutation index
+      keyBuffer.resize(size);                                   // Buffer for keys
+      indexBuffer.resize(size);                                 // Buffer for permutation
+      uint64_t * key = keys.data();                             // Keys
+      int * permutation = index.data();                         // Permutation
+      uint64_t * keyIn = key;                                   // Keys in current order
+      int * indexIn = permutation;                              // Permutation in current order
+      uint64_t * keyOut = keyBuffer.data();                     // Keys in next order
+      int * indexOut = indexBuffer.data();                      // Permutation in next order
+      uint64_t maxKey = 0;                                      // Bitwise or of all keys
+#ifdef _OPENMP
+#pragma omp parallel for reduction(|:maxKey)
+#endif
+      for (int i=0; i<size; i++) {                              // Loop over keys
+	permutation[i] = i;                                     //  Initialize permutation
+	maxKey |= key[i];                                       //  Collect used bits
+      }                                                         // End loop over keys
+      for (int shift=0; shift<64 && (maxKey >> shift) > 0; shift+=bitStride) {// Loop over strides with used bits
+	bool skip = false;                                      //  Skip pass if all keys have the same digit
+#ifdef _OPENMP
+#pragma omp parallel
+#endif
+	{
+	  int numThreads = 1;                                   //   Number of threads
+	  int ithread = 0;                                      //   Current thread
+#ifdef _OPENMP
+	  numThreads = omp_get_num_threads();                   //   Get number of threads
+	  ithread = omp_get_thread_num();                       //   Get current thread
+#endif
+	  int begin = int(int64_t(size) * ithread / numThreads); //   First key of this thread
+	  int end = int(int64_t(size) * (ithread + 1) / numThreads);// Last key of this thread
+	  int * count = &bucket[ithread * stride];              //   Bucket of this thread
+	  for (int i=0; i<stride; i++)                          //   Loop over strides
+	    count[i] = 0;                                       //    Initialize bucket
+	  for (int i=begin; i<end; i++)                         //   Loop over keys of this thread
+	    count[(keyIn[i] >> shift) & mask]++;                //    Increment bucket
+#ifdef _OPENMP
+#pragma omp barrier
+#pragma omp single
+#endif
+	  {
+	    int offset = 0;                                     //    Running offset
+	    for (int i=0; i<stride; i++) {                      //    Loop over strides
+	      int total = 0;                                    //     Number of keys in bucket i
+	      for (int t=0; t<numThreads; t++)                  //     Loop over threads
+		total += bucket[t * stride + i];                //      Add keys of thread t
+	      if (total == size) skip = true;                   //     All keys fall in one bucket
+	      for (int t=0; t<numThreads; t++) {                //     Loop over threads in order (keeps sort stable)
+		int c = bucket[t * stride + i];                 //      Number of keys of thread t in bucket i
+		bucket[t * stride + i] = offset;                //      Offset of thread t in bucket i
+		offset += c;                                    //      Increment running offset
+	      }                                                 //     End loop over threads
+	    }                                                   //    End loop over strides
+	  }                                                     //   End single (implicit barrier)
+	  if (!skip) {                                          //   If this stride changes the order
+	    for (int i=begin; i<end; i++) {                     //    Loop over keys of this thread
+	      int j = count[(keyIn[i] >> shift) & mask]++;      //     Destination of key
+	      keyOut[j] = keyIn[i];                             //     Scatter key
+	      indexOut[j] = indexIn[i];                         //     Scatter permutation
+	    }                                                   //    End loop over keys of this thread
+	  }                                                     //   End if for stride
+	}                                                       //  End parallel region
+	if (skip) continue;                                     //  Nothing was scattered
+	std::swap(keyIn, keyOut);                               //  Swap key buffers
+	std::swap(indexIn, indexOut);                           //  Swap permutation buffers
+      }                                                         // End loop over strides
+      if (indexIn != permutation) {                             // If result is in the buffer
+	std::copy(indexIn, indexIn + size, permutation);        //  Copy back permutation
+	std::copy(keyIn, keyIn + size, key);                    //  Copy back keys
+      }                                                         // End if for buffer
+    }
+
+    //! Reorder bodies (and their SoA copy) in one pass so that new[i] = old[permutation[i]]
+    void permute(Bodies & bodies, const int * permutation, BodiesSoA * bodiesSoA) {
+      const int size = bodies.size();                           // Size of bodies vector
+      Bodies output(size);                                      // Output buffer, freed with the old order on return
+#ifdef _OPENMP
+#pragma omp parallel for
+#endif
+      for (int i=0; i<size; i++) {                              // Loop over output bodies
+	output[i] = bodies[permutation[i]];                     //  Permute according to index
+      }                                                         // End loop over output bodies
+      bodies.swap(output);                                      // Swap with output buffer
+      if (bodiesSoA) bodiesSoA->permute(permutation);           // Apply the same permutation to SoA bodies
     }
 
   public:
     //! Sort input accoring to ibody
     Bodies ibody(Bodies & input) {
       const int size = input.size();                            // Size of bodies vector
-      int * key = new int [size];                               // Allocate key array
-      int * index = new int [size];                             // Allocate index array
+      ikeys.resize(size);                                       // Resize key array
+      index.resize(size);                                       // Resize index array
+      int * key = ikeys.data();                                 // Key array
       for (B_iter B=input.begin(); B!=input.end(); B++) {       // Loop over input bodies
 	int i = B-input.begin();                                //  Body index
 	key[i] = B->IBODY;                                      //  Copy IBODY to key array
 	index[i] = i;                                           //  Initialize index array
       }                                                         // End loop over input bodies
-      radixsort(key,index,size);                                // Radix sort index according to key
-      output.resize(size);                                      // Resize output buffer
+      radixsort(key,index.data(),size);                         // Radix sort index according to key
+      Bodies output(size);                                      // Output buffer
       for (B_iter B=output.begin(); B!=output.end(); B++) {     // Loop over output boides
 	int i = B-output.begin();                               //  Body index
 	*B = input[index[i]];                                   //  Permute according to index
       }                                                         // End loop over output bodies
-      delete[] key;                                             // Deallocate key array
-      delete[] index;                                           // Deallocate index array
       return output;                                            // Return output
     }
 
     //! Sort input accoring to irank
     Bodies irank(Bodies & input) {
       const int size = input.size();                            // Size of bodies vector
-      int * key = new int [size];                               // Allocate key array
-      int * index = new int [size];                             // Allocate index array
+      ikeys.resize(size);                                       // Resize key array
+      index.resize(size);                                       // Resize index array
+      int * key = ikeys.data();                                 // Key array
       for (B_iter B=input.begin(); B!=input.end(); B++) {       // Loop over input bodies
 	int i = B-input.begin();                                //  Body index
 	key[i] = B->IRANK;                                      //  Copy IRANK to key array
 	index[i] = i;                                           //  Initialize index array
       }                                                         // End loop over input bodies
-      radixsort(key,index,size);                                // Radix sort index according to key
-      output.resize(size);                                      // Resize output buffer
+      radixsort(key,index.data(),size);                         // Radix sort index according to key
+      Bodies output(size);                                      // Output buffer
       for (B_iter B=output.begin(); B!=output.end(); B++) {     // Loop over output boides
 	int i = B-output.begin();                               //  Body index
 	*B = input[index[i]];                                   //  Permute according to index
       }                                                         // End loop over output bodies
-      delete[] key;                                             // Deallocate key array
-      delete[] index;                                           // Deallocate index array
       return output;                                            // Return output
     }
 
+    //! Sort bodies in place according to icell (stable, multithreaded)
+    void sortICELL(Bodies & bodies, BodiesSoA * bodiesSoA = NULL) {
+      const int size = bodies.size();                           // Size of bodies vector
+      keys.resize(size);                                        // Resize key array
+      for (int i=0; i<size; i++) keys[i] = bodies[i].ICELL;     // Copy ICELL to key array
+      radixsort(size);                                          // Radix sort permutation according to key
+      permute(bodies, index.data(), bodiesSoA);                 // Permute bodies
+    }
+
+    //! Sort bodies in place according to irank (stable, multithreaded)
+    void sortIRANK(Bodies & bodies, BodiesSoA * bodiesSoA = NULL) {
+      const int size = bodies.size();                           // Size of bodies vector
+      keys.resize(size);                                        // Resize key array
+      for (int i=0; i<size; i++) keys[i] = bodies[i].IRANK;     // Copy IRANK to key array
+      radixsort(size);                                          // Radix sort permutation according to key
+      permute(bodies, index.data(), bodiesSoA);                 // Permute bodies
+    }
+
     //! Sort bodies back to original order
     Bodies unsort(Bodies & bodies) {
       bodies = ibody(bodies);                                   // Sort bodies
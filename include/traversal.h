@@ -1,5 +1,6 @@
 #ifndef traversal_h
 #define traversal_h
+#include <atomic>
 #include "kernel.h"
 #include "logger.h"
 #include "thread.h"
@@ -8,6 +9,10 @@
 #include "cell_dispatcher.h"
 
 
+#ifndef EXAFMM_BATCH_M2L
+#define EXAFMM_BATCH_M2L 0                                      // Set to 1 to record local M2L pairs and evaluate them in batches
+#endif
+
 #if EXAFMM_COUNT_KERNEL
 #define countKernel(N) N++
 #else
@@ -18,27 +23,63 @@ namespace exafmm {
 template <typename ComType>
 class Traversal {
 private:
+	typedef typename ComType::RemoteCells RemoteCells;          //!< Type of received cell vector
+	typedef typename ComType::CellIterator R_iter;              //!< Iterator of received cells
+
+	//! Remote pair waiting for the children or bodies of its source cell
+	struct RemotePair {
+		C_iter Ci;                                                //!< Target cell
+		R_iter Cj;                                                //!< Remote source cell
+		size_t rank;                                              //!< Rank owning the source cell
+		RemotePair(C_iter _Ci, R_iter _Cj, size_t _rank) : Ci(_Ci), Cj(_Cj), rank(_rank) {}
+	};
+
 	const int nspawn;                                           //!< Threshold of NBODY for spawning new threads
 	const int images;                                           //!< Number of periodic image sublevels
 	int (* listOffset)[3];                                      //!< Offset in interaction lists
 	int (* lists)[3];                                           //!< Interaction lists
 #if EXAFMM_COUNT_KERNEL
-	real_t numP2P;                                              //!< Number of P2P kernel calls
-	real_t numM2L;                                              //!< Number of M2L kernel calls
-	real_t remoteNumP2P;                                        //!< Number of remote P2P kernel calls
-	real_t remoteNumM2L;                                        //!< Number of remote M2L kernel calls
+	std::atomic<long> numP2P;                                   //!< Number of P2P kernel calls
+	std::atomic<long> numM2L;                                   //!< Number of M2L kernel calls
+	std::atomic<long> remoteNumP2P;                             //!< Number of remote P2P kernel calls
+	std::atomic<long> remoteNumM2L;                             //!< Number of remote M2L kernel calls
 #endif
 	C_iter Ci0;                                                 //!< Iterator of first target cell
 	C_iter Cj0;                                                 //!< Iterator of first source cell
+	vecP * Mi0;                                                 //!< Multipole coefficients of first target cell
+	vecP * Li0;                                                 //!< Local coefficients of first target cell
+	vecP * Mj0;                                                 //!< Multipole coefficients of first source cell
+	vecP * Lj0;                                                 //!< Local coefficients of first source cell
 	ComType* communicator;                                      //!< The MPI communication class
+	BodiesSoA * ibodiesSoA;                                     //!< SoA copy of target bodies (optional)
+	BodiesSoA * jbodiesSoA;                                     //!< SoA copy of source bodies (optional)
+	std::vector<RemotePair> remotePairs;                        //!< Remote pairs deferred until their data arrives
+	std::vector<int> subtreeOf;                                 //!< Local subtree of each target cell, -1 above the cut
+	int numSubtrees;                                            //!< Number of local subtrees below the cut
+	std::vector<RemotePair> cutPairs;                           //!< Remote pairs collected at the cut
+	bool collectRemote;                                         //!< Collect pairs at the cut instead of traversing them
+	bool remoteStarted;                                         //!< Remote traversal was started by startTraversalRemote
+	std::vector<RemoteCells> remoteRoots;                       //!< Root cell of each remote tree
+	std::vector<bool> remoteCleared;                            //!< Cache of rank has been cleared
+	std::vector<RemotePair> resumedPairs;                       //!< Pairs resumed in this round
+	std::mutex remoteMutex;                                     //!< Guards remotePairs and cutPairs
+	static const int NCELLLOCK = 1024;                          //!< Number of striped cell locks
+	std::mutex cellLocks[NCELLLOCK];                            //!< Locks of cells written by mutual and remote kernels
+#if EXAFMM_BATCH_M2L
+	std::vector<std::vector<C_iter> > m2lLists;                 //!< Accepted M2L source cells per target cell
+#endif
 
 private:
 #if EXAFMM_COUNT_LIST
 	//! Accumulate interaction list size of cells
 	void countList(C_iter Ci, C_iter Cj, bool mutual, bool isP2P) {
-		if (isP2P) Ci->numP2P++;                                  // If P2P, increment P2P counter of target cell
-		else Ci->numM2L++;                                        // Else, increment M2L counter of target cell
+		{
+			std::unique_lock<std::mutex> lock = lockCell(Ci, mutual);//  Other pairs may share Ci for mutual
+			if (isP2P) Ci->numP2P++;                                //  If P2P, increment P2P counter of target cell
+			else Ci->numM2L++;                                      //  Else, increment M2L counter of target cell
+		}
 		if (mutual) {                                             // If mutual interaction in on
+			std::unique_lock<std::mutex> lock = lockCell(Cj, mutual);//  Other pairs may share Cj
 			if (isP2P) Cj->numP2P++;                                //  If P2P, increment P2P counter of source cell
 			else Cj->numM2L++;                                      //  Else, increment M2L counter of source cell
 		}                                                         // End if for mutual interaction
@@ -47,16 +88,176 @@ private:
 	void countList(C_iter, C_iter, bool, bool) {}
 #endif
 
+	//! P2P kernel between local cells, on the SoA bodies when they are attached
+	//! Other pairs may share Ci or Cj for mutual, so while tasks run concurrently the kernel runs on copies that are added back under the locks
+	//! A self pair writes only one cell, which is locked around the kernel instead of copied
+	void P2P(C_iter Ci, C_iter Cj, bool mutual) {
+		if (mutual && concurrent() && Ci != Cj) {                 // If other pairs may share the cells
+			C_iter C[2] = {Ci, Cj};                                 //  Cells of the pair
+			PairScratch & scratch = copyCells(C, 2);                //  Copy them with zero targets
+			C_iter Cc = scratch.cells.begin();                      //  Copy of Ci, followed by the copy of Cj
+#if EXAFMM_LAPLACE
+			if (ibodiesSoA) kernel::P2P(Cc, Cc + 1, scratch.bodiesSoA, scratch.bodiesSoA, true);// SoA P2P kernel on the copies
+			else
+#endif
+			kernel::P2P(Cc, Cc + 1, true);                          //  P2P kernel on the copies
+			addCells(C, 2, scratch);                                //  Add their targets to the cells
+			return;
+		}                                                         // End if for mutual
+		std::unique_lock<std::mutex> lock = lockCell(Ci, mutual && concurrent());// Other pairs may share a self pair
+#if EXAFMM_LAPLACE
+		if (ibodiesSoA) kernel::P2P(Ci, Cj, *ibodiesSoA, *jbodiesSoA, mutual);// SoA P2P kernel for pair of cells
+		else
+#endif
+		kernel::P2P(Ci, Cj, mutual);                              // P2P kernel for pair of cells
+	}
+
+	//! M2L kernel between local cells; with EXAFMM_BATCH_M2L the pair is only recorded until evaluateM2L
+	void M2L(C_iter Ci, C_iter Cj, bool mutual) {
+#if EXAFMM_BATCH_M2L
+		if (!mutual) {                                            // Tasks never share a target cell without mutual
+			m2lLists[Ci - Ci0].push_back(Cj);                       //  Record source cell
+			return;
+		}                                                         // End if for mutual
+#endif
+		if (mutual) {                                             // Other pairs may share Ci or Cj
+			vecP Li, Lj;                                            //  Local expansions of this pair only
+			Li = Lj = 0;                                            //  Initialize them
+			kernel::M2L(Ci, Cj, Mi0[Ci - Ci0], Li, Mj0[Cj - Cj0], &Lj);//  M2L kernel without holding a lock
+			{
+				std::unique_lock<std::mutex> lock = lockCell(Ci, mutual);// Lock Ci only to add to it
+				Li0[Ci - Ci0] += Li;                                  //   Add to local expansion of Ci
+			}
+			std::unique_lock<std::mutex> lock = lockCell(Cj, mutual);//  Lock Cj only to add to it
+			Lj0[Cj - Cj0] += Lj;                                    //  Add to local expansion of Cj
+			return;
+		}                                                         // End if for mutual
+		kernel::M2L(Ci, Cj, Mi0[Ci - Ci0], Li0[Ci - Ci0], Mj0[Cj - Cj0], NULL);// M2L kernel for pair of cells
+	}
+
+	//! Evaluate the recorded M2L lists, all sources of one target cell in one batch
+	void evaluateM2L() {
+#if EXAFMM_BATCH_M2L
+		int numCells = m2lLists.size();                           // Number of target cells
+#ifdef _OPENMP
+#pragma omp parallel for schedule(dynamic)
+#endif
+		for (int i = 0; i < numCells; i++) {                      // Loop over target cells
+			if (!m2lLists[i].empty()) {                             //  If cell has M2L sources
+				kernel::M2LBatch(Ci0 + i, &m2lLists[i][0], m2lLists[i].size(), // Batched M2L kernel
+				                 Cj0, Mi0[i], Li0[i], Mj0);
+				m2lLists[i].clear();                                  //   Keep capacity for the next traversal
+			}                                                       //  End if for M2L sources
+		}                                                         // End loop over target cells
+#endif
+	}
+
+	//! P2P kernel within a local cell, on the SoA bodies when they are attached
+	//! Other pairs may share C for mutual; only one cell is written, so it is locked around the kernel instead of copied
+	void P2P(C_iter C, bool mutual) {
+		std::unique_lock<std::mutex> lock = lockCell(C, mutual && concurrent());// Other pairs may share C
+#if EXAFMM_LAPLACE
+		if (ibodiesSoA) kernel::P2P(C, *ibodiesSoA);              // SoA P2P kernel for single cell
+		else
+#endif
+		kernel::P2P(C);                                           // P2P kernel for single cell
+	}
+
 #if EXAFMM_USE_WEIGHT
 	//! Accumulate interaction weights of cells
 	void countWeight(C_iter Ci, C_iter Cj, bool mutual, real_t weight) {
-		Ci->WEIGHT += weight;                                     // Increment weight of target cell
-		if (mutual) Cj->WEIGHT += weight;                         // Increment weight of source cell
+		{
+			std::unique_lock<std::mutex> lock = lockCell(Ci, mutual);//  Other pairs may share Ci for mutual
+			Ci->WEIGHT += weight;                                   //  Increment weight of target cell
+		}
+		if (mutual) {                                             // If mutual interaction in on
+			std::unique_lock<std::mutex> lock = lockCell(Cj, mutual);//  Other pairs may share Cj
+			Cj->WEIGHT += weight;                                   //  Increment weight of source cell
+		}                                                         // End if for mutual interaction
 	}
 #else
 	void countWeight(C_iter, C_iter, bool, real_t) {}
 #endif
 
+	//! Stripe of the lock guarding a cell
+	int lockIndex(C_iter C) {
+		return (uintptr_t(&*C) / sizeof(Cell)) % NCELLLOCK;
+	}
+
+	//! Whether other tasks may be running kernels now, so that cells shared by mutual pairs need copies or locks
+	bool concurrent() const {
+#if EXAFMM_WITH_OPENMP
+		return omp_in_parallel() && omp_get_num_threads() > 1;    // Tasks run on the threads of the parallel region
+#elif EXAFMM_WITH_TBB || EXAFMM_WITH_MTHREAD || EXAFMM_WITH_QTHREAD || EXAFMM_WITH_CILK
+		return true;                                              // Tasks may run on any worker
+#else
+		return false;                                             // Tasks run in the calling thread
+#endif
+	}
+
+	//! Lock of a cell that other pairs may share for mutual, no lock otherwise
+	//! Only one cell is locked at a time, so no order of locks is needed
+	std::unique_lock<std::mutex> lockCell(C_iter C, bool mutual) {
+		if (!mutual) return std::unique_lock<std::mutex>();     // Tasks never share a target cell without mutual
+		return std::unique_lock<std::mutex>(cellLocks[lockIndex(C)]);
+	}
+
+	//! Copies of the cells of one mutual kernel and of their bodies, which the kernel writes without a lock
+	struct PairScratch {
+		Cells cells;                                              //!< Copies of the cells
+		Bodies bodies;                                            //!< Copies of their bodies, one cell after another
+		BodiesSoA bodiesSoA;                                      //!< SoA copies of their bodies, when SoA bodies are attached
+	};
+
+	//! Copy the n cells in C and their bodies with zero targets to the scratch of this thread
+	PairScratch & copyCells(const C_iter * C, int n) {
+		static thread_local PairScratch scratch;                  // Kept between kernels to reuse its capacity
+		int nbody = 0, nentry = 0;                                // Number of bodies and of padded SoA entries in the cells
+		for (int k = 0; k < n; k++) {                             // Loop over cells
+			nbody += C[k]->NBODY;                                   //  Count bodies
+			if (ibodiesSoA) nentry += (k == 0 ? ibodiesSoA : jbodiesSoA)->count(C[k]);// Count entries
+		}                                                         // End loop over cells
+		scratch.cells.resize(n);                                  // One copy per cell
+		if (ibodiesSoA) {                                         // If SoA bodies are attached
+			scratch.bodiesSoA.resize(nentry);                       //  Room for the padded SoA bodies
+			scratch.bodiesSoA.entry.resize(nbody);                  //  One entry per body
+		} else scratch.bodies.resize(nbody);                      // Else room for the bodies
+		for (int k = 0, offset = 0, eoffset = 0; k < n; offset += C[k]->NBODY, k++) {// Loop over cells
+			Cell & cell = scratch.cells[k];                         //  Copy of cell
+			cell = *C[k];                                           //  Copy geometry and body count
+			if (ibodiesSoA) {                                       //  If SoA bodies are attached
+				BodiesSoA & B = k == 0 ? *ibodiesSoA : *jbodiesSoA;   //   Ci is a target, the other cell a source
+				int e0 = B.begin(C[k]), ne = B.count(C[k]);           //   Padded entries of the cell
+				cell.IBODY = offset;                                  //   Point copy to its SoA bodies
+				for (int b = 0; b < cell.NBODY; b++) scratch.bodiesSoA.entry[offset + b] = eoffset + B.entry[C[k]->IBODY + b] - e0;
+				for (int e = 0; e < ne; e++) scratch.bodiesSoA.set(eoffset + e, B, e0 + e);// Copy with padding, so the copy starts aligned too
+				eoffset += ne;                                        //   Next copy starts at a multiple of NSIMD
+			} else {                                                //  Else bodies are AoS
+				cell.BODY = scratch.bodies.begin() + offset;          //   Point copy to its bodies
+				for (int b = 0; b < cell.NBODY; b++) {                //   Loop over bodies
+					cell.BODY[b] = C[k]->BODY[b];                       //    Copy body
+					cell.BODY[b].TRG = 0;                               //    Zero its targets
+				}                                                     //   End loop over bodies
+			}                                                       //  End if for SoA bodies
+		}                                                         // End loop over cells
+		return scratch;                                           // Return scratch of this thread
+	}
+
+	//! Add the targets of the copies made by copyCells to the n cells in C, locking one cell at a time
+	void addCells(const C_iter * C, int n, const PairScratch & scratch) {
+		for (int k = 0, offset = 0, eoffset = 0; k < n; offset += C[k]->NBODY, k++) {// Loop over cells
+			std::unique_lock<std::mutex> lock = lockCell(C[k], true);//  Other pairs may share the cell
+			if (ibodiesSoA) {                                       //  If SoA bodies are attached
+				BodiesSoA & B = k == 0 ? *ibodiesSoA : *jbodiesSoA;   //   Same bodies as copyCells
+				int e0 = B.begin(C[k]), ne = B.count(C[k]);           //   Padded entries of the cell
+				for (int e = 0; e < ne; e++) B.addTarget(e0 + e, scratch.bodiesSoA, eoffset + e);
+				eoffset += ne;                                        //   Same offsets as copyCells
+			} else {                                                //  Else bodies are AoS
+				for (int b = 0; b < C[k]->NBODY; b++) C[k]->BODY[b].TRG += scratch.bodies[offset + b].TRG;
+			}                                                       //  End if for SoA bodies
+		}                                                         // End loop over cells
+	}
+
 	//! Get level from key
 	int getLevel(uint64_t key) {
 		int level = -1;                                           // Initialize level
@@ -190,10 +391,64 @@ private:
 		}                                                         // End loop over target cells
 	}
 
+	//! Request the children or bodies of a remote cell and defer the pair until they arrive
+	void deferRemote(C_iter Ci, R_iter Cj, size_t rank, int requestType) {
+		if (requestType == BODYTAG) communicator->requestBodies(Cj->ICELL, Cj->LEVEL, rank);// Queue request for bodies
+		else communicator->requestChildren(Cj->ICELL, Cj->LEVEL, rank);// Queue request for children
+		std::lock_guard<std::mutex> lock(remoteMutex);            // Pairs are deferred from many tasks
+		remotePairs.push_back(RemotePair(Ci, Cj, rank));          // Defer pair
+	}
+
+	//! Assign every target cell to the subtree below the cut that contains it
+	//! Subtrees have fewer than nspawn bodies; cells above the cut get -1
+	void setSubtrees(C_iter C, int subtree) {
+		if (subtree < 0 && (C->NCHILD == 0 || C->NBODY < nspawn)) {// If C is the root of a subtree
+			subtree = numSubtrees++;                                //  Index of new subtree
+		}                                                         // End if for root of subtree
+		subtreeOf[C - Ci0] = subtree;                             // Subtree owning C
+		for (C_iter CC = Ci0 + C->ICHILD; CC != Ci0 + C->ICHILD + C->NCHILD; CC++) {// Loop over child cells
+			setSubtrees(CC, subtree);                               //  Recursive call for child
+		}                                                         // End loop over child cells
+	}
+
+	//! Functor that traverses one pair of a local subtree and a remote cell collected at the cut
+	struct TraverseRemotePair {
+		Traversal * traversal;                                    //!< Traversal object
+		RemotePair pair;                                          //!< Pair collected at the cut
+		real_t remote;                                            //!< Weight for remote work load
+		TraverseRemotePair(Traversal * _traversal, const RemotePair & _pair, real_t _remote) :// Constructor
+			traversal(_traversal), pair(_pair), remote(_remote) {}  // Initialize variables
+		void operator() () {                                      // Overload operator()
+			Tracer tracer;                                          //  Instantiate tracer
+			logger::startTracer(tracer);                            //  Start tracer
+			traversal->traverseRemote(pair.Ci, pair.Cj, false, remote, pair.rank);// Traverse, or defer
+			logger::stopTracer(tracer);                             //  Stop tracer
+		}                                                         // End overload operator()
+	};
+
+	//! Traverse the pairs collected at the cut with one task per pair
+	//! Pairs may share a target cell, so traverseRemote locks it around the kernels
+	void traverseSubtrees(real_t remote) {
+		collectRemote = false;                                    // Traverse below the cut from now on
+#if EXAFMM_WITH_OPENMP
+#pragma omp parallel
+#pragma omp single
+#endif
+		{                                                         // Tasks only run in parallel inside a parallel region
+			mk_task_group;                                          //  Initialize task group
+			for (size_t p = 0; p < cutPairs.size(); p++) {          //  Loop over collected pairs
+				TraverseRemotePair pair(this, cutPairs[p], remote);   //   Instantiate functor
+				create_taskc(pair);                                   //   Create new task for pair
+			}                                                       //  End loop over collected pairs
+			wait_tasks;                                             //  Synchronize task group
+		}                                                         // End parallel region
+		cutPairs.clear();                                         // All pairs are done or deferred
+		collectRemote = true;                                     // Collect pairs again
+	}
+
 	//! Split cell and call traverse() recursively for child
 	template <typename I_iter, typename J_iter>
 	void splitCellRemote(I_iter Ci, J_iter Cj, bool mutual, real_t remote, size_t rank) {
-		double commtime;
 		if (Cj->NCHILD == 0) {                                      // If Cj is leaf
 			assert(Ci->NCHILD > 0);                                   //  Make sure Ci is not leaf
 			for (I_iter ci = Ci0 + Ci->ICHILD; ci != Ci0 + Ci->ICHILD + Ci->NCHILD; ci++) { // Loop over Ci's children
@@ -201,31 +456,34 @@ private:
 			}                                                         //  End loop over Ci's children
 		} else if (Ci->NCHILD == 0) {                               // Else if Ci is leaf
 			assert(Cj->NCHILD > 0);                                   //  Make sure Cj is not leaf
-			auto&& cells = communicator->getCell(Cj->ICELL, Cj->NCHILD, Cj->LEVEL, rank, CHILDCELLTAG, commtime);
-#if WEIGH_COM
-			Ci->WEIGHT += commtime;
-#endif
-			for (auto cj = cells.begin(); cj != cells.end(); ++cj) {// Loop over Cj's children
+			auto&& cells = communicator->findChildren(Cj->ICELL, Cj->LEVEL, rank);
+			if (!cells) {                                             //  If children have not arrived yet
+				deferRemote(Ci, Cj, rank, CHILDCELLTAG);                //   Resume this pair when they do
+				return;
+			}
+			for (auto cj = cells->begin(); cj != cells->end(); ++cj) {// Loop over Cj's children
 				traverseRemote(Ci, cj, mutual, remote, rank);            //   Traverse a single pair of cells
 			}
 		} else if (Ci->NBODY + Cj->NBODY >= nspawn) {// Else if cells are still large
-			auto&& cells = communicator->getCell(Cj->ICELL, Cj->NCHILD, Cj->LEVEL, rank, CHILDCELLTAG, commtime);
-#if WEIGH_COM
-			Ci->WEIGHT += commtime;
-#endif
+			auto&& cells = communicator->findChildren(Cj->ICELL, Cj->LEVEL, rank);
+			if (!cells) {                                             //  If children have not arrived yet
+				deferRemote(Ci, Cj, rank, CHILDCELLTAG);                //   Resume this pair when they do
+				return;
+			}
 			TraverseRemoteRange<I_iter, J_iter> traverseRange(this, Ci0 + Ci->ICHILD, Ci0 + Ci->ICHILD + Ci->NCHILD, // Instantiate recursive functor
-			    cells.begin(), cells.end(), mutual, remote, rank);
+			    cells->begin(), cells->end(), mutual, remote, rank);
 			traverseRange();
 		} else if (Ci->R >= Cj->R) {                                // Else if Ci is larger than Cj
 			for (I_iter ci = Ci0 + Ci->ICHILD; ci != Ci0 + Ci->ICHILD + Ci->NCHILD; ci++) { // Loop over Ci's children
 				traverseRemote(ci, Cj, mutual, remote, rank);            //   Traverse a single pair of cells
 			}                                                         //  End loop over Ci's children
 		} else {                                                    // Else if Cj is larger than Ci
-			auto&& cells = communicator->getCell(Cj->ICELL, Cj->NCHILD, Cj->LEVEL, rank, CHILDCELLTAG, commtime);
-#if WEIGH_COM
-			Ci->WEIGHT += commtime;
-#endif
-			for (auto cj = cells.begin(); cj != cells.end(); ++cj) {// Loop over Cj's children
+			auto&& cells = communicator->findChildren(Cj->ICELL, Cj->LEVEL, rank);
+			if (!cells) {                                             //  If children have not arrived yet
+				deferRemote(Ci, Cj, rank, CHILDCELLTAG);                //   Resume this pair when they do
+				return;
+			}
+			for (auto cj = cells->begin(); cj != cells->end(); ++cj) {// Loop over Cj's children
 				traverseRemote(Ci, cj, mutual, remote, rank);            //   Traverse a single pair of cells
 			}                                                         //  End loop over Cj's children
 		}                                                           // End if for leafs and Ci Cj size
@@ -262,41 +520,70 @@ private:
 	//! Dual tree traversal for a single pair of cells
 	template <typename I_iter, typename J_iter>
 	void traverseRemote(I_iter Ci, J_iter Cj, bool mutual, real_t remote, size_t rank) {
+		if (collectRemote && subtreeOf[Ci - Ci0] >= 0) {            // If Ci is below the cut
+			std::lock_guard<std::mutex> lock(remoteMutex);          //  Pairs are collected from many tasks
+			cutPairs.push_back(RemotePair(Ci, Cj, rank));           //  Leave pair to its own task
+			return;
+		}                                                           // End if for below the cut
 		vec3 dX = Ci->X - Cj->X - kernel::Xperiodic;                // Distance vector from source to target
 		real_t R2 = norm(dX);                                       // Scalar distance squared
 		if (R2 > (Ci->R + Cj->R) * (Ci->R + Cj->R) * (1 - 1e-3)) {  // Distance is far enough
-			kernel::M2L(Ci, Cj,false);          					                  //  M2L kernel
-			countKernel(remoteNumM2L);                                //  Increment remote M2L counter
+			M2LRemote(Ci, Cj);                                        //  M2L kernel
 			//countWeight(Ci, remote,remoteWeight*0.25);              //   Increment P2P weight
 		} else if (Ci->NCHILD == 0 && Cj->NCHILD == 0) {            // Else if both cells are bodies
-			double commtime;
-			auto&& bodies = communicator->getBodies(Cj->ICELL, Cj->LEVEL, rank, BODYTAG, commtime);
-#if WEIGH_COM
-			Ci->WEIGHT += commtime;
-#endif
-			if (bodies.size() > 0) {
-				Cj->BODY = bodies.begin();
-				kernel::P2P(Ci, Cj, false);   								          //    P2P kernel for pair of cells
-				countKernel(remoteNumP2P);                              //  Increment remote M2L counter
+			auto&& bodies = communicator->findBodies(Cj->ICELL, Cj->LEVEL, rank);
+			if (!bodies) {                                            //  If bodies have not arrived yet
+				deferRemote(Ci, Cj, rank, BODYTAG);                     //   Resume this pair when they do
+				return;
+			}
+			if (bodies->size() > 0) {
+				Cells leaf(1, *Cj);                                     //   Copy of Cj without multipole, other tasks may be using Cj
+				leaf[0].BODY = bodies->begin();                         //   Point it to the received bodies
+				assert(!ibodiesSoA);                                    //   Remote P2P runs on the Body vector
+				PairScratch & scratch = copyCells(&Ci, 1);              //   Copy Ci with zero targets
+				kernel::P2P(scratch.cells.begin(), leaf.begin(), false);//   P2P kernel on the copy, without holding a lock
+				addCells(&Ci, 1, scratch);                              //   Lock Ci only to add to it
+				countKernel(remoteNumP2P);                              //  Increment remote P2P counter
 #if 0
 				countWeight(Ci, remoteWeight);                          //   Increment P2P weight
 #endif
 			} else {
-				kernel::M2L(Ci, Cj,false);                   						//   M2L kernel
-				countKernel(remoteNumM2L);                              //  Increment remote M2L counter
+				M2LRemote(Ci, Cj);                                      //   M2L kernel
 				//countWeight(Ci, remote,remoteWeight*0.25);            //   Increment M2L weight
 			}
 		} else {                                                    // Else if cells are close but not bodies
-			splitCellRemote(Ci, Cj, mutual, remote, rank);						//  Split cell and call function recursively for child
+			splitCellRemote(Ci, Cj, mutual, remote, rank);            //  Split cell and call function recursively for child
 		}                                                           // End if for multipole acceptance
 	}
 
+	//! M2L kernel from a remote cell; pairs may share Ci, so it is locked only to add the result
+	template <typename I_iter, typename J_iter>
+	void M2LRemote(I_iter Ci, J_iter Cj) {
+		vecP L;                                                     // Local expansion of this pair only
+		L = 0;                                                      // Initialize it
+		kernel::M2L(Ci, Cj, Mi0[Ci - Ci0], L, Cj->M, NULL);         // M2L kernel without holding a lock
+		{
+			std::unique_lock<std::mutex> lock = lockCell(Ci, true);   //  Lock Ci only to add to it
+			Li0[Ci - Ci0] += L;                                       //  Add to local expansion of Ci
+		}
+		countKernel(remoteNumM2L);                                  // Increment remote M2L counter
+	}
+
+	//! Dual tree traversal from the root cells, spawning its tasks inside a parallel region
+	void traverseRoots(bool mutual, real_t remote) {
+#if EXAFMM_WITH_OPENMP
+#pragma omp parallel
+#pragma omp single
+#endif
+		dualTreeTraversal(Ci0, Cj0, mutual, remote);              // Traverse the tree
+	}
+
 	//! Dual tree traversal for a single pair of cells
 	void dualTreeTraversal(C_iter Ci, C_iter Cj, bool mutual, real_t remote) {
 		vec3 dX = Ci->X - Cj->X - kernel::Xperiodic;              // Distance vector from source to target
 		real_t R2 = norm(dX);                                     // Scalar distance squared
 		if (R2 > (Ci->R + Cj->R) * (Ci->R + Cj->R) * (1 - 1e-3)) { // If distance is far enough
-			kernel::M2L(Ci, Cj, mutual);                            //  M2L kernel
+			M2L(Ci, Cj, mutual);                                    //  M2L kernel
 			countKernel(numM2L);                                    //  Increment M2L counter
 			countList(Ci, Cj, mutual, false);                       //  Increment M2L list
 			countWeight(Ci, Cj, mutual, remote);                    //  Increment M2L weight
@@ -329,13 +616,13 @@ private:
 #endif
 			if (Cj->NBODY == 0) {                                   //  If the bodies weren't sent from remote node
 				//std::cout << "Warning: icell " << Ci->ICELL << " needs bodies from jcell" << Cj->ICELL << std::endl;
-				kernel::M2L(Ci, Cj, mutual);                          //   M2L kernel
+				M2L(Ci, Cj, mutual);                                  //   M2L kernel
 				countKernel(numM2L);                                  //   Increment M2L counter
 				countList(Ci, Cj, mutual, false);                     //   Increment M2L list
 				countWeight(Ci, Cj, mutual, remote);                  //   Increment M2L weight
 #if EXAFMM_NO_P2P
 			} else if (!isNeighbor) {                               //  If GROAMCS handles neighbors
-				kernel::M2L(Ci, Cj, mutual);                          //   M2L kernel
+				M2L(Ci, Cj, mutual);                                  //   M2L kernel
 				countKernel(numM2L);                                  //   Increment M2L counter
 				countList(Ci, Cj, mutual, false);                     //   Increment M2L list
 				countWeight(Ci, Cj, mutual, remote);                  //   Increment M2L weight
@@ -344,9 +631,9 @@ private:
 #else
 			} else {
 				if (R2 == 0 && Ci == Cj) {                            //   If source and target are same
-					kernel::P2P(Ci);                                    //    P2P kernel for single cell
+					P2P(Ci, mutual);                                    //    P2P kernel for single cell
 				} else {                                              //   Else if source and target are different
-					kernel::P2P(Ci, Cj, mutual);                        //    P2P kernel for pair of cells
+					P2P(Ci, Cj, mutual);                                //    P2P kernel for pair of cells
 				}                                                     //   End if for same source and target
 				countKernel(numP2P);                                  //   Increment P2P counter
 				countList(Ci, Cj, mutual, true);                      //   Increment P2P list
@@ -390,98 +677,97 @@ private:
 				C_iter CiMid = CiBegin + (CiEnd - CiBegin) / 2;       //   Split range of Ci cells in half
 				C_iter CjMid = CjBegin + (CjEnd - CjBegin) / 2;       //   Split range of Cj cells in half
 				mk_task_group;                                        //   Initialize task group
-				{
-					TraverseRange leftBranch(traversal, CiBegin, CiMid, //    Instantiate recursive functor
-					                         CjBegin, CjMid, mutual, remote);
-					create_taskc(leftBranch);                           //    Ci:former Cj:former
-					TraverseRange rightBranch(traversal, CiMid, CiEnd,  //    Instantiate recursive functor
-					                          CjMid, CjEnd, mutual, remote);
-					rightBranch();                                      //    Ci:latter Cj:latter
-					wait_tasks;                                         //    Synchronize task group
-				}
-				{
-					TraverseRange leftBranch(traversal, CiBegin, CiMid, //    Instantiate recursive functor
-					                         CjMid, CjEnd, mutual, remote);
-					create_taskc(leftBranch);                           //    Ci:former Cj:latter
-					if (!mutual || CiBegin != CjBegin) {                //    Exclude mutual & self interaction
-						TraverseRange rightBranch(traversal, CiMid, CiEnd,//    Instantiate recursive functor
-						                          CjBegin, CjMid, mutual, remote);
-						rightBranch();                                    //    Ci:latter Cj:former
-					} else {                                            //    If mutual or self interaction
-						assert(CiEnd == CjEnd);                           //     Check if mutual & self interaction
+				if (mutual) {                                         //   If kernels lock the cells they write to
+					TraverseRange formerFormer(traversal, CiBegin, CiMid,//   Instantiate recursive functor
+					                           CjBegin, CjMid, mutual, remote);
+					create_taskc(formerFormer);                         //    Ci:former Cj:former
+					TraverseRange latterLatter(traversal, CiMid, CiEnd, //    Instantiate recursive functor
+					                           CjMid, CjEnd, mutual, remote);
+					create_taskc(latterLatter);                         //    Ci:latter Cj:latter
+					if (CiBegin != CjBegin) {                           //    Exclude mutual & self interaction
+						TraverseRange latterFormer(traversal, CiMid, CiEnd,// Instantiate recursive functor
+						                           CjBegin, CjMid, mutual, remote);
+						create_taskc(latterFormer);                       //     Ci:latter Cj:former
 					}                                                   //    End if for mutual & self interaction
+					TraverseRange formerLatter(traversal, CiBegin, CiMid,//   Instantiate recursive functor
+					                           CjMid, CjEnd, mutual, remote);
+					formerLatter();                                     //    Ci:former Cj:latter
 					wait_tasks;                                         //    Synchronize task group
-				}
+				} else {                                              //   Else tasks may not share a target cell
+					{
+						TraverseRange leftBranch(traversal, CiBegin, CiMid,//     Instantiate recursive functor
+						                         CjBegin, CjMid, mutual, remote);
+						create_taskc(leftBranch);                         //     Ci:former Cj:former
+						TraverseRange rightBranch(traversal, CiMid, CiEnd,//     Instantiate recursive functor
+						                          CjMid, CjEnd, mutual, remote);
+						rightBranch();                                    //     Ci:latter Cj:latter
+						wait_tasks;                                       //     Synchronize task group
+					}
+					{
+						TraverseRange leftBranch(traversal, CiBegin, CiMid,//     Instantiate recursive functor
+						                         CjMid, CjEnd, mutual, remote);
+						create_taskc(leftBranch);                         //     Ci:former Cj:latter
+						TraverseRange rightBranch(traversal, CiMid, CiEnd,//     Instantiate recursive functor
+						                          CjBegin, CjMid, mutual, remote);
+						rightBranch();                                    //     Ci:latter Cj:former
+						wait_tasks;                                       //     Synchronize task group
+					}
+				}                                                     //   End if for mutual
 			}                                                       //  End if for many cells in range
 			logger::stopTracer(tracer);                             //  Stop tracer
 		}                                                         // End overload operator()
 	};
 
-		//! Recursive functor for dual tree traversal of a range of Ci and Cj
+	//! Recursive functor for dual tree traversal of a range of local Ci and remote Cj
 	template <typename I_iter, typename J_iter>
 	struct TraverseRemoteRange {
-		Traversal * traversal;                                      //!< Traversal object
-		I_iter CiBegin;                                             //!< Begin iterator of target cells
-		I_iter CiEnd;                                               //!< End iterator of target cells
-		J_iter CjBegin;                                             //!< Begin Iterator of source cells
-		J_iter CjEnd;                                               //!< End iterator of source cells		
-		bool mutual;                                                //!< Flag for mutual interaction
-		real_t remote;                                              //!< Weight for remote work load
-		size_t rank;
+		Traversal * traversal;                                    //!< Traversal object
+		I_iter CiBegin;                                           //!< Begin iterator of target cells
+		I_iter CiEnd;                                             //!< End iterator of target cells
+		J_iter CjBegin;                                           //!< Begin Iterator of source cells
+		J_iter CjEnd;                                             //!< End iterator of source cells
+		bool mutual;                                              //!< Flag for mutual interaction
+		real_t remote;                                            //!< Weight for remote work load
+		size_t rank;                                              //!< Rank that owns the source cells
 		TraverseRemoteRange(Traversal * _traversal, I_iter _CiBegin, I_iter _CiEnd,// Constructor
 		                    J_iter _CjBegin, J_iter _CjEnd,
 		                    bool _mutual, real_t _remote, size_t _rank) :
-			traversal(_traversal), CiBegin(_CiBegin), CiEnd(_CiEnd),  // Initialize variables
-			CjBegin(_CjBegin), CjEnd(_CjEnd),
-			mutual(_mutual), remote(_remote), rank(_rank) {}
-		void operator() () {                                        // Overload operator()
-			Tracer tracer;                                            //  Instantiate tracer
-			logger::startTracer(tracer);                              //  Start tracer
-			if (CiEnd - CiBegin == 1 || CjEnd - CjBegin == 1) {       //  If only one cell in range
-				for (I_iter Ci = CiBegin; Ci != CiEnd; Ci++) {        //    Loop over all Ci cells
-					for (J_iter Cj = CjBegin; Cj != CjEnd; Cj++) {      //     Loop over all Cj cells
-						traversal->traverseRemote(Ci, Cj, mutual, remote, rank); // Call traverse for single pair
-					}                                                   //     End loop over all Cj cells
-				}                                                       //   End if for Ci == Cj
-			} else {                                                  //  If many cells are in the range
-				I_iter CiMid = CiBegin + (CiEnd - CiBegin) / 2;         //   Split range of Ci cells in half
-				J_iter CjMid = CjBegin + (CjEnd - CjBegin) / 2;         //   Split range of Cj cells in half
-#if THREADED_REMOTE
-				mk_task_group;                                          //   Initialize task group
-#endif
+			traversal(_traversal), CiBegin(_CiBegin), CiEnd(_CiEnd),// Initialize variables
+			CjBegin(_CjBegin), CjEnd(_CjEnd), mutual(_mutual), remote(_remote), rank(_rank) {}
+		void operator() () {                                      // Overload operator()
+			Tracer tracer;                                          //  Instantiate tracer
+			logger::startTracer(tracer);                            //  Start tracer
+			if (CiEnd - CiBegin == 1 || CjEnd - CjBegin == 1) {     //  If only one cell in range
+				for (I_iter Ci = CiBegin; Ci != CiEnd; Ci++) {        //   Loop over all Ci cells
+					for (J_iter Cj = CjBegin; Cj != CjEnd; Cj++) {      //    Loop over all Cj cells
+						traversal->traverseRemote(Ci, Cj, mutual, remote, rank);//     Call traverse for single pair
+					}                                                   //    End loop over all Cj cells
+				}                                                     //   End loop over all Ci cells
+			} else {                                                //  If many cells are in the range
+				I_iter CiMid = CiBegin + (CiEnd - CiBegin) / 2;       //   Split range of Ci cells in half
+				J_iter CjMid = CjBegin + (CjEnd - CjBegin) / 2;       //   Split range of Cj cells in half
+				mk_task_group;                                        //   Initialize task group
 				{
-					TraverseRemoteRange<I_iter, J_iter> leftBranch(traversal, CiBegin, CiMid,   //    Instantiate recursive functor
-					    CjBegin, CjMid, mutual, remote, rank);
-#if THREADED_REMOTE
-					create_taskc(leftBranch);                             //    Ci:former Cj:former
-#else
-					leftBranch();
-#endif
-					TraverseRemoteRange<I_iter, J_iter> rightBranch(traversal, CiMid, CiEnd,    //    Instantiate recursive functor
-					    CjMid, CjEnd, mutual, remote, rank);;
-					rightBranch();                                        //    Ci:latter Cj:latter
-#if THREADED_REMOTE
-					wait_tasks;                                           //    Synchronize task group
-#endif
+					TraverseRemoteRange leftBranch(traversal, CiBegin, CiMid,//    Instantiate recursive functor
+					                               CjBegin, CjMid, mutual, remote, rank);
+					create_taskc(leftBranch);                           //    Ci:former Cj:former
+					TraverseRemoteRange rightBranch(traversal, CiMid, CiEnd,//    Instantiate recursive functor
+					                                CjMid, CjEnd, mutual, remote, rank);
+					rightBranch();                                      //    Ci:latter Cj:latter
+					wait_tasks;                                         //    Synchronize task group
 				}
 				{
-					TraverseRemoteRange<I_iter, J_iter> leftBranch(traversal, CiBegin, CiMid,   //    Instantiate recursive functor
-					    CjMid, CjEnd, mutual, remote, rank);;
-#if THREADED_REMOTE
-					create_taskc(leftBranch);                             //    Ci:former Cj:latter
-#else
-					leftBranch();
-#endif
-					TraverseRemoteRange<I_iter, J_iter> rightBranch(traversal, CiMid, CiEnd,  //    Instantiate recursive functor
-					    CjBegin, CjMid, mutual, remote, rank);;
-					rightBranch();                                            //    Ci:latter Cj:former
-#if THREADED_REMOTE                                              //    End if for mutual & self interaction
-					wait_tasks;                                             //    Synchronize task group
-#endif
+					TraverseRemoteRange leftBranch(traversal, CiBegin, CiMid,//    Instantiate recursive functor
+					                               CjMid, CjEnd, mutual, remote, rank);
+					create_taskc(leftBranch);                           //    Ci:former Cj:latter
+					TraverseRemoteRange rightBranch(traversal, CiMid, CiEnd,//    Instantiate recursive functor
+					                                CjBegin, CjMid, mutual, remote, rank);
+					rightBranch();                                      //    Ci:latter Cj:former
+					wait_tasks;                                         //    Synchronize task group
 				}
-			}                                                         //  End if for many cells in range
-			logger::stopTracer(tracer);                               //  Stop tracer
-		}                                                           // End overload operator()
+			}                                                       //  End if for many cells in range
+			logger::stopTracer(tracer);                             //  Stop tracer
+		}                                                         // End overload operator()
 	};
 
 	//! List based traversal
@@ -502,7 +788,8 @@ private:
 				for (int d = 0; d < 3; d++) {                         //   Loop over dimensions
 					kernel::Xperiodic[d] = pX[d] * cycle;               //    Periodic coordinate offset
 				}                                                     //   End loop over dimensions
-				kernel::M2L(Ci, Cj, mutual);                          //   M2L kernel
+				kernel::M2L(Ci, Cj, Mi0[icell], Li0[icell], Mj0[jcell], //   M2L kernel
+				            mutual ? &Lj0[jcell] : NULL);
 				countKernel(numM2L);                                  //   Increment M2L counter
 				countList(Ci, Cj, mutual, false);                     //   Increment M2L list
 				countWeight(Ci, Cj, mutual, remote);                  //   Increment M2L weight
@@ -526,7 +813,7 @@ private:
 					for (int d = 0; d < 3; d++) {                       //    Loop over dimensions
 						kernel::Xperiodic[d] = pX[d] * cycle;             //     Periodic coordinate offset
 					}                                                   //    End loop over dimensions
-					kernel::P2P(Ci, Cj, mutual);                        //    P2P kernel
+					P2P(Ci, Cj, mutual);                                //    P2P kernel
 					countKernel(numP2P);                                //    Increment P2P counter
 					countList(Ci, Cj, mutual, true);                    //    Increment P2P list
 					countWeight(Ci, Cj, mutual, remote);                //    Increment P2P weight
@@ -540,8 +827,11 @@ private:
 	void traversePeriodic(real_t cycle) {
 		logger::startTimer("Traverse periodic");                  // Start timer
 		Cells pcells; pcells.resize(27);                          // Create cells
+		Expansions pM(27);                                        // Multipoles of periodic cells
 		C_iter Ci = pcells.end() - 1;                             // Last cell is periodic parent cell
+		vecP & Mi = pM[26];                                       // Multipole of periodic parent cell
 		*Ci = *Cj0;                                               // Copy values from source root
+		Mi = Mj0[0];                                              // Copy multipole from source root
 		Ci->ICHILD = 0;                                           // Child cells for periodic center cell
 		Ci->NCHILD = 26;                                          // Number of child cells for periodic center cell
 		C_iter C0 = Cj0;                                          // Placeholder for Cj0
@@ -556,7 +846,7 @@ private:
 										kernel::Xperiodic[0] = (ix * 3 + cx) * cycle;//        Coordinate offset for x periodic direction
 										kernel::Xperiodic[1] = (iy * 3 + cy) * cycle;//        Coordinate offset for y periodic direction
 										kernel::Xperiodic[2] = (iz * 3 + cz) * cycle;//        Coordinate offset for z periodic direction
-										kernel::M2L(Ci0, Ci, false);              //         M2L kernel
+										kernel::M2L(Ci0, Ci, Mi0[0], Li0[0], Mi, NULL);//      M2L kernel
 									}                                           //        End loop over z periodic direction (child)
 								}                                             //       End loop over y periodic direction (child)
 							}                                               //      End loop over x periodic direction (child)
@@ -565,7 +855,7 @@ private:
 				}                                                     //   End loop over y periodic direction
 			}                                                       //  End loop over x periodic direction
 #if EXAFMM_MASS
-			for (int i = 1; i < NTERM; i++) Ci->M[i] *= Ci->M[0];   //  Normalize multipole expansion coefficients
+			for (int i = 1; i < NTERM; i++) Mi[i] *= Mi[0];         //  Normalize multipole expansion coefficients
 #endif
 			Cj0 = pcells.begin();                                   //  Redefine Cj0 for M2M
 			C_iter Cj = Cj0;                                        //  Iterator of periodic neighbor cells
@@ -576,22 +866,22 @@ private:
 							Cj->X[0] = Ci->X[0] + ix * cycle;               //      Set new x coordinate for periodic image
 							Cj->X[1] = Ci->X[1] + iy * cycle;               //      Set new y cooridnate for periodic image
 							Cj->X[2] = Ci->X[2] + iz * cycle;               //      Set new z coordinate for periodic image
-							Cj->M    = Ci->M;                               //      Copy multipoles to new periodic image
+							pM[Cj - Cj0] = Mi;                              //      Copy multipoles to new periodic image
 							Cj++;                                           //      Increment periodic cell iterator
 						}                                                 //     Endif for periodic center cell
 					}                                                   //    End loop over z periodic direction
 				}                                                     //   End loop over y periodic direction
 			}                                                       //  End loop over x periodic direction
-			Ci->M = 0;                                              //  Reset multipoles of periodic parent
-			kernel::M2M(Ci, Cj0);                                   //  Evaluate periodic M2M kernels for this sublevel
+			Mi = 0;                                                 //  Reset multipoles of periodic parent
+			kernel::M2M(Ci, Cj0, &pM[0]);                           //  Evaluate periodic M2M kernels for this sublevel
 #if EXAFMM_MASS
-			for (int i = 1; i < NTERM; i++) Ci->M[i] /= Ci->M[0];   //  Normalize multipole expansion coefficients
+			for (int i = 1; i < NTERM; i++) Mi[i] /= Mi[0];         //  Normalize multipole expansion coefficients
 #endif
 			cycle *= 3;                                             //  Increase center cell size three times
 			Cj0 = C0;                                               //  Reset Cj0 back
 		}                                                         // End loop over sublevels of tree
 #if EXAFMM_MASS
-		Ci0->L /= Ci0->M[0];                                      // Normalize local expansion coefficients
+		Li0[0] /= Mi0[0][0];                                      // Normalize local expansion coefficients
 #endif
 		logger::stopTimer("Traverse periodic");                   // Stop timer
 	}
@@ -600,12 +890,20 @@ public:
 	//! Constructor
 	Traversal(int _nspawn, int _images, ComType* _communicator=0):// Constructor
 		nspawn(_nspawn), images(_images), 												// Initialize variables
-		communicator(_communicator)
 #if EXAFMM_COUNT_KERNEL
-		, numP2P(0), numM2L(0)
+		numP2P(0), numM2L(0), remoteNumP2P(0), remoteNumM2L(0),
 #endif
+		Mi0(NULL), Li0(NULL), Mj0(NULL), Lj0(NULL),
+		communicator(_communicator), ibodiesSoA(NULL), jbodiesSoA(NULL), numSubtrees(0), collectRemote(false),
+		remoteStarted(false)
 	{}
 
+	//! Attach SoA copies of target and source bodies, used by local P2P instead of the Body vectors; both must be laid out for the tree
+	void setBodiesSoA(BodiesSoA * ibodies, BodiesSoA * jbodies) {
+		ibodiesSoA = ibodies;                                     // SoA copy of target bodies
+		jbodiesSoA = jbodies;                                     // SoA copy of source bodies
+	}
+
 #if EXAFMM_COUNT_LIST
 	//! Initialize size of P2P and M2L interaction lists per cell
 	void initListCount(Cells & cells) {
@@ -633,50 +931,123 @@ public:
 	void initWeight(Cells) {}
 #endif
 
-	//! Evaluate P2P and M2L using dual tree traversal
-	template <typename HOT, typename DownwardPassType>
-	void dualTreeTraversalRemote(Cells & icells, size_t mpirank, size_t mpisize, HOT const& indexer, DownwardPassType && updownPass, real_t remote = 1) {
+	//! Release the caches of ranks without deferred pairs and send the requests of the deferred pairs
+	//! Returns without waiting for the replies; returns false if no pair is deferred
+	bool issueRemote(size_t mpirank, size_t mpisize) {
+		std::vector<int> numPairs(mpisize, 0);                      // Deferred pairs per rank
+		for (size_t p = 0; p < remotePairs.size(); p++) numPairs[remotePairs[p].rank]++;
+		for (size_t i = 0; i < mpisize; ++i) {                      // Loop over ranks
+			if (i != mpirank && numPairs[i] == 0 && !remoteCleared[i]) {// If traversal of rank is done
+				logger::startTimer("Clear cache");                      //  Start timer
+				communicator->clearCellCache(i);                        //  Release its cells and bodies
+				logger::stopTimer("Clear cache", 0);                    //  Stop timer
+				remoteCleared[i] = true;
+			}                                                         // End if for finished rank
+		}                                                           // End loop over ranks
+		if (remotePairs.empty()) return false;                      // Done when nothing is deferred
+		communicator->evictCache();                                 // No bodies are in use between rounds
+		communicator->sendRequests();                               // One batched request per rank
+		return true;
+	}
+
+	//! Wait for replies and traverse the deferred pairs, one task per pair below the cut
+	void resumeRemote(real_t remote) {
+		double commtime;
+		communicator->waitReplies(commtime);                        // Wait for replies, serving other ranks
+		resumedPairs.swap(remotePairs);                             // Take deferred pairs
+		remotePairs.clear();
+		for (size_t p = 0; p < resumedPairs.size(); p++) {          // Loop over deferred pairs
+#if WEIGH_COM
+			resumedPairs[p].Ci->WEIGHT += commtime / resumedPairs.size();// Share the wait among the pairs
+#endif
+			traverseRemote(resumedPairs[p].Ci, resumedPairs[p].Cj, false, remote, resumedPairs[p].rank);// Resume above the cut, or collect
+		}                                                           // End loop over deferred pairs
+		traverseSubtrees(remote);                                   // Traverse below the cut, one task per pair
+	}
+
+	//! Traverse the remote trees until the first requests for children and bodies are sent
+	//! Call before the local traversal so that the replies are on their way while it runs
+	//! M and L are the multipole and local coefficients of icells, filled by the upward pass
+	void startTraversalRemote(Cells & icells, Expansions & M, Expansions & L, size_t mpirank, size_t mpisize,
+	                          CellIndex const& indexer, real_t remote = 1) {
 		if (icells.empty()) return;                                 // Quit if either of the cell vectors are empty
 		logger::startTimer("Traverse Remote");                      // Start timer
 		kernel::Xperiodic = 0;
-		communicator->initDispatcher(icells, indexer);
+		communicator->initDispatcher(icells, M, indexer);           // Start serving local cells (if not started yet)
 		logger::initTracer();                                       // Initialize tracer
-		Ci0 = icells.begin();                                       // Set iterator of target root cell	
-#pragma omp parallel 
-{ 
-		#pragma omp for	
-		for (int i = 0; i < mpisize; ++i) {
-			if (i != mpirank) {
+		Ci0 = icells.begin();                                       // Set iterator of target root cell
+		Mi0 = &M[0];                                                // Multipoles of target cells
+		Li0 = &L[0];                                                // Locals of target cells
+		subtreeOf.resize(icells.size());                            // Subtree of each target cell
+		numSubtrees = 0;                                            // Count subtrees below the cut
+		cutPairs.clear();                                           // Pairs collected at the cut
+		setSubtrees(Ci0, -1);                                       // Cut the local tree into subtrees
+		collectRemote = true;                                       // Above the cut, traverse serially
+		remoteRoots.assign(mpisize, RemoteCells());                 // Root cell of each remote tree
+		remoteCleared.assign(mpisize, false);                       // No cache has been cleared
+		for (size_t i = 0; i < mpisize; ++i) {                      // Loop over ranks
+			if (i != mpirank) {                                       //  If rank is remote
 				double commtime;
-				auto&& cells = communicator->getCell(0, 1, 0, i, LEVELTAG, commtime);
-				assert(cells.size() > 0);
-				traverseRemote(Ci0, cells.begin(), false, remote, i);
-				logger::startTimer("Clear cache");                             // Start timer
-				communicator->clearCellCache(i);
-				logger::stopTimer("Clear cache", 0);                            // Start timer
-			}
-		}
-}
-		updownPass.downwardPass(icells);
+				remoteRoots[i] = communicator->getCell(0, 1, 0, i, LEVELTAG, commtime);// Get remote root
+				assert(remoteRoots[i].size() > 0);
+				traverseRemote(Ci0, remoteRoots[i].begin(), false, remote, i);// Traverse down to the cut
+			}                                                         //  End if for remote rank
+		}                                                           // End loop over ranks
+		traverseSubtrees(remote);                                   // Traverse below the cut, one task per pair
+		issueRemote(mpirank, mpisize);                              // Requests are in flight during the local traversal
+		remoteStarted = true;
+		logger::stopTimer("Traverse Remote", 0);                    // Stop timer
+	}
+
+	//! Evaluate P2P and M2L using dual tree traversal
+	//! Finishes the traversal begun by startTraversalRemote, or runs all of it
+	template <typename DownwardPassType>
+	void dualTreeTraversalRemote(Cells & icells, Expansions & M, Expansions & L, size_t mpirank, size_t mpisize,
+	                             CellIndex const& indexer, DownwardPassType && updownPass, real_t remote = 1) {
+		if (icells.empty()) return;                                 // Quit if either of the cell vectors are empty
+		if (!remoteStarted) startTraversalRemote(icells, M, L, mpirank, mpisize, indexer, remote);// Not started before the local traversal
+		logger::startTimer("Traverse Remote");                      // Start timer
+		kernel::Xperiodic = 0;                                      // The local traversal may have shifted it
+		Ci0 = icells.begin();                                       // The local traversal may have moved it
+		Mi0 = &M[0];
+		Li0 = &L[0];
+		collectRemote = true;                                       // Above the cut, traverse serially
+		while (!remotePairs.empty()) {                              // Loop until no pairs are deferred
+			resumeRemote(remote);                                     //  Traverse pairs whose data arrived
+			issueRemote(mpirank, mpisize);                            //  Request data for the next round
+		}                                                           // End loop over rounds
+		collectRemote = false;
+		remoteStarted = false;
+		remoteRoots.clear();
+		updownPass.downwardPass(icells, M, L);
 		logger::printTime("Clear cache");
 		logger::stopTimer("Traverse Remote");                              // Stop timer
 		logger::stopTimer("Total FMM");
-		communicator->flushDispatcher();
-		communicator->startDispatcher();
+		communicator->finishDispatcher();                           // Serve requests until all ranks are done
 		logger::writeTracer();                                      // Write tracer to file
 	}
 
 	//! Evaluate P2P and M2L using list based traversal
-	void traverse(Cells & icells, Cells & jcells, real_t cycle, bool dual, bool mutual, real_t remote = 1) {
+	//! Mi, Li and Mj, Lj are the coefficients of icells and jcells; Lj is only written with mutual
+	void traverse(Cells & icells, Expansions & Mi, Expansions & Li, Cells & jcells, Expansions & Mj, Expansions & Lj,
+	              real_t cycle, bool dual, bool mutual, real_t remote = 1) {
 		if (icells.empty() || jcells.empty()) return;             // Quit if either of the cell vectors are empty
 		logger::startTimer("Traverse");                           // Start timer
 		logger::initTracer();                                     // Initialize tracer
 		Ci0 = icells.begin();                                     // Iterator of first target cell
 		Cj0 = jcells.begin();                                     // Iterator of first source cell
+		Mi0 = &Mi[0];                                             // Multipoles of target cells
+		Li0 = &Li[0];                                             // Locals of target cells
+		Mj0 = &Mj[0];                                             // Multipoles of source cells
+		Lj0 = &Lj[0];                                             // Locals of source cells
 		kernel::Xperiodic = 0;                                    // Set periodic coordinate offset to 0
 		if (dual) {                                               // If dual tree traversal
+#if EXAFMM_BATCH_M2L
+			m2lLists.resize(icells.size());                         //  M2L lists per target cell
+#endif
 			if (images == 0) {                                      //  If non-periodic boundary condition
-				dualTreeTraversal(Ci0, Cj0, mutual, remote);          //   Traverse the tree
+				traverseRoots(mutual, remote);                        //   Traverse the tree
+				evaluateM2L();                                        //   Evaluate recorded M2L pairs
 			} else {                                                //  If periodic boundary condition
 				for (int ix = -1; ix <= 1; ix++) {                    //   Loop over x periodic direction
 					for (int iy = -1; iy <= 1; iy++) {                  //    Loop over y periodic direction
@@ -684,7 +1055,8 @@ public:
 							kernel::Xperiodic[0] = ix * cycle;              //      Coordinate shift for x periodic direction
 							kernel::Xperiodic[1] = iy * cycle;              //      Coordinate shift for y periodic direction
 							kernel::Xperiodic[2] = iz * cycle;              //      Coordinate shift for z periodic direction
-							dualTreeTraversal(Ci0, Cj0, false, remote);     //      Traverse the tree for this periodic image
+							traverseRoots(false, remote);                   //      Traverse the tree for this periodic image
+							evaluateM2L();                                  //      Evaluate M2L pairs of this image
 						}                                                 //     End loop over z periodic direction
 					}                                                   //    End loop over y periodic direction
 				}                                                     //   End loop over x periodic direction
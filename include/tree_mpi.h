@@ -14,8 +14,8 @@ namespace exafmm {
     float (* allBoundsXmax)[3];                                 //!< Array for local Xmax for all ranks
     Bodies sendBodies;                                          //!< Send buffer for bodies
     Bodies recvBodies;                                          //!< Receive buffer for bodies
-    Cells sendCells;                                            //!< Send buffer for cells
-    Cells recvCells;                                            //!< Receive buffer for cells
+    Multipoles sendCells;                                       //!< Send buffer for cells
+    Multipoles recvCells;                                       //!< Receive buffer for cells
     int * sendBodyCount;                                        //!< Send count
     int * sendBodyDispl;                                        //!< Send displacement
     int * recvBodyCount;                                        //!< Receive count
@@ -67,7 +67,7 @@ namespace exafmm {
     }
 
     //! Exchange send count for cells
-    void alltoall(Cells) {
+    void alltoall(Multipoles) {
       MPI_Alltoall(sendCellCount, 1, MPI_INT,                   // Communicate send count to get receive count
 		   recvCellCount, 1, MPI_INT, MPI_COMM_WORLD);
       recvCellDispl[0] = 0;                                     // Initialize receive displacements
@@ -77,7 +77,7 @@ namespace exafmm {
     }
 
     //! Exchange cells
-    void alltoallv(Cells & cells) {
+    void alltoallv(Multipoles & cells) {
       assert( (sizeof(cells[0]) & 3) == 0 );                    // Cell structure must be 4 Byte aligned
       int word = sizeof(cells[0]) / 4;                          // Word size of body structure
       recvCells.resize(recvCellDispl[mpisize-1]+recvCellCount[mpisize-1]);// Resize receive buffer
@@ -111,13 +111,15 @@ namespace exafmm {
     }
 
     //! Add cells to send buffer
-    void addSendCell(C_iter C, int & irank, int & icell, int & iparent, bool copyData) {
+    void addSendCell(C_iter C, const vecP & M, int & irank, int & icell, int & iparent, bool copyData) {
       if (copyData) {                                           // If copying data to send cells
-	Cell cell(*C);                                          //  Initialize send cell
+	Multipole cell;                                         //  Initialize send cell
+	static_cast<Cell&>(cell) = *C;                          //  Copy cell
+	cell.M = M;                                             //  Copy multipole expansion
 	cell.NCHILD = cell.NBODY = 0;                           //  Reset counters
 	cell.IPARENT = iparent;                                 //  Index of parent
 	sendCells[sendCellDispl[irank]+icell] = cell;           //  Copy cell to send buffer
-	C_iter Cparent = sendCells.begin() + sendCellDispl[irank] + iparent;// Get parent iterator
+	M_iter Cparent = sendCells.begin() + sendCellDispl[irank] + iparent;// Get parent iterator
 	if (Cparent->NCHILD == 0) Cparent->ICHILD = icell;      //  Index of parent's first child
 	Cparent->NCHILD++;                                      //  Increment parent's child counter
       }                                                         // End if for copying data to send cells
@@ -127,7 +129,7 @@ namespace exafmm {
     //! Add bodies to send buffer
     void addSendBody(C_iter C, int & irank, int & ibody, int icell, bool copyData) {
       if (copyData) {                                           // If copying data to send bodies
-	C_iter Csend = sendCells.begin() + sendCellDispl[irank] + icell; // Send cell iterator
+	M_iter Csend = sendCells.begin() + sendCellDispl[irank] + icell; // Send cell iterator
 	Csend->NBODY = C->NBODY;                                //  Number of bodies
 	Csend->IBODY = ibody;                                   //  Body index per rank
 	B_iter Bsend = sendBodies.begin() + sendBodyDispl[irank] + ibody; // Send body iterator
@@ -140,7 +142,7 @@ namespace exafmm {
     }
 
     //! Determine which cells to send
-    void traverseLET(C_iter C, C_iter C0, Bounds bounds, real_t cycle,
+    void traverseLET(C_iter C, C_iter C0, const vecP * M0, Bounds bounds, real_t cycle,
 		     int & irank, int & ibody, int & icell, int iparent, bool copyData) {
       int level = int(logf(mpisize-1) / M_LN2 / 3) + 1;         // Level of local root cell
       if (mpisize == 1) level = 0;                              // Account for serial case
@@ -149,7 +151,7 @@ namespace exafmm {
       int cc = 0;                                               // Initialize child index
       for (C_iter CC=C0+C->ICHILD; CC!=C0+C->ICHILD+C->NCHILD; CC++,cc++) { // Loop over child cells
 	icells[cc] = icell;                                     //  Store cell index
-	addSendCell(CC, irank, icell, iparent, copyData);       //  Add cells to send
+	addSendCell(CC, M0[CC-C0], irank, icell, iparent, copyData);// Add cells to send
 	if (CC->NCHILD == 0) {                                  //  If cell is leaf
 	  addSendBody(CC, irank, ibody, icell-1, copyData);     //   Add bodies to send
 	} else {                                                //  If cell is not leaf
@@ -177,7 +179,7 @@ namespace exafmm {
       for (C_iter CC=C0+C->ICHILD; CC!=C0+C->ICHILD+C->NCHILD; CC++,cc++) { // Loop over child cells
 	if (divide[cc]) {                                       //  If cell must be divided further
 	  iparent = icells[cc];                                 //   Parent cell index
-	  traverseLET(CC, C0, bounds, cycle, irank, ibody, icell, iparent, copyData);// Recursively traverse tree to set LET
+	  traverseLET(CC, C0, M0, bounds, cycle, irank, ibody, icell, iparent, copyData);// Recursively traverse tree to set LET
 	}                                                       //  End if for cell division
       }                                                         // End loop over child cells
     }
@@ -223,7 +225,7 @@ namespace exafmm {
     }
 
     //! Set local essential tree to send to each process
-    void setLET(Cells & cells, real_t cycle) {
+    void setLET(Cells & cells, const Expansions & M, real_t cycle) {
       logger::startTimer("Set LET size");                       // Start timer
       C_iter C0 = cells.begin();                                // Set cells begin iterator
       Bounds bounds;                                            // Bounds of local subdomain
@@ -244,7 +246,7 @@ namespace exafmm {
 	  if (C0->NCHILD == 0) {                                //   If root cell is leaf
 	    addSendBody(C0, irank, ibody, icell-1, false);      //    Add bodies to send
 	  }                                                     //   End if for root cell leaf
-	  traverseLET(C0, C0, bounds, cycle, irank, ibody, icell, 0, false); // Traverse tree to set LET
+	  traverseLET(C0, C0, &M[0], bounds, cycle, irank, ibody, icell, 0, false); // Traverse tree to set LET
 	  sendBodyCount[irank] = ibody;                         //   Send body count for current rank
 	  sendCellCount[irank] = icell;                         //   Send cell count for current rank
 	}                                                       //  Endif for current rank
@@ -264,26 +266,27 @@ namespace exafmm {
 	    bounds.Xmin[d] = allBoundsXmin[irank][d];           //   Local Xmin for irank
 	    bounds.Xmax[d] = allBoundsXmax[irank][d];           //   Local Xmax for irank
 	  }                                                     //   End loop over dimensions
-	  C_iter Csend = sendCells.begin() + sendCellDispl[irank];//   Send cell iterator
-	  *Csend = *C0;                                         //   Copy cell to send buffer
+	  M_iter Csend = sendCells.begin() + sendCellDispl[irank];//   Send cell iterator
+	  static_cast<Cell&>(*Csend) = *C0;                     //   Copy cell to send buffer
+	  Csend->M = M[0];                                      //   Copy multipole expansion to send buffer
 	  Csend->NCHILD = Csend->NBODY = 0;                     //   Reset link to children and bodies
 	  icell++;                                              //   Increment send cell counter
 	  if (C0->NCHILD == 0) {                                //   If root cell is leaf
 	    addSendBody(C0, irank, ibody, icell-1, true);       //    Add bodies to send
 	  }                                                     //   End if for root cell leaf
-	  traverseLET(C0, C0, bounds, cycle, irank, ibody, icell, 0, true); // Traverse tree to set LET
+	  traverseLET(C0, C0, &M[0], bounds, cycle, irank, ibody, icell, 0, true); // Traverse tree to set LET
 	}                                                       //  Endif for current rank
       }                                                         // End loop over ranks
       logger::stopTimer("Set LET");                             // Stop timer
     }
 
     //! Get local essential tree from irank
-    void getLET(Cells & cells, int irank) {
+    void getLET(Cells & cells, Expansions & M, int irank) {
       std::stringstream event;                                  // Event name
       event << "Get LET from rank " << irank;                   // Create event name based on irank
       logger::startTimer(event.str());                          // Start timer
       for (int i=0; i<recvCellCount[irank]; i++) {              // Loop over receive cells
-	C_iter C = recvCells.begin() + recvCellDispl[irank] + i;//  Iterator of receive cell
+	M_iter C = recvCells.begin() + recvCellDispl[irank] + i;//  Iterator of receive cell
 	if (C->NBODY != 0) {                                    //  If cell has bodies
 	  C->BODY = recvBodies.begin() + recvBodyDispl[irank] + C->IBODY;// Iterator of first body
 	}                                                       //  End if for bodies
@@ -291,6 +294,10 @@ namespace exafmm {
       cells.resize(recvCellCount[irank]);                       // Resize cell vector for LET
       cells.assign(recvCells.begin()+recvCellDispl[irank],      // Assign receive cells to vector
 		   recvCells.begin()+recvCellDispl[irank]+recvCellCount[irank]);
+      M.resize(recvCellCount[irank]);                           // Resize multipole expansions for LET
+      for (int i=0; i<recvCellCount[irank]; i++) {              // Loop over receive cells
+	M[i] = recvCells[recvCellDispl[irank]+i].M;             //  Copy multipole expansion
+      }                                                         // End loop over receive cells
       logger::stopTimer(event.str());                           // Stop timer
     }
 
@@ -299,7 +306,7 @@ namespace exafmm {
       logger::startTimer("Link LET");                           // Start timer
       for (int irank=0; irank<mpisize; irank++) {               // Loop over ranks
 	for (int i=0; i<recvCellCount[irank]; i++) {            //  Loop over receive cells
-	  C_iter C = recvCells.begin() + recvCellDispl[irank] + i;//   Iterator of receive cell
+	  M_iter C = recvCells.begin() + recvCellDispl[irank] + i;//   Iterator of receive cell
 	  if (C->NBODY != 0) {                                  //   If cell has bodies
 	    C->BODY = recvBodies.begin() + recvBodyDispl[irank] + C->IBODY;// Iterator of first body
 	  }                                                     //   End if for bodies
@@ -315,7 +322,7 @@ namespace exafmm {
       bodies.reserve(mpisize-1);                                // Reserve size of body vector
       for (int irank=0; irank<mpisize; irank++) {               // Loop over ranks
 	if (irank != mpirank) {                                 //  If not current rank
-	  C_iter C0 = recvCells.begin() + recvCellDispl[irank]; //   Root cell iterator for irank
+	  M_iter C0 = recvCells.begin() + recvCellDispl[irank]; //   Root cell iterator for irank
 	  Body body;                                            //   Body to contain remote root coordinates
 	  body.X = C0->X;                                       //   Copy remote root coordinates
 	  body.IBODY = recvCellDispl[irank];                    //   Copy remote root displacement in vector
@@ -327,16 +334,21 @@ namespace exafmm {
     }
 
     //! Graft remote trees to global tree
-    void attachRoot(Cells & cells) {
+    void attachRoot(Cells & cells, Expansions & M) {
       logger::startTimer("Attach root");                        // Start timer
       int globalCells = cells.size();                           // Number of global cells
       cells.insert(cells.end(), recvCells.begin(), recvCells.end()); // Join LET cell vectors
+      M.resize(cells.size());                                   // Resize multipole expansions
+      for (size_t i=0; i<recvCells.size(); i++) {               // Loop over receive cells
+	M[globalCells+i] = recvCells[i].M;                      //  Copy multipole expansion
+      }                                                         // End loop over receive cells
       for (C_iter C=cells.begin(); C!=cells.begin()+globalCells; C++) { // Loop over global cells
 	if (C->NCHILD==0) {                                     // If leaf cell
 	  int offset = globalCells + C->BODY->IBODY;            //  Offset of received root cell index
 	  C_iter C0 = cells.begin() + offset;                   //  Root cell iterator
 	  C0->IPARENT = C->IPARENT;                             //  Link remote root to global leaf
 	  *C = *C0;                                             //  Copy remote root to global leaf
+	  M[C-cells.begin()] = M[offset];                       //  Copy remote root multipoles to global leaf
 	  C->ICHILD += offset;                                  //  Add offset to child index
 	} else {                                                // If not leaf cell
 	  C->BODY = recvBodies.end();                           //  Use BODY as flag to indicate non-leaf global cell
@@ -366,8 +378,8 @@ namespace exafmm {
 	    C->R = std::max(C->X[d] - Xmin[d], C->R);           //    Calculate min distance from center
 	    C->R = std::max(Xmax[d] - C->X[d], C->R);           //    Calculate max distance from center
 	  }                                                     //   End loop over dimensions
-	  C->M = 0;                                             //   Reset multipoles
-	  kernel::M2M(C, C0);                                   //   M2M kernel
+	  M[i] = 0;                                             //   Reset multipoles
+	  kernel::M2M(C, C0, &M[0]);                            //   M2M kernel
 	}                                                       //  End if for non-leaf global cell
       }                                                         // End loop over global cells bottom up
       logger::stopTimer("Attach root");                         // Stop timer
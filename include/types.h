@@ -14,6 +14,14 @@
 #include <unordered_map>
 #include <unordered_set>
 
+#ifndef EXAFMM_MIXED
+#define EXAFMM_MIXED 0                                          // Set to 1 for single precision expansions with double precision P2P
+#endif
+#if EXAFMM_MIXED && !EXAFMM_CARTESIAN
+#undef EXAFMM_MIXED
+#define EXAFMM_MIXED 0                                          // Only the Cartesian kernels have single precision expansions
+#endif
+
 namespace exafmm {
   // Basic type definitions
 #if EXAFMM_SINGLE
@@ -24,6 +32,14 @@ namespace exafmm {
   const real_t EPS = 1e-16;                                     //!< Double precision epsilon
 #endif
   typedef std::complex<real_t> complex_t;                       //!< Complex type
+
+  // Expansion precision, chosen separately from the precision of bodies and P2P
+#if EXAFMM_MIXED
+  typedef float mreal_t;                                        //!< Floating point type of expansions and M2M/M2L/L2L
+#else
+  typedef real_t mreal_t;                                       //!< Floating point type of expansions and M2M/M2L/L2L
+#endif
+  typedef std::complex<mreal_t> mcomplex_t;                     //!< Complex type of expansions
   typedef vec<3,int> ivec3;                                     //!< Vector of 3 int types
   typedef vec<3,real_t> vec3;                                   //!< Vector of 3 real_t types
   typedef vec<4,real_t> vec4;                                   //!< Vector of 4 real_t types
@@ -32,6 +48,8 @@ namespace exafmm {
   // SIMD vector types for MIC, AVX, and SSE
   const int NSIMD = SIMD_BYTES / sizeof(real_t);                //!< SIMD vector length (SIMD_BYTES defined in macros.h)
   typedef vec<NSIMD,real_t> simdvec;                            //!< SIMD vector type
+  const int NSIMDM = SIMD_BYTES / sizeof(mreal_t);              //!< SIMD vector length of expansions
+  typedef vec<NSIMDM,mreal_t> msimdvec;                         //!< SIMD vector type of expansions
 
   // Kahan summation types (Achieves quasi-double precision using single precision types)
 #if EXAFMM_USE_KAHAN
@@ -50,7 +68,7 @@ namespace exafmm {
   const int P = EXAFMM_EXPANSION;                               //!< Order of expansions
 #if EXAFMM_CARTESIAN
   const int NTERM = P*(P+1)*(P+2)/6;                            //!< Number mutlipole/local terms
-  typedef vec<NTERM,real_t> vecP;                               //!< Multipole/local coefficient type
+  typedef vec<NTERM,mreal_t> vecP;                              //!< Multipole/local coefficient type
 #elif EXAFMM_SPHERICAL
 #if EXAFMM_LAPLACE
   const int NTERM = P*(P+1)/2;                                  //!< Number of terms for Laplace
@@ -59,7 +77,7 @@ namespace exafmm {
 #elif EXAFMM_BIOTSAVART
   const int NTERM = 3*P*(P+1)/2;                                //!< Number of terms for Biot-Savart
 #endif
-  typedef vec<NTERM,complex_t> vecP;                            //!< Multipole/local coefficient type
+  typedef vec<NTERM,mcomplex_t> vecP;                           //!< Multipole/local coefficient type
 #endif
 
   //! Center and radius of bounding box
@@ -106,8 +124,9 @@ namespace exafmm {
 #endif
   typedef Bodies::iterator B_iter;                              //!< Iterator of body vector
 
-  //! Structure of cells
-  struct Multipole {
+  //! Structure of cells, topology and geometry only
+  //! Expansion coefficients are kept in Expansions indexed by cell id, so that the traversal reads compact cells
+  struct Cell {
   	uint16_t  LEVEL;                                            //!< Level at which cell is located
     int      IPARENT;                                           //!< Index of parent cell
     int      ICHILD;                                            //!< Index of first child cell
@@ -118,8 +137,6 @@ namespace exafmm {
     real_t   SCALE;                                             //!< Scale for Helmholtz kernel
     vec3     X;                                                 //!< Cell center
     real_t   R;                                                 //!< Cell radius
-    vecP     M;                                                 //!< Multipole coefficients 
-    vecP      L;                                                //!< Local coefficients   
 	  int       IBODY;                                            //!< Index of first body
 #if EXAFMM_COUNT_LIST
     int      numP2P;                                         	  //!< Size of P2P interaction list per cell
@@ -128,20 +145,19 @@ namespace exafmm {
 	  real_t    WEIGHT;                                           //!< Weight for partitioning
   };
 
-  //! Structure of cells
-	struct Cell : public Multipole {  
-	  //std::vector<uint32_t> interactionList;
+  //! Structure of cells received from other ranks, which carry their multipole coefficients
+	struct Multipole : public Cell {
+    vecP     M;                                                 //!< Multipole coefficients
 	};
 
   typedef std::vector<Cell> Cells;                    			   //!< Vector of cells
   typedef Cells::iterator C_iter;  	                           //!< Iterator of cell vector
   typedef std::vector<Multipole> Multipoles;             			 //!< Vector of multipoles
   typedef Multipoles::iterator M_iter;                         //!< Iterator of multipole vector
+  typedef std::vector<vecP> Expansions;                        //!< Multipole or local coefficients of cells, indexed by cell id
 
 	typedef uint64_t hilbert_t;                                  //!< Type of Hilbert orders
 	typedef std::array<uint32_t,3> hilbert_arr;                  //!< Type of Hilbert array 
-	typedef std::unordered_map<uint64_t, size_t> TreeLevelMap;   //!< Tree Level type
-	typedef std::unordered_map<size_t,TreeLevelMap> TreeType;    //!< Level Indexer
 	typedef std::map<Cell*,std::pair<size_t,size_t>> CellMap;    //!<maps cells to number of shifts
 }
 #endif
@@ -16,26 +16,29 @@ namespace exafmm {
     struct SetRopt {
       C_iter C;                                                 //!< Iterator of current cell
       C_iter C0;                                                //!< Iterator of first cell
+      vecP * M0;                                                //!< Multipole coefficients of first cell
       real_t c;                                                 //!< Root coefficient
       real_t theta;                                             //!< Multipole acceptance criteria
-      SetRopt(C_iter _C, C_iter _C0, real_t _c, real_t _theta) :// Constructor
-	C(_C), C0(_C0), c(_c), theta(_theta) {}                 // Initialize variables
+      SetRopt(C_iter _C, C_iter _C0, vecP * _M0, real_t _c, real_t _theta) :// Constructor
+	C(_C), C0(_C0), M0(_M0), c(_c), theta(_theta) {}        // Initialize variables
       void operator() () {                                      // Overload operator()
 	mk_task_group;                                          //  Initialize tasks
 	for (C_iter CC=C0+C->ICHILD; CC!=C0+C->ICHILD+C->NCHILD; CC++) {// Loop over child cells
-	  SetRopt setRopt(CC, C0, c, theta);                    //   Initialize recusive functor
+	  SetRopt setRopt(CC, C0, M0, c, theta);                //   Initialize recusive functor
 	  create_taskc(setRopt);                                //   Create new task for recursive call
 	}                                                       //  End loop over child cells
 	wait_tasks;                                             //  Synchronize tasks
+	vecP & M = M0[C-C0];                                    //  Multipole coefficients of cell
 #if EXAFMM_MASS
-	for (int i=1; i<NTERM; i++) C->M[i] /= C->M[0];         //  Normalize multipole expansion coefficients
+	for (int i=1; i<NTERM; i++) M[i] /= M[0];               //  Normalize multipole expansion coefficients
 #endif
 	real_t x = 1.0 / theta;                                 //  Inverse of theta
 	assert(theta != 1.0);                                   //  Newton-Raphson won't work for theta==1
-	real_t a = c * powf(std::abs(C->M[0]),1.0/3);           //  Cell coefficient
+	real_t a = c * powf(std::abs(M[0]),1.0/3);              //  Cell coefficient
+	const int p = kernel::order;                            //  Expansion order
 	for (int i=0; i<5; i++) {                               //  Loop for Newton-Raphson iteration
-	  real_t f = x * x - 2 * x + 1 - a * std::pow(x,-P);    //   Function value
-	  real_t df = (P + 2) * x - 2 * (P + 1) + P / x;        //   Function derivative value
+	  real_t f = x * x - 2 * x + 1 - a * std::pow(x,-p);    //   Function value
+	  real_t df = (p + 2) * x - 2 * (p + 1) + p / x;        //   Function derivative value
 	  x -= f / df;                                          //   Increment x
 	}                                                       //  End loop for Newton-Raphson iteration
 	C->R *= x * theta;                                      //  Multiply R by error optimized parameter x
@@ -63,6 +66,8 @@ namespace exafmm {
     struct PostOrderTraversal {
       C_iter C;                                                 //!< Iterator of current cell
       C_iter C0;                                                //!< Iterator of first cell
+      vecP * M0;                                                //!< Multipole coefficients of first cell
+      vecP * L0;                                                //!< Local coefficients of first cell
       real_t theta;                                             //!< Multipole acceptance criteria
       bool useRmax;                                             //!< Use maximum distance for MAC
       //! Redefine cell radius R based on maximum distance
@@ -83,19 +88,19 @@ namespace exafmm {
 	}                                                       // End if for leaf cell
 	C->R = std::min(C->R,Rmax);                             // Redefine R based on maximum distance
       }
-      PostOrderTraversal(C_iter _C, C_iter _C0, real_t _theta, bool _useRmax) : // Constructor
-	C(_C), C0(_C0), theta(_theta), useRmax(_useRmax) {}     // Initialize variables
+      PostOrderTraversal(C_iter _C, C_iter _C0, vecP * _M0, vecP * _L0, real_t _theta, bool _useRmax) : // Constructor
+	C(_C), C0(_C0), M0(_M0), L0(_L0), theta(_theta), useRmax(_useRmax) {}// Initialize variables
       void operator() () {                                      // Overload operator()
 	mk_task_group;                                          //  Initialize tasks
 	for (C_iter CC=C0+C->ICHILD; CC!=C0+C->ICHILD+C->NCHILD; CC++) {// Loop over child cells
-	  PostOrderTraversal postOrderTraversal(CC, C0, theta, useRmax); // Instantiate recursive functor
+	  PostOrderTraversal postOrderTraversal(CC, C0, M0, L0, theta, useRmax); // Instantiate recursive functor
 	  create_taskc(postOrderTraversal);                     //    Create new task for recursive call
 	}                                                       //   End loop over child cells
 	wait_tasks;                                             //   Synchronize tasks
-	C->M = 0;                                               //  Initialize multipole expansion coefficients
-	C->L = 0;                                               //  Initialize local expansion coefficients
-	if(C->NCHILD==0) kernel::P2M(C);                        //  P2M kernel
-	else kernel::M2M(C, C0);                                //  M2M kernel
+	M0[C-C0] = 0;                                           //  Initialize multipole expansion coefficients
+	L0[C-C0] = 0;                                           //  Initialize local expansion coefficients
+	if(C->NCHILD==0) kernel::P2M(C, M0[C-C0]);              //  P2M kernel
+	else kernel::M2M(C, C0, M0);                            //  M2M kernel
 	if (useRmax) setRmax();                                 //  Redefine cell radius R based on maximum distance
 	C->R /= theta;                                          //  Divide R by theta
       }                                                         // End overload operator()
@@ -105,11 +110,13 @@ namespace exafmm {
     struct PreOrderTraversal {
       C_iter C;                                                 //!< Iterator of current cell
       C_iter C0;                                                //!< Iterator of first cell
-      PreOrderTraversal(C_iter _C, C_iter _C0) :                // Constructor
-	C(_C), C0(_C0) {}                                       // Initialize variables
+      const vecP * M0;                                          //!< Multipole coefficients of first cell
+      vecP * L0;                                                //!< Local coefficients of first cell
+      PreOrderTraversal(C_iter _C, C_iter _C0, const vecP * _M0, vecP * _L0) :// Constructor
+	C(_C), C0(_C0), M0(_M0), L0(_L0) {}                     // Initialize variables
       void operator() () {                                      // Overload operator()
-	kernel::L2L(C, C0);                                     //  L2L kernel
-	if (C->NCHILD==0) kernel::L2P(C);                       //  L2P kernel
+	kernel::L2L(C, C0, M0, L0);                             //  L2L kernel
+	if (C->NCHILD==0) kernel::L2P(C, L0[C-C0]);             //  L2P kernel
 #if EXAFMM_USE_WEIGHT
 	C_iter CP = C0 + C->IPARENT;                            // Parent cell
 	C->WEIGHT += CP->WEIGHT;                                // Add parent's weight
@@ -121,7 +128,7 @@ namespace exafmm {
 #endif
 	mk_task_group;                                          //  Initialize tasks
 	for (C_iter CC=C0+C->ICHILD; CC!=C0+C->ICHILD+C->NCHILD; CC++) {// Loop over child cells
-	  PreOrderTraversal preOrderTraversal(CC, C0);          //   Instantiate recursive functor
+	  PreOrderTraversal preOrderTraversal(CC, C0, M0, L0);  //   Instantiate recursive functor
 	  create_taskc(preOrderTraversal);                      //   Create new task for recursive call
 	}                                                       //  End loop over chlid cells
 	wait_tasks;                                             //  Synchronize tasks
@@ -134,33 +141,35 @@ namespace exafmm {
       theta(_theta), useRmax(_useRmax), useRopt(_useRopt) {     // Initialize variables
     }
 
-    //! Upward pass (P2M, M2M)
-    void upwardPass(Cells & cells) {
+    //! Upward pass (P2M, M2M) into M; also clears L for the traversal
+    void upwardPass(Cells & cells, Expansions & M, Expansions & L) {
       logger::startTimer("Upward pass");                        // Start timer
+      M.resize(cells.size());                                   // One multipole per cell
+      L.resize(cells.size());                                   // One local expansion per cell
       if (!cells.empty()) {                                     // If cell vector is not empty
 	C_iter C0 = cells.begin();                              //  Set iterator of target root cell
 	SetScaleFromRadius setScaleFromRadius(C0, C0);          //  Instantiate recursive functor
 	setScaleFromRadius();                                   //  Recursive call for setting cell scale
-	PostOrderTraversal postOrderTraversal(C0, C0, theta, useRmax); // Instantiate recursive functor
+	PostOrderTraversal postOrderTraversal(C0, C0, &M[0], &L[0], theta, useRmax); // Instantiate recursive functor
 	postOrderTraversal();                                   //  Recursive call for upward pass
-	real_t c = (1 - theta) * (1 - theta) / std::pow(theta,P+2) / powf(std::abs(C0->M[0]),1.0/3); // Root coefficient
+	real_t c = (1 - theta) * (1 - theta) / std::pow(theta,kernel::order+2) / powf(std::abs(M[0][0]),1.0/3); // Root coefficient
 	if (useRopt) {                                          //  If using error optimized theta
-	  SetRopt setRopt(C0, C0, c, theta);                    //   Instantiate recursive functor
+	  SetRopt setRopt(C0, C0, &M[0], c, theta);             //   Instantiate recursive functor
 	  setRopt();                                            //   Error optimization of R
 	}                                                       //  End if for using error optimized theta
       }                                                         // End if for empty cell vector
       logger::stopTimer("Upward pass");                         // Stop timer
     }
 
-    //! Downward pass (L2L, L2P)
-    void downwardPass(Cells & cells) {
+    //! Downward pass (L2L, L2P) from the local coefficients L
+    void downwardPass(Cells & cells, const Expansions & M, Expansions & L) {
       logger::startTimer("Downward pass");                      // Start timer
       if (!cells.empty()) {                                     // If cell vector is not empty
 	C_iter C0 = cells.begin();                              //  Root cell
-	if (C0->NCHILD == 0) kernel::L2P(C0);                   //  If root is the only cell do L2P
+	if (C0->NCHILD == 0) kernel::L2P(C0, L[0]);             //  If root is the only cell do L2P
 	mk_task_group;                                          //  Initialize tasks
 	for (C_iter CC=C0+C0->ICHILD; CC!=C0+C0->ICHILD+C0->NCHILD; CC++) {// Loop over child cells
-	  PreOrderTraversal preOrderTraversal(CC, C0);          //    Instantiate recursive functor
+	  PreOrderTraversal preOrderTraversal(CC, C0, &M[0], &L[0]);//  Instantiate recursive functor
 	  create_taskc(preOrderTraversal);                      //    Recursive call for downward pass
 	}                                                       //   End loop over child cells
 	wait_tasks;                                             //   Synchronize tasks
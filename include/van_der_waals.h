@@ -2,6 +2,9 @@
 #define van_der_waals_h
 #include "logger.h"
 #include "types.h"
+#if EXAFMM_USE_SIMD
+#include "simdvec.h"
+#endif
 
 namespace exafmm {
   class VanDerWaals {
@@ -17,42 +20,102 @@ namespace exafmm {
   private:
     //! Van der Waals P2P kernel
     void P2P(C_iter Ci, C_iter Cj, vec3 Xperiodic) const {
-      for (B_iter Bi=Ci->BODY; Bi!=Ci->BODY+Ci->NBODY; Bi++) {
-	int atypei = int(Bi->SRC);
-	for (B_iter Bj=Cj->BODY; Bj!=Cj->BODY+Cj->NBODY; Bj++) {
-	  vec3 dX = Bi->X - Bj->X - Xperiodic;
+      const real_t cuton2 = cuton * cuton;
+      const real_t cutoff2 = cutoff * cutoff;
+      const real_t invWidth3 = 1 / ((cutoff2 - cuton2) * (cutoff2 - cuton2) * (cutoff2 - cuton2));
+      B_iter Bi = Ci->BODY;
+      B_iter Bj = Cj->BODY;
+      int ni = Ci->NBODY;
+      int nj = Cj->NBODY;
+#if EXAFMM_USE_SIMD
+      simdvec zero = 0.0;
+      for (int i=0; i<ni; i+=NSIMD) {
+	int nv = std::min(NSIMD, ni-i);                         // Lanes past nv are not written back
+	simdvec pot = zero;
+	simdvec ax = zero;
+	simdvec ay = zero;
+	simdvec az = zero;
+	simdvec xi = SIMDPartial<simdvec,0,NSIMD>::setBody(Bi,i,nv) - Xperiodic[0];
+	simdvec yi = SIMDPartial<simdvec,1,NSIMD>::setBody(Bi,i,nv) - Xperiodic[1];
+	simdvec zi = SIMDPartial<simdvec,2,NSIMD>::setBody(Bi,i,nv) - Xperiodic[2];
+	int rowi[NSIMD];                                        // Offset of each target's row in the tables
+	for (int k=0; k<NSIMD; k++) rowi[k] = k < nv ? int(Bi[i+k].SRC) * numTypes : 0;
+	for (int j=0; j<nj; j++) {
+	  int atypej = int(Bj[j].SRC);
+	  simdvec rs = gather(&rscale[atypej], rowi);           // Gather pair parameters at rowi + atypej
+	  simdvec gs = gather(&gscale[atypej], rowi);
+	  simdvec fgs = gather(&fgscale[atypej], rowi);
+	  simdvec dx = xi - Bj[j].X[0];
+	  simdvec dy = yi - Bj[j].X[1];
+	  simdvec dz = zi - Bj[j].X[2];
+	  simdvec R2 = dx * dx;
+	  R2 += dy * dy;
+	  R2 += dz * dz;
+	  simdvec invR2 = simdvec(1.0) / (R2 * rs);
+	  simdvec invR2u = invR2 * rs;                          // 1 / R2 without scaling
+	  simdvec invR6 = invR2 * invR2 * invR2;
+	  simdvec tmp = invR6 * (invR6 - real_t(1));
+	  simdvec dtmp = invR2 * invR6 * (invR6 + invR6 - real_t(1));
+	  simdvec tmp1 = (simdvec(cutoff2) - R2) * invWidth3;   // Switching function between cuton and cutoff
+	  simdvec tmp2 = tmp1 * (simdvec(cutoff2) - R2) * (R2 + R2 + (cutoff2 - 3 * cuton2));
+	  simdvec tmpS = tmp * tmp2;
+	  simdvec dtmpS = tmp * real_t(12) * (simdvec(cuton2) - R2) * tmp1
+	    - invR6 * real_t(6) * (invR6 + (invR6 - real_t(1)) * tmp2) * tmp2 * invR2u;
+	  tmpS -= tmp;                                          // Blend in the switching function past cuton
+	  dtmpS -= dtmp;
+	  tmpS &= R2 > simdvec(cuton2);
+	  dtmpS &= R2 > simdvec(cuton2);
+	  tmp += tmpS;
+	  dtmp += dtmpS;
+	  tmp &= R2 > zero;                                     // Skip coincident bodies and pairs beyond cutoff
+	  tmp &= R2 < simdvec(cutoff2);
+	  dtmp &= R2 > zero;
+	  dtmp &= R2 < simdvec(cutoff2);
+	  dtmp *= fgs;
+	  pot += gs * tmp;
+	  ax -= dx * dtmp;
+	  ay -= dy * dtmp;
+	  az -= dz * dtmp;
+	}
+	for (int k=0; k<nv; k++) {
+	  Bi[i+k].TRG[0] += pot[k];
+	  Bi[i+k].TRG[1] += ax[k];
+	  Bi[i+k].TRG[2] += ay[k];
+	  Bi[i+k].TRG[3] += az[k];
+	}
+      }
+#else
+      for (int i=0; i<ni; i++) {
+	const real_t * rs = &rscale[int(Bi[i].SRC)*numTypes];  // Table rows of this atom type
+	const real_t * gs = &gscale[int(Bi[i].SRC)*numTypes];
+	const real_t * fgs = &fgscale[int(Bi[i].SRC)*numTypes];
+	for (int j=0; j<nj; j++) {
+	  vec3 dX = Bi[i].X - Bj[j].X - Xperiodic;
 	  real_t R2 = norm(dX);
-	  if (R2 != 0) {
-	    int atypej = int(Bj->SRC);
-	    real_t rs = rscale[atypei*numTypes+atypej];
-	    real_t gs = gscale[atypei*numTypes+atypej];
-	    real_t fgs = fgscale[atypei*numTypes+atypej];
-	    real_t R2s = R2 * rs;
-	    real_t invR2 = 1.0 / R2s;
+	  if (R2 != 0 && R2 < cutoff2) {
+	    int atypej = int(Bj[j].SRC);
+	    real_t invR2 = 1.0 / (R2 * rs[atypej]);
 	    real_t invR6 = invR2 * invR2 * invR2;
-	    real_t cuton2 = cuton * cuton;
-	    real_t cutoff2 = cutoff * cutoff;
-	    if (R2 < cutoff2) {
-	      real_t tmp = 0, dtmp = 0;
-	      if (cuton2 < R2) {
-		real_t tmp1 = (cutoff2 - R2) / ((cutoff2-cuton2)*(cutoff2-cuton2)*(cutoff2-cuton2));
-		real_t tmp2 = tmp1 * (cutoff2 - R2) * (cutoff2 - 3 * cuton2 + 2 * R2);
-		tmp = invR6 * (invR6 - 1) * tmp2;
-		dtmp = invR6 * (invR6 - 1) * 12 * (cuton2 - R2) * tmp1
-		  - 6 * invR6 * (invR6 + (invR6 - 1) * tmp2) * tmp2 / R2;
-	      } else {
-		tmp = invR6 * (invR6 - 1);
-		dtmp = invR2 * invR6 * (2 * invR6 - 1);
-	      }
-	      dtmp *= fgs;
-	      Bi->TRG[0] += gs * tmp;
-	      Bi->TRG[1] -= dX[0] * dtmp;
-	      Bi->TRG[2] -= dX[1] * dtmp;
-	      Bi->TRG[3] -= dX[2] * dtmp;
+	    real_t tmp = 0, dtmp = 0;
+	    if (cuton2 < R2) {
+	      real_t tmp1 = (cutoff2 - R2) * invWidth3;
+	      real_t tmp2 = tmp1 * (cutoff2 - R2) * (cutoff2 - 3 * cuton2 + 2 * R2);
+	      tmp = invR6 * (invR6 - 1) * tmp2;
+	      dtmp = invR6 * (invR6 - 1) * 12 * (cuton2 - R2) * tmp1
+		- 6 * invR6 * (invR6 + (invR6 - 1) * tmp2) * tmp2 / R2;
+	    } else {
+	      tmp = invR6 * (invR6 - 1);
+	      dtmp = invR2 * invR6 * (2 * invR6 - 1);
 	    }
+	    dtmp *= fgs[atypej];
+	    Bi[i].TRG[0] += gs[atypej] * tmp;
+	    Bi[i].TRG[1] -= dX[0] * dtmp;
+	    Bi[i].TRG[2] -= dX[1] * dtmp;
+	    Bi[i].TRG[3] -= dX[2] * dtmp;
 	  }
 	}
       }
+#endif
     }
 
     //! Recursive functor for traversing tree to find neighbors
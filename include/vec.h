@@ -29,6 +29,18 @@ namespace exafmm {
       for (int i=0; i<N; i++) data[i] = v[i];
     }
     ~vec(){}                                                    // Destructor
+    void load(const T * p) {                                    // Load contiguous values (unaligned)
+      for (int i=0; i<N; i++) data[i] = p[i];
+    }
+    void store(T * p) const {                                   // Store contiguous values (unaligned)
+      for (int i=0; i<N; i++) p[i] = data[i];
+    }
+    void load_a(const T * p) {                                  // Load contiguous values (aligned to SIMD_BYTES)
+      for (int i=0; i<N; i++) data[i] = p[i];
+    }
+    void store_a(T * p) const {                                 // Store contiguous values (aligned to SIMD_BYTES)
+      for (int i=0; i<N; i++) p[i] = data[i];
+    }
     const vec &operator=(const T v) {                           // Scalar assignment
       for (int i=0; i<N; i++) data[i] = v;
       return *this;
@@ -584,6 +596,18 @@ namespace exafmm {
       data = _mm512_setr_ps(a,b,c,d,e,f,g,h,i,j,k,l,m,n,o,p);
     }
     ~vec(){}                                                    // Destructor
+    void load(const float * p) {                                // Load contiguous values (unaligned)
+      for (int i=0; i<16; i++) ((float*)&data)[i] = p[i];
+    }
+    void store(float * p) const {                               // Store contiguous values (unaligned)
+      for (int i=0; i<16; i++) p[i] = ((float*)&data)[i];
+    }
+    void load_a(const float * p) {                              // Load contiguous values (aligned to SIMD_BYTES)
+      for (int i=0; i<16; i++) ((float*)&data)[i] = p[i];
+    }
+    void store_a(float * p) const {                             // Store contiguous values (aligned to SIMD_BYTES)
+      for (int i=0; i<16; i++) p[i] = ((float*)&data)[i];
+    }
     const vec &operator=(const float v) {                       // Scalar assignment
       data = _mm512_set1_ps(v);
       return *this;
@@ -699,6 +723,18 @@ namespace exafmm {
       data = _mm512_setr_pd(a,b,c,d,e,f,g,h);
     }
     ~vec(){}                                                    // Destructor
+    void load(const double * p) {                               // Load contiguous values (unaligned)
+      for (int i=0; i<8; i++) ((double*)&data)[i] = p[i];
+    }
+    void store(double * p) const {                              // Store contiguous values (unaligned)
+      for (int i=0; i<8; i++) p[i] = ((double*)&data)[i];
+    }
+    void load_a(const double * p) {                             // Load contiguous values (aligned to SIMD_BYTES)
+      for (int i=0; i<8; i++) ((double*)&data)[i] = p[i];
+    }
+    void store_a(double * p) const {                            // Store contiguous values (aligned to SIMD_BYTES)
+      for (int i=0; i<8; i++) p[i] = ((double*)&data)[i];
+    }
     const vec &operator=(const double v) {                      // Scalar assignment
       data = _mm512_set1_pd(v);
       return *this;
@@ -819,6 +855,18 @@ namespace exafmm {
 	const float e, const float f, const float g, const float h) :
       data(a,b,c,d,e,f,g,h) {}                                  // Copy constructor (component-wise)
     ~vec(){}                                                    // Destructor
+    void load(const float * p) {                                // Load contiguous values (unaligned)
+      data.load(p);
+    }
+    void store(float * p) const {                               // Store contiguous values (unaligned)
+      data.store(p);
+    }
+    void load_a(const float * p) {                              // Load contiguous values (aligned to SIMD_BYTES)
+      data.load_a(p);
+    }
+    void store_a(float * p) const {                             // Store contiguous values (aligned to SIMD_BYTES)
+      data.store_a(p);
+    }
     const vec &operator=(const float v) {                       // Scalar assignment
       data = v;
       return *this;
@@ -930,6 +978,18 @@ namespace exafmm {
     vec(const double a, const double b, const double c, const double d) :
       data(a,b,c,d) {}                                          // Copy constructor (component-wise)
     ~vec(){}                                                    // Destructor
+    void load(const double * p) {                               // Load contiguous values (unaligned)
+      data.load(p);
+    }
+    void store(double * p) const {                              // Store contiguous values (unaligned)
+      data.store(p);
+    }
+    void load_a(const double * p) {                             // Load contiguous values (aligned to SIMD_BYTES)
+      data.load_a(p);
+    }
+    void store_a(double * p) const {                            // Store contiguous values (aligned to SIMD_BYTES)
+      data.store_a(p);
+    }
     const vec &operator=(const double v) {                      // Scalar assignment
       data = v;
       return *this;
@@ -1029,6 +1089,262 @@ namespace exafmm {
   };
 #endif
 
+#if __AVX512F__ && !__MIC__
+#if EXAFMM_VEC_VERBOSE
+#pragma message("Overloading vector operators for AVX-512")
+#endif
+  template<>
+  class vec<16,float> {
+  private:
+    Vec16f data;
+  public:
+    vec(){}                                                     // Default constructor
+    vec(const float v) : data(v) {}                             // Copy constructor scalar
+    vec(const Vec16f v) {                                       // Copy constructor SIMD register
+      data = v;
+    }
+    vec(const vec & v) {                                        // Copy constructor vector
+      data = v.data;
+    }
+    vec(const float a, const float b, const float c, const float d,
+	const float e, const float f, const float g, const float h,
+	const float i, const float j, const float k, const float l,
+	const float m, const float n, const float o, const float p) :
+      data(a,b,c,d,e,f,g,h,i,j,k,l,m,n,o,p) {}                  // Copy constructor (component-wise)
+    ~vec(){}                                                    // Destructor
+    void load(const float * p) {                                // Load contiguous values (unaligned)
+      data.load(p);
+    }
+    void store(float * p) const {                               // Store contiguous values (unaligned)
+      data.store(p);
+    }
+    void load_a(const float * p) {                              // Load contiguous values (aligned to SIMD_BYTES)
+      data.load_a(p);
+    }
+    void store_a(float * p) const {                             // Store contiguous values (aligned to SIMD_BYTES)
+      data.store_a(p);
+    }
+    const vec &operator=(const float v) {                       // Scalar assignment
+      data = v;
+      return *this;
+    }
+    const vec &operator=(const vec & v) {                       // Vector assignment
+      data = v.data;
+      return *this;
+    }
+    const vec &operator+=(const vec & v) {                      // Vector compound assignment (add)
+      data += v.data;
+      return *this;
+    }
+    const vec &operator-=(const vec & v) {                      // Vector compound assignment (subtract)
+      data -= v.data;
+      return *this;
+    }
+    const vec &operator*=(const vec & v) {                      // Vector compound assignment (multiply)
+      data *= v.data;
+      return *this;
+    }
+    const vec &operator/=(const vec & v) {                      // Vector compound assignment (divide)
+      data /= v.data;
+      return *this;
+    }
+    const vec &operator&=(const Vec16fb & v) {                  // Vector compound assignment (mask)
+      data = data & v;
+      return *this;
+    }
+    vec operator+(const vec & v) const {                        // Vector arithmetic (add)
+      return vec(data + v.data);
+    }
+    vec operator-(const vec & v) const {                        // Vector arithmetic (subtract)
+      return vec(data - v.data);
+    }
+    vec operator*(const vec & v) const {                        // Vector arithmetic (multiply)
+      return vec(data * v.data);
+    }
+    vec operator/(const vec & v) const {                        // Vector arithmetic (divide)
+      return vec(data / v.data);
+    }
+    Vec16fb operator>(const vec & v) const {                    // Vector arithmetic (greater than)
+      return data > v.data;
+    }
+    Vec16fb operator<(const vec & v) const {                    // Vector arithmetic (less than)
+      return data < v.data;
+    }
+    vec operator-() const {                                     // Vector arithmetic (negation)
+      return vec(-data);
+    }
+    float &operator[](int i) {                                  // Indexing (lvalue)
+      return ((float*)&data)[i];
+    }
+    const float &operator[](int i) const {                      // Indexing (rvalue)
+      return ((float*)&data)[i];
+    }
+    friend std::ostream &operator<<(std::ostream & s, const vec & v) {// Component-wise output stream
+      for (int i=0; i<16; i++) s << v[i] << ' ';
+      return s;
+    }
+    friend float sum(const vec & v) {                           // Sum vector
+      return horizontal_add(v.data);
+    }
+    friend float norm(const vec & v) {                          // L2 norm squared
+      Vec16f temp = v.data * v.data;
+      return horizontal_add(temp);
+    }
+    friend vec min(const vec & v, const vec & w) {              // Element-wise minimum
+      return vec(min(v.data,w.data));
+    }
+    friend vec max(const vec & v, const vec & w) {              // Element-wise maximum
+      return vec(max(v.data,w.data));
+    }
+    friend vec rsqrt(const vec & v) {                           // Reciprocal square root
+#if EXAFMM_VEC_NEWTON                                           // Switch on Newton-Raphson correction
+      vec temp = vec(approx_rsqrt(v.data));
+      temp *= (temp * temp * v - 3.0f) * (-0.5f);
+      return temp;
+#else
+      return vec(approx_rsqrt(v.data));
+#endif
+    }
+    friend vec sin(const vec & v) {                             // Sine function
+      return vec(sin(v.data));
+    }
+    friend vec cos(const vec & v) {                             // Cosine function
+      return vec(cos(v.data));
+    }
+    friend void sincos(vec & s, vec & c, const vec & v) {       // Sine & cosine function
+      s.data = sincos(&c.data, v.data);
+    }
+    friend vec exp(const vec & v) {                             // Exponential function
+      return vec(exp(v.data));
+    }
+  };
+
+  template<>
+  class vec<8,double> {
+  private:
+    Vec8d data;
+  public:
+    vec(){}                                                     // Default constructor
+    vec(const double v) : data(v) {}                            // Copy constructor scalar
+    vec(const Vec8d v) {                                        // Copy constructor SIMD register
+      data = v;
+    }
+    vec(const vec & v) {                                        // Copy constructor vector
+      data = v.data;
+    }
+    vec(const double a, const double b, const double c, const double d,
+	const double e, const double f, const double g, const double h) :
+      data(a,b,c,d,e,f,g,h) {}                                  // Copy constructor (component-wise)
+    ~vec(){}                                                    // Destructor
+    void load(const double * p) {                               // Load contiguous values (unaligned)
+      data.load(p);
+    }
+    void store(double * p) const {                              // Store contiguous values (unaligned)
+      data.store(p);
+    }
+    void load_a(const double * p) {                             // Load contiguous values (aligned to SIMD_BYTES)
+      data.load_a(p);
+    }
+    void store_a(double * p) const {                            // Store contiguous values (aligned to SIMD_BYTES)
+      data.store_a(p);
+    }
+    const vec &operator=(const double v) {                      // Scalar assignment
+      data = v;
+      return *this;
+    }
+    const vec &operator=(const vec & v) {                       // Vector assignment
+      data = v.data;
+      return *this;
+    }
+    const vec &operator+=(const vec & v) {                      // Vector compound assignment (add)
+      data += v.data;
+      return *this;
+    }
+    const vec &operator-=(const vec & v) {                      // Vector compound assignment (subtract)
+      data -= v.data;
+      return *this;
+    }
+    const vec &operator*=(const vec & v) {                      // Vector compound assignment (multiply)
+      data *= v.data;
+      return *this;
+    }
+    const vec &operator/=(const vec & v) {                      // Vector compound assignment (divide)
+      data /= v.data;
+      return *this;
+    }
+    const vec &operator&=(const Vec8db & v) {                   // Vector compound assignment (mask)
+      data = data & v;
+      return *this;
+    }
+    vec operator+(const vec & v) const {                        // Vector arithmetic (add)
+      return vec(data + v.data);
+    }
+    vec operator-(const vec & v) const {                        // Vector arithmetic (subtract)
+      return vec(data - v.data);
+    }
+    vec operator*(const vec & v) const {                        // Vector arithmetic (multiply)
+      return vec(data * v.data);
+    }
+    vec operator/(const vec & v) const {                        // Vector arithmetic (divide)
+      return vec(data / v.data);
+    }
+    Vec8db operator>(const vec & v) const {                     // Vector arithmetic (greater than)
+      return data > v.data;
+    }
+    Vec8db operator<(const vec & v) const {                     // Vector arithmetic (less than)
+      return data < v.data;
+    }
+    vec operator-() const {                                     // Vector arithmetic (negation)
+      return vec(-data);
+    }
+    double &operator[](int i) {                                 // Indexing (lvalue)
+      return ((double*)&data)[i];
+    }
+    const double &operator[](int i) const {                     // Indexing (rvalue)
+      return ((double*)&data)[i];
+    }
+    friend std::ostream &operator<<(std::ostream & s, const vec & v) {// Component-wise output stream
+      for (int i=0; i<8; i++) s << v[i] << ' ';
+      return s;
+    }
+    friend double sum(const vec & v) {                          // Sum vector
+      return horizontal_add(v.data);
+    }
+    friend double norm(const vec & v) {                         // L2 norm squared
+      Vec8d temp = v.data * v.data;
+      return horizontal_add(temp);
+    }
+    friend vec min(const vec & v, const vec & w) {              // Element-wise minimum
+      return vec(min(v.data,w.data));
+    }
+    friend vec max(const vec & v, const vec & w) {              // Element-wise maximum
+      return vec(max(v.data,w.data));
+    }
+    friend vec rsqrt(const vec & v) {                           // Reciprocal square root
+#if EXAFMM_VEC_NEWTON                                           // Switch on Newton-Raphson correction
+      vec temp = vec(_mm512_rsqrt14_pd(v.data));                // 14 bit estimate in double precision
+      temp *= (temp * temp * v - 3.0) * (-0.5);
+      return temp;
+#else
+      vec one = 1;
+      return vec(one.data / sqrt(v.data));
+#endif
+    }
+    friend vec sin(const vec & v) {                             // Sine function
+      return vec(sin(v.data));
+    }
+    friend vec cos(const vec & v) {                             // Cosine function
+      return vec(cos(v.data));
+    }
+    friend void sincos(vec & s, vec & c, const vec & v) {       // Sine & cosine function
+      s.data = sincos(&c.data, v.data);
+    }
+    friend vec exp(const vec & v) {                             // Exponential function
+      return vec(exp(v.data));
+    }
+  };
+#endif
+
 #if __bgq__
 #if EXAFMM_VEC_VERBOSE
 #pragma message("Overloading vector operators for BG/Q")
@@ -1054,6 +1370,18 @@ namespace exafmm {
       data = temp;
     }
     ~vec(){}                                                    // Destructor
+    void load(const double * p) {                               // Load contiguous values (unaligned)
+      for (int i=0; i<4; i++) ((double*)&data)[i] = p[i];
+    }
+    void store(double * p) const {                              // Store contiguous values (unaligned)
+      for (int i=0; i<4; i++) p[i] = ((double*)&data)[i];
+    }
+    void load_a(const double * p) {                             // Load contiguous values (aligned to SIMD_BYTES)
+      for (int i=0; i<4; i++) ((double*)&data)[i] = p[i];
+    }
+    void store_a(double * p) const {                            // Store contiguous values (aligned to SIMD_BYTES)
+      for (int i=0; i<4; i++) p[i] = ((double*)&data)[i];
+    }
     const vec &operator=(double v) {                            // Scalar assignment
       vector4double temp = {v};
       data = temp;
@@ -1178,6 +1506,18 @@ namespace exafmm {
     vec(const float a, const float b, const float c, const float d) :
       data(a,b,c,d) {}                                          // Copy constructor (component-wise)
     ~vec(){}                                                    // Destructor
+    void load(const float * p) {                                // Load contiguous values (unaligned)
+      data.load(p);
+    }
+    void store(float * p) const {                               // Store contiguous values (unaligned)
+      data.store(p);
+    }
+    void load_a(const float * p) {                              // Load contiguous values (aligned to SIMD_BYTES)
+      data.load_a(p);
+    }
+    void store_a(float * p) const {                             // Store contiguous values (aligned to SIMD_BYTES)
+      data.store_a(p);
+    }
     const vec &operator=(const float v) {                       // Scalar assignment
       data = v;
       return *this;
@@ -1289,6 +1629,18 @@ namespace exafmm {
     vec(const double a, const double b) :
       data(a,b) {}                                              // Copy constructor (component-wise)
     ~vec(){}                                                    // Destructor
+    void load(const double * p) {                               // Load contiguous values (unaligned)
+      data.load(p);
+    }
+    void store(double * p) const {                              // Store contiguous values (unaligned)
+      data.store(p);
+    }
+    void load_a(const double * p) {                             // Load contiguous values (aligned to SIMD_BYTES)
+      data.load_a(p);
+    }
+    void store_a(double * p) const {                            // Store contiguous values (aligned to SIMD_BYTES)
+      data.store_a(p);
+    }
     const vec &operator=(const double v) {                      // Scalar assignment
       data = v;
       return *this;
@@ -1413,6 +1765,18 @@ namespace exafmm {
       data = _mm_set_pd(b,a);
     }
     ~vec(){}                                                    // Destructor
+    void load(const double * p) {                               // Load contiguous values (unaligned)
+      data = _mm_loadu_pd(p);
+    }
+    void store(double * p) const {                              // Store contiguous values (unaligned)
+      _mm_storeu_pd(p,data);
+    }
+    void load_a(const double * p) {                             // Load contiguous values (aligned to SIMD_BYTES)
+      data = _mm_load_pd(p);
+    }
+    void store_a(double * p) const {                            // Store contiguous values (aligned to SIMD_BYTES)
+      _mm_store_pd(p,data);
+    }
     const vec &operator=(const double v) {                      // Scalar assignment
       data = _mm_set_pd(v,v);
       return *this;
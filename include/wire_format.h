@@ -0,0 +1,178 @@
+#ifndef wire_format_h
+#define wire_format_h
+#include <cassert>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <vector>
+#include "types.h"
+
+#ifndef EXAFMM_WIRE_FLOAT_M
+#define EXAFMM_WIRE_FLOAT_M 0                                   // Set to 1 to send multipoles in single precision
+#endif
+
+namespace exafmm {
+  const int WIRE_VERSION = 2;                                   //!< Version of the packed format
+  const int WIRE_FLOAT_M = 1;                                   //!< Flag: multipoles are packed as float
+
+  //! Flags used by this build when packing
+#if EXAFMM_WIRE_FLOAT_M && !EXAFMM_SINGLE && !EXAFMM_MIXED
+  const int WIRE_FLAGS = WIRE_FLOAT_M;
+#else
+  const int WIRE_FLAGS = 0;
+#endif
+
+  //! Header at the start of every packed stream of cells or bodies
+  struct WireHeader {
+    int version;                                                //!< Format version
+    int flags;                                                  //!< Format flags
+    int count;                                                  //!< Number of packed cells or bodies
+    int pad;                                                    //!< Padding
+  };
+  const int WIREHEADERWORD = sizeof(WireHeader) / 4;
+
+  //! Fields of a cell needed by the receiver; the multipole coefficients follow it
+  //! Plain old data, so that it can be copied to and from the buffer with memcpy
+  struct PackedCell {
+    real_t   X[3];                                              //!< Cell center
+    real_t   R;                                                 //!< Cell radius
+    real_t   SCALE;                                             //!< Scale for Helmholtz kernel
+    uint64_t ICELL;                                             //!< Cell index
+    int      NCHILD;                                            //!< Number of child cells
+    int      NBODY;                                             //!< Number of descendant bodies
+    int      IPARENT;                                           //!< Index of parent inside a packed subtree
+    int      LEVEL;                                             //!< Level at which cell is located
+  };
+
+  const int WIRETERMS = sizeof(vecP) / sizeof(mreal_t);         //!< Real numbers in one multipole
+  const int WIRESRC = sizeof(Source::SRC) / sizeof(real_t);     //!< Real numbers in one source value
+
+  //! Position and source of a body, the only fields that are sent
+  struct PackedBody {
+    real_t   X[3];                                              //!< Position
+    real_t   SRC[WIRESRC];                                      //!< Source values
+  };
+  const int PACKEDBODYWORD = (sizeof(PackedBody) + 3) / 4;      //!< Words of one packed body
+
+  //! Words of one packed cell
+  inline int packedCellWords(int flags) {
+    size_t bytes = sizeof(PackedCell) + WIRETERMS * ((flags & WIRE_FLOAT_M) ? sizeof(float) : sizeof(mreal_t));
+    return (bytes + 3) / 4;
+  }
+
+  //! Start a packed stream; buffer must be empty
+  inline void beginWire(std::vector<int> & buffer, int flags=WIRE_FLAGS) {
+    assert(buffer.empty());
+    WireHeader header = {WIRE_VERSION, flags, 0, 0};
+    buffer.resize(WIREHEADERWORD);
+    std::memcpy(&buffer[0], &header, sizeof(header));
+  }
+
+  //! Header of a packed stream
+  inline WireHeader readWire(const int * data) {
+    WireHeader header;
+    std::memcpy(&header, data, sizeof(header));
+    if (header.version != WIRE_VERSION) {                       // If the stream was packed by another build
+      std::cerr << "Packed stream has version " << header.version
+                << ", expected " << WIRE_VERSION << std::endl;
+      abort();
+    }                                                           // End if for version
+    return header;
+  }
+
+  //! Number of cells or bodies in a packed stream
+  inline int wireCount(const int * data) {
+    return readWire(data).count;
+  }
+
+  //! Append count cells to a packed stream, with the multipole coefficients of cell i from M[i]
+  template <typename Iter>
+  inline void packCells(std::vector<int> & buffer, Iter first, const vecP * M, int count) {
+    WireHeader header = readWire(&buffer[0]);
+    const int words = packedCellWords(header.flags);
+    size_t offset = buffer.size();
+    buffer.resize(offset + size_t(words) * count);
+    for (int i=0; i<count; i++, ++first) {                      // Loop over cells
+      PackedCell cell;                                          //  Packed fields
+      for (int d=0; d<3; d++) cell.X[d] = first->X[d];
+      cell.R = first->R;
+      cell.SCALE = first->SCALE;
+      cell.ICELL = first->ICELL;
+      cell.NCHILD = first->NCHILD;
+      cell.NBODY = first->NBODY;
+      cell.IPARENT = first->IPARENT;
+      cell.LEVEL = first->LEVEL;
+      char * data = (char*)&buffer[offset + size_t(words) * i];  //  Start of packed cell
+      std::memcpy(data, &cell, sizeof(cell));
+      const mreal_t * Mr = (const mreal_t*)&M[i];               //  Multipole as real numbers
+      if (header.flags & WIRE_FLOAT_M) {                        //  If multipole is downcast
+        float * Mf = (float*)(data + sizeof(cell));
+        for (int n=0; n<WIRETERMS; n++) Mf[n] = Mr[n];
+      } else {                                                  //  Else full precision
+        std::memcpy(data + sizeof(cell), Mr, WIRETERMS * sizeof(mreal_t));
+      }                                                         //  End if for downcast
+    }                                                           // End loop over cells
+    header.count += count;
+    std::memcpy(&buffer[0], &header, sizeof(header));
+  }
+
+  //! Append count bodies to a packed stream
+  template <typename Iter>
+  inline void packBodies(std::vector<int> & buffer, Iter first, int count) {
+    WireHeader header = readWire(&buffer[0]);
+    size_t offset = buffer.size();
+    buffer.resize(offset + size_t(PACKEDBODYWORD) * count);
+    for (int i=0; i<count; i++, ++first) {                      // Loop over bodies
+      PackedBody body;                                          //  Packed fields
+      for (int d=0; d<3; d++) body.X[d] = first->X[d];
+      const real_t * SRC = (const real_t*)&first->SRC;          //  Source as real numbers
+      for (int n=0; n<WIRESRC; n++) body.SRC[n] = SRC[n];
+      std::memcpy(&buffer[offset + size_t(PACKEDBODYWORD) * i], &body, sizeof(body));
+    }                                                           // End loop over bodies
+    header.count += count;
+    std::memcpy(&buffer[0], &header, sizeof(header));
+  }
+
+  //! Unpack all cells of a packed stream into Multipole cells; fields that are not sent are left untouched
+  template <typename Iter>
+  inline void unpackCells(const int * data, Iter first) {
+    WireHeader header = readWire(data);
+    const int words = packedCellWords(header.flags);
+    data += WIREHEADERWORD;
+    for (int i=0; i<header.count; i++, ++first) {               // Loop over cells
+      const char * packed = (const char*)(data + size_t(words) * i);// Start of packed cell
+      PackedCell cell;
+      std::memcpy(&cell, packed, sizeof(cell));
+      for (int d=0; d<3; d++) first->X[d] = cell.X[d];
+      first->R = cell.R;
+      first->SCALE = cell.SCALE;
+      first->ICELL = cell.ICELL;
+      first->NCHILD = cell.NCHILD;
+      first->NBODY = cell.NBODY;
+      first->IPARENT = cell.IPARENT;
+      first->LEVEL = cell.LEVEL;
+      mreal_t * M = (mreal_t*)&first->M;                        //  Multipole as real numbers
+      if (header.flags & WIRE_FLOAT_M) {                        //  If multipole was downcast
+        const float * Mf = (const float*)(packed + sizeof(cell));
+        for (int n=0; n<WIRETERMS; n++) M[n] = Mf[n];
+      } else {                                                  //  Else full precision
+        std::memcpy(M, packed + sizeof(cell), WIRETERMS * sizeof(mreal_t));
+      }                                                         //  End if for downcast
+    }                                                           // End loop over cells
+  }
+
+  //! Unpack all bodies of a packed stream; only position and source are set
+  template <typename Iter>
+  inline void unpackBodies(const int * data, Iter first) {
+    WireHeader header = readWire(data);
+    data += WIREHEADERWORD;
+    for (int i=0; i<header.count; i++, ++first) {               // Loop over bodies
+      PackedBody body;                                          //  Packed fields
+      std::memcpy(&body, data + size_t(PACKEDBODYWORD) * i, sizeof(body));
+      for (int d=0; d<3; d++) first->X[d] = body.X[d];
+      real_t * SRC = (real_t*)&first->SRC;                      //  Source as real numbers
+      for (int n=0; n<WIRESRC; n++) SRC[n] = body.SRC[n];
+    }                                                           // End loop over bodies
+  }
+}
+#endif
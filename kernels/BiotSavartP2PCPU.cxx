@@ -8,12 +8,152 @@ namespace exafmm {
     real_t eps2;
     vec3 Xperiodic;
 
-    void P2P(C_iter Ci, C_iter Cj, bool mutual) {
+#if EXAFMM_USE_SIMD
+    const int NCHEBSERIES = 16;                                 //!< Chebyshev terms of the small argument fit
+    const int NCHEBFRACTION = 20;                               //!< Chebyshev terms of the large argument fit
+    const real_t XMID = 2.0;                                    //!< Switch between the two fits
+    const real_t XMAX = 6.0;                                    //!< erfc is below 1e-16 from here on
+
+    //! Chebyshev coefficients of f on [a,b]
+    template<typename F>
+    std::vector<real_t> chebyshevFit(F f, double a, double b, int n) {
+      std::vector<double> fnode(n);
+      std::vector<real_t> coef(n);
+      for (int k=0; k<n; k++) {
+	fnode[k] = f(a + (b - a) * (std::cos(M_PI * (k + 0.5) / n) + 1) / 2);
+      }
+      for (int m=0; m<n; m++) {
+	double c = 0;
+	for (int k=0; k<n; k++) c += fnode[k] * std::cos(M_PI * m * (k + 0.5) / n);
+	coef[m] = (m == 0 ? 1.0 : 2.0) * c / n;
+      }
+      return coef;
+    }
+
+    //! (erf(x) - 2 x exp(-x^2) / sqrt(pi)) / x^3 as a function of t = x^2, by its Taylor series
+    double seriesReference(double t) {
+      double sum = 0, term = 1;
+      for (int n=0; std::abs(term)>1e-20; n++) {
+	sum += term / (2 * n + 3);
+	term *= -t / (n + 1);
+      }
+      return 4 / std::sqrt(M_PI) * sum;
+    }
+
+    //! Scaled complementary error function exp(x^2) erfc(x)
+    double erfcxReference(double x) {
+      return std::exp(x * x) * std::erfc(x);
+    }
+
+    //! Clenshaw summation of a Chebyshev series at y in [-1,1]
+    inline simdvec clenshaw(const std::vector<real_t> & coef, const simdvec & y) {
+      int n = coef.size();
+      simdvec y2 = y + y;
+      simdvec b1 = coef[n-1];
+      simdvec b2 = 0.0;
+      for (int m=n-2; m>0; m--) {
+	simdvec b = y2 * b1 - b2 + coef[m];
+	b2 = b1;
+	b1 = b;
+      }
+      return y * b1 - b2 + coef[0];
+    }
+
+    //! erf(x) - 2 x exp(-x^2) / sqrt(pi), evaluated without cancellation at small x
+    //! x^3 times a fit in x^2 below XMID, erfc through a fit of erfcx above, relative error < 1e-13
+    inline simdvec cutoffFactor(const simdvec & x) {
+      static const std::vector<real_t> coefSeries = chebyshevFit(seriesReference, 0, XMID * XMID, NCHEBSERIES);
+      static const std::vector<real_t> coefFraction = chebyshevFit(erfcxReference, XMID, XMAX, NCHEBFRACTION);
+      simdvec one = 1.0;
+      simdvec x2 = x * x;
+      simdvec xs = min(x, simdvec(XMID));                       // Small argument
+      simdvec xs2 = xs * xs;
+      simdvec series = xs * xs2 * clenshaw(coefSeries, xs2 * real_t(2 / (XMID * XMID)) - one);
+      simdvec xl = max(min(x, simdvec(XMAX)), simdvec(XMID));   // Large argument
+      simdvec yl = (xl + xl - real_t(XMID + XMAX)) * real_t(1 / (XMAX - XMID));
+      simdvec fraction = one - exp(-x2) * (clenshaw(coefFraction, yl) + x * real_t(2 / std::sqrt(M_PI)));
+      simdvec blend = series - fraction;
+      blend &= x < simdvec(XMID);
+      return fraction + blend;
+    }
+
+    //! P2P_TILE_I target vectors against P2P_TILE_J sources {x,y,z,alpha,0.5/sigma^2}, with every pair in registers
+    //! The self pair has dX = 0 and adds nothing, so the same tile serves P2P(C)
+    inline __attribute__((always_inline)) void P2PTile(const simdvec * xi, const simdvec * yi, const simdvec * zi,
+						       const real_t (* Sj)[7], ksimdvec * ax, ksimdvec * ay, ksimdvec * az) {
+      simdvec zero = 0.0;
+      for (int jj=0; jj<P2P_TILE_J; jj++) {
+	for (int ii=0; ii<P2P_TILE_I; ii++) {
+	  simdvec dx = xi[ii] - Sj[jj][0];
+	  simdvec dy = yi[ii] - Sj[jj][1];
+	  simdvec dz = zi[ii] - Sj[jj][2];
+	  simdvec R2 = eps2;
+	  R2 += dx * dx;
+	  R2 += dy * dy;
+	  R2 += dz * dz;
+	  simdvec invR = rsqrt(R2);
+	  simdvec RS = R2 * Sj[jj][6];
+	  simdvec cutoff = invR * invR * invR * cutoffFactor(RS * rsqrt(RS));
+	  cutoff &= R2 > zero;
+	  ax[ii] += (dy * Sj[jj][5] - dz * Sj[jj][4]) * cutoff;
+	  ay[ii] += (dz * Sj[jj][3] - dx * Sj[jj][5]) * cutoff;
+	  az[ii] += (dx * Sj[jj][4] - dy * Sj[jj][3]) * cutoff;
+	}
+      }
+    }
+
+    //! Stage sources j..j+mj; the padding has zero strength and unit core size
+    template<typename J_iter>
+    inline void loadSources(J_iter Bj, int j, int mj, real_t (* Sj)[7]) {
+      for (int jj=0; jj<P2P_TILE_J; jj++) {
+	for (int d=0; d<6; d++) Sj[jj][d] = 0;
+	Sj[jj][6] = 0.5;
+      }
+      for (int jj=0; jj<mj; jj++) {
+	for (int d=0; d<3; d++) Sj[jj][d] = Bj[j+jj].X[d];
+	for (int d=0; d<3; d++) Sj[jj][3+d] = Bj[j+jj].SRC[d];
+	Sj[jj][6] = 0.5 / (Bj[j+jj].SRC[3] * Bj[j+jj].SRC[3]);
+      }
+    }
+#endif
+
+    template <typename J_iter>
+    void P2P(C_iter Ci, J_iter Cj, bool mutual) {
       B_iter Bi = Ci->BODY;
       B_iter Bj = Cj->BODY;
       int ni = Ci->NBODY;
       int nj = Cj->NBODY;
       int i = 0;
+#if EXAFMM_USE_SIMD
+      simdvec zero = 0.0;
+      for ( ; i<ni; i+=P2P_TILE_I*NSIMD) {
+	simdvec xi[P2P_TILE_I], yi[P2P_TILE_I], zi[P2P_TILE_I];
+	ksimdvec ax[P2P_TILE_I], ay[P2P_TILE_I], az[P2P_TILE_I];
+	for (int ii=0; ii<P2P_TILE_I; ii++) {
+	  int nv = std::max(0, std::min(NSIMD, ni-i-ii*NSIMD)); // Lanes past nv are not written back
+	  xi[ii] = SIMDPartial<simdvec,0,NSIMD>::setBody(Bi,i+ii*NSIMD,nv) - Xperiodic[0];
+	  yi[ii] = SIMDPartial<simdvec,1,NSIMD>::setBody(Bi,i+ii*NSIMD,nv) - Xperiodic[1];
+	  zi[ii] = SIMDPartial<simdvec,2,NSIMD>::setBody(Bi,i+ii*NSIMD,nv) - Xperiodic[2];
+	  ax[ii] = zero;
+	  ay[ii] = zero;
+	  az[ii] = zero;
+	}
+	for (int j=0; j<nj; j+=P2P_TILE_J) {
+	  real_t Sj[P2P_TILE_J][7];
+	  loadSources(Bj, j, std::min(P2P_TILE_J, nj-j), Sj);
+	  P2PTile(xi, yi, zi, Sj, ax, ay, az);
+	}
+	for (int ii=0; ii<P2P_TILE_I; ii++) {
+	  int nv = std::max(0, std::min(NSIMD, ni-i-ii*NSIMD));
+	  for (int k=0; k<nv; k++) {
+	    Bi[i+ii*NSIMD+k].TRG[0] = 1;
+	    Bi[i+ii*NSIMD+k].TRG[1] += transpose(ax[ii], k);
+	    Bi[i+ii*NSIMD+k].TRG[2] += transpose(ay[ii], k);
+	    Bi[i+ii*NSIMD+k].TRG[3] += transpose(az[ii], k);
+	  }
+	}
+      }
+#else
       for ( ; i<ni; i++) {
 	kreal_t ax = 0;
 	kreal_t ay = 0;
@@ -34,20 +174,51 @@ namespace exafmm {
 	Bi[i].TRG[0] = 1;
 	Bi[i].TRG[1] += ax;
 	Bi[i].TRG[2] += ay;
-	Bi[i].TRG[3] += az; 
+	Bi[i].TRG[3] += az;
       }
+#endif
     }
 
     void P2P(C_iter C) {
       B_iter B = C->BODY;
       int n = C->NBODY;
       int i = 0;
+#if EXAFMM_USE_SIMD
+      simdvec zero = 0.0;
+      for ( ; i<n; i+=P2P_TILE_I*NSIMD) {
+	simdvec xi[P2P_TILE_I], yi[P2P_TILE_I], zi[P2P_TILE_I];
+	ksimdvec ax[P2P_TILE_I], ay[P2P_TILE_I], az[P2P_TILE_I];
+	for (int ii=0; ii<P2P_TILE_I; ii++) {
+	  int nv = std::max(0, std::min(NSIMD, n-i-ii*NSIMD));  // Lanes past nv are not written back
+	  xi[ii] = SIMDPartial<simdvec,0,NSIMD>::setBody(B,i+ii*NSIMD,nv);
+	  yi[ii] = SIMDPartial<simdvec,1,NSIMD>::setBody(B,i+ii*NSIMD,nv);
+	  zi[ii] = SIMDPartial<simdvec,2,NSIMD>::setBody(B,i+ii*NSIMD,nv);
+	  ax[ii] = zero;
+	  ay[ii] = zero;
+	  az[ii] = zero;
+	}
+	for (int j=0; j<n; j+=P2P_TILE_J) {                     // Every source, since the kernel is not symmetric
+	  real_t Sj[P2P_TILE_J][7];
+	  loadSources(B, j, std::min(P2P_TILE_J, n-j), Sj);
+	  P2PTile(xi, yi, zi, Sj, ax, ay, az);
+	}
+	for (int ii=0; ii<P2P_TILE_I; ii++) {
+	  int nv = std::max(0, std::min(NSIMD, n-i-ii*NSIMD));
+	  for (int k=0; k<nv; k++) {
+	    B[i+ii*NSIMD+k].TRG[0] = 1;
+	    B[i+ii*NSIMD+k].TRG[1] += transpose(ax[ii], k);
+	    B[i+ii*NSIMD+k].TRG[2] += transpose(ay[ii], k);
+	    B[i+ii*NSIMD+k].TRG[3] += transpose(az[ii], k);
+	  }
+	}
+      }
+#else
       for ( ; i<n; i++) {
 	kreal_t ax = 0;
 	kreal_t ay = 0;
 	kreal_t az = 0;
-	for (int j=i+1; j<n; j++) {
-	  vec3 dX = B[j].X - B[i].X;
+	for (int j=0; j<n; j++) {
+	  vec3 dX = B[i].X - B[j].X;
 	  real_t R2 = norm(dX) + eps2;
 	  if (R2 != 0) {
 	    real_t invR2 = 1.0 / R2;
@@ -64,6 +235,9 @@ namespace exafmm {
 	B[i].TRG[2] += ay;
 	B[i].TRG[3] += az;
       }
+#endif
     }
   }
 }
+template void exafmm::kernel::P2P<exafmm::C_iter>(exafmm::C_iter Ci, exafmm::C_iter Cj, bool mutual);
+template void exafmm::kernel::P2P<exafmm::M_iter>(exafmm::C_iter Ci, exafmm::M_iter Cj, bool mutual);
@@ -107,9 +107,13 @@ namespace exafmm {
       }                                                         // End loop over m in Ynm
     }
 
-    void setup() {}
+    int order = P;
 
-    void P2M(C_iter C) {
+    void setup() {
+      checkOrder(P, P);                                         // Spherical kernels are built for a single order
+    }
+
+    void P2M(C_iter C, vecP & M) {
       complex_t Ynm[P*P], YnmTheta[P*P];
       for (B_iter B=C->BODY; B!=C->BODY+C->NBODY; B++) {
 	vec3 dX = B->X - C->X;
@@ -121,16 +125,18 @@ namespace exafmm {
 	    int nm  = n * n + n - m;
 	    int nms = n * (n + 1) / 2 + m;
 	    for (int d=0; d<3; d++) {
-	      C->M[3*nms+d] += B->SRC[d] * Ynm[nm];
+	      M[3*nms+d] += B->SRC[d] * Ynm[nm];
 	    }
 	  }
 	}
       }
     }
 
-    void M2M(C_iter Ci, C_iter C0) {
+    void M2M(C_iter Ci, C_iter C0, vecP * M0) {
       complex_t Ynm[P*P], YnmTheta[P*P];
+      vecP & Mi = M0[Ci-C0];
       for (C_iter Cj=C0+Ci->ICHILD; Cj!=C0+Ci->ICHILD+Ci->NCHILD; Cj++) {
+	const vecP & Mj = M0[Cj-C0];
 	vec3 dX = Ci->X - Cj->X;
 	real_t rho, alpha, beta;
 	cart2sph(rho, alpha, beta, dX);
@@ -144,26 +150,28 @@ namespace exafmm {
 		int jnkms = (j - n) * (j - n + 1) / 2 + k - m;
 		int nm    = n * n + n - m;
 		for (int d=0; d<3; d++) {
-		  M[d] += Cj->M[3*jnkms+d] * Ynm[nm] * real_t(ipow2n(m) * oddOrEven(n));
+		  M[d] += Mj[3*jnkms+d] * Ynm[nm] * real_t(ipow2n(m) * oddOrEven(n));
 		}
 	      }
 	      for (int m=k; m<=std::min(n,j+k-n); m++) {
 		int jnkms = (j - n) * (j - n + 1) / 2 - k + m;
 		int nm    = n * n + n - m;	
 		for (int d=0; d<3; d++) {
-		  M[d] += std::conj(Cj->M[3*jnkms+d]) * Ynm[nm] * real_t(oddOrEven(k+n+m));
+		  M[d] += std::conj(Mj[3*jnkms+d]) * Ynm[nm] * real_t(oddOrEven(k+n+m));
 		}
 	      }
 	    }
 	    for (int d=0; d<3; d++) {
-	      Ci->M[3*jks+d] += M[d];
+	      Mi[3*jks+d] += M[d];
 	    }
 	  }
 	}
       }
     }
 
-    void M2L(C_iter Ci, C_iter Cj, bool mutual) {
+    template <typename J_iter>
+    void M2L(C_iter Ci, J_iter Cj, const vecP & Mi, vecP & Li, const vecP & Mj, vecP * Lj) {
+      bool mutual = Lj != NULL;
       assert(mutual == false);
       complex_t Ynmi[P*P], Ynmj[P*P];
       vec3 dX = Ci->X - Cj->X - Xperiodic;
@@ -175,14 +183,14 @@ namespace exafmm {
 	real_t Cnm = oddOrEven(j);
 	for (int k=0; k<=j; k++) {
 	  int jks = j * (j + 1) / 2 + k;
-	  complex_t Li[3] = {0, 0, 0}, Lj[3] = {0, 0, 0};
+	  complex_t LI[3] = {0, 0, 0}, LJ[3] = {0, 0, 0};
 	  for (int n=0; n<P-j; n++) {
 	    for (int m=-n; m<0; m++) {
 	      int nms  = n * (n + 1) / 2 - m;
 	      int jnkm = (j + n) * (j + n) + j + n + m - k;
 	      for (int d=0; d<3; d++) {
-		Li[d] += std::conj(Cj->M[3*nms+d]) * Cnm * Ynmi[jnkm];
-		if (mutual) Lj[d] += std::conj(Ci->M[3*nms+d]) * Cnm * Ynmj[jnkm];
+		LI[d] += std::conj(Mj[3*nms+d]) * Cnm * Ynmi[jnkm];
+		if (mutual) LJ[d] += std::conj(Mi[3*nms+d]) * Cnm * Ynmj[jnkm];
 	      }
 	    }
 	    for (int m=0; m<=n; m++) {
@@ -190,22 +198,31 @@ namespace exafmm {
 	      int jnkm = (j + n) * (j + n) + j + n + m - k;
 	      real_t Cnm2 = Cnm * oddOrEven((k-m)*(k<m)+m);
 	      for (int d=0; d<3; d++) {
-		Li[d] += Cj->M[3*nms+d] * Cnm2 * Ynmi[jnkm];
-		if (mutual) Lj[d] += Ci->M[3*nms+d] * Cnm2 * Ynmj[jnkm];
+		LI[d] += Mj[3*nms+d] * Cnm2 * Ynmi[jnkm];
+		if (mutual) LJ[d] += Mi[3*nms+d] * Cnm2 * Ynmj[jnkm];
 	      }
 	    }
 	  }
 	  for (int d=0; d<3; d++) {
-	    Ci->L[3*jks+d] += Li[d];
-	    if (mutual) Cj->L[3*jks+d] += Lj[d];
+	    Li[3*jks+d] += LI[d];
+	    if (mutual) (*Lj)[3*jks+d] += LJ[d];
 	  }
 	}
       }
     }
+    template void M2L<C_iter>(C_iter Ci, C_iter Cj, const vecP & Mi, vecP & Li, const vecP & Mj, vecP * Lj);
+    template void M2L<M_iter>(C_iter Ci, M_iter Cj, const vecP & Mi, vecP & Li, const vecP & Mj, vecP * Lj);
+
+    //! M2L from a list of source cells to Ci
+    void M2LBatch(C_iter Ci, const C_iter * Cj, int numCj, C_iter Cj0, const vecP & Mi, vecP & Li, const vecP * Mj) {
+      for (int j=0; j<numCj; j++) M2L(Ci, Cj[j], Mi, Li, Mj[Cj[j]-Cj0], NULL);
+    }
 
-    void L2L(C_iter Ci, C_iter C0) {
+    void L2L(C_iter Ci, C_iter C0, const vecP *, vecP * L0) {
       complex_t Ynm[P*P], YnmTheta[P*P];
       C_iter Cj = C0 + Ci->IPARENT;
+      vecP & Li = L0[Ci-C0];
+      const vecP & Lj = L0[Ci->IPARENT];
       vec3 dX = Ci->X - Cj->X;
       real_t rho, alpha, beta;
       cart2sph(rho, alpha, beta, dX);
@@ -219,7 +236,7 @@ namespace exafmm {
 	      int jnkm = (n - j) * (n - j) + n - j + m - k;
 	      int nms  = n * (n + 1) / 2 - m;
 	      for (int d=0; d<3; d++) {
-		L[d] += std::conj(Cj->L[3*nms+d]) * Ynm[jnkm] * real_t(oddOrEven(k));
+		L[d] += std::conj(Lj[3*nms+d]) * Ynm[jnkm] * real_t(oddOrEven(k));
 	      }
 	    }
 	    for (int m=0; m<=n; m++) {
@@ -227,19 +244,19 @@ namespace exafmm {
 		int jnkm = (n - j) * (n - j) + n - j + m - k;
 		int nms  = n * (n + 1) / 2 + m;
 		for (int d=0; d<3; d++) {
-		  L[d] += Cj->L[3*nms+d] * Ynm[jnkm] * real_t(oddOrEven((m-k)*(m<k)));
+		  L[d] += Lj[3*nms+d] * Ynm[jnkm] * real_t(oddOrEven((m-k)*(m<k)));
 		}
 	      }
 	    }
 	  }
 	  for (int d=0; d<3; d++) {
-	    Ci->L[3*jks+d] += L[d];
+	    Li[3*jks+d] += L[d];
 	  }
 	}
       }
     }
 
-    void L2P(C_iter Ci) {
+    void L2P(C_iter Ci, const vecP & L) {
       complex_t Ynm[P*P], YnmTheta[P*P];
       for (B_iter B=Ci->BODY; B!=Ci->BODY+Ci->NBODY; B++) {
 	vec3 dX = B->X - Ci->X + EPS;
@@ -251,18 +268,18 @@ namespace exafmm {
 	for (int n=0; n<P; n++) {
 	  int nm  = n * n + n;
 	  int nms = n * (n + 1) / 2;
-	  B->TRG[0] += std::real(Ci->L[nms] * Ynm[nm]);
+	  B->TRG[0] += std::real(L[nms] * Ynm[nm]);
 	  for (int d=0; d<3; d++) {
-	    spherical[d][0] += std::real(Ci->L[3*nms+d] * Ynm[nm]) / r * n;
-	    spherical[d][1] += std::real(Ci->L[3*nms+d] * YnmTheta[nm]);
+	    spherical[d][0] += std::real(L[3*nms+d] * Ynm[nm]) / r * n;
+	    spherical[d][1] += std::real(L[3*nms+d] * YnmTheta[nm]);
 	  }
 	  for( int m=1; m<=n; m++) {
 	    nm  = n * n + n + m;
 	    nms = n * (n + 1) / 2 + m;
 	    for (int d=0; d<3; d++) {
-	      spherical[d][0] += 2 * std::real(Ci->L[3*nms+d] * Ynm[nm]) / r * n;
-	      spherical[d][1] += 2 * std::real(Ci->L[3*nms+d] * YnmTheta[nm]);
-	      spherical[d][2] += 2 * std::real(Ci->L[3*nms+d] * Ynm[nm] * I) * m;
+	      spherical[d][0] += 2 * std::real(L[3*nms+d] * Ynm[nm]) / r * n;
+	      spherical[d][1] += 2 * std::real(L[3*nms+d] * YnmTheta[nm]);
+	      spherical[d][2] += 2 * std::real(L[3*nms+d] * Ynm[nm] * I) * m;
 	    }
 	  }
 	}
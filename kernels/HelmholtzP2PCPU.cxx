@@ -8,97 +8,154 @@ complex_t wavek;
 vec3 Xperiodic;
 
 const complex_t I(0., 1.);
-template <typename J_iter>
-void P2P(C_iter Ci, J_iter Cj, bool mutual) {
-	real_t wave_r = std::real(wavek);
-	real_t wave_i = std::imag(wavek);
-	B_iter Bi = Ci->BODY;
-	B_iter Bj = Cj->BODY;
-	int ni = Ci->NBODY;
-	int nj = Cj->NBODY;
-	int i = 0;
 #if EXAFMM_USE_SIMD
-	simdvec wave_rvec = wave_r;
-	simdvec wave_ivec = wave_i;
-	for ( ; i <= ni - NSIMD; i += NSIMD) {
-		simdvec zero = 0.0;
-		simdvec one = 1.0;
-		ksimdvec pot_r = zero;
-		ksimdvec pot_i = zero;
-		ksimdvec ax_r = zero;
-		ksimdvec ax_i = zero;
-		ksimdvec ay_r = zero;
-		ksimdvec ay_i = zero;
-		ksimdvec az_r = zero;
-		ksimdvec az_i = zero;
-
-		simdvec xi = SIMD<simdvec, 0, NSIMD>::setBody(Bi, i);
-		simdvec yi = SIMD<simdvec, 1, NSIMD>::setBody(Bi, i);
-		simdvec zi = SIMD<simdvec, 2, NSIMD>::setBody(Bi, i);
-		simdvec mi_r = SIMD<simdvec, 4, NSIMD>::setBody(Bi, i);
-		simdvec mi_i = SIMD<simdvec, 5, NSIMD>::setBody(Bi, i);
-
-		simdvec dx = Xperiodic[0];
-		xi -= dx;
-		simdvec dy = Xperiodic[1];
-		yi -= dy;
-		simdvec dz = Xperiodic[2];
-		zi -= dz;
-
-		for (int j = 0; j < nj; j++) {
-			dx = Bj[j].X[0];
-			dx -= xi;
-			dy = Bj[j].X[1];
-			dy -= yi;
-			dz = Bj[j].X[2];
-			dz -= zi;
+//! P2P_TILE_I target vectors against P2P_TILE_J sources {x,y,z,q_r,q_i}, with every pair in registers
+//! Target terms go to trgi {pot,ax,ay,az as real,imag}; if mutual, source terms are summed over the tile into trgj
+//! If self, the target lane whose index equals the source index is skipped
+template<bool self, bool mutual>
+inline __attribute__((always_inline)) void P2PTile(const simdvec * xi, const simdvec * yi, const simdvec * zi,
+						   const simdvec * mi_r, const simdvec * mi_i, const simdvec * index, int j,
+						   const real_t (* Sj)[5], const simdvec & wave_r, const simdvec & wave_i,
+						   ksimdvec (* trgi)[8], real_t (* trgj)[8]) {
+	simdvec zero = 0.0;
+	simdvec one = 1.0;
+	simdvec tj[mutual ? P2P_TILE_J : 1][8];
+	for (int jj = 0; jj < P2P_TILE_J; jj++) {
+		if (mutual) {
+			for (int l = 0; l < 8; l++) tj[jj][l] = zero;
+		}
+		for (int ii = 0; ii < P2P_TILE_I; ii++) {
+			simdvec dx = Sj[jj][0];
+			dx -= xi[ii];
+			simdvec dy = Sj[jj][1];
+			dy -= yi[ii];
+			simdvec dz = Sj[jj][2];
+			dz -= zi[ii];
 
 			simdvec R2 = eps2;
 			R2 += dx * dx;
-			simdvec mj_r = std::real(Bj[j].SRC);
+			simdvec mj_r = Sj[jj][3];
 			R2 += dy * dy;
-			simdvec mj_i = std::imag(Bj[j].SRC);
+			simdvec mj_i = Sj[jj][4];
 			R2 += dz * dz;
 			simdvec invR = rsqrt(R2);
 			simdvec R = one / invR;
+			if (self) {
+				simdvec below = invR;
+				below &= index[ii] < simdvec(real_t(j + jj));
+				invR &= index[ii] > simdvec(real_t(j + jj));
+				invR += below;
+				below = R;
+				below &= index[ii] < simdvec(real_t(j + jj));
+				R &= index[ii] > simdvec(real_t(j + jj));
+				R += below;
+			}
 			invR &= R2 > zero;
 			R &= R2 > zero;
 
-			simdvec tmp = mi_r * mj_r - mi_i * mj_i;
-			mj_i = mi_r * mj_i + mi_i * mj_r;
+			simdvec tmp = mi_r[ii] * mj_r - mi_i[ii] * mj_i;
+			mj_i = mi_r[ii] * mj_i + mi_i[ii] * mj_r;
 			mj_r = tmp;
-			tmp = invR / exp(wave_ivec * R);
-			simdvec coef_r = cos(wave_rvec * R) * tmp;
-			simdvec coef_i = sin(wave_rvec * R) * tmp;
+			tmp = invR / exp(wave_i * R);
+			simdvec coef_r = cos(wave_r * R) * tmp;
+			simdvec coef_i = sin(wave_r * R) * tmp;
 			tmp = mj_r * coef_r - mj_i * coef_i;
 			coef_i = mj_r * coef_i + mj_i * coef_r;
 			coef_r = tmp;
-			mj_r = (one + wave_ivec * R) * invR * invR;
-			mj_i = - wave_rvec * invR;
-			pot_r += coef_r;
-			pot_i += coef_i;
-			if (mutual) Bj[j].TRG[0] += kcomplex_t(sum(coef_r), sum(coef_i));
+			mj_r = (one + wave_i * R) * invR * invR;
+			mj_i = - wave_r * invR;
+			trgi[ii][0] += coef_r;
+			trgi[ii][1] += coef_i;
+			if (mutual) {
+				tj[jj][0] += coef_r;
+				tj[jj][1] += coef_i;
+			}
 			tmp = mj_r * coef_r - mj_i * coef_i;
 			coef_i = mj_r * coef_i + mj_i * coef_r;
 			coef_r = tmp;
-			ax_r += coef_r * dx;
-			ax_i += coef_i * dx;
-			if (mutual) Bj[j].TRG[1] += kcomplex_t(sum(coef_r * dx), sum(coef_i * dx));
-			ay_r += coef_r * dy;
-			ay_i += coef_i * dy;
-			if (mutual) Bj[j].TRG[2] += kcomplex_t(sum(coef_r * dy), sum(coef_i * dy));
-			az_r += coef_r * dz;
-			az_i += coef_i * dz;
-			if (mutual) Bj[j].TRG[3] += kcomplex_t(sum(coef_r * dz), sum(coef_i * dz));
+			trgi[ii][2] += coef_r * dx;
+			trgi[ii][3] += coef_i * dx;
+			trgi[ii][4] += coef_r * dy;
+			trgi[ii][5] += coef_i * dy;
+			trgi[ii][6] += coef_r * dz;
+			trgi[ii][7] += coef_i * dz;
+			if (mutual) {
+				tj[jj][2] += coef_r * dx;
+				tj[jj][3] += coef_i * dx;
+				tj[jj][4] += coef_r * dy;
+				tj[jj][5] += coef_i * dy;
+				tj[jj][6] += coef_r * dz;
+				tj[jj][7] += coef_i * dz;
+			}
 		}
-		for (int k = 0; k < NSIMD; k++) {
-			Bi[i + k].TRG[0] += transpose(pot_r, pot_i, k);
-			Bi[i + k].TRG[1] -= transpose(ax_r, ax_i, k);
-			Bi[i + k].TRG[2] -= transpose(ay_r, ay_i, k);
-			Bi[i + k].TRG[3] -= transpose(az_r, az_i, k);
+	}
+	if (mutual) {
+		for (int jj = 0; jj < P2P_TILE_J; jj++) {
+			for (int l = 0; l < 8; l++) trgj[jj][l] = sum(tj[jj][l]);
 		}
 	}
+}
 #endif
+
+template <typename J_iter>
+void P2P(C_iter Ci, J_iter Cj, bool mutual) {
+	real_t wave_r = std::real(wavek);
+	real_t wave_i = std::imag(wavek);
+	B_iter Bi = Ci->BODY;
+	B_iter Bj = Cj->BODY;
+	int ni = Ci->NBODY;
+	int nj = Cj->NBODY;
+	int i = 0;
+#if EXAFMM_USE_SIMD
+	simdvec zero = 0.0;
+	simdvec wave_rvec = wave_r;
+	simdvec wave_ivec = wave_i;
+	for (i = 0; i < ni; i += P2P_TILE_I * NSIMD) {
+		simdvec xi[P2P_TILE_I], yi[P2P_TILE_I], zi[P2P_TILE_I], mi_r[P2P_TILE_I], mi_i[P2P_TILE_I], index[P2P_TILE_I];
+		ksimdvec trgi[P2P_TILE_I][8];
+		for (int ii = 0; ii < P2P_TILE_I; ii++) {
+			int nv = std::max(0, std::min(NSIMD, ni - i - ii * NSIMD));
+			xi[ii] = SIMDPartial<simdvec, 0, NSIMD>::setBody(Bi, i + ii * NSIMD, nv) - Xperiodic[0];
+			yi[ii] = SIMDPartial<simdvec, 1, NSIMD>::setBody(Bi, i + ii * NSIMD, nv) - Xperiodic[1];
+			zi[ii] = SIMDPartial<simdvec, 2, NSIMD>::setBody(Bi, i + ii * NSIMD, nv) - Xperiodic[2];
+			mi_r[ii] = SIMDPartial<simdvec, 4, NSIMD>::setBody(Bi, i + ii * NSIMD, nv);
+			mi_i[ii] = SIMDPartial<simdvec, 5, NSIMD>::setBody(Bi, i + ii * NSIMD, nv);
+			index[ii] = zero;
+			for (int l = 0; l < 8; l++) trgi[ii][l] = zero;
+		}
+		for (int j = 0; j < nj; j += P2P_TILE_J) {
+			int mj = std::min(P2P_TILE_J, nj - j);
+			real_t Sj[P2P_TILE_J][5] = {}, trgj[P2P_TILE_J][8];
+			for (int jj = 0; jj < mj; jj++) {
+				Sj[jj][0] = Bj[j + jj].X[0];
+				Sj[jj][1] = Bj[j + jj].X[1];
+				Sj[jj][2] = Bj[j + jj].X[2];
+				Sj[jj][3] = std::real(Bj[j + jj].SRC);
+				Sj[jj][4] = std::imag(Bj[j + jj].SRC);
+			}
+			if (mutual) {
+				P2PTile<false, true>(xi, yi, zi, mi_r, mi_i, index, j, Sj, wave_rvec, wave_ivec, trgi, trgj);
+				for (int jj = 0; jj < mj; jj++) {
+					Bj[j + jj].TRG[0] += complex_t(trgj[jj][0], trgj[jj][1]);
+					Bj[j + jj].TRG[1] += complex_t(trgj[jj][2], trgj[jj][3]);
+					Bj[j + jj].TRG[2] += complex_t(trgj[jj][4], trgj[jj][5]);
+					Bj[j + jj].TRG[3] += complex_t(trgj[jj][6], trgj[jj][7]);
+				}
+			} else {
+				P2PTile<false, false>(xi, yi, zi, mi_r, mi_i, index, j, Sj, wave_rvec, wave_ivec, trgi, NULL);
+			}
+		}
+		for (int ii = 0; ii < P2P_TILE_I; ii++) {
+			int nv = std::max(0, std::min(NSIMD, ni - i - ii * NSIMD));
+			for (int k = 0; k < nv; k++) {
+				Bi[i + ii * NSIMD + k].TRG[0] += transpose(trgi[ii][0], trgi[ii][1], k);
+				Bi[i + ii * NSIMD + k].TRG[1] -= transpose(trgi[ii][2], trgi[ii][3], k);
+				Bi[i + ii * NSIMD + k].TRG[2] -= transpose(trgi[ii][4], trgi[ii][5], k);
+				Bi[i + ii * NSIMD + k].TRG[3] -= transpose(trgi[ii][6], trgi[ii][7], k);
+			}
+		}
+	}
+#else
 	for ( ; i < ni; i++) {
 		real_t pot_r = 0.0;
 		real_t pot_i = 0.0;
@@ -149,6 +206,7 @@ void P2P(C_iter Ci, J_iter Cj, bool mutual) {
 		Bi[i].TRG[2] += complex_t(ay_r, ay_i);
 		Bi[i].TRG[3] += complex_t(az_r, az_i);
 	}
+#endif
 }
 
 void P2P(C_iter C) {
@@ -158,82 +216,56 @@ void P2P(C_iter C) {
 	int n = C->NBODY;
 	int i = 0;
 #if EXAFMM_USE_SIMD
+	simdvec zero = 0.0;
 	simdvec wave_rvec = wave_r;
 	simdvec wave_ivec = wave_i;
-	for ( ; i <= n - NSIMD; i += NSIMD) {
-		simdvec zero = 0.0;
-		simdvec one = 1.0;
-		ksimdvec pot_r = zero;
-		ksimdvec pot_i = zero;
-		ksimdvec ax_r = zero;
-		ksimdvec ax_i = zero;
-		ksimdvec ay_r = zero;
-		ksimdvec ay_i = zero;
-		ksimdvec az_r = zero;
-		ksimdvec az_i = zero;
-
-		simdvec index = SIMD<simdvec, 0, NSIMD>::setIndex(i);
-		simdvec xi = SIMD<simdvec, 0, NSIMD>::setBody(B, i);
-		simdvec yi = SIMD<simdvec, 1, NSIMD>::setBody(B, i);
-		simdvec zi = SIMD<simdvec, 2, NSIMD>::setBody(B, i);
-		simdvec mi_r = SIMD<simdvec, 4, NSIMD>::setBody(B, i);
-		simdvec mi_i = SIMD<simdvec, 5, NSIMD>::setBody(B, i);
-		for (int j = i + 1; j < n; j++) {
-			simdvec dx = B[j].X[0];
-			dx -= xi;
-			simdvec dy = B[j].X[1];
-			dy -= yi;
-			simdvec dz = B[j].X[2];
-			dz -= zi;
-
-			simdvec R2 = eps2;
-			R2 += dx * dx;
-			simdvec mj_r = std::real(B[j].SRC);
-			R2 += dy * dy;
-			simdvec mj_i = std::imag(B[j].SRC);
-			R2 += dz * dz;
-			simdvec invR = rsqrt(R2);
-			simdvec R = one / invR;
-			invR &= index < j;
-			invR &= R2 > zero;
-			R &= index < j;
-			R &= R2 > zero;
-
-			simdvec tmp = mi_r * mj_r - mi_i * mj_i;
-			mj_i = mi_r * mj_i + mi_i * mj_r;
-			mj_r = tmp;
-			tmp = invR / exp(wave_ivec * R);
-			simdvec coef_r = cos(wave_rvec * R) * tmp;
-			simdvec coef_i = sin(wave_rvec * R) * tmp;
-			tmp = mj_r * coef_r - mj_i * coef_i;
-			coef_i = mj_r * coef_i + mj_i * coef_r;
-			coef_r = tmp;
-			mj_r = (one + wave_ivec * R) * invR * invR;
-			mj_i = - wave_rvec * invR;
-			pot_r += coef_r;
-			pot_i += coef_i;
-			B[j].TRG[0] += kcomplex_t(sum(coef_r), sum(coef_i));
-			tmp = mj_r * coef_r - mj_i * coef_i;
-			coef_i = mj_r * coef_i + mj_i * coef_r;
-			coef_r = tmp;
-			ax_r += coef_r * dx;
-			ax_i += coef_i * dx;
-			B[j].TRG[1] += kcomplex_t(sum(coef_r * dx), sum(coef_i * dx));
-			ay_r += coef_r * dy;
-			ay_i += coef_i * dy;
-			B[j].TRG[2] += kcomplex_t(sum(coef_r * dy), sum(coef_i * dy));
-			az_r += coef_r * dz;
-			az_i += coef_i * dz;
-			B[j].TRG[3] += kcomplex_t(sum(coef_r * dz), sum(coef_i * dz));
+	for (i = 0; i < n; i += P2P_TILE_I * NSIMD) {
+		simdvec xi[P2P_TILE_I], yi[P2P_TILE_I], zi[P2P_TILE_I], mi_r[P2P_TILE_I], mi_i[P2P_TILE_I], index[P2P_TILE_I];
+		ksimdvec trgi[P2P_TILE_I][8];
+		for (int ii = 0; ii < P2P_TILE_I; ii++) {
+			int nv = std::max(0, std::min(NSIMD, n - i - ii * NSIMD));
+			index[ii] = SIMD<simdvec, 0, NSIMD>::setIndex(i + ii * NSIMD);
+			xi[ii] = SIMDPartial<simdvec, 0, NSIMD>::setBody(B, i + ii * NSIMD, nv);
+			yi[ii] = SIMDPartial<simdvec, 1, NSIMD>::setBody(B, i + ii * NSIMD, nv);
+			zi[ii] = SIMDPartial<simdvec, 2, NSIMD>::setBody(B, i + ii * NSIMD, nv);
+			mi_r[ii] = SIMDPartial<simdvec, 4, NSIMD>::setBody(B, i + ii * NSIMD, nv);
+			mi_i[ii] = SIMDPartial<simdvec, 5, NSIMD>::setBody(B, i + ii * NSIMD, nv);
+			for (int l = 0; l < 8; l++) trgi[ii][l] = zero;
+		}
+		int jd = std::min(i + P2P_TILE_I * NSIMD, n);
+		for (int j = i, mj; j < n; j += mj) {
+			mj = std::min(P2P_TILE_J, (j < jd ? jd : n) - j);
+			real_t Sj[P2P_TILE_J][5] = {}, trgj[P2P_TILE_J][8];
+			for (int jj = 0; jj < mj; jj++) {
+				Sj[jj][0] = B[j + jj].X[0];
+				Sj[jj][1] = B[j + jj].X[1];
+				Sj[jj][2] = B[j + jj].X[2];
+				Sj[jj][3] = std::real(B[j + jj].SRC);
+				Sj[jj][4] = std::imag(B[j + jj].SRC);
+			}
+			if (j < jd) {
+				P2PTile<true, false>(xi, yi, zi, mi_r, mi_i, index, j, Sj, wave_rvec, wave_ivec, trgi, NULL);
+			} else {
+				P2PTile<false, true>(xi, yi, zi, mi_r, mi_i, index, j, Sj, wave_rvec, wave_ivec, trgi, trgj);
+				for (int jj = 0; jj < mj; jj++) {
+					B[j + jj].TRG[0] += complex_t(trgj[jj][0], trgj[jj][1]);
+					B[j + jj].TRG[1] += complex_t(trgj[jj][2], trgj[jj][3]);
+					B[j + jj].TRG[2] += complex_t(trgj[jj][4], trgj[jj][5]);
+					B[j + jj].TRG[3] += complex_t(trgj[jj][6], trgj[jj][7]);
+				}
+			}
 		}
-		for (int k = 0; k < NSIMD; k++) {
-			B[i + k].TRG[0] += transpose(pot_r, pot_i, k);
-			B[i + k].TRG[1] -= transpose(ax_r, ax_i, k);
-			B[i + k].TRG[2] -= transpose(ay_r, ay_i, k);
-			B[i + k].TRG[3] -= transpose(az_r, az_i, k);
+		for (int ii = 0; ii < P2P_TILE_I; ii++) {
+			int nv = std::max(0, std::min(NSIMD, n - i - ii * NSIMD));
+			for (int k = 0; k < nv; k++) {
+				B[i + ii * NSIMD + k].TRG[0] += transpose(trgi[ii][0], trgi[ii][1], k);
+				B[i + ii * NSIMD + k].TRG[1] -= transpose(trgi[ii][2], trgi[ii][3], k);
+				B[i + ii * NSIMD + k].TRG[2] -= transpose(trgi[ii][4], trgi[ii][5], k);
+				B[i + ii * NSIMD + k].TRG[3] -= transpose(trgi[ii][6], trgi[ii][7], k);
+			}
 		}
 	}
-#endif
+#else
 	for ( ; i < n; i++) {
 		kreal_t pot_r = 0;
 		kreal_t pot_i = 0;
@@ -280,6 +312,7 @@ void P2P(C_iter C) {
 		B[i].TRG[2] -= complex_t(ay_r, ay_i);
 		B[i].TRG[3] -= complex_t(az_r, az_i);
 	}
+#endif
 }
 }
 }
@@ -339,7 +339,10 @@ namespace exafmm {
 			}
 		}
 
+		int order = P;
+
 		void setup() {
+			checkOrder(P, P);
 			nquad = fmax(6, P);
 			legendre(nquad, xquad, wquad);
 			nquad2 = fmax(6, 2*P);
@@ -347,7 +350,7 @@ namespace exafmm {
 			getAnm();
 		}
 
-		void P2M(C_iter C) {
+		void P2M(C_iter C, vecP & M) {
 			real_t Ynm[P*(P+1)/2];
 			complex_t ephi[P], jn[P+1], jnd[P+1];
 			vecP Mnm = complex_t(0,0);
@@ -381,10 +384,10 @@ namespace exafmm {
 					}
 				}
 			}
-			C->M += Mnm * I * wavek;
+			M += Mnm * I * wavek;
 		}
 
-		void M2M(C_iter Ci, C_iter C0) {
+		void M2M(C_iter Ci, C_iter C0, vecP * M0) {
 			real_t Ynm[P*(P+1)/2];
 			complex_t phitemp[2*P], hn[P], ephi[2*P];
 			vecP Mnm = complex_t(0,0);
@@ -406,7 +409,7 @@ namespace exafmm {
 				for (int n=0; n<P; n++) {
 					for (int m=-n; m<=n; m++) {
 						int nm = n * n + n + m;
-						Mnm[nm] = Cj->M[nm] * ephi[P+m];
+						Mnm[nm] = M0[Cj-C0][nm] * ephi[P+m];
 					}
 				}
 				rotate(theta, P, Mnm, Mrot);
@@ -460,13 +463,13 @@ namespace exafmm {
 						Mnm[nm] = ephi[P-m] * Mrot[nm];
 					}
 				}
-				Ci->M += Mnm;
+				M0[Ci-C0] += Mnm;
 			}
 		}
 
 		template <typename J_iter>
-		void M2L(C_iter Ci, J_iter Cj, bool mutual) {
-			assert(mutual == false);
+		void M2L(C_iter Ci, J_iter Cj, const vecP &, vecP & Li, const vecP & Mj, vecP * Lj) {
+			assert(Lj == NULL);
 			real_t Ynm[P*(P+1)/2], Ynmd[P*(P+1)/2];
 			complex_t phitemp[2*P], phitempn[2*P];
 			complex_t hn[P], hnd[P], jn[P+1], jnd[P+1], ephi[2*P];
@@ -500,7 +503,7 @@ namespace exafmm {
 			for (int n=0; n<Popt; n++) {
 				for (int m=-n; m<=n; m++) {
 					int nm = n * n + n + m;
-					Mnm[nm] = Cj->M[nm] * ephi[P+m];
+					Mnm[nm] = Mj[nm] * ephi[P+m];
 				}
 			}
 			rotate(theta, Popt, Mnm, Mrot);
@@ -586,12 +589,17 @@ namespace exafmm {
 					Lnm[nm] = ephi[P-m] * Lrot[nm];
 				}
 			}
-			Ci->L += Lnm;
+			Li += Lnm;
+		}
+		template void M2L<C_iter>(C_iter Ci, C_iter Cj, const vecP & Mi, vecP & Li, const vecP & Mj, vecP * Lj);
+		template void M2L<M_iter>(C_iter Ci, M_iter Cj, const vecP & Mi, vecP & Li, const vecP & Mj, vecP * Lj);
+
+		//! M2L from a list of source cells to Ci
+		void M2LBatch(C_iter Ci, const C_iter * Cj, int numCj, C_iter Cj0, const vecP & Mi, vecP & Li, const vecP * Mj) {
+			for (int j=0; j<numCj; j++) M2L(Ci, Cj[j], Mi, Li, Mj[Cj[j]-Cj0], NULL);
 		}
-		template void M2L<C_iter>(C_iter Ci,C_iter Cj, bool mutual);
-		template void M2L<M_iter>(C_iter Ci,M_iter Cj, bool mutual);
 
-		void L2L(C_iter Ci, C_iter C0) {
+		void L2L(C_iter Ci, C_iter C0, const vecP *, vecP * L0) {
 			real_t Ynm[P*(P+1)/2], Ynmd[P*(P+1)/2];
 			complex_t phitemp[2*P], phitempn[2*P];
 			complex_t jn[P+1], jnd[P+1], ephi[2*P];
@@ -613,7 +621,7 @@ namespace exafmm {
 			for (int n=0; n<P; n++) {
 				for (int m=-n; m<=n; m++) {
 					int nm = n * n + n + m;
-					Lnm[nm] = Cj->L[nm] * ephi[P+m];
+					Lnm[nm] = L0[Ci->IPARENT][nm] * ephi[P+m];
 				}
 			}
 			rotate(theta, P, Lnm, Lrot);
@@ -706,16 +714,16 @@ namespace exafmm {
 					Lnm[nm] = ephi[P-m] * Lrot[nm];
 				}
 			}
-			Ci->L += Lnm;
+			L0[Ci-C0] += Lnm;
 		}
 
-		void L2P(C_iter C) {
+		void L2P(C_iter C, const vecP & L) {
 			real_t Ynm[P*(P+1)/2], Ynmd[P*(P+1)/2];
 			complex_t ephi[P], jn[P+1], jnd[P+1];
 			real_t kscale = C->SCALE * abs(wavek);
 			for (B_iter B=C->BODY; B!=C->BODY+C->NBODY; B++) {
 				B->TRG /= B->SRC;
-				vecP Lj = C->L;
+				vecP Lj = L;
 				kcvec4 TRG = kcomplex_t(0,0);
 				vec3 dX = B->X - C->X;
 				real_t r, theta, phi;
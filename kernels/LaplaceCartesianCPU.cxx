@@ -137,33 +137,37 @@ namespace exafmm {
     };
 
 
-    template<int nx, int ny, int nz, int kx=0, int ky=0, int kz=P-1-nx-ny-nz>
+    template<int nx, int ny, int nz, int PP, int kx=0, int ky=0, int kz=PP-1-nx-ny-nz>
       struct LocalSum {
-	static inline real_t kernel(const vecP &M, const vecP &L) {
-	  return LocalSum<nx,ny,nz,kx,ky+1,kz-1>::kernel(M,L)
+	template<typename T>
+	static inline T kernel(const vec<NTERM,T> &M, const vec<NTERM,T> &L) {
+	  return LocalSum<nx,ny,nz,PP,kx,ky+1,kz-1>::kernel(M,L)
 	    + M[Index<kx,ky,kz>::I] * L[Index<nx+kx,ny+ky,nz+kz>::I];
 	}
       };
 
-    template<int nx, int ny, int nz, int kx, int ky>
-    struct LocalSum<nx,ny,nz,kx,ky,0> {
-      static inline real_t kernel(const vecP &M, const vecP &L) {
-	return LocalSum<nx,ny,nz,kx+1,0,ky-1>::kernel(M, L)
+    template<int nx, int ny, int nz, int PP, int kx, int ky>
+    struct LocalSum<nx,ny,nz,PP,kx,ky,0> {
+      template<typename T>
+	static inline T kernel(const vec<NTERM,T> &M, const vec<NTERM,T> &L) {
+	return LocalSum<nx,ny,nz,PP,kx+1,0,ky-1>::kernel(M, L)
 	  + M[Index<kx,ky,0>::I] * L[Index<nx+kx,ny+ky,nz>::I];
       }
     };
 
-    template<int nx, int ny, int nz, int kx>
-    struct LocalSum<nx,ny,nz,kx,0,0> {
-      static inline real_t kernel(const vecP &M, const vecP &L) {
-	return LocalSum<nx,ny,nz,0,0,kx-1>::kernel(M, L)
+    template<int nx, int ny, int nz, int PP, int kx>
+    struct LocalSum<nx,ny,nz,PP,kx,0,0> {
+      template<typename T>
+	static inline T kernel(const vec<NTERM,T> &M, const vec<NTERM,T> &L) {
+	return LocalSum<nx,ny,nz,PP,0,0,kx-1>::kernel(M, L)
 	  + M[Index<kx,0,0>::I] * L[Index<nx+kx,ny,nz>::I];
       }
     };
 
-    template<int nx, int ny, int nz>
-    struct LocalSum<nx,ny,nz,0,0,0> {
-      static inline real_t kernel(const vecP&, const vecP&) { return 0; }
+    template<int nx, int ny, int nz, int PP>
+    struct LocalSum<nx,ny,nz,PP,0,0,0> {
+      template<typename T>
+      static inline T kernel(const vec<NTERM,T>&, const vec<NTERM,T>&) { return T(0); }
     };
 
 
@@ -186,17 +190,20 @@ namespace exafmm {
 	Kernels<nx,ny+1,nz-1>::M2M(MI, C, MJ);
 	MI[Index<nx,ny,nz>::I] += MultipoleSum<nx,ny,nz>::kernel(C, MJ);
       }
-      static inline void M2L(vecP &L, const vecP &C, const vecP &M) {
-	Kernels<nx,ny+1,nz-1>::M2L(L, C, M);
-	L[Index<nx,ny,nz>::I] += LocalSum<nx,ny,nz>::kernel(M, C);
+      template<int PP, typename T>
+      static inline void M2L(vec<NTERM,T> &L, const vec<NTERM,T> &C, const vec<NTERM,T> &M) {
+	Kernels<nx,ny+1,nz-1>::template M2L<PP>(L, C, M);
+	L[Index<nx,ny,nz>::I] += LocalSum<nx,ny,nz,PP>::kernel(M, C);
       }
+      template<int PP>
       static inline void L2L(vecP &LI, const vecP &C, const vecP &LJ) {
-	Kernels<nx,ny+1,nz-1>::L2L(LI, C, LJ);
-	LI[Index<nx,ny,nz>::I] += LocalSum<nx,ny,nz>::kernel(C, LJ);
+	Kernels<nx,ny+1,nz-1>::template L2L<PP>(LI, C, LJ);
+	LI[Index<nx,ny,nz>::I] += LocalSum<nx,ny,nz,PP>::kernel(C, LJ);
       }
+      template<int PP>
       static inline void L2P(B_iter B, const vecP &C, const vecP &L) {
-	Kernels<nx,ny+1,nz-1>::L2P(B, C, L);
-	B->TRG[Index<nx,ny,nz>::I] += LocalSum<nx,ny,nz>::kernel(C, L);
+	Kernels<nx,ny+1,nz-1>::template L2P<PP>(B, C, L);
+	B->TRG[Index<nx,ny,nz>::I] += LocalSum<nx,ny,nz,PP>::kernel(C, L);
       }
     };
 
@@ -219,17 +226,20 @@ namespace exafmm {
 	Kernels<nx+1,0,ny-1>::M2M(MI, C, MJ);
 	MI[Index<nx,ny,0>::I] += MultipoleSum<nx,ny,0>::kernel(C, MJ);
       }
-      static inline void M2L(vecP &L, const vecP &C, const vecP &M) {
-	Kernels<nx+1,0,ny-1>::M2L(L, C, M);
-	L[Index<nx,ny,0>::I] += LocalSum<nx,ny,0>::kernel(M, C);
+      template<int PP, typename T>
+      static inline void M2L(vec<NTERM,T> &L, const vec<NTERM,T> &C, const vec<NTERM,T> &M) {
+	Kernels<nx+1,0,ny-1>::template M2L<PP>(L, C, M);
+	L[Index<nx,ny,0>::I] += LocalSum<nx,ny,0,PP>::kernel(M, C);
       }
+      template<int PP>
       static inline void L2L(vecP &LI, const vecP &C, const vecP &LJ) {
-	Kernels<nx+1,0,ny-1>::L2L(LI, C, LJ);
-	LI[Index<nx,ny,0>::I] += LocalSum<nx,ny,0>::kernel(C, LJ);
+	Kernels<nx+1,0,ny-1>::template L2L<PP>(LI, C, LJ);
+	LI[Index<nx,ny,0>::I] += LocalSum<nx,ny,0,PP>::kernel(C, LJ);
       }
+      template<int PP>
       static inline void L2P(B_iter B, const vecP &C, const vecP &L) {
-	Kernels<nx+1,0,ny-1>::L2P(B, C, L);
-	B->TRG[Index<nx,ny,0>::I] += LocalSum<nx,ny,0>::kernel(C, L);
+	Kernels<nx+1,0,ny-1>::template L2P<PP>(B, C, L);
+	B->TRG[Index<nx,ny,0>::I] += LocalSum<nx,ny,0,PP>::kernel(C, L);
       }
     };
 
@@ -252,17 +262,20 @@ namespace exafmm {
 	Kernels<0,0,nx-1>::M2M(MI, C, MJ);
 	MI[Index<nx,0,0>::I] += MultipoleSum<nx,0,0>::kernel(C, MJ);
       }
-      static inline void M2L(vecP &L, const vecP &C, const vecP &M) {
-	Kernels<0,0,nx-1>::M2L(L, C, M);
-	L[Index<nx,0,0>::I] += LocalSum<nx,0,0>::kernel(M, C);
+      template<int PP, typename T>
+      static inline void M2L(vec<NTERM,T> &L, const vec<NTERM,T> &C, const vec<NTERM,T> &M) {
+	Kernels<0,0,nx-1>::template M2L<PP>(L, C, M);
+	L[Index<nx,0,0>::I] += LocalSum<nx,0,0,PP>::kernel(M, C);
       }
+      template<int PP>
       static inline void L2L(vecP &LI, const vecP &C, const vecP &LJ) {
-	Kernels<0,0,nx-1>::L2L(LI, C, LJ);
-	LI[Index<nx,0,0>::I] += LocalSum<nx,0,0>::kernel(C, LJ);
+	Kernels<0,0,nx-1>::template L2L<PP>(LI, C, LJ);
+	LI[Index<nx,0,0>::I] += LocalSum<nx,0,0,PP>::kernel(C, LJ);
       }
+      template<int PP>
       static inline void L2P(B_iter B, const vecP &C, const vecP &L) {
-	Kernels<0,0,nx-1>::L2P(B, C, L);
-	B->TRG[Index<nx,0,0>::I] += LocalSum<nx,0,0>::kernel(C, L);
+	Kernels<0,0,nx-1>::template L2P<PP>(B, C, L);
+	B->TRG[Index<nx,0,0>::I] += LocalSum<nx,0,0,PP>::kernel(C, L);
       }
     };
 
@@ -272,197 +285,240 @@ namespace exafmm {
       static inline void derivative(vecP&, const vec3&, const real_t&) {}
       static inline void scale(vecP&) {}
       static inline void M2M(vecP&, const vecP&, const vecP&) {}
-      static inline void M2L(vecP&, const vecP&, const vecP&) {}
+      template<int PP, typename T>
+      static inline void M2L(vec<NTERM,T>&, const vec<NTERM,T>&, const vec<NTERM,T>&) {}
+      template<int PP>
       static inline void L2L(vecP&, const vecP&, const vecP&) {}
+      template<int PP>
       static inline void L2P(B_iter, const vecP&, const vecP&) {}
     };
 
 
-    template<int PP>
-    inline void getCoef(vecP &C, const vec3 &dX, real_t &invR2, const real_t &invR) {
-      C[0] = invR;
-      Kernels<0,0,PP>::derivative(C, dX, invR2);
-      Kernels<0,0,PP>::scale(C);
+    //! Integer factor times a lane vector, so the closed form coefficients below also accept msimdvec
+    inline msimdvec operator*(int a, const msimdvec & v) {
+      return msimdvec(mreal_t(a)) * v;
     }
 
+    //! Derivatives of 1/R up to order PP; closed forms for PP<=6 take scalars or SIMD lanes alike
+    template<int PP>
+    struct Coef {
+      static inline void get(vecP &C, const vec3 &dX, real_t &invR2, const real_t &invR) {
+	C[0] = invR;
+	Kernels<0,0,PP>::derivative(C, dX, invR2);
+	Kernels<0,0,PP>::scale(C);
+      }
+
+      //! Lane by lane fallback for orders without a closed form
+      static inline void get(vec<NTERM,msimdvec> &C, const vec<3,msimdvec> &dX, msimdvec &invR2, const msimdvec &invR) {
+	const int nterm = (PP+1)*(PP+2)*(PP+3)/6;
+	for (int k=0; k<NSIMDM; k++) {                          // Loop over lanes
+	  vecP Ck;
+	  vec3 dXk;
+	  for (int d=0; d<3; d++) dXk[d] = dX[d][k];
+	  real_t invR2k = invR2[k], invRk = invR[k];
+	  get(Ck, dXk, invR2k, invRk);
+	  for (int i=0; i<nterm; i++) C[i][k] = Ck[i];
+	  invR2[k] = invR2k;
+	}                                                       // End loop over lanes
+      }
+    };
+
     template<>
-    inline void getCoef<1>(vecP &C, const vec3 &dX, real_t &invR2, const real_t &invR) {
-      C[0] = invR;
-      invR2 = -invR2;
-      real_t x = dX[0], y = dX[1], z = dX[2];
-      real_t invR3 = invR * invR2;
-      C[1] = x * invR3;
-      C[2] = y * invR3;
-      C[3] = z * invR3;
-    }
+    struct Coef<1> {
+      template<typename TC, typename T>
+      static inline void get(vec<NTERM,TC> &C, const vec<3,T> &dX, T &invR2, const T &invR) {
+	C[0] = invR;
+	invR2 = -invR2;
+	T x = dX[0], y = dX[1], z = dX[2];
+	T invR3 = invR * invR2;
+	C[1] = x * invR3;
+	C[2] = y * invR3;
+	C[3] = z * invR3;
+      }
+    };
 
     template<>
-    inline void getCoef<2>(vecP &C, const vec3 &dX, real_t &invR2, const real_t &invR) {
-      getCoef<1>(C, dX, invR2, invR);
-      real_t x = dX[0], y = dX[1], z = dX[2];
-      real_t invR3 = invR * invR2;
-      real_t invR5 = 3 * invR3 * invR2;
-      real_t t = x * invR5;
-      C[4] = x * t + invR3;
-      C[5] = y * t;
-      C[6] = z * t;
-      t = y * invR5;
-      C[7] = y * t + invR3;
-      C[8] = z * t;
-      C[9] = z * z * invR5 + invR3;
-    }
+    struct Coef<2> {
+      template<typename TC, typename T>
+      static inline void get(vec<NTERM,TC> &C, const vec<3,T> &dX, T &invR2, const T &invR) {
+	Coef<1>::get(C, dX, invR2, invR);
+	T x = dX[0], y = dX[1], z = dX[2];
+	T invR3 = invR * invR2;
+	T invR5 = 3 * invR3 * invR2;
+	T t = x * invR5;
+	C[4] = x * t + invR3;
+	C[5] = y * t;
+	C[6] = z * t;
+	t = y * invR5;
+	C[7] = y * t + invR3;
+	C[8] = z * t;
+	C[9] = z * z * invR5 + invR3;
+      }
+    };
     template<>
-    inline void getCoef<3>(vecP &C, const vec3 &dX, real_t &invR2, const real_t &invR) {
-      getCoef<2>(C, dX, invR2, invR);
-      real_t x = dX[0], y = dX[1], z = dX[2];
-      real_t invR3 = invR * invR2;
-      real_t invR5 = 3 * invR3 * invR2;
-      real_t invR7 = 5 * invR5 * invR2;
-      real_t t = x * x * invR7;
-      C[10] = x * (t + 3 * invR5);
-      C[11] = y * (t +     invR5);
-      C[12] = z * (t +     invR5);
-      t = y * y * invR7;
-      C[13] = x * (t +     invR5);
-      C[16] = y * (t + 3 * invR5);
-      C[17] = z * (t +     invR5);
-      t = z * z * invR7;
-      C[15] = x * (t +     invR5);
-      C[18] = y * (t +     invR5);
-      C[19] = z * (t + 3 * invR5);
-      C[14] = x * y * z * invR7;
-    }
+    struct Coef<3> {
+      template<typename TC, typename T>
+      static inline void get(vec<NTERM,TC> &C, const vec<3,T> &dX, T &invR2, const T &invR) {
+	Coef<2>::get(C, dX, invR2, invR);
+	T x = dX[0], y = dX[1], z = dX[2];
+	T invR3 = invR * invR2;
+	T invR5 = 3 * invR3 * invR2;
+	T invR7 = 5 * invR5 * invR2;
+	T t = x * x * invR7;
+	C[10] = x * (t + 3 * invR5);
+	C[11] = y * (t +     invR5);
+	C[12] = z * (t +     invR5);
+	t = y * y * invR7;
+	C[13] = x * (t +     invR5);
+	C[16] = y * (t + 3 * invR5);
+	C[17] = z * (t +     invR5);
+	t = z * z * invR7;
+	C[15] = x * (t +     invR5);
+	C[18] = y * (t +     invR5);
+	C[19] = z * (t + 3 * invR5);
+	C[14] = x * y * z * invR7;
+      }
+    };
 
     template<>
-    inline void getCoef<4>(vecP &C, const vec3 &dX, real_t &invR2, const real_t &invR) {
-      getCoef<3>(C, dX, invR2, invR);
-      real_t x = dX[0], y = dX[1], z = dX[2];
-      real_t invR3 = invR * invR2;
-      real_t invR5 = 3 * invR3 * invR2;
-      real_t invR7 = 5 * invR5 * invR2;
-      real_t invR9 = 7 * invR7 * invR2;
-      real_t t = x * x * invR9;
-      C[20] = x * x * (t + 6 * invR7) + 3 * invR5;
-      C[21] = x * y * (t + 3 * invR7);
-      C[22] = x * z * (t + 3 * invR7);
-      C[23] = y * y * (t +     invR7) + x * x * invR7 + invR5;
-      C[24] = y * z * (t +     invR7);
-      C[25] = z * z * (t +     invR7) + x * x * invR7 + invR5;
-      t = y * y * invR9;
-      C[26] = x * y * (t + 3 * invR7);
-      C[27] = x * z * (t +     invR7);
-      C[30] = y * y * (t + 6 * invR7) + 3 * invR5;
-      C[31] = y * z * (t + 3 * invR7);
-      C[32] = z * z * (t +     invR7) + y * y * invR7 + invR5;
-      t = z * z * invR9;
-      C[28] = x * y * (t +     invR7);
-      C[29] = x * z * (t + 3 * invR7);
-      C[33] = y * z * (t + 3 * invR7);
-      C[34] = z * z * (t + 6 * invR7) + 3 * invR5;
-    }
+    struct Coef<4> {
+      template<typename TC, typename T>
+      static inline void get(vec<NTERM,TC> &C, const vec<3,T> &dX, T &invR2, const T &invR) {
+	Coef<3>::get(C, dX, invR2, invR);
+	T x = dX[0], y = dX[1], z = dX[2];
+	T invR3 = invR * invR2;
+	T invR5 = 3 * invR3 * invR2;
+	T invR7 = 5 * invR5 * invR2;
+	T invR9 = 7 * invR7 * invR2;
+	T t = x * x * invR9;
+	C[20] = x * x * (t + 6 * invR7) + 3 * invR5;
+	C[21] = x * y * (t + 3 * invR7);
+	C[22] = x * z * (t + 3 * invR7);
+	C[23] = y * y * (t +     invR7) + x * x * invR7 + invR5;
+	C[24] = y * z * (t +     invR7);
+	C[25] = z * z * (t +     invR7) + x * x * invR7 + invR5;
+	t = y * y * invR9;
+	C[26] = x * y * (t + 3 * invR7);
+	C[27] = x * z * (t +     invR7);
+	C[30] = y * y * (t + 6 * invR7) + 3 * invR5;
+	C[31] = y * z * (t + 3 * invR7);
+	C[32] = z * z * (t +     invR7) + y * y * invR7 + invR5;
+	t = z * z * invR9;
+	C[28] = x * y * (t +     invR7);
+	C[29] = x * z * (t + 3 * invR7);
+	C[33] = y * z * (t + 3 * invR7);
+	C[34] = z * z * (t + 6 * invR7) + 3 * invR5;
+      }
+    };
 
     template<>
-    inline void getCoef<5>(vecP &C, const vec3 &dX, real_t &invR2, const real_t &invR) {
-      getCoef<4>(C, dX, invR2, invR);
-      real_t x = dX[0], y = dX[1], z = dX[2];
-      real_t invR3 = invR * invR2;
-      real_t invR5 = 3 * invR3 * invR2;
-      real_t invR7 = 5 * invR5 * invR2;
-      real_t invR9 = 7 * invR7 * invR2;
-      real_t invR11 = 9 * invR9 * invR2;
-      real_t t = x * x * invR11;
-      C[35] = x * x * x * (t + 10 * invR9) + 15 * x * invR7;
-      C[36] = x * x * y * (t +  6 * invR9) +  3 * y * invR7;
-      C[37] = x * x * z * (t +  6 * invR9) +  3 * z * invR7;
-      C[38] = x * y * y * (t +  3 * invR9) + x * x * x * invR9 + 3 * x * invR7;
-      C[39] = x * y * z * (t +  3 * invR9);
-      C[40] = x * z * z * (t +  3 * invR9) + x * x * x * invR9 + 3 * x * invR7;
-      C[41] = y * y * y * (t +      invR9) + 3 * x * x * y * invR9 + 3 * y * invR7;
-      C[42] = y * y * z * (t +      invR9) + x * x * z * invR9 + z * invR7;
-      C[43] = y * z * z * (t +      invR9) + x * x * y * invR9 + y * invR7;
-      C[44] = z * z * z * (t +      invR9) + 3 * x * x * z * invR9 + 3 * z * invR7;
-      t = y * y * invR11;
-      C[45] = x * y * y * (t +  6 * invR9) +  3 * x * invR7;
-      C[46] = x * y * z * (t +  3 * invR9);
-      C[47] = x * z * z * (t +      invR9) + x * y * y * invR9 + x * invR7;
-      C[50] = y * y * y * (t + 10 * invR9) + 15 * y * invR7;
-      C[51] = y * y * z * (t +  6 * invR9) + 3 * z * invR7;
-      C[52] = y * z * z * (t +  3 * invR9) + y * y * y * invR9 + 3 * y * invR7;
-      C[53] = z * z * z * (t +      invR9) + 3 * y * y * z * invR9 + 3 * z * invR7;
-      t = z * z * invR11;
-      C[48] = x * y * z * (t +  3 * invR9);
-      C[49] = x * z * z * (t +  6 * invR9) +  3 * x * invR7;
-      C[54] = y * z * z * (t +  6 * invR9) +  3 * y * invR7;
-      C[55] = z * z * z * (t + 10 * invR9) + 15 * z * invR7;
-    }
+    struct Coef<5> {
+      template<typename TC, typename T>
+      static inline void get(vec<NTERM,TC> &C, const vec<3,T> &dX, T &invR2, const T &invR) {
+	Coef<4>::get(C, dX, invR2, invR);
+	T x = dX[0], y = dX[1], z = dX[2];
+	T invR3 = invR * invR2;
+	T invR5 = 3 * invR3 * invR2;
+	T invR7 = 5 * invR5 * invR2;
+	T invR9 = 7 * invR7 * invR2;
+	T invR11 = 9 * invR9 * invR2;
+	T t = x * x * invR11;
+	C[35] = x * x * x * (t + 10 * invR9) + 15 * x * invR7;
+	C[36] = x * x * y * (t +  6 * invR9) +  3 * y * invR7;
+	C[37] = x * x * z * (t +  6 * invR9) +  3 * z * invR7;
+	C[38] = x * y * y * (t +  3 * invR9) + x * x * x * invR9 + 3 * x * invR7;
+	C[39] = x * y * z * (t +  3 * invR9);
+	C[40] = x * z * z * (t +  3 * invR9) + x * x * x * invR9 + 3 * x * invR7;
+	C[41] = y * y * y * (t +      invR9) + 3 * x * x * y * invR9 + 3 * y * invR7;
+	C[42] = y * y * z * (t +      invR9) + x * x * z * invR9 + z * invR7;
+	C[43] = y * z * z * (t +      invR9) + x * x * y * invR9 + y * invR7;
+	C[44] = z * z * z * (t +      invR9) + 3 * x * x * z * invR9 + 3 * z * invR7;
+	t = y * y * invR11;
+	C[45] = x * y * y * (t +  6 * invR9) +  3 * x * invR7;
+	C[46] = x * y * z * (t +  3 * invR9);
+	C[47] = x * z * z * (t +      invR9) + x * y * y * invR9 + x * invR7;
+	C[50] = y * y * y * (t + 10 * invR9) + 15 * y * invR7;
+	C[51] = y * y * z * (t +  6 * invR9) + 3 * z * invR7;
+	C[52] = y * z * z * (t +  3 * invR9) + y * y * y * invR9 + 3 * y * invR7;
+	C[53] = z * z * z * (t +      invR9) + 3 * y * y * z * invR9 + 3 * z * invR7;
+	t = z * z * invR11;
+	C[48] = x * y * z * (t +  3 * invR9);
+	C[49] = x * z * z * (t +  6 * invR9) +  3 * x * invR7;
+	C[54] = y * z * z * (t +  6 * invR9) +  3 * y * invR7;
+	C[55] = z * z * z * (t + 10 * invR9) + 15 * z * invR7;
+      }
+    };
 
     template<>
-    inline void getCoef<6>(vecP &C, const vec3 &dX, real_t &invR2, const real_t &invR) {
-      getCoef<5>(C, dX, invR2, invR);
-      real_t x = dX[0], y = dX[1], z = dX[2];
-      real_t invR3 = invR * invR2;
-      real_t invR5 = 3 * invR3 * invR2;
-      real_t invR7 = 5 * invR5 * invR2;
-      real_t invR9 = 7 * invR7 * invR2;
-      real_t invR11 = 9 * invR9 * invR2;
-      real_t invR13 = 11 * invR11 * invR2;
-      real_t t = x * x * invR13;
-      C[56] = x * x * x * x * (t + 15 * invR11) + 45 * x * x * invR9 + 15 * invR7;
-      C[57] = x * x * x * y * (t + 10 * invR11) + 15 * x * y * invR9;
-      C[58] = x * x * x * z * (t + 10 * invR11) + 15 * x * z * invR9;
-      C[59] = x * x * y * y * (t +  6 * invR11) + x * x * x * x * invR11 + (6 * x * x + 3 * y * y) * invR9 + 3 * invR7;
-      C[60] = x * x * y * z * (t +  6 * invR11) + 3 * y * z * invR9;
-      C[61] = x * x * z * z * (t +  6 * invR11) + x * x * x * x * invR11 + (6 * x * x + 3 * z * z) * invR9 + 3 * invR7;
-      C[62] = x * y * y * y * (t +  3 * invR11) + 3 * x * x * x * y * invR11 + 9 * x * y * invR9;
-      C[63] = x * y * y * z * (t +  3 * invR11) + x * x * x * z * invR11 + 3 * x * z * invR9;
-      C[64] = x * y * z * z * (t +  3 * invR11) + x * x * x * y * invR11 + 3 * x * y * invR9;
-      C[65] = x * z * z * z * (t +  3 * invR11) + 3 * x * x * x * z * invR11 + 9 * x * z * invR9;
-      C[66] = y * y * y * y * (t +      invR11) + 6 * x * x * y * y * invR11 + (3 * x * x + 6 * y * y) * invR9 + 3 * invR7;
-      C[67] = y * y * y * z * (t +      invR11) + 3 * x * x * y * z * invR11 + 3 * y * z * invR9;
-      C[68] = y * y * z * z * (t +      invR11) + (x * x * y * y + x * x * z * z) * invR11 + (x * x + y * y + z * z) * invR9 + invR7;
-      C[69] = y * z * z * z * (t +      invR11) + 3 * x * x * y * z * invR11 + 3 * y * z * invR9;
-      C[70] = z * z * z * z * (t +      invR11) + 6 * x * x * z * z * invR11 + (3 * x * x + 6 * z * z) * invR9 + 3 * invR7;
-      t = y * y * invR13;
-      C[71] = x * y * y * y * (t + 10 * invR11) + 15 * x * y * invR9;
-      C[72] = x * y * y * z * (t +  6 * invR11) + 3 * x * z * invR9;
-      C[73] = x * y * z * z * (t +  3 * invR11) + x * y * y * y * invR11 + 3 * x * y * invR9;
-      C[74] = x * z * z * z * (t +      invR11) + 3 * x * y * y * z * invR11 + 3 * x * z * invR9;
-      C[77] = y * y * y * y * (t + 15 * invR11) + 45 * y * y * invR9 + 15 * invR7;
-      C[78] = y * y * y * z * (t + 10 * invR11) + 15 * y * z * invR9;
-      C[79] = y * y * z * z * (t +  6 * invR11) + y * y * y * y * invR11 + (6 * y * y + 3 * z * z) * invR9 + 3 * invR7;
-      C[80] = y * z * z * z * (t +  3 * invR11) + 3 * y * y * y * z * invR11 + 9 * y * z * invR9;
-      C[81] = z * z * z * z * (t +      invR11) + 6 * y * y * z * z * invR11 + (3 * y * y + 6 * z * z) * invR9 + 3 * invR7;
-      t = z * z * invR13;
-      C[75] = x * y * z * z * (t +  6 * invR11) + 3 * x * y * invR9;
-      C[76] = x * z * z * z * (t + 10 * invR11) + 15 * x * z * invR9;
-      C[82] = y * z * z * z * (t + 10 * invR11) + 15 * y * z * invR9;
-      C[83] = z * z * z * z * (t + 15 * invR11) + 45 * z * z * invR9 + 15 * invR7;
-    }
+    struct Coef<6> {
+      template<typename TC, typename T>
+      static inline void get(vec<NTERM,TC> &C, const vec<3,T> &dX, T &invR2, const T &invR) {
+	Coef<5>::get(C, dX, invR2, invR);
+	T x = dX[0], y = dX[1], z = dX[2];
+	T invR3 = invR * invR2;
+	T invR5 = 3 * invR3 * invR2;
+	T invR7 = 5 * invR5 * invR2;
+	T invR9 = 7 * invR7 * invR2;
+	T invR11 = 9 * invR9 * invR2;
+	T invR13 = 11 * invR11 * invR2;
+	T t = x * x * invR13;
+	C[56] = x * x * x * x * (t + 15 * invR11) + 45 * x * x * invR9 + 15 * invR7;
+	C[57] = x * x * x * y * (t + 10 * invR11) + 15 * x * y * invR9;
+	C[58] = x * x * x * z * (t + 10 * invR11) + 15 * x * z * invR9;
+	C[59] = x * x * y * y * (t +  6 * invR11) + x * x * x * x * invR11 + (6 * x * x + 3 * y * y) * invR9 + 3 * invR7;
+	C[60] = x * x * y * z * (t +  6 * invR11) + 3 * y * z * invR9;
+	C[61] = x * x * z * z * (t +  6 * invR11) + x * x * x * x * invR11 + (6 * x * x + 3 * z * z) * invR9 + 3 * invR7;
+	C[62] = x * y * y * y * (t +  3 * invR11) + 3 * x * x * x * y * invR11 + 9 * x * y * invR9;
+	C[63] = x * y * y * z * (t +  3 * invR11) + x * x * x * z * invR11 + 3 * x * z * invR9;
+	C[64] = x * y * z * z * (t +  3 * invR11) + x * x * x * y * invR11 + 3 * x * y * invR9;
+	C[65] = x * z * z * z * (t +  3 * invR11) + 3 * x * x * x * z * invR11 + 9 * x * z * invR9;
+	C[66] = y * y * y * y * (t +      invR11) + 6 * x * x * y * y * invR11 + (3 * x * x + 6 * y * y) * invR9 + 3 * invR7;
+	C[67] = y * y * y * z * (t +      invR11) + 3 * x * x * y * z * invR11 + 3 * y * z * invR9;
+	C[68] = y * y * z * z * (t +      invR11) + (x * x * y * y + x * x * z * z) * invR11 + (x * x + y * y + z * z) * invR9 + invR7;
+	C[69] = y * z * z * z * (t +      invR11) + 3 * x * x * y * z * invR11 + 3 * y * z * invR9;
+	C[70] = z * z * z * z * (t +      invR11) + 6 * x * x * z * z * invR11 + (3 * x * x + 6 * z * z) * invR9 + 3 * invR7;
+	t = y * y * invR13;
+	C[71] = x * y * y * y * (t + 10 * invR11) + 15 * x * y * invR9;
+	C[72] = x * y * y * z * (t +  6 * invR11) + 3 * x * z * invR9;
+	C[73] = x * y * z * z * (t +  3 * invR11) + x * y * y * y * invR11 + 3 * x * y * invR9;
+	C[74] = x * z * z * z * (t +      invR11) + 3 * x * y * y * z * invR11 + 3 * x * z * invR9;
+	C[77] = y * y * y * y * (t + 15 * invR11) + 45 * y * y * invR9 + 15 * invR7;
+	C[78] = y * y * y * z * (t + 10 * invR11) + 15 * y * z * invR9;
+	C[79] = y * y * z * z * (t +  6 * invR11) + y * y * y * y * invR11 + (6 * y * y + 3 * z * z) * invR9 + 3 * invR7;
+	C[80] = y * z * z * z * (t +  3 * invR11) + 3 * y * y * y * z * invR11 + 9 * y * z * invR9;
+	C[81] = z * z * z * z * (t +      invR11) + 6 * y * y * z * z * invR11 + (3 * y * y + 6 * z * z) * invR9 + 3 * invR7;
+	t = z * z * invR13;
+	C[75] = x * y * z * z * (t +  6 * invR11) + 3 * x * y * invR9;
+	C[76] = x * z * z * z * (t + 10 * invR11) + 15 * x * z * invR9;
+	C[82] = y * z * z * z * (t + 10 * invR11) + 15 * y * z * invR9;
+	C[83] = z * z * z * z * (t + 15 * invR11) + 45 * z * z * invR9 + 15 * invR7;
+      }
+    };
 
 
     template<int PP>
-    inline void sumM2L(vecP &L, const vecP &C, const vecP &M) {
+    inline void sumM2L(vecP &L, const vecP &C, const vecP &M, int nterm=(PP+1)*(PP+2)*(PP+3)/6) {
 #if EXAFMM_MASS
-      for (int i=0; i<NTERM; i++) L[i] += C[i];
+      for (int i=0; i<nterm; i++) L[i] += C[i];
 #else
-      for (int i=0; i<NTERM; i++) L[i] += M[0] * C[i];
+      for (int i=0; i<nterm; i++) L[i] += M[0] * C[i];
 #endif
-      for (int i=1; i<NTERM; i++) L[0] += M[i] * C[i];
-      Kernels<0,0,PP-1>::M2L(L, C, M);
+      for (int i=1; i<nterm; i++) L[0] += M[i] * C[i];
+      Kernels<0,0,PP-1>::template M2L<PP+1>(L, C, M);
     }
 
     template<>
-    inline void sumM2L<1>(vecP &L, const vecP &C, const vecP&M __attribute__((unused))) {
+    inline void sumM2L<1>(vecP &L, const vecP &C, const vecP&M __attribute__((unused)), int nterm) {
 #if EXAFMM_MASS
-      for (int i=0; i<NTERM; i++) L[i] += C[i];
+      for (int i=0; i<nterm; i++) L[i] += C[i];
 #else
-      for (int i=0; i<NTERM; i++) L[i] += M[0] * C[i];
+      for (int i=0; i<nterm; i++) L[i] += M[0] * C[i];
 #endif
     }
 
     template<>
-    inline void sumM2L<2>(vecP &L, const vecP &C, const vecP &M) {
-      sumM2L<1>(L, C, M);
+    inline void sumM2L<2>(vecP &L, const vecP &C, const vecP &M, int nterm) {
+      sumM2L<1>(L, C, M, nterm);
       L[0] += M[1]*C[1]+M[2]*C[2]+M[3]*C[3];
       L[1] += M[1]*C[4]+M[2]*C[5]+M[3]*C[6];
       L[2] += M[1]*C[5]+M[2]*C[7]+M[3]*C[8];
@@ -470,8 +526,8 @@ namespace exafmm {
     }
 
     template<>
-    inline void sumM2L<3>(vecP &L, const vecP &C, const vecP &M) {
-      sumM2L<2>(L, C, M);
+    inline void sumM2L<3>(vecP &L, const vecP &C, const vecP &M, int nterm) {
+      sumM2L<2>(L, C, M, nterm);
       L[0] += M[4]*C[4]+M[5]*C[5]+M[6]*C[6]+M[7]*C[7]+M[8]*C[8]+M[9]*C[9];
       L[1] += M[4]*C[10]+M[5]*C[11]+M[6]*C[12]+M[7]*C[13]+M[8]*C[14]+M[9]*C[15];
       L[2] += M[4]*C[11]+M[5]*C[13]+M[6]*C[14]+M[7]*C[16]+M[8]*C[17]+M[9]*C[18];
@@ -485,8 +541,8 @@ namespace exafmm {
     }
 
     template<>
-    inline void sumM2L<4>(vecP &L, const vecP &C, const vecP &M) {
-      sumM2L<3>(L, C, M);
+    inline void sumM2L<4>(vecP &L, const vecP &C, const vecP &M, int nterm) {
+      sumM2L<3>(L, C, M, nterm);
       L[0] += M[10]*C[10]+M[11]*C[11]+M[12]*C[12]+M[13]*C[13]+M[14]*C[14]+M[15]*C[15]+M[16]*C[16]+M[17]*C[17]+M[18]*C[18]+M[19]*C[19];
       L[1] += M[10]*C[20]+M[11]*C[21]+M[12]*C[22]+M[13]*C[23]+M[14]*C[24]+M[15]*C[25]+M[16]*C[26]+M[17]*C[27]+M[18]*C[28]+M[19]*C[29];
       L[2] += M[10]*C[21]+M[11]*C[23]+M[12]*C[24]+M[13]*C[26]+M[14]*C[27]+M[15]*C[28]+M[16]*C[30]+M[17]*C[31]+M[18]*C[32]+M[19]*C[33];
@@ -510,8 +566,8 @@ namespace exafmm {
     }
 
     template<>
-    inline void sumM2L<5>(vecP &L, const vecP &C, const vecP &M) {
-      sumM2L<4>(L, C, M);
+    inline void sumM2L<5>(vecP &L, const vecP &C, const vecP &M, int nterm) {
+      sumM2L<4>(L, C, M, nterm);
       L[0] += M[20]*C[20]+M[21]*C[21]+M[22]*C[22]+M[23]*C[23]+M[24]*C[24]+M[25]*C[25]+M[26]*C[26]+M[27]*C[27]+M[28]*C[28]+M[29]*C[29]+M[30]*C[30]+M[31]*C[31]+M[32]*C[32]+M[33]*C[33]+M[34]*C[34];
       L[1] += M[20]*C[35]+M[21]*C[36]+M[22]*C[37]+M[23]*C[38]+M[24]*C[39]+M[25]*C[40]+M[26]*C[41]+M[27]*C[42]+M[28]*C[43]+M[29]*C[44]+M[30]*C[45]+M[31]*C[46]+M[32]*C[47]+M[33]*C[48]+M[34]*C[49];
       L[2] += M[20]*C[36]+M[21]*C[38]+M[22]*C[39]+M[23]*C[41]+M[24]*C[42]+M[25]*C[43]+M[26]*C[45]+M[27]*C[46]+M[28]*C[47]+M[29]*C[48]+M[30]*C[50]+M[31]*C[51]+M[32]*C[52]+M[33]*C[53]+M[34]*C[54];
@@ -550,8 +606,8 @@ namespace exafmm {
     }
 
     template<>
-    inline void sumM2L<6>(vecP &L, const vecP &C, const vecP &M) {
-      sumM2L<5>(L, C, M);
+    inline void sumM2L<6>(vecP &L, const vecP &C, const vecP &M, int nterm) {
+      sumM2L<5>(L, C, M, nterm);
       L[0] += M[35]*C[35]+M[36]*C[36]+M[37]*C[37]+M[38]*C[38]+M[39]*C[39]+M[40]*C[40]+M[41]*C[41]+M[42]*C[42]+M[43]*C[43]+M[44]*C[44]+M[45]*C[45]+M[46]*C[46]+M[47]*C[47]+M[48]*C[48]+M[49]*C[49]+M[50]*C[50]+M[51]*C[51]+M[52]*C[52]+M[53]*C[53]+M[54]*C[54]+M[55]*C[55];
       L[1] += M[35]*C[56]+M[36]*C[57]+M[37]*C[58]+M[38]*C[59]+M[39]*C[60]+M[40]*C[61]+M[41]*C[62]+M[42]*C[63]+M[43]*C[64]+M[44]*C[65]+M[45]*C[66]+M[46]*C[67]+M[47]*C[68]+M[48]*C[69]+M[49]*C[70]+M[50]*C[71]+M[51]*C[72]+M[52]*C[73]+M[53]*C[74]+M[54]*C[75]+M[55]*C[76];
       L[2] += M[35]*C[57]+M[36]*C[59]+M[37]*C[60]+M[38]*C[62]+M[39]*C[63]+M[40]*C[64]+M[41]*C[66]+M[42]*C[67]+M[43]*C[68]+M[44]*C[69]+M[45]*C[71]+M[46]*C[72]+M[47]*C[73]+M[48]*C[74]+M[49]*C[75]+M[50]*C[77]+M[51]*C[78]+M[52]*C[79]+M[53]*C[80]+M[54]*C[81]+M[55]*C[82];
@@ -633,80 +689,204 @@ namespace exafmm {
       static inline void negate(vecP){}
     };
 
-    void setup() {}
+    int order = P;
+
+    void setup() {
+      checkOrder(2, P);                                         // Orders instantiated below
+    }
 
-    void P2M(C_iter C) {
+    template<int PP>
+    void P2M(C_iter C, vecP & MC) {
+      const int nterm = PP*(PP+1)*(PP+2)/6;
       for (B_iter B=C->BODY; B!=C->BODY+C->NBODY; B++) {
 	vec3 dX = C->X - B->X;
 	vecP M;
 	M[0] = B->SRC;
-	Kernels<0,0,P-1>::power(M, dX);
-	for (int i=0; i<NTERM; i++) C->M[i] += M[i];
+	Kernels<0,0,PP-1>::power(M, dX);
+	for (int i=0; i<nterm; i++) MC[i] += M[i];
       }
     }
 
-    void M2M(C_iter Ci, C_iter C0) {
+    template<int PP>
+    void M2M(C_iter Ci, C_iter C0, vecP * M0) {
+      const int nterm = PP*(PP+1)*(PP+2)/6;
+      vecP & Mi = M0[Ci-C0];
       for (C_iter Cj=C0+Ci->ICHILD; Cj!=C0+Ci->ICHILD+Ci->NCHILD; Cj++) {
 	vec3 dX = Ci->X - Cj->X;
 	vecP M;
 	vecP C;
 	C[0] = 1;
-	Kernels<0,0,P-1>::power(C, dX);
-	M = Cj->M;
-	for (int i=0; i<NTERM; i++) Ci->M[i] += C[i] * M[0];
-	Kernels<0,0,P-1>::M2M(Ci->M, C, M);
+	Kernels<0,0,PP-1>::power(C, dX);
+	M = M0[Cj-C0];
+	for (int i=0; i<nterm; i++) Mi[i] += C[i] * M[0];
+	Kernels<0,0,PP-1>::M2M(Mi, C, M);
       }
     }
 
-		template <typename J_iter>
-		void M2L(C_iter Ci, J_iter Cj, bool mutual) {
+    template<int PP, typename J_iter>
+    void M2L(C_iter Ci, J_iter Cj, const vecP & Mi, vecP & Li, const vecP & Mj, vecP * Lj) {
       vec3 dX = Ci->X - Cj->X - Xperiodic;
       real_t invR2 = 1 / norm(dX);
 #if EXAFMM_MASS
-      real_t invR  = Ci->M[0] * Cj->M[0] * std::sqrt(invR2);
+      real_t invR  = Mi[0] * Mj[0] * std::sqrt(invR2);
 #else
       real_t invR = std::sqrt(invR2);
 #endif
       vecP C;
-      getCoef<P-1>(C, dX, invR2, invR);
-      sumM2L<P-1>(Ci->L, C, Cj->M);
-      if (mutual) {
-	Coefs<P-1,(P-1)&1>::negate(C);
-	sumM2L<P-1>(Cj->L, C, Ci->M);
+      Coef<PP-1>::get(C, dX, invR2, invR);
+      sumM2L<PP-1>(Li, C, Mj);
+      if (Lj) {
+	Coefs<PP-1,(PP-1)&1>::negate(C);
+	sumM2L<PP-1>(*Lj, C, Mi);
       }
     }
-    template void M2L<C_iter>(C_iter Ci,C_iter Cj, bool mutual);
-		template void M2L<M_iter>(C_iter Ci,M_iter Cj, bool mutual);
 
-    void L2L(C_iter Ci, C_iter Ci0) {
-      C_iter Cj = Ci0 + Ci->IPARENT;
+    //! M2L from a list of source cells to Ci, with coefficients and contraction for NSIMDM sources at a time in SIMD lanes
+    template<int PP>
+    void M2LBatch(C_iter Ci, const C_iter * Cj, int numCj, C_iter Cj0, const vecP & Mi, vecP & Li, const vecP * Mj) {
+      const int nterm = PP*(PP+1)*(PP+2)/6;
+      vec<NTERM,msimdvec> C, M, L;                              // Coefficients, multipoles, locals per lane
+      vec<3,msimdvec> dX;                                       // Distance vector per lane
+      L = msimdvec(0);
+      for (int j=0; j<numCj; j+=NSIMDM) {                       // Loop over blocks of sources
+	for (int k=0; k<NSIMDM; k++) {                          //  Loop over lanes
+	  if (j + k < numCj) {                                  //   If lane has a source
+	    C_iter Cjk = Cj[j+k];
+	    const vecP & Mjk = Mj[Cjk-Cj0];
+	    for (int d=0; d<3; d++) dX[d][k] = Ci->X[d] - Cjk->X[d] - Xperiodic[d];
+	    for (int i=0; i<nterm; i++) M[i][k] = Mjk[i];
+	  } else {                                              //   Else pad lane with a unit distance and zero multipoles
+	    dX[0][k] = 1;
+	    dX[1][k] = dX[2][k] = 0;
+	    for (int i=0; i<nterm; i++) M[i][k] = 0;
+	  }                                                     //   End if for lane
+	}                                                       //  End loop over lanes
+	msimdvec R2 = norm(dX);                                 //  Distance squared for all lanes
+	msimdvec invR2 = msimdvec(1) / R2;
+	msimdvec invR = rsqrt(R2);
+	invR *= (msimdvec(3) - R2 * invR * invR) * msimdvec(0.5);//  Newton step
+#if EXAFMM_MASS
+	invR *= msimdvec(Mi[0]) * M[0];                         //  Padded lanes vanish through M[0] = 0
+#endif
+	Coef<PP-1>::get(C, dX, invR2, invR);                    //  Coefficients for all lanes at once
+#if EXAFMM_MASS
+	for (int i=0; i<nterm; i++) L[i] += C[i];
+#else
+	for (int i=0; i<nterm; i++) L[i] += M[0] * C[i];
+#endif
+	for (int i=1; i<nterm; i++) L[0] += M[i] * C[i];
+	Kernels<0,0,PP-2>::template M2L<PP>(L, C, M);
+      }                                                         // End loop over blocks of sources
+      for (int i=0; i<nterm; i++) Li[i] += sum(L[i]);           // Reduce lanes
+    }
+
+    template<int PP>
+    void L2L(C_iter Ci, C_iter C0, const vecP * M0, vecP * L0) {
+      const int nterm = PP*(PP+1)*(PP+2)/6;
+      C_iter Cj = C0 + Ci->IPARENT;
+      vecP & Li = L0[Ci-C0];
+      const vecP & Lj = L0[Ci->IPARENT];
       vec3 dX = Ci->X - Cj->X;
       vecP C;
       C[0] = 1;
-      Kernels<0,0,P-1>::power(C, dX);
+      Kernels<0,0,PP-1>::power(C, dX);
 #if EXAFMM_MASS
-      Ci->L /= Ci->M[0];
+      Li /= M0[Ci-C0][0];
 #endif
-      Ci->L += Cj->L;
-      for (int i=1; i<NTERM; i++) Ci->L[0] += C[i] * Cj->L[i];
-      Kernels<0,0,P-1>::L2L(Ci->L, C, Cj->L);
+      Li += Lj;
+      for (int i=1; i<nterm; i++) Li[0] += C[i] * Lj[i];
+      Kernels<0,0,PP-1>::template L2L<PP>(Li, C, Lj);
     }
 
-    void L2P(C_iter Ci) {
+    template<int PP>
+    void L2P(C_iter Ci, const vecP & Li) {
+      const int nterm = PP*(PP+1)*(PP+2)/6;
       for (B_iter B=Ci->BODY; B!=Ci->BODY+Ci->NBODY; B++) {
 	vec3 dX = B->X - Ci->X;
 	vecP C, L;
 	C[0] = 1;
-	Kernels<0,0,P-1>::power(C,dX);
-	L = Ci->L;
+	Kernels<0,0,PP-1>::power(C,dX);
+	L = Li;
 	B->TRG /= B->SRC;
 	B->TRG[0] += L[0];
 	B->TRG[1] += L[1];
 	B->TRG[2] += L[2];
 	B->TRG[3] += L[3];
-	for (int i=1; i<NTERM; i++) B->TRG[0] += C[i] * L[i];
-	Kernels<0,0,1>::L2P(B, C, L);
+	for (int i=1; i<nterm; i++) B->TRG[0] += C[i] * L[i];
+	Kernels<0,0,1>::template L2P<PP>(B, C, L);
+      }
+    }
+
+    //! Kernels instantiated for orders 2 to PP; each call is forwarded to the run-time order
+    template<int PP>
+    struct Order {
+      static inline void P2M(C_iter C, vecP & M) {
+	if (order == PP) kernel::P2M<PP>(C, M);
+	else Order<PP-1>::P2M(C, M);
+      }
+      static inline void M2M(C_iter Ci, C_iter C0, vecP * M) {
+	if (order == PP) kernel::M2M<PP>(Ci, C0, M);
+	else Order<PP-1>::M2M(Ci, C0, M);
+      }
+      template<typename J_iter>
+      static inline void M2L(C_iter Ci, J_iter Cj, const vecP & Mi, vecP & Li, const vecP & Mj, vecP * Lj) {
+	if (order == PP) kernel::M2L<PP>(Ci, Cj, Mi, Li, Mj, Lj);
+	else Order<PP-1>::M2L(Ci, Cj, Mi, Li, Mj, Lj);
+      }
+      static inline void M2LBatch(C_iter Ci, const C_iter * Cj, int numCj, C_iter Cj0, const vecP & Mi, vecP & Li, const vecP * Mj) {
+	if (order == PP) kernel::M2LBatch<PP>(Ci, Cj, numCj, Cj0, Mi, Li, Mj);
+	else Order<PP-1>::M2LBatch(Ci, Cj, numCj, Cj0, Mi, Li, Mj);
+      }
+      static inline void L2L(C_iter Ci, C_iter C0, const vecP * M, vecP * L) {
+	if (order == PP) kernel::L2L<PP>(Ci, C0, M, L);
+	else Order<PP-1>::L2L(Ci, C0, M, L);
       }
+      static inline void L2P(C_iter Ci, const vecP & L) {
+	if (order == PP) kernel::L2P<PP>(Ci, L);
+	else Order<PP-1>::L2P(Ci, L);
+      }
+    };
+
+    template<>
+    struct Order<2> {
+      static inline void P2M(C_iter C, vecP & M) { kernel::P2M<2>(C, M); }
+      static inline void M2M(C_iter Ci, C_iter C0, vecP * M) { kernel::M2M<2>(Ci, C0, M); }
+      template<typename J_iter>
+      static inline void M2L(C_iter Ci, J_iter Cj, const vecP & Mi, vecP & Li, const vecP & Mj, vecP * Lj) {
+	kernel::M2L<2>(Ci, Cj, Mi, Li, Mj, Lj);
+      }
+      static inline void M2LBatch(C_iter Ci, const C_iter * Cj, int numCj, C_iter Cj0, const vecP & Mi, vecP & Li, const vecP * Mj) {
+	kernel::M2LBatch<2>(Ci, Cj, numCj, Cj0, Mi, Li, Mj);
+      }
+      static inline void L2L(C_iter Ci, C_iter C0, const vecP * M, vecP * L) { kernel::L2L<2>(Ci, C0, M, L); }
+      static inline void L2P(C_iter Ci, const vecP & L) { kernel::L2P<2>(Ci, L); }
+    };
+
+    void P2M(C_iter C, vecP & M) {
+      Order<P>::P2M(C, M);
+    }
+
+    void M2M(C_iter Ci, C_iter C0, vecP * M) {
+      Order<P>::M2M(Ci, C0, M);
+    }
+
+    template <typename J_iter>
+    void M2L(C_iter Ci, J_iter Cj, const vecP & Mi, vecP & Li, const vecP & Mj, vecP * Lj) {
+      Order<P>::M2L(Ci, Cj, Mi, Li, Mj, Lj);
+    }
+    template void M2L<C_iter>(C_iter Ci, C_iter Cj, const vecP & Mi, vecP & Li, const vecP & Mj, vecP * Lj);
+    template void M2L<M_iter>(C_iter Ci, M_iter Cj, const vecP & Mi, vecP & Li, const vecP & Mj, vecP * Lj);
+
+    void M2LBatch(C_iter Ci, const C_iter * Cj, int numCj, C_iter Cj0, const vecP & Mi, vecP & Li, const vecP * Mj) {
+      Order<P>::M2LBatch(Ci, Cj, numCj, Cj0, Mi, Li, Mj);
+    }
+
+    void L2L(C_iter Ci, C_iter C0, const vecP * M, vecP * L) {
+      Order<P>::L2L(Ci, C0, M, L);
+    }
+
+    void L2P(C_iter Ci, const vecP & L) {
+      Order<P>::L2P(Ci, L);
     }
   }
 }
@@ -7,77 +7,122 @@ namespace exafmm {
   namespace kernel {
     real_t eps2;
     vec3 Xperiodic;
-		template <typename J_iter>
-    void P2P(C_iter Ci, J_iter Cj, bool mutual) {
-      B_iter Bi = Ci->BODY;
-      B_iter Bj = Cj->BODY;
-      int ni = Ci->NBODY;
-      int nj = Cj->NBODY;
-      int i = 0;
 #if EXAFMM_USE_SIMD
-      for ( ; i<=ni-NSIMD; i+=NSIMD) {
-	simdvec zero = 0.0;
-	ksimdvec pot = zero;
-	ksimdvec ax = zero;
-	ksimdvec ay = zero;
-	ksimdvec az = zero;
-
-	simdvec xi = SIMD<simdvec,0,NSIMD>::setBody(Bi,i);
-	simdvec yi = SIMD<simdvec,1,NSIMD>::setBody(Bi,i);
-	simdvec zi = SIMD<simdvec,2,NSIMD>::setBody(Bi,i);
-	simdvec mi = SIMD<simdvec,3,NSIMD>::setBody(Bi,i);
-
-	simdvec xj = Xperiodic[0];
-	xi -= xj;
-	simdvec yj = Xperiodic[1];
-	yi -= yj;
-	simdvec zj = Xperiodic[2];
-	zi -= zj;
-
-	for (int j=0; j<nj; j++) {
-	  simdvec dx = Bj[j].X[0];
-	  dx -= xi;
-	  simdvec dy = Bj[j].X[1];
-	  dy -= yi;
-	  simdvec dz = Bj[j].X[2];
-	  dz -= zi;
-	  simdvec mj = Bj[j].SRC;
-
+    //! P2P_TILE_I target vectors against P2P_TILE_J sources {x,y,z,q}, with every pair in registers
+    //! Target terms go to pot..az; if mutual, source terms are summed over the tile into trgj
+    //! If self, the target lane whose index equals the source index is skipped
+    template<bool self, bool mutual>
+    inline __attribute__((always_inline)) void P2PTile(const simdvec * xi, const simdvec * yi, const simdvec * zi, const simdvec * mi,
+			const simdvec * index, int j, const real_t (* Sj)[4],
+			ksimdvec * pot, ksimdvec * ax, ksimdvec * ay, ksimdvec * az, real_t (* trgj)[4]) {
+      simdvec zero = 0.0;
+      simdvec pj[mutual ? P2P_TILE_J : 1], axj[mutual ? P2P_TILE_J : 1];
+      simdvec ayj[mutual ? P2P_TILE_J : 1], azj[mutual ? P2P_TILE_J : 1];
+      for (int jj=0; jj<P2P_TILE_J; jj++) {
+	if (mutual) pj[jj] = axj[jj] = ayj[jj] = azj[jj] = zero;
+	simdvec xj = Sj[jj][0];
+	simdvec yj = Sj[jj][1];
+	simdvec zj = Sj[jj][2];
+	simdvec mj = Sj[jj][3];
+	for (int ii=0; ii<P2P_TILE_I; ii++) {
+	  simdvec dx = xj - xi[ii];
+	  simdvec dy = yj - yi[ii];
+	  simdvec dz = zj - zi[ii];
 	  simdvec R2 = eps2;
-	  xj = dx;
 	  R2 += dx * dx;
-	  yj = dy;
 	  R2 += dy * dy;
-	  zj = dz;
 	  R2 += dz * dz;
-	  simdvec invR = rsqrt(R2); 
+	  simdvec invR = rsqrt(R2);
+	  if (self) {
+	    simdvec below = invR;
+	    below &= index[ii] < simdvec(real_t(j+jj));
+	    invR &= index[ii] > simdvec(real_t(j+jj));
+	    invR += below;
+	  }
 	  invR &= R2 > zero;
 
-	  mj *= invR * mi;
-	  pot += mj;
-	  if (mutual) Bj[j].TRG[0] += sum(mj);
-	  invR = invR * invR * mj; 
+	  simdvec m = mj * invR * mi[ii];
+	  pot[ii] += m;
+	  if (mutual) pj[jj] += m;
+	  invR = invR * invR * m;
 
-	  xj *= invR;
-	  ax += xj;
-	  if (mutual) Bj[j].TRG[1] -= sum(xj);
+	  dx *= invR;
+	  ax[ii] += dx;
+	  if (mutual) axj[jj] += dx;
 
-	  yj *= invR;
-	  ay += yj;
-	  if (mutual) Bj[j].TRG[2] -= sum(yj);
+	  dy *= invR;
+	  ay[ii] += dy;
+	  if (mutual) ayj[jj] += dy;
 
-	  zj *= invR;
-	  az += zj;
-	  if (mutual) Bj[j].TRG[3] -= sum(zj);
+	  dz *= invR;
+	  az[ii] += dz;
+	  if (mutual) azj[jj] += dz;
 	}
-	for (int k=0; k<NSIMD; k++) {
-	  Bi[i+k].TRG[0] += transpose(pot, k);
-	  Bi[i+k].TRG[1] += transpose(ax, k);
-	  Bi[i+k].TRG[2] += transpose(ay, k);
-	  Bi[i+k].TRG[3] += transpose(az, k);
+      }
+      if (mutual) {                                             // One horizontal sum per source and tile
+	for (int jj=0; jj<P2P_TILE_J; jj++) {
+	  trgj[jj][0] = sum(pj[jj]);
+	  trgj[jj][1] = sum(axj[jj]);
+	  trgj[jj][2] = sum(ayj[jj]);
+	  trgj[jj][3] = sum(azj[jj]);
 	}
       }
+    }
 #endif
+
+    template <typename J_iter>
+    void P2P(C_iter Ci, J_iter Cj, bool mutual) {
+      B_iter Bi = Ci->BODY;
+      B_iter Bj = Cj->BODY;
+      int ni = Ci->NBODY;
+      int nj = Cj->NBODY;
+      int i = 0;
+#if EXAFMM_USE_SIMD
+      simdvec zero = 0.0;
+      for (i=0; i<ni; i+=P2P_TILE_I*NSIMD) {                   // Loop over tiles of target vectors
+	simdvec xi[P2P_TILE_I], yi[P2P_TILE_I], zi[P2P_TILE_I], mi[P2P_TILE_I], index[P2P_TILE_I];
+	ksimdvec pot[P2P_TILE_I], ax[P2P_TILE_I], ay[P2P_TILE_I], az[P2P_TILE_I];
+	for (int ii=0; ii<P2P_TILE_I; ii++) {                   //  Loop over target vectors in tile
+	  int nv = std::max(0, std::min(NSIMD, ni-i-ii*NSIMD)); //   Either 0 or an aligned vector
+	  xi[ii] = SIMDPartial<simdvec,0,NSIMD>::setBody(Bi,i+ii*NSIMD,nv) - Xperiodic[0];
+	  yi[ii] = SIMDPartial<simdvec,1,NSIMD>::setBody(Bi,i+ii*NSIMD,nv) - Xperiodic[1];
+	  zi[ii] = SIMDPartial<simdvec,2,NSIMD>::setBody(Bi,i+ii*NSIMD,nv) - Xperiodic[2];
+	  mi[ii] = SIMDPartial<simdvec,3,NSIMD>::setBody(Bi,i+ii*NSIMD,nv);
+	  index[ii] = zero;
+	  pot[ii] = ax[ii] = ay[ii] = az[ii] = zero;
+	}                                                       //  End loop over target vectors in tile
+	for (int j=0; j<nj; j+=P2P_TILE_J) {                    //  Loop over tiles of sources
+	  int mj = std::min(P2P_TILE_J, nj-j);                  //   Sources past mj have zero charge
+	  real_t Sj[P2P_TILE_J][4] = {}, trgj[P2P_TILE_J][4];
+	  for (int jj=0; jj<mj; jj++) {
+	    Sj[jj][0] = Bj[j+jj].X[0];
+	    Sj[jj][1] = Bj[j+jj].X[1];
+	    Sj[jj][2] = Bj[j+jj].X[2];
+	    Sj[jj][3] = Bj[j+jj].SRC;
+	  }
+	  if (mutual) {                                         //   If mutual, also add to the sources
+	    P2PTile<false,true>(xi, yi, zi, mi, index, j, Sj, pot, ax, ay, az, trgj);
+	    for (int jj=0; jj<mj; jj++) {
+	      Bj[j+jj].TRG[0] += trgj[jj][0];
+	      Bj[j+jj].TRG[1] -= trgj[jj][1];
+	      Bj[j+jj].TRG[2] -= trgj[jj][2];
+	      Bj[j+jj].TRG[3] -= trgj[jj][3];
+	    }
+	  } else {                                              //   Else targets only
+	    P2PTile<false,false>(xi, yi, zi, mi, index, j, Sj, pot, ax, ay, az, NULL);
+	  }                                                     //   End if for mutual
+	}                                                       //  End loop over tiles of sources
+	for (int ii=0; ii<P2P_TILE_I; ii++) {                   //  Loop over target vectors in tile
+	  int nv = std::max(0, std::min(NSIMD, ni-i-ii*NSIMD));
+	  for (int k=0; k<nv; k++) {
+	    Bi[i+ii*NSIMD+k].TRG[0] += transpose(pot[ii], k);
+	    Bi[i+ii*NSIMD+k].TRG[1] += transpose(ax[ii], k);
+	    Bi[i+ii*NSIMD+k].TRG[2] += transpose(ay[ii], k);
+	    Bi[i+ii*NSIMD+k].TRG[3] += transpose(az[ii], k);
+	  }
+	}                                                       //  End loop over target vectors in tile
+      }                                                         // End loop over tiles of target vectors
+#else
       for ( ; i<ni; i++) {
 	kreal_t pot = 0; 
 	kreal_t ax = 0;
@@ -107,6 +152,7 @@ namespace exafmm {
 	Bi[i].TRG[2] -= ay;
 	Bi[i].TRG[3] -= az;
       }
+#endif
     }
 
     void P2P(C_iter C) {
@@ -114,63 +160,52 @@ namespace exafmm {
       int n = C->NBODY;
       int i = 0;
 #if EXAFMM_USE_SIMD
-      for ( ; i<=n-NSIMD; i+=NSIMD) {
-	simdvec zero = 0;
-	ksimdvec pot = zero;
-	ksimdvec ax = zero;
-	ksimdvec ay = zero;
-	ksimdvec az = zero;
-
-	simdvec index = SIMD<simdvec,0,NSIMD>::setIndex(i);
-	simdvec xi = SIMD<simdvec,0,NSIMD>::setBody(B,i);
-	simdvec yi = SIMD<simdvec,1,NSIMD>::setBody(B,i);
-	simdvec zi = SIMD<simdvec,2,NSIMD>::setBody(B,i);
-	simdvec mi = SIMD<simdvec,3,NSIMD>::setBody(B,i);
-	for (int j=i+1; j<n; j++) {
-	  simdvec dx = B[j].X[0];
-	  dx -= xi;
-	  simdvec dy = B[j].X[1];
-	  dy -= yi;
-	  simdvec dz = B[j].X[2];
-	  dz -= zi;
-	  simdvec mj = B[j].SRC;
-
-	  simdvec R2 = eps2;
-	  simdvec xj = dx;
-	  R2 += dx * dx;
-	  simdvec yj = dy;
-	  R2 += dy * dy;
-	  simdvec zj = dz;
-	  R2 += dz * dz;
-	  simdvec invR = rsqrt(R2);
-	  invR &= index < j;
-	  invR &= R2 > zero;
-
-	  mj *= invR * mi;
-	  pot += mj;
-	  B[j].TRG[0] += sum(mj);
-	  invR = invR * invR * mj;
-
-	  xj *= invR;
-	  ax += xj;
-	  B[j].TRG[1] -= sum(xj);
-
-	  yj *= invR;
-	  ay += yj;
-	  B[j].TRG[2] -= sum(yj);
-
-	  zj *= invR;
-	  az += zj;
-	  B[j].TRG[3] -= sum(zj);
-	}
-	for (int k=0; k<NSIMD; k++) {
-	  B[i+k].TRG[0] += transpose(pot, k);
-	  B[i+k].TRG[1] += transpose(ax, k);
-	  B[i+k].TRG[2] += transpose(ay, k);
-	  B[i+k].TRG[3] += transpose(az, k);
-	}
-      }
-#endif
+      simdvec zero = 0.0;
+      for (i=0; i<n; i+=P2P_TILE_I*NSIMD) {                    // Loop over tiles of target vectors
+	simdvec xi[P2P_TILE_I], yi[P2P_TILE_I], zi[P2P_TILE_I], mi[P2P_TILE_I], index[P2P_TILE_I];
+	ksimdvec pot[P2P_TILE_I], ax[P2P_TILE_I], ay[P2P_TILE_I], az[P2P_TILE_I];
+	for (int ii=0; ii<P2P_TILE_I; ii++) {                   //  Loop over target vectors in tile
+	  int nv = std::max(0, std::min(NSIMD, n-i-ii*NSIMD));  //   Either 0 or an aligned vector
+	  index[ii] = SIMD<simdvec,0,NSIMD>::setIndex(i+ii*NSIMD);
+	  xi[ii] = SIMDPartial<simdvec,0,NSIMD>::setBody(B,i+ii*NSIMD,nv);
+	  yi[ii] = SIMDPartial<simdvec,1,NSIMD>::setBody(B,i+ii*NSIMD,nv);
+	  zi[ii] = SIMDPartial<simdvec,2,NSIMD>::setBody(B,i+ii*NSIMD,nv);
+	  mi[ii] = SIMDPartial<simdvec,3,NSIMD>::setBody(B,i+ii*NSIMD,nv);
+	  pot[ii] = ax[ii] = ay[ii] = az[ii] = zero;
+	}                                                       //  End loop over target vectors in tile
+	int jd = std::min(i+P2P_TILE_I*NSIMD, n);               //  Sources from jd on are past the diagonal
+	for (int j=i, mj; j<n; j+=mj) {                         //  Loop over tiles of sources
+	  mj = std::min(P2P_TILE_J, (j < jd ? jd : n) - j);     //   Sources past mj have zero charge
+	  real_t Sj[P2P_TILE_J][4] = {}, trgj[P2P_TILE_J][4];
+	  for (int jj=0; jj<mj; jj++) {
+	    Sj[jj][0] = B[j+jj].X[0];
+	    Sj[jj][1] = B[j+jj].X[1];
+	    Sj[jj][2] = B[j+jj].X[2];
+	    Sj[jj][3] = B[j+jj].SRC;
+	  }
+	  if (j < jd) {                                         //   If diagonal block, each pair from both sides
+	    P2PTile<true,false>(xi, yi, zi, mi, index, j, Sj, pot, ax, ay, az, NULL);
+	  } else {                                              //   Else mutual
+	    P2PTile<false,true>(xi, yi, zi, mi, index, j, Sj, pot, ax, ay, az, trgj);
+	    for (int jj=0; jj<mj; jj++) {
+	      B[j+jj].TRG[0] += trgj[jj][0];
+	      B[j+jj].TRG[1] -= trgj[jj][1];
+	      B[j+jj].TRG[2] -= trgj[jj][2];
+	      B[j+jj].TRG[3] -= trgj[jj][3];
+	    }
+	  }                                                     //   End if for diagonal block
+	}                                                       //  End loop over tiles of sources
+	for (int ii=0; ii<P2P_TILE_I; ii++) {                   //  Loop over target vectors in tile
+	  int nv = std::max(0, std::min(NSIMD, n-i-ii*NSIMD));
+	  for (int k=0; k<nv; k++) {
+	    B[i+ii*NSIMD+k].TRG[0] += transpose(pot[ii], k);
+	    B[i+ii*NSIMD+k].TRG[1] += transpose(ax[ii], k);
+	    B[i+ii*NSIMD+k].TRG[2] += transpose(ay[ii], k);
+	    B[i+ii*NSIMD+k].TRG[3] += transpose(az[ii], k);
+	  }
+	}                                                       //  End loop over target vectors in tile
+      }                                                         // End loop over tiles of target vectors
+#else
       for ( ; i<n; i++) {
 	kreal_t pot = 0;
 	kreal_t ax = 0;
@@ -198,6 +233,178 @@ namespace exafmm {
 	B[i].TRG[2] += ay;
 	B[i].TRG[3] += az;
       }
+#endif
+    }
+
+    void P2P(C_iter Ci, C_iter Cj, BodiesSoA & Bi, BodiesSoA & Bj, bool mutual) {
+      int ib = Bi.begin(Ci);                                    // Leaves start at a multiple of NSIMD
+      int jb = Bj.begin(Cj);
+      int ni = Bi.count(Ci);                                    // Padding has zero charge
+      int nj = Bj.count(Cj);
+      int i = 0;
+#if EXAFMM_USE_SIMD
+      simdvec zero = 0.0;
+      for (i=0; i<ni; i+=P2P_TILE_I*NSIMD) {                   // Loop over tiles of target vectors
+	simdvec xi[P2P_TILE_I], yi[P2P_TILE_I], zi[P2P_TILE_I], mi[P2P_TILE_I], index[P2P_TILE_I];
+	ksimdvec pot[P2P_TILE_I], ax[P2P_TILE_I], ay[P2P_TILE_I], az[P2P_TILE_I];
+	for (int ii=0; ii<P2P_TILE_I; ii++) {                   //  Loop over target vectors in tile
+	  int nv = std::max(0, std::min(NSIMD, ni-i-ii*NSIMD)); //   Lanes past nv have zero charge
+	  xi[ii] = loadPartial(&Bi.x[ib+i+ii*NSIMD], nv) - Xperiodic[0];
+	  yi[ii] = loadPartial(&Bi.y[ib+i+ii*NSIMD], nv) - Xperiodic[1];
+	  zi[ii] = loadPartial(&Bi.z[ib+i+ii*NSIMD], nv) - Xperiodic[2];
+	  mi[ii] = loadPartial(&Bi.q[ib+i+ii*NSIMD], nv);
+	  index[ii] = zero;
+	  pot[ii] = ax[ii] = ay[ii] = az[ii] = zero;
+	}                                                       //  End loop over target vectors in tile
+	for (int j=jb; j<jb+nj; j+=P2P_TILE_J) {                //  Loop over tiles of sources
+	  int mj = std::min(P2P_TILE_J, jb+nj-j);               //   Sources past mj have zero charge
+	  real_t Sj[P2P_TILE_J][4] = {}, trgj[P2P_TILE_J][4];
+	  for (int jj=0; jj<mj; jj++) {
+	    Sj[jj][0] = Bj.x[j+jj];
+	    Sj[jj][1] = Bj.y[j+jj];
+	    Sj[jj][2] = Bj.z[j+jj];
+	    Sj[jj][3] = Bj.q[j+jj];
+	  }
+	  if (mutual) {                                         //   If mutual, also add to the sources
+	    P2PTile<false,true>(xi, yi, zi, mi, index, j, Sj, pot, ax, ay, az, trgj);
+	    for (int jj=0; jj<mj; jj++) {
+	      Bj.pot[j+jj] += trgj[jj][0];
+	      Bj.ax[j+jj] -= trgj[jj][1];
+	      Bj.ay[j+jj] -= trgj[jj][2];
+	      Bj.az[j+jj] -= trgj[jj][3];
+	    }
+	  } else {                                              //   Else targets only
+	    P2PTile<false,false>(xi, yi, zi, mi, index, j, Sj, pot, ax, ay, az, NULL);
+	  }                                                     //   End if for mutual
+	}                                                       //  End loop over tiles of sources
+	for (int ii=0; ii<P2P_TILE_I; ii++) {                   //  Loop over target vectors in tile
+	  int nv = std::max(0, std::min(NSIMD, ni-i-ii*NSIMD));
+	  addPartial(pot[ii], &Bi.pot[ib+i+ii*NSIMD], nv);
+	  addPartial(ax[ii], &Bi.ax[ib+i+ii*NSIMD], nv);
+	  addPartial(ay[ii], &Bi.ay[ib+i+ii*NSIMD], nv);
+	  addPartial(az[ii], &Bi.az[ib+i+ii*NSIMD], nv);
+	}                                                       //  End loop over target vectors in tile
+      }                                                         // End loop over tiles of target vectors
+#else
+      for ( ; i<ni; i++) {
+	kreal_t pot = 0;
+	kreal_t ax = 0;
+	kreal_t ay = 0;
+	kreal_t az = 0;
+	for (int j=jb; j<jb+nj; j++) {
+	  real_t dx = Bi.x[ib+i] - Bj.x[j] - Xperiodic[0];
+	  real_t dy = Bi.y[ib+i] - Bj.y[j] - Xperiodic[1];
+	  real_t dz = Bi.z[ib+i] - Bj.z[j] - Xperiodic[2];
+	  real_t R2 = dx * dx + dy * dy + dz * dz + eps2;
+	  if (R2 != 0) {
+	    real_t invR2 = 1.0 / R2;
+	    real_t invR = Bi.q[ib+i] * Bj.q[j] * sqrt(invR2);
+	    invR2 *= invR;
+	    dx *= invR2;
+	    dy *= invR2;
+	    dz *= invR2;
+	    pot += invR;
+	    ax += dx;
+	    ay += dy;
+	    az += dz;
+	    if (mutual) {
+	      Bj.pot[j] += invR;
+	      Bj.ax[j] += dx;
+	      Bj.ay[j] += dy;
+	      Bj.az[j] += dz;
+	    }
+	  }
+	}
+	Bi.pot[ib+i] += pot;
+	Bi.ax[ib+i] -= ax;
+	Bi.ay[ib+i] -= ay;
+	Bi.az[ib+i] -= az;
+      }
+#endif
+    }
+
+    void P2P(C_iter C, BodiesSoA & B) {
+      int ib = B.begin(C);                                      // Leaves start at a multiple of NSIMD
+      int n = B.count(C);                                       // Padding has zero charge
+      int i = 0;
+#if EXAFMM_USE_SIMD
+      simdvec zero = 0.0;
+      for (i=0; i<n; i+=P2P_TILE_I*NSIMD) {                    // Loop over tiles of target vectors
+	simdvec xi[P2P_TILE_I], yi[P2P_TILE_I], zi[P2P_TILE_I], mi[P2P_TILE_I], index[P2P_TILE_I];
+	ksimdvec pot[P2P_TILE_I], ax[P2P_TILE_I], ay[P2P_TILE_I], az[P2P_TILE_I];
+	for (int ii=0; ii<P2P_TILE_I; ii++) {                   //  Loop over target vectors in tile
+	  int nv = std::max(0, std::min(NSIMD, n-i-ii*NSIMD));  //   Lanes past nv are masked by index
+	  index[ii] = SIMD<simdvec,0,NSIMD>::setIndex(i+ii*NSIMD);
+	  xi[ii] = loadPartial(&B.x[ib+i+ii*NSIMD], nv);
+	  yi[ii] = loadPartial(&B.y[ib+i+ii*NSIMD], nv);
+	  zi[ii] = loadPartial(&B.z[ib+i+ii*NSIMD], nv);
+	  mi[ii] = loadPartial(&B.q[ib+i+ii*NSIMD], nv);
+	  pot[ii] = ax[ii] = ay[ii] = az[ii] = zero;
+	}                                                       //  End loop over target vectors in tile
+	int jd = std::min(i+P2P_TILE_I*NSIMD, n);               //  Sources from jd on are past the diagonal
+	for (int j=i, mj; j<n; j+=mj) {                         //  Loop over tiles of sources
+	  mj = std::min(P2P_TILE_J, (j < jd ? jd : n) - j);     //   Sources past mj have zero charge
+	  real_t Sj[P2P_TILE_J][4] = {}, trgj[P2P_TILE_J][4];
+	  for (int jj=0; jj<mj; jj++) {
+	    Sj[jj][0] = B.x[ib+j+jj];
+	    Sj[jj][1] = B.y[ib+j+jj];
+	    Sj[jj][2] = B.z[ib+j+jj];
+	    Sj[jj][3] = B.q[ib+j+jj];
+	  }
+	  if (j < jd) {                                         //   If diagonal block, each pair from both sides
+	    P2PTile<true,false>(xi, yi, zi, mi, index, j, Sj, pot, ax, ay, az, NULL);
+	  } else {                                              //   Else mutual
+	    P2PTile<false,true>(xi, yi, zi, mi, index, j, Sj, pot, ax, ay, az, trgj);
+	    for (int jj=0; jj<mj; jj++) {
+	      B.pot[ib+j+jj] += trgj[jj][0];
+	      B.ax[ib+j+jj] -= trgj[jj][1];
+	      B.ay[ib+j+jj] -= trgj[jj][2];
+	      B.az[ib+j+jj] -= trgj[jj][3];
+	    }
+	  }                                                     //   End if for diagonal block
+	}                                                       //  End loop over tiles of sources
+	for (int ii=0; ii<P2P_TILE_I; ii++) {                   //  Loop over target vectors in tile
+	  int nv = std::max(0, std::min(NSIMD, n-i-ii*NSIMD));
+	  addPartial(pot[ii], &B.pot[ib+i+ii*NSIMD], nv);
+	  addPartial(ax[ii], &B.ax[ib+i+ii*NSIMD], nv);
+	  addPartial(ay[ii], &B.ay[ib+i+ii*NSIMD], nv);
+	  addPartial(az[ii], &B.az[ib+i+ii*NSIMD], nv);
+	}                                                       //  End loop over target vectors in tile
+      }                                                         // End loop over tiles of target vectors
+#else
+      for ( ; i<n; i++) {
+	kreal_t pot = 0;
+	kreal_t ax = 0;
+	kreal_t ay = 0;
+	kreal_t az = 0;
+	for (int j=i+1; j<n; j++) {
+	  real_t dx = B.x[ib+j] - B.x[ib+i];
+	  real_t dy = B.y[ib+j] - B.y[ib+i];
+	  real_t dz = B.z[ib+j] - B.z[ib+i];
+	  real_t R2 = dx * dx + dy * dy + dz * dz + eps2;
+	  if (R2 != 0) {
+	    real_t invR2 = 1.0 / R2;
+	    real_t invR = B.q[ib+i] * B.q[ib+j] * sqrt(invR2);
+	    invR2 *= invR;
+	    dx *= invR2;
+	    dy *= invR2;
+	    dz *= invR2;
+	    pot += invR;
+	    ax += dx;
+	    ay += dy;
+	    az += dz;
+	    B.pot[ib+j] += invR;
+	    B.ax[ib+j] -= dx;
+	    B.ay[ib+j] -= dy;
+	    B.az[ib+j] -= dz;
+	  }
+	}
+	B.pot[ib+i] += pot;
+	B.ax[ib+i] += ax;
+	B.ay[ib+i] += ay;
+	B.az[ib+i] += az;
+      }
+#endif
     }
   }
 }
@@ -1,4 +1,8 @@
 #include "kernel.h"
+#include <cstring>
+#ifndef EXAFMM_ROTATION
+#define EXAFMM_ROTATION 0                                       // Set to 1 to translate by rotation in O(p^3)
+#endif
 
 namespace exafmm {
   namespace kernel {
@@ -107,9 +111,150 @@ namespace exafmm {
       }                                                         // End loop over m in Ynm
     }
 
-    void setup() {}
+#if EXAFMM_ROTATION
+    real_t factorial[P];                                        // n!
+    real_t scaleNM[NTERM];                                      // sqrt((n - m)! * (n + m)!)
+    real_t sqrtNM[P][P];                                        // sqrt(n^2 - m^2)
+    real_t invSqrtNM[P][P];                                     // 1 / sqrt(n^2 - m^2), 0 for m = n
+    real_t sqrtBinom[P][2*P];                                   // sqrt((2n)! / ((n + m)! * (n - m)!)) at [n][n+m]
+    real_t coefA[P], coefB[P], coefC[P];                        // n(2n-1), 1/(n(n-1)), 1/((n-1)(2n-1))
+
+//! Wigner d-matrix \f$ d^n_{m'm}(\theta) \f$ for 0 <= m <= n, stored at d[n][P+m'][m]
+    void wigner(real_t theta, real_t d[P][2*P][P]) {
+      real_t x = std::cos(theta);                               // x = cos(theta)
+      real_t cpow[2*P], spow[2*P];                              // Powers of cos(theta/2) and sin(theta/2)
+      cpow[0] = spow[0] = 1;                                    // Initialize powers
+      for (int i=1; i<2*P; i++) {                               // Loop over powers
+	cpow[i] = cpow[i-1] * std::cos(theta / 2);              //  cos(theta/2)^i
+	spow[i] = spow[i-1] * std::sin(theta / 2);              //  sin(theta/2)^i
+      }                                                         // End loop over powers
+      for (int n=0; n<P; n++) {                                 // Loop over lowest degree of each (m', m)
+	for (int m=0; m<=n; m++) {                              //  Loop over m
+	  d[n][P+n][m] = sqrtBinom[n][n+m] * cpow[n+m] * spow[n-m] * oddOrEven(n-m);// m' = n
+	  d[n][P-n][m] = sqrtBinom[n][n+m] * cpow[n-m] * spow[n+m];// m' = -n
+	  if (n > 0) d[n-1][P+n][m] = d[n-1][P-n][m] = 0;       //   No degree below the lowest
+	}                                                       //  End loop over m
+	for (int mp=1-n; mp<n; mp++) {                          //  Loop over |m'| < m = n
+	  d[n][P+mp][n] = sqrtBinom[n][n+mp] * cpow[n+mp] * spow[n-mp];
+	  if (n > 0) d[n-1][P+mp][n] = 0;                       //   No degree below the lowest
+	}                                                       //  End loop over m'
+      }                                                         // End loop over lowest degree
+      if (P > 1) d[1][P][0] = x;                                // d^1_{00}
+      for (int n=2; n<P; n++) {                                 // Loop over n using recurrence relation
+	for (int mp=1-n; mp<n; mp++) {                          //  Loop over |m'| < n
+	  int amp = std::abs(mp);                               //   |m'|
+	  real_t a = coefA[n] * invSqrtNM[n][amp];              //   Coefficient of whole term
+	  real_t b = mp * coefB[n];                             //   Coefficient of m in first term
+	  real_t c = coefC[n] * sqrtNM[n-1][amp];               //   Coefficient of second term
+	  for (int m=0; m<n; m++) {                             //   Loop over m < n
+	    d[n][P+mp][m] = a * invSqrtNM[n][m] * ((x - m * b) * d[n-1][P+mp][m]
+						   - c * sqrtNM[n-1][m] * d[n-2][P+mp][m]);
+	  }                                                     //   End loop over m
+	}                                                       //  End loop over m'
+      }                                                         // End loop over n
+    }
+
+    const int NWIGNER = 64;                                     // Slots of the per-thread Wigner d-matrix cache
+
+//! Recently used Wigner d-matrices, direct mapped by the bits of theta
+//! Kept on the heap, since thread local storage is carved out of each thread's stack
+    struct WignerCache {
+      std::vector<real_t> theta;                                // Angle held by each slot, -1 if empty
+      std::vector<real_t> d;                                    // d-matrix of each slot, P*2P*P values apart
+      WignerCache() : theta(NWIGNER, -1), d(NWIGNER * P * 2 * P * P) {}// Not NaN, which -ffast-math ignores
+    };
+
+//! Wigner d-matrix for theta, computed only if this thread has not cached the same angle
+//! Translations between cells at the same relative position mostly share theta
+    const real_t (* cachedWigner(real_t theta))[2*P][P] {
+      static thread_local WignerCache cache;                    // One cache per thread, no locking
+      uint64_t bits = 0;                                        // Bits of theta
+      std::memcpy(&bits, &theta, sizeof(theta));                // Reinterpret angle as integer
+      int slot = (bits ^ (bits >> 23) ^ (bits >> 41)) % NWIGNER;// Hash of theta
+      real_t (* d)[2*P][P] = reinterpret_cast<real_t (*)[2*P][P]>(&cache.d[slot * P * 2 * P * P]);// d-matrix of slot
+      if (cache.theta[slot] != theta) {                         // If slot holds another angle
+	wigner(theta, d);                                       //  Compute d-matrix into slot
+	cache.theta[slot] = theta;                              //  Tag slot with its angle
+      }                                                         // End if for slot
+      return d;                                                 // Valid until the next call on this thread
+    }
+
+//! Rotate expansion A into the frame whose z axis points along (theta, phi), or back from it
+//! Coefficients are scaled by sqrt((n-m)!(n+m)!) (multipoles) or its inverse (locals) so that d applies directly
+    void rotate(const real_t d[P][2*P][P], const complex_t * eim, const complex_t * A, complex_t * B,
+		bool local, bool back) {
+      complex_t S[NTERM];                                       // Scaled coefficients
+      for (int n=0; n<P; n++) {                                 // Loop over n
+	for (int m=0; m<=n; m++) {                              //  Loop over m
+	  int nms = n * (n + 1) / 2 + m;                        //   Index of coefficient
+	  S[nms] = local ? A[nms] / scaleNM[nms] : A[nms] * scaleNM[nms];// Scale coefficient
+	  if (!back) S[nms] *= eim[m];                          //   Rotate about z axis by -phi
+	}                                                       //  End loop over m
+      }                                                         // End loop over n
+      for (int n=0; n<P; n++) {                                 // Loop over n
+	int ns = n * (n + 1) / 2;                               //  Index of m = 0
+	real_t Bre[P], Bim[P];                                  //  Rotated coefficients
+	for (int m=0; m<=n; m++) {                              //  Loop over m
+	  Bre[m] = d[n][P][m] * std::real(S[ns]);               //   Contribution of m' = 0
+	  Bim[m] = d[n][P][m] * std::imag(S[ns]);
+	}                                                       //  End loop over m
+	for (int mp=1; mp<=n; mp++) {                           //  Loop over m' > 0
+	  real_t sign = oddOrEven(mp);                          //   Coefficient of -m' is (-1)^m' conj
+	  real_t Sre = std::real(S[ns+mp]);                     //   Real part of coefficient
+	  real_t Sim = std::imag(S[ns+mp]);                     //   Imaginary part of coefficient
+	  if (back) {                                           //   If rotating back by -theta
+	    Sre *= sign;                                        //    d^n_{m'm}(-theta) = (-1)^(m'-m) d^n_{m'm}(theta)
+	    Sim *= sign;
+	  }                                                     //   End if for rotating back
+	  for (int m=0; m<=n; m++) {                            //   Loop over m
+	    real_t dp = d[n][P+mp][m];                          //    d for m'
+	    real_t dm = d[n][P-mp][m] * sign;                   //    d for -m'
+	    Bre[m] += (dp + dm) * Sre;                          //    Rotate about y axis
+	    Bim[m] += (dp - dm) * Sim;
+	  }                                                     //   End loop over m
+	}                                                       //  End loop over m' > 0
+	for (int m=0; m<=n; m++) {                              //  Loop over m
+	  complex_t b(Bre[m], Bim[m]);                          //   Rotated coefficient
+	  if (back) b *= real_t(oddOrEven(m)) * std::conj(eim[m]);//  Sign of m and rotate about z axis by phi
+	  B[ns+m] = local ? b * scaleNM[ns+m] : b / scaleNM[ns+m];// Unscale coefficient
+	}                                                       //  End loop over m
+      }                                                         // End loop over n
+    }
+
+//! Powers of exp(i * phi)
+    void evalPhase(real_t phi, complex_t * eim) {
+      eim[0] = 1;                                               // exp(0)
+      complex_t ei = std::exp(I * phi);                         // exp(i * phi)
+      for (int m=1; m<P; m++) eim[m] = eim[m-1] * ei;           // exp(i * m * phi)
+    }
+#endif
+
+    int order = P;
+
+    void setup() {
+      checkOrder(P, P);                                         // Spherical kernels are built for a single order
+#if EXAFMM_ROTATION
+      double fact[2*P];                                         // Factorials up to (2P-1)!
+      fact[0] = 1;                                              // 0!
+      for (int n=1; n<2*P; n++) fact[n] = fact[n-1] * n;        // n!
+      for (int n=0; n<P; n++) {                                 // Loop over n
+	factorial[n] = fact[n];                                 //  n!
+	coefA[n] = n * (2 * n - 1);                             //  Coefficients of recurrence relation
+	coefB[n] = n > 1 ? 1.0 / (n * (n - 1)) : 0;
+	coefC[n] = n > 1 ? 1.0 / ((n - 1) * (2 * n - 1)) : 0;
+	for (int m=0; m<=n; m++) {                              //  Loop over m
+	  scaleNM[n*(n+1)/2+m] = std::sqrt(fact[n-m] * fact[n+m]);//  Scale of rotated coefficients
+	  sqrtNM[n][m] = std::sqrt(real_t(n * n - m * m));      //   sqrt(n^2 - m^2)
+	  invSqrtNM[n][m] = m < n ? 1 / sqrtNM[n][m] : 0;       //   1 / sqrt(n^2 - m^2)
+	}                                                       //  End loop over m
+	for (int m=-n; m<=n; m++) {                             //  Loop over m
+	  sqrtBinom[n][n+m] = std::sqrt(fact[2*n] / (fact[n+m] * fact[n-m]));// Coefficient of lowest degree
+	}                                                       //  End loop over m
+      }                                                         // End loop over n
+#endif
+    }
 
-    void P2M(C_iter C) {
+    void P2M(C_iter C, vecP & M) {
       complex_t Ynm[P*P], YnmTheta[P*P];
       for (B_iter B=C->BODY; B!=C->BODY+C->NBODY; B++) {
 	vec3 dX = B->X - C->X;
@@ -120,15 +265,42 @@ namespace exafmm {
 	  for (int m=0; m<=n; m++) {
 	    int nm  = n * n + n - m;
 	    int nms = n * (n + 1) / 2 + m;
-	    C->M[nms] += B->SRC * Ynm[nm];
+	    M[nms] += B->SRC * Ynm[nm];
 	  }
 	}
       }
     }
 
-    void M2M(C_iter Ci, C_iter C0) {
+    void M2M(C_iter Ci, C_iter C0, vecP * M0) {
+      vecP & Mi = M0[Ci-C0];
+#if EXAFMM_ROTATION
+      complex_t eim[P], A[NTERM], B[NTERM];
+      for (C_iter Cj=C0+Ci->ICHILD; Cj!=C0+Ci->ICHILD+Ci->NCHILD; Cj++) {
+	vec3 dX = Ci->X - Cj->X;
+	real_t rho, theta, phi;
+	cart2sph(rho, theta, phi, dX);
+	const real_t (* d)[2*P][P] = cachedWigner(theta);
+	evalPhase(phi, eim);
+	real_t rhon[P];
+	rhon[0] = 1;
+	for (int n=1; n<P; n++) rhon[n] = rhon[n-1] * rho;
+	rotate(d, eim, &M0[Cj-C0][0], A, false, false);
+	for (int j=0; j<P; j++) {
+	  for (int k=0; k<=j; k++) {
+	    complex_t M = 0;
+	    for (int n=0; n<=j-k; n++) {
+	      M += A[(j-n)*(j-n+1)/2+k] * (rhon[n] / factorial[n]);
+	    }
+	    B[j*(j+1)/2+k] = M;
+	  }
+	}
+	rotate(d, eim, B, A, false, true);
+	for (int i=0; i<NTERM; i++) Mi[i] += A[i];
+      }
+#else
       complex_t Ynm[P*P], YnmTheta[P*P];
       for (C_iter Cj=C0+Ci->ICHILD; Cj!=C0+Ci->ICHILD+Ci->NCHILD; Cj++) {
+	const vecP & Mj = M0[Cj-C0];
 	vec3 dX = Ci->X - Cj->X;
 	real_t rho, alpha, beta;
 	cart2sph(rho, alpha, beta, dX);
@@ -141,21 +313,73 @@ namespace exafmm {
 	      for (int m=std::max(-n,-j+k+n); m<=std::min(k-1,n); m++) {
 		int jnkms = (j - n) * (j - n + 1) / 2 + k - m;
 		int nm    = n * n + n - m;
-		M += Cj->M[jnkms] * Ynm[nm] * real_t(ipow2n(m) * oddOrEven(n));
+		M += Mj[jnkms] * Ynm[nm] * real_t(ipow2n(m) * oddOrEven(n));
 	      }
 	      for (int m=k; m<=std::min(n,j+k-n); m++) {
 		int jnkms = (j - n) * (j - n + 1) / 2 - k + m;
 		int nm    = n * n + n - m;
-		M += std::conj(Cj->M[jnkms]) * Ynm[nm] * real_t(oddOrEven(k+n+m));
+		M += std::conj(Mj[jnkms]) * Ynm[nm] * real_t(oddOrEven(k+n+m));
 	      }
 	    }
-	    Ci->M[jks] += M;
+	    Mi[jks] += M;
 	  }
 	}
       }
+#endif
     }
 
-    void M2L(C_iter Ci, C_iter Cj, bool mutual) {
+#if EXAFMM_ROTATION
+//! M2L along the z axis of the rotated frame; the source lies at -rho (or +rho if flip) on the z axis
+    void M2Lz(real_t rho, const complex_t * M, complex_t * L, bool flip) {
+      real_t coef[P];                                           // n! / rho^(n+1)
+      coef[0] = 1 / rho;
+      for (int n=1; n<P; n++) coef[n] = coef[n-1] * n / rho;
+      for (int j=0; j<P; j++) {
+	for (int k=0; k<=j; k++) {
+	  complex_t Lz = 0;
+	  for (int n=k; n<P-j; n++) {
+	    Lz += M[n*(n+1)/2+k] * (coef[j+n] * oddOrEven(flip ? j+k : n+k));
+	  }
+	  L[j*(j+1)/2+k] = Lz;
+	}
+      }
+    }
+#endif
+
+    template <typename J_iter>
+    void M2L(C_iter Ci, J_iter Cj, const vecP & Mi, vecP & Li, const vecP & Mj, vecP * Lj) {
+      bool mutual = Lj != NULL;
+#if EXAFMM_ROTATION
+      complex_t eim[P], MI[NTERM], MJ[NTERM], A[NTERM], B[NTERM];
+      vec3 dX = Ci->X - Cj->X - Xperiodic;
+      real_t rho, theta, phi;
+      cart2sph(rho, theta, phi, dX);
+      const real_t (* d)[2*P][P] = cachedWigner(theta);
+      evalPhase(phi, eim);
+      for (int i=0; i<NTERM; i++) {
+	MI[i] = Mi[i];
+	MJ[i] = Mj[i];
+      }
+#if EXAFMM_MASS
+      real_t mass = std::real(Mi[0] * Mj[0]);
+      for (int i=0; i<NTERM; i++) {
+	MI[i] *= mass;
+	MJ[i] *= mass;
+      }
+      MI[0] = MJ[0] = mass;
+#endif
+      rotate(d, eim, MJ, A, false, false);
+      M2Lz(rho, A, B, false);
+      rotate(d, eim, B, A, true, true);
+      for (int i=0; i<NTERM; i++) Li[i] += A[i];
+      if (mutual) {
+	rotate(d, eim, MI, A, false, false);
+	M2Lz(rho, A, B, true);
+	rotate(d, eim, B, A, true, true);
+	for (int i=0; i<NTERM; i++) (*Lj)[i] += A[i];
+      }
+#else
+
       complex_t Ynmi[P*P], Ynmj[P*P];
       vec3 dX = Ci->X - Cj->X - Xperiodic;
       real_t rho, alpha, beta;
@@ -164,17 +388,17 @@ namespace exafmm {
       if (mutual) evalLocal(rho, alpha+M_PI, beta, Ynmj);
       for (int j=0; j<P; j++) {
 #if EXAFMM_MASS
-	real_t Cnm = std::real(Ci->M[0] * Cj->M[0]) * oddOrEven(j);
+	real_t Cnm = std::real(Mi[0] * Mj[0]) * oddOrEven(j);
 #else
 	real_t Cnm = oddOrEven(j);
 #endif
 	for (int k=0; k<=j; k++) {
 	  int jks = j * (j + 1) / 2 + k;
-	  complex_t Li = 0, Lj = 0;
+	  complex_t LI = 0, LJ = 0;
 #if EXAFMM_MASS
 	  int jk = j * j + j - k;
-	  Li += Cnm * Ynmi[jk];
-	  if (mutual) Lj += Cnm * Ynmj[jk];
+	  LI += Cnm * Ynmi[jk];
+	  if (mutual) LJ += Cnm * Ynmj[jk];
 	  for (int n=1; n<P-j; n++) {
 #else
 	  for (int n=0; n<P-j; n++) {
@@ -182,33 +406,65 @@ namespace exafmm {
 	    for (int m=-n; m<0; m++) {
 	      int nms  = n * (n + 1) / 2 - m;
 	      int jnkm = (j + n) * (j + n) + j + n + m - k;
-	      Li += std::conj(Cj->M[nms]) * Cnm * Ynmi[jnkm];
-	      if (mutual) Lj += std::conj(Ci->M[nms]) * Cnm * Ynmj[jnkm];
+	      LI += std::conj(Mj[nms]) * Cnm * Ynmi[jnkm];
+	      if (mutual) LJ += std::conj(Mi[nms]) * Cnm * Ynmj[jnkm];
 	    }
 	    for (int m=0; m<=n; m++) {
 	      int nms  = n * (n + 1) / 2 + m;
 	      int jnkm = (j + n) * (j + n) + j + n + m - k;
 	      real_t Cnm2 = Cnm * oddOrEven((k-m)*(k<m)+m);
-	      Li += Cj->M[nms] * Cnm2 * Ynmi[jnkm];
-	      if (mutual) Lj += Ci->M[nms] * Cnm2 * Ynmj[jnkm];
+	      LI += Mj[nms] * Cnm2 * Ynmi[jnkm];
+	      if (mutual) LJ += Mi[nms] * Cnm2 * Ynmj[jnkm];
 	    }
 	  }
-	  Ci->L[jks] += Li;
-	  if (mutual) Cj->L[jks] += Lj;
+	  Li[jks] += LI;
+	  if (mutual) (*Lj)[jks] += LJ;
 	}
       }
+#endif
     }
+    template void M2L<C_iter>(C_iter Ci, C_iter Cj, const vecP & Mi, vecP & Li, const vecP & Mj, vecP * Lj);
+    template void M2L<M_iter>(C_iter Ci, M_iter Cj, const vecP & Mi, vecP & Li, const vecP & Mj, vecP * Lj);
 
-    void L2L(C_iter Ci, C_iter C0) {
-      complex_t Ynm[P*P], YnmTheta[P*P];
+    //! M2L from a list of source cells to Ci
+    void M2LBatch(C_iter Ci, const C_iter * Cj, int numCj, C_iter Cj0, const vecP & Mi, vecP & Li, const vecP * Mj) {
+      for (int j=0; j<numCj; j++) M2L(Ci, Cj[j], Mi, Li, Mj[Cj[j]-Cj0], NULL);
+    }
+
+    void L2L(C_iter Ci, C_iter C0, const vecP * M0, vecP * L0) {
       C_iter Cj = C0 + Ci->IPARENT;
+      vecP & Li = L0[Ci-C0];
+      const vecP & Lj = L0[Ci->IPARENT];
       vec3 dX = Ci->X - Cj->X;
+#if EXAFMM_MASS
+      Li /= M0[Ci-C0][0];
+#endif
+#if EXAFMM_ROTATION
+      complex_t eim[P], A[NTERM], B[NTERM];
+      real_t rho, theta, phi;
+      cart2sph(rho, theta, phi, dX);
+      const real_t (* d)[2*P][P] = cachedWigner(theta);
+      evalPhase(phi, eim);
+      real_t rhon[P];
+      rhon[0] = 1;
+      for (int n=1; n<P; n++) rhon[n] = -rhon[n-1] * rho / n;
+      rotate(d, eim, &Lj[0], A, true, false);
+      for (int j=0; j<P; j++) {
+	for (int k=0; k<=j; k++) {
+	  complex_t L = 0;
+	  for (int n=j; n<P; n++) {
+	    L += A[n*(n+1)/2+k] * rhon[n-j];
+	  }
+	  B[j*(j+1)/2+k] = L;
+	}
+      }
+      rotate(d, eim, B, A, true, true);
+      for (int i=0; i<NTERM; i++) Li[i] += A[i];
+#else
+      complex_t Ynm[P*P], YnmTheta[P*P];
       real_t rho, alpha, beta;
       cart2sph(rho, alpha, beta, dX);
       evalMultipole(rho, alpha, beta, Ynm, YnmTheta);
-#if EXAFMM_MASS
-      Ci->L /= Ci->M[0];
-#endif
       for (int j=0; j<P; j++) {
 	for (int k=0; k<=j; k++) {
 	  int jks = j * (j + 1) / 2 + k;
@@ -217,22 +473,23 @@ namespace exafmm {
 	    for (int m=j+k-n; m<0; m++) {
 	      int jnkm = (n - j) * (n - j) + n - j + m - k;
 	      int nms  = n * (n + 1) / 2 - m;
-	      L += std::conj(Cj->L[nms]) * Ynm[jnkm] * real_t(oddOrEven(k));
+	      L += std::conj(Lj[nms]) * Ynm[jnkm] * real_t(oddOrEven(k));
 	    }
 	    for (int m=0; m<=n; m++) {
 	      if( n-j >= abs(m-k) ) {
 		int jnkm = (n - j) * (n - j) + n - j + m - k;
 		int nms  = n * (n + 1) / 2 + m;
-		L += Cj->L[nms] * Ynm[jnkm] * real_t(oddOrEven((m-k)*(m<k)));
+		L += Lj[nms] * Ynm[jnkm] * real_t(oddOrEven((m-k)*(m<k)));
 	      }
 	    }
 	  }
-	  Ci->L[jks] += L;
+	  Li[jks] += L;
 	}
       }
+#endif
     }
 
-    void L2P(C_iter Ci) {
+    void L2P(C_iter Ci, const vecP & L) {
       complex_t Ynm[P*P], YnmTheta[P*P];
       for (B_iter B=Ci->BODY; B!=Ci->BODY+Ci->NBODY; B++) {
 	vec3 dX = B->X - Ci->X + EPS;
@@ -245,16 +502,16 @@ namespace exafmm {
 	for (int n=0; n<P; n++) {
 	  int nm  = n * n + n;
 	  int nms = n * (n + 1) / 2;
-	  B->TRG[0] += std::real(Ci->L[nms] * Ynm[nm]);
-	  spherical[0] += std::real(Ci->L[nms] * Ynm[nm]) / r * n;
-	  spherical[1] += std::real(Ci->L[nms] * YnmTheta[nm]);
+	  B->TRG[0] += std::real(L[nms] * Ynm[nm]);
+	  spherical[0] += std::real(L[nms] * Ynm[nm]) / r * n;
+	  spherical[1] += std::real(L[nms] * YnmTheta[nm]);
 	  for( int m=1; m<=n; m++) {
 	    nm  = n * n + n + m;
 	    nms = n * (n + 1) / 2 + m;
-	    B->TRG[0] += 2 * std::real(Ci->L[nms] * Ynm[nm]);
-	    spherical[0] += 2 * std::real(Ci->L[nms] * Ynm[nm]) / r * n;
-	    spherical[1] += 2 * std::real(Ci->L[nms] * YnmTheta[nm]);
-	    spherical[2] += 2 * std::real(Ci->L[nms] * Ynm[nm] * I) * m;
+	    B->TRG[0] += 2 * std::real(L[nms] * Ynm[nm]);
+	    spherical[0] += 2 * std::real(L[nms] * Ynm[nm]) / r * n;
+	    spherical[1] += 2 * std::real(L[nms] * YnmTheta[nm]);
+	    spherical[2] += 2 * std::real(L[nms] * Ynm[nm] * I) * m;
 	  }
 	}
 	sph2cart(r, theta, phi, spherical, cartesian);
@@ -28,7 +28,8 @@ namespace exafmm {
 
     void downwardPass() {
       logger::startTimer("Traverse");
-      M2L();
+      if (useFFT) M2LFFT();
+      else M2L();
       logger::stopTimer("Traverse", 0);
 
       logger::startTimer("Downward pass");
@@ -0,0 +1,73 @@
+#include <cassert>
+#include <cmath>
+#include <complex>
+#include <vector>
+
+namespace exafmm {
+  //! Self-contained mixed-radix FFT for lengths whose prime factors are 2, 3 and 5
+  class FFT {
+  public:
+    int n;                                                      //!< Length of transform
+    std::vector<complex_t> twiddle;                             //!< exp(-2 pi i j / n)
+
+  private:
+    //! Recursive decimation in time; reads in with stride, writes out contiguously
+    void transform(complex_t *out, const complex_t *in, int len, int stride) const {
+      if( len == 1 ) {
+	out[0] = in[0];
+	return;
+      }
+      int radix = len % 2 == 0 ? 2 : len % 3 == 0 ? 3 : 5;
+      int m = len / radix;
+      for( int q=0; q<radix; q++ ) transform(out + q * m, in + q * stride, m, stride * radix);
+      int step = n / len;
+      complex_t tmp[5];
+      for( int k=0; k<m; k++ ) {
+	for( int q=0; q<radix; q++ ) tmp[q] = out[q*m+k] * twiddle[q*k*step];
+	for( int u=0; u<radix; u++ ) {
+	  complex_t sum = 0;
+	  for( int q=0; q<radix; q++ ) sum += tmp[q] * twiddle[(q*u*m*step)%n];
+	  out[u*m+k] = sum;
+	}
+      }
+    }
+
+  public:
+    FFT(int _n) : n(_n), twiddle(_n) {
+      int r = n;
+      while( r % 2 == 0 ) r /= 2;
+      while( r % 3 == 0 ) r /= 3;
+      while( r % 5 == 0 ) r /= 5;
+      assert( r == 1 );
+      for( int j=0; j<n; j++ ) twiddle[j] = std::exp(complex_t(0,-2*M_PI*j/n));
+    }
+
+    //! Smallest length with factors 2, 3 and 5 only that is at least m
+    static int size(int m) {
+      for( int s=m; ; s++ ) {
+	int r = s;
+	while( r % 2 == 0 ) r /= 2;
+	while( r % 3 == 0 ) r /= 3;
+	while( r % 5 == 0 ) r /= 5;
+	if( r == 1 ) return s;
+      }
+    }
+
+    //! Unnormalized in-place 3D transform of an n^3 grid, x fastest; the inverse uses exp(+2 pi i j / n)
+    void transform3(complex_t *grid, bool inverse) const {
+      std::vector<complex_t> line(n), work(n);
+      int stride[3] = {1, n, n * n};
+      for( int axis=0; axis<3; axis++ ) {
+	int s = stride[axis];
+	for( int a=0; a<n; a++ ) {
+	  for( int b=0; b<n; b++ ) {
+	    complex_t *first = grid + a * stride[(axis+1)%3] + b * stride[(axis+2)%3];
+	    for( int i=0; i<n; i++ ) line[i] = inverse ? std::conj(first[i*s]) : first[i*s];
+	    transform(&work[0], &line[0], n, 1);
+	    for( int i=0; i<n; i++ ) first[i*s] = inverse ? std::conj(work[i]) : work[i];
+	  }
+	}
+      }
+    }
+  };
+}
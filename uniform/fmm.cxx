@@ -4,7 +4,6 @@
 #include "build_tree.h"
 #include "dataset.h"
 #include "ewald.h"
-#include "traversal.h"
 #include "tree_mpi.h"
 #include "up_down_pass.h"
 #include "verify.h"
@@ -30,7 +29,6 @@ int main(int argc, char ** argv) {
   BuildTree buildTree(args.ncrit, args.nspawn);
   Dataset data;
   Ewald ewald(ksize, alpha, sigma, cutoff, cycle);
-  Traversal traversal(args.nspawn, args.images);
   UpDownPass upDownPass(args.theta, args.useRmax, args.useRopt);
 #if EXAFMM_SERIAL
   SerialFMM FMM;
@@ -50,10 +48,11 @@ int main(int argc, char ** argv) {
   }
 
   FMM.allocate(numBodies, maxLevel, numImages);
+  FMM.useFFT = args.fft;
   args.verbose &= FMM.MPIRANK == 0;
   logger::verbose = args.verbose;
   logger::printTitle("FMM Parameters");
-  args.print(logger::stringLength, EXAFMM_PP);
+  args.print(logger::stringLength, EXAFMM_PP, std::cout);
 
   logger::printTitle("FMM Profiling");
   logger::startTimer("Total FMM");
@@ -61,7 +60,10 @@ int main(int argc, char ** argv) {
   FMM.partitioner(gatherLevel);
   logger::stopTimer("Partition");
 
-  for( int it=0; it<1; it++ ) {
+  const int numPasses = args.fft ? 2 : 1;                      // With -F a second pass with the table M2L is the reference
+  Bodies fftBodies;
+  for( int it=0; it<numPasses; it++ ) {
+    FMM.useFFT = args.fft && it == 0;
     int ix[3] = {0, 0, 0};
     FMM.R0 = 0.5 * cycle / FMM.numPartition[FMM.maxGlobLevel][0];
     for_3d FMM.RGlob[d] = FMM.R0 * FMM.numPartition[FMM.maxGlobLevel][d];
@@ -79,6 +81,7 @@ int main(int argc, char ** argv) {
     average /= FMM.numBodies;
     for( int i=0; i<FMM.numBodies; i++ ) {
       FMM.Jbodies[i][3] -= average;
+      for_4d FMM.Ibodies[i][d] = 0;
     }
   
     logger::startTimer("Grow tree");
@@ -122,6 +125,31 @@ int main(int argc, char ** argv) {
 #endif
   
     FMM.downwardPass();
+
+    if( numPasses == 2 ) {
+      Bodies bodies(FMM.numBodies);
+      B_iter B = bodies.begin();
+      for (int b=0; b<FMM.numBodies; b++, B++) {
+        B->SRC = FMM.Jbodies[b][3];
+        for_4d B->TRG[d] = FMM.Ibodies[b][d];
+      }
+      if( it == 0 ) {
+        fftBodies = bodies;
+      } else {
+        Verify verify;
+        double diff[4] = {verify.getDifScalar(fftBodies, bodies), verify.getNrmScalar(bodies),
+                          verify.getDifVector(fftBodies, bodies), verify.getNrmVector(bodies)};
+#if EXAFMM_SERIAL
+#else
+        double diffGlob[4];
+        MPI_Reduce(diff, diffGlob, 4, MPI_DOUBLE, MPI_SUM, 0, MPI_COMM_WORLD);
+        for_4d diff[d] = diffGlob[d];
+#endif
+        logger::printTitle("FFT vs. table M2L");
+        verify.print("Rel. L2 Error (pot)",std::sqrt(diff[0]/diff[1]));
+        verify.print("Rel. L2 Error (acc)",std::sqrt(diff[2]/diff[3]));
+      }
+    }
     /*
     logger::stopTimer("Total FMM", 0);
 
@@ -4,14 +4,20 @@
 #include <fstream>
 #include <iostream>
 #include <omp.h>
+#include <vector>
 
+#ifndef EXAFMM_PP
 #define EXAFMM_PP 6
+#endif
 const int DP2P = 1; // Use 1 for parallel
 const int DM2L = 1; // Use 1 for parallel
+const int M2LRANGE = 2 * DM2L + 1; // Largest offset between well-separated cells in one dimension
+const int M2LWIDTH = 2 * M2LRANGE + 1;
 const int MTERM = EXAFMM_PP*(EXAFMM_PP+1)*(EXAFMM_PP+2)/6;
 const int LTERM = (EXAFMM_PP+1)*(EXAFMM_PP+2)*(EXAFMM_PP+3)/6;
 
 #include "core.h"
+#include "fft.h"
 
 #define for_3d for (int d=0; d<3; d++)
 #define for_4d for (int d=0; d<4; d++)
@@ -37,6 +43,7 @@ namespace exafmm {
     int numSendLeafs;
     int MPISIZE;
     int MPIRANK;
+    bool useFFT;
 
     real_t X0[3];
     real_t R0;
@@ -83,6 +90,27 @@ namespace exafmm {
       return ix[0] + (ix[1] + ix[2] * numPartition[level][1]) * numPartition[level][0];
     }
 
+    inline int getM2LOffset(const int *dx) const {
+      return ((dx[2] + M2LRANGE) * M2LWIDTH + dx[1] + M2LRANGE) * M2LWIDTH + dx[0] + M2LRANGE;
+    }
+
+    //! M2L coefficients of every offset between cells of the given diameter, indexed by getM2LOffset
+    void getM2LCoef(real_t (*C)[LTERM], real_t diameter) const {
+      int dx[3];
+      for( dx[2]=-M2LRANGE; dx[2]<=M2LRANGE; dx[2]++ ) {
+	for( dx[1]=-M2LRANGE; dx[1]<=M2LRANGE; dx[1]++ ) {
+	  for( dx[0]=-M2LRANGE; dx[0]<=M2LRANGE; dx[0]++ ) {
+	    if( dx[0] == 0 && dx[1] == 0 && dx[2] == 0 ) continue;
+	    real_t dX[3];
+	    for_3d dX[d] = dx[d] * diameter;
+	    real_t invR2 = 1. / (dX[0] * dX[0] + dX[1] * dX[1] + dX[2] * dX[2]);
+	    real_t invR  = sqrt(invR2);
+	    getCoef(C[getM2LOffset(dx)],dX,invR2,invR);
+	  }
+	}
+      }
+    }
+
     void P2P(int ibegin, int iend, int jbegin, int jend, real_t *periodic) const {
       for( int i=ibegin; i<iend; i++ ) {
 	real_t Po = 0, Fx = 0, Fy = 0, Fz = 0;
@@ -200,6 +228,7 @@ namespace exafmm {
       int ixc[3];
       int DM2LC = DM2L;
       getGlobIndex(ixc,MPIRANK,maxGlobLevel);
+      real_t (*C)[LTERM] = new real_t [M2LWIDTH*M2LWIDTH*M2LWIDTH][LTERM];
       for( int lev=1; lev<=maxLevel; lev++ ) {
 	if (lev==maxLevel) DM2LC = DP2P;
 	int levelOffset = ((1 << 3 * lev) - 1) / 7;
@@ -214,6 +243,7 @@ namespace exafmm {
 	  for_3d nxmax[d] += (nunitGlob[d] >> 1);
 	}
 	real_t diameter = 2 * R0 / (1 << lev);
+	getM2LCoef(C,diameter);
 #pragma omp parallel for
 	for( int i=0; i<(1 << 3 * lev); i++ ) {
 	  real_t L[LTERM];
@@ -241,15 +271,9 @@ namespace exafmm {
 		  int rankOffset = (jxp[0] + 3 * jxp[1] + 9 * jxp[2]) * numCells;
 #endif
 		  j += rankOffset;
-		  real_t M[MTERM];
-		  for_m M[m] = Multipole[j][m];
-		  real_t dX[3];
-		  for_3d dX[d] = (ix[d] - jx[d]) * diameter;
-		  real_t invR2 = 1. / (dX[0] * dX[0] + dX[1] * dX[1] + dX[2] * dX[2]);
-		  real_t invR  = sqrt(invR2);
-		  real_t C[LTERM];
-		  getCoef(C,dX,invR2,invR);
-		  M2LSum(L,C,M);
+		  int dx[3];
+		  for_3d dx[d] = ix[d] - jx[d];
+		  M2LSum(L,C[getM2LOffset(dx)],Multipole[j]);
 		}
 	      }
 	    }
@@ -257,6 +281,174 @@ namespace exafmm {
 	  for_l Local[i+levelOffset][l] += L[l];
 	}
       }
+      delete[] C;
+    }
+
+    //! Triplets (l, m, l+m) of the terms contracted by M2LSum
+    void getM2LPairs(std::vector<int> & pairs) const {
+      int exponent[LTERM][3];
+      int index[EXAFMM_PP+1][EXAFMM_PP+1][EXAFMM_PP+1];
+      for( int n=0, l=0; n<=EXAFMM_PP; n++ ) {
+	for( int a=n; a>=0; a-- ) {
+	  for( int b=n-a; b>=0; b--, l++ ) {
+	    exponent[l][0] = a;
+	    exponent[l][1] = b;
+	    exponent[l][2] = n - a - b;
+	    index[a][b][n-a-b] = l;
+	  }
+	}
+      }
+      pairs.clear();
+      for_l {
+	for_m {
+	  int e[3];
+	  for_3d e[d] = exponent[l][d] + exponent[m][d];
+	  if( e[0] + e[1] + e[2] > EXAFMM_PP ) continue;
+	  pairs.push_back(l);
+	  pairs.push_back(m);
+	  pairs.push_back(index[e[0]][e[1]][e[2]]);
+	}
+      }
+    }
+
+    //! M2L as a convolution over the level grid, evaluated with FFTs
+    //! Cells are split by their position in the parent; for each of the 8 positions the multipoles form a grid
+    //! over the parents, and the kernel between positions c and s only depends on c - s and the parent offset
+    //! Memory: Mhat and Lhat hold 8*(MTERM+LTERM)*nf^3 complex values, nf >= 2^(lev-1)+2*DM2L; they live for one
+    //! level, so the finest level sets the peak (about 0.8 GB at P=6 with 6 levels, 5 GB with 7)
+    void M2LFFT() const {
+      const int ND = 2 * DM2L + 1;
+      std::vector<int> pairs;
+      getM2LPairs(pairs);
+      const int numPairs = pairs.size() / 3;
+      int ixc[3];
+      int DM2LC = DM2L;
+      getGlobIndex(ixc,MPIRANK,maxGlobLevel);
+      for( int lev=1; lev<=maxLevel; lev++ ) {
+	if (lev==maxLevel) DM2LC = DP2P;
+	int levelOffset = ((1 << 3 * lev) - 1) / 7;
+	int nunit = 1 << lev;
+	int nunitGlob[3];
+	for_3d nunitGlob[d] = nunit * numPartition[maxGlobLevel][d];
+	int nxmin[3], nxmax[3];
+	for_3d nxmin[d] = -ixc[d] * (nunit >> 1);
+	for_3d nxmax[d] = (nunitGlob[d] >> 1) + nxmin[d] - 1;
+	if( numImages != 0 ) {
+	  for_3d nxmin[d] -= (nunitGlob[d] >> 1);
+	  for_3d nxmax[d] += (nunitGlob[d] >> 1);
+	}
+	real_t diameter = 2 * R0 / (1 << lev);
+	int nparent = nunit >> 1;
+	FFT fft(FFT::size(nparent + 2 * DM2L));
+	const int nf = fft.n;
+	const int nf3 = nf * nf * nf;
+	std::vector<complex_t> Mhat(8 * MTERM * nf3, complex_t(0)), Lhat(8 * LTERM * nf3);
+#pragma omp parallel for
+	for( int s=0; s<8; s++ ) {
+	  int jq[3];
+	  for( jq[2]=-DM2L; jq[2]<nparent+DM2L; jq[2]++ ) {
+	    for( jq[1]=-DM2L; jq[1]<nparent+DM2L; jq[1]++ ) {
+	      for( jq[0]=-DM2L; jq[0]<nparent+DM2L; jq[0]++ ) {
+		if(jq[0] < nxmin[0] || nxmax[0] < jq[0] ||
+		   jq[1] < nxmin[1] || nxmax[1] < jq[1] ||
+		   jq[2] < nxmin[2] || nxmax[2] < jq[2]) continue;
+		int jx[3];
+		for_3d jx[d] = 2 * jq[d] + ((s >> d) & 1);
+		int jxp[3];
+		for_3d jxp[d] = (jx[d] + nunit) % nunit;
+		int j = getKey(jxp,lev);
+		for_3d jxp[d] = (jx[d] + nunit) / nunit;
+#if EXAFMM_SERIAL
+		int rankOffset = 13 * numCells;
+#else
+		int rankOffset = (jxp[0] + 3 * jxp[1] + 9 * jxp[2]) * numCells;
+#endif
+		j += rankOffset;
+		int g = ((jq[2] + DM2L) * nf + jq[1] + DM2L) * nf + jq[0] + DM2L;
+		for_m Mhat[(s*MTERM+m)*nf3+g] = Multipole[j][m];
+	      }
+	    }
+	  }
+	}
+#pragma omp parallel for
+	for( int f=0; f<8*MTERM; f++ ) fft.transform3(&Mhat[f*nf3], false);
+	std::vector<real_t> C(ND*ND*ND*27*LTERM);
+	std::vector<int> farD(ND*ND*ND*27, 0);
+	for( int id=0; id<ND*ND*ND; id++ ) {
+	  for( int idelta=0; idelta<27; idelta++ ) {
+	    int dx[3] = {2 * (id % ND - DM2L) + idelta % 3 - 1,
+			 2 * (id / ND % ND - DM2L) + idelta / 3 % 3 - 1,
+			 2 * (id / ND / ND - DM2L) + idelta / 9 - 1};
+	    if(dx[0] < -DM2LC || DM2LC < dx[0] ||
+	       dx[1] < -DM2LC || DM2LC < dx[1] ||
+	       dx[2] < -DM2LC || DM2LC < dx[2]) {
+	      farD[id*27+idelta] = 1;
+	      real_t dX[3];
+	      for_3d dX[d] = dx[d] * diameter;
+	      real_t invR2 = 1. / (dX[0] * dX[0] + dX[1] * dX[1] + dX[2] * dX[2]);
+	      real_t invR  = sqrt(invR2);
+	      getCoef(&C[(id*27+idelta)*LTERM],dX,invR2,invR);
+	    }
+	  }
+	}
+#pragma omp parallel for schedule(dynamic)
+	for( int k=0; k<nf3; k++ ) {
+	  int kx = k % nf, ky = k / nf % nf, kz = k / nf / nf;
+	  if( kz > nf / 2 ) continue;
+	  complex_t w[ND*ND*ND];
+	  for( int id=0; id<ND*ND*ND; id++ ) {
+	    int phase = kx * (id % ND - DM2L) + ky * (id / ND % ND - DM2L) + kz * (id / ND / ND - DM2L);
+	    w[id] = fft.twiddle[(phase % nf + nf) % nf];
+	  }
+	  complex_t M[8][MTERM], L[8][LTERM], K[LTERM];
+	  for( int s=0; s<8; s++ ) {
+	    for_m M[s][m] = Mhat[(s*MTERM+m)*nf3+k];
+	    for_l L[s][l] = 0;
+	  }
+	  for( int idelta=0; idelta<27; idelta++ ) {
+	    int delta[3] = {idelta % 3 - 1, idelta / 3 % 3 - 1, idelta / 9 - 1};
+	    for_l K[l] = 0;
+	    for( int id=0; id<ND*ND*ND; id++ ) {
+	      if( !farD[id*27+idelta] ) continue;
+	      const real_t *Cd = &C[(id*27+idelta)*LTERM];
+	      for_l K[l] += w[id] * Cd[l];
+	    }
+	    for( int c=0; c<8; c++ ) {
+	      int s = 0;
+	      bool valid = true;
+	      for_3d {
+		int sd = ((c >> d) & 1) - delta[d];
+		valid &= sd == 0 || sd == 1;
+		s |= (sd & 1) << d;
+	      }
+	      if( !valid ) continue;
+	      for( int p=0; p<numPairs; p++ ) {
+		L[c][pairs[3*p]] += K[pairs[3*p+2]] * M[s][pairs[3*p+1]];
+	      }
+	    }
+	  }
+	  for( int c=0; c<8; c++ ) {
+	    for_l Lhat[(c*LTERM+l)*nf3+k] = L[c][l];
+	  }
+	}
+#pragma omp parallel for
+	for( int k=0; k<nf3; k++ ) {
+	  int kx = k % nf, ky = k / nf % nf, kz = k / nf / nf;
+	  if( kz <= nf / 2 ) continue;
+	  int kn = (((nf - kz) % nf) * nf + (nf - ky) % nf) * nf + (nf - kx) % nf;
+	  for( int f=0; f<8*LTERM; f++ ) Lhat[f*nf3+k] = std::conj(Lhat[f*nf3+kn]);
+	}
+#pragma omp parallel for
+	for( int f=0; f<8*LTERM; f++ ) fft.transform3(&Lhat[f*nf3], true);
+#pragma omp parallel for
+	for( int i=0; i<(1 << 3 * lev); i++ ) {
+	  int ix[3] = {0, 0, 0};
+	  getIndex(ix,i);
+	  int c = (ix[0] & 1) + 2 * (ix[1] & 1) + 4 * (ix[2] & 1);
+	  int g = (((ix[2] >> 1) + DM2L) * nf + (ix[1] >> 1) + DM2L) * nf + (ix[0] >> 1) + DM2L;
+	  for_l Local[i+levelOffset][l] += std::real(Lhat[(c*LTERM+l)*nf3+g]) / nf3;
+	}
+      }
     }
 
     void L2L() const {
@@ -307,7 +499,7 @@ namespace exafmm {
     }
 
   public:
-    Kernel() : MPISIZE(1), MPIRANK(0) {}
+    Kernel() : MPISIZE(1), MPIRANK(0), useFFT(false) {}
     ~Kernel() {}
 
     inline int getKey(int *ix, int level, bool levelOffset=true) const {
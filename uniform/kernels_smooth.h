@@ -8,6 +8,8 @@
 #define EXAFMM_PP 6
 const int DP2P = 2; // Use 1 for parallel
 const int DM2L = 2; // Use 1 for parallel
+const int M2LRANGE = 2 * DM2L + 1; // Largest offset between well-separated cells in one dimension
+const int M2LWIDTH = 2 * M2LRANGE + 1;
 const int MTERM = EXAFMM_PP*(EXAFMM_PP+1)*(EXAFMM_PP+2)/6;
 const int LTERM = (EXAFMM_PP+1)*(EXAFMM_PP+2)*(EXAFMM_PP+3)/6;
 const real_t ALPHA_M = 100;
@@ -85,6 +87,27 @@ namespace exafmm {
       return ix[0] + (ix[1] + ix[2] * numPartition[level][1]) * numPartition[level][0];
     }
 
+    inline int getM2LOffset(const int *dx) const {
+      return ((dx[2] + M2LRANGE) * M2LWIDTH + dx[1] + M2LRANGE) * M2LWIDTH + dx[0] + M2LRANGE;
+    }
+
+    //! M2L coefficients of every offset between cells of the given diameter, indexed by getM2LOffset
+    void getM2LCoef(real_t (*C)[LTERM], real_t diameter) const {
+      int dx[3];
+      for( dx[2]=-M2LRANGE; dx[2]<=M2LRANGE; dx[2]++ ) {
+	for( dx[1]=-M2LRANGE; dx[1]<=M2LRANGE; dx[1]++ ) {
+	  for( dx[0]=-M2LRANGE; dx[0]<=M2LRANGE; dx[0]++ ) {
+	    if( dx[0] == 0 && dx[1] == 0 && dx[2] == 0 ) continue;
+	    real_t dX[3];
+	    for_3d dX[d] = dx[d] * diameter;
+	    real_t invR2 = 1. / (dX[0] * dX[0] + dX[1] * dX[1] + dX[2] * dX[2]);
+	    real_t invR  = sqrt(invR2);
+	    getCoef(C[getM2LOffset(dx)],dX,invR2,invR);
+	  }
+	}
+      }
+    }
+
     void P2P(int ibegin, int iend, int jbegin, int jend,
 	     real_t *Ximin, real_t *Ximax, real_t *Xjmin, real_t *Xjmax, real_t *periodic) const {
       for( int i=ibegin; i<iend; i++ ) {
@@ -272,6 +295,7 @@ namespace exafmm {
       int ixc[3];
       int DM2LC = DM2L;
       getGlobIndex(ixc,MPIRANK,maxGlobLevel);
+      real_t (*C)[LTERM] = new real_t [M2LWIDTH*M2LWIDTH*M2LWIDTH][LTERM];
       for( int lev=1; lev<=maxLevel; lev++ ) {
 	if (lev==maxLevel) DM2LC = DP2P;
 	int levelOffset = ((1 << 3 * lev) - 1) / 7;
@@ -286,6 +310,7 @@ namespace exafmm {
 	  for_3d nxmax[d] += (nunitGlob[d] >> 1);
 	}
 	real_t diameter = 2 * R0 / (1 << lev);
+	getM2LCoef(C,diameter);
 #pragma omp parallel for
 	for( int i=0; i<(1 << 3 * lev); i++ ) {
 	  real_t L[LTERM];
@@ -313,15 +338,9 @@ namespace exafmm {
 		  int rankOffset = (jxp[0] + 3 * jxp[1] + 9 * jxp[2]) * numCells;
 #endif
 		  j += rankOffset;
-		  real_t M[MTERM];
-		  for_m M[m] = Multipole[j][m];
-		  real_t dX[3];
-		  for_3d dX[d] = (ix[d] - jx[d]) * diameter;
-		  real_t invR2 = 1. / (dX[0] * dX[0] + dX[1] * dX[1] + dX[2] * dX[2]);
-		  real_t invR  = sqrt(invR2);
-		  real_t C[LTERM];
-		  getCoef(C,dX,invR2,invR);
-		  M2LSum(L,C,M);
+		  int dx[3];
+		  for_3d dx[d] = ix[d] - jx[d];
+		  M2LSum(L,C[getM2LOffset(dx)],Multipole[j]);
 		}
 	      }
 	    }
@@ -329,6 +348,7 @@ namespace exafmm {
 	  for_l Local[i+levelOffset][l] += L[l];
 	}
       }
+      delete[] C;
     }
 
     void L2L() const {
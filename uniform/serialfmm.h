@@ -292,27 +292,46 @@ namespace exafmm {
 #endif
       real_t L[LTERM];
       for_l L[l] = 0;
+      int order[LTERM];
+      for( int n=0, l=0; n<=EXAFMM_PP; n++ ) {
+	for( int k=0; k<(n+1)*(n+2)/2; k++, l++ ) order[l] = n;
+      }
+      real_t (*C)[LTERM] = new real_t [9*9*9][LTERM];
+      int jx[3];
+      for( jx[2]=-4; jx[2]<=4; jx[2]++ ) {
+	for( jx[1]=-4; jx[1]<=4; jx[1]++ ) {
+	  for( jx[0]=-4; jx[0]<=4; jx[0]++ ) {
+	    if(jx[0] < -1 || 1 < jx[0] ||
+	       jx[1] < -1 || 1 < jx[1] ||
+	       jx[2] < -1 || 1 < jx[2]) {
+	      real_t dX[3];
+	      for_3d dX[d] = jx[d] * 2 * RGlob[d];
+	      real_t invR2 = 1. / (dX[0] * dX[0] + dX[1] * dX[1] + dX[2] * dX[2]);
+	      real_t invR  = sqrt(invR2);
+	      getCoef(C[(jx[2]+4)*81+(jx[1]+4)*9+jx[0]+4],dX,invR2,invR);
+	    }
+	  }
+	}
+      }
       for( int lev=1; lev<numImages; lev++ ) {
 	real_t diameter[3];
 	for_3d diameter[d] = 2 * RGlob[d] * std::pow(3.,lev-1);
-	int jx[3];
+	real_t scale = std::pow(3.,1-lev); // Coefficients of order n scale as scale^(n+1)
+	real_t Ms[MTERM], Ls[LTERM];
+	for_m Ms[m] = M[m] * std::pow(scale,order[m]);
+	for_l Ls[l] = 0;
 	for( jx[2]=-4; jx[2]<=4; jx[2]++ ) {
 	  for( jx[1]=-4; jx[1]<=4; jx[1]++ ) {
 	    for( jx[0]=-4; jx[0]<=4; jx[0]++ ) {
 	      if(jx[0] < -1 || 1 < jx[0] ||
 		 jx[1] < -1 || 1 < jx[1] ||
 		 jx[2] < -1 || 1 < jx[2]) {
-		real_t dX[3];
-		for_3d dX[d] = jx[d] * diameter[d];
-		real_t invR2 = 1. / (dX[0] * dX[0] + dX[1] * dX[1] + dX[2] * dX[2]);
-		real_t invR  = sqrt(invR2);
-		real_t C[LTERM];
-		getCoef(C,dX,invR2,invR);
-		M2LSum(L,C,M);
+		M2LSum(Ls,C[(jx[2]+4)*81+(jx[1]+4)*9+jx[0]+4],Ms);
 	      }
 	    }
 	  }
 	}
+	for_l L[l] += Ls[l] * std::pow(scale,order[l]+1);
 	real_t M3[MTERM];
 	for_m M3[m] = 0;
 	int ix[3];
@@ -331,6 +350,7 @@ namespace exafmm {
 	}
 	for_m M[m] = M3[m];
       }
+      delete[] C;
 #if EXAFMM_SERIAL
       for_l Local[0][l] += L[l];
 #else
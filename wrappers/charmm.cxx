@@ -14,6 +14,9 @@
 #endif
 using namespace exafmm;
 
+typedef HOTMPI<Bodies,Multipoles> BasicMPI;
+typedef Traversal<BasicMPI> TreeTraversal;                      // The LET comes from TreeMPI, not from a communicator
+
 static const double Celec = 332.0716;
 
 Args * args;
@@ -21,7 +24,7 @@ BaseMPI * baseMPI;
 BoundBox * boundBox;
 BuildTree * localTree, * globalTree;
 Partition * partition;
-Traversal * traversal;
+TreeTraversal * traversal;
 TreeMPI * treeMPI;
 UpDownPass * upDownPass;
 
@@ -42,8 +45,8 @@ extern "C" void fmm_init_(int & images, double & theta, int & verbose) {
   boundBox = new BoundBox(nspawn);
   localTree = new BuildTree(ncrit, nspawn);
   globalTree = new BuildTree(1, nspawn);
-  partition = new Partition(baseMPI->mpirank, baseMPI->mpisize);
-  traversal = new Traversal(nspawn, images);
+  ::partition = new Partition(baseMPI->mpirank, baseMPI->mpisize);
+  traversal = new TreeTraversal(nspawn, images);
   treeMPI = new TreeMPI(baseMPI->mpirank, baseMPI->mpisize, images);
   upDownPass = new UpDownPass(theta, useRmax, useRopt);
 
@@ -61,7 +64,7 @@ extern "C" void fmm_init_(int & images, double & theta, int & verbose) {
   args->useRmax = useRmax;
   logger::verbose = args->verbose;
   logger::printTitle("Initial Parameters");
-  args->print(logger::stringLength, P);
+  args->print(logger::stringLength, P, std::cout);
 }
 
 extern "C" void fmm_finalize_() {
@@ -70,7 +73,7 @@ extern "C" void fmm_finalize_() {
   delete boundBox;
   delete localTree;
   delete globalTree;
-  delete partition;
+  delete ::partition;
   delete traversal;
   delete treeMPI;
   delete upDownPass;
@@ -103,7 +106,7 @@ extern "C" void fmm_partition_(int & nglobal, int * icpumap, double * x, double
   }
   localBounds = boundBox->getBounds(bodies);
   globalBounds = baseMPI->allreduceBounds(localBounds);
-  localBounds = partition->octsection(bodies,globalBounds);
+  localBounds = ::partition->octsection(bodies,globalBounds);
   bodies = treeMPI->commBodies(bodies);
   for (int i=0; i<nglobal; i++) {
     icpumap[i] = 0;
@@ -138,7 +141,7 @@ extern "C" void fmm_coulomb_(int & nglobal, int * icpumap,
   }
   args->numBodies = nlocal;
   logger::printTitle("FMM Parameters");
-  args->print(logger::stringLength, P);
+  args->print(logger::stringLength, P, std::cout);
   logger::printTitle("FMM Profiling");
   logger::startTimer("Total FMM");
   logger::startPAPI();
@@ -157,30 +160,34 @@ extern "C" void fmm_coulomb_(int & nglobal, int * icpumap,
     }
   }
   Cells cells = localTree->buildTree(bodies, buffer, localBounds);
-  upDownPass->upwardPass(cells);
+  Expansions M, L;
+  upDownPass->upwardPass(cells, M, L);
   treeMPI->allgatherBounds(localBounds);
-  treeMPI->setLET(cells, cycle);
+  treeMPI->setLET(cells, M, cycle);
   treeMPI->commBodies();
   treeMPI->commCells();
   traversal->initListCount(cells);
   traversal->initWeight(cells);
-  traversal->traverse(cells, cells, cycle, args->dual, args->mutual);
+  traversal->traverse(cells, M, L, cells, M, L, cycle, args->dual, args->mutual);
   Cells jcells;
+  Expansions jM, jL;
   if (baseMPI->mpisize > 1) {
     if (args->graft) {
       treeMPI->linkLET();
       Bodies gbodies = treeMPI->root2body();
       jcells = globalTree->buildTree(gbodies, buffer, globalBounds);
-      treeMPI->attachRoot(jcells);
-      traversal->traverse(cells, jcells, cycle, args->dual, false);
+      treeMPI->attachRoot(jcells, jM);
+      jL.resize(jcells.size());
+      traversal->traverse(cells, M, L, jcells, jM, jL, cycle, args->dual, false);
     } else {
       for (int irank=0; irank<baseMPI->mpisize; irank++) {
-	treeMPI->getLET(jcells, (baseMPI->mpirank+irank)%baseMPI->mpisize);
-	traversal->traverse(cells, jcells, cycle, args->dual, false);
+	treeMPI->getLET(jcells, jM, (baseMPI->mpirank+irank)%baseMPI->mpisize);
+	jL.resize(jcells.size());
+	traversal->traverse(cells, M, L, jcells, jM, jL, cycle, args->dual, false);
       }
     }
   }
-  upDownPass->downwardPass(cells);
+  upDownPass->downwardPass(cells, M, L);
   vec3 localDipole = upDownPass->getDipole(bodies,0);
   vec3 globalDipole = baseMPI->allreduceVec3(localDipole);
   int numBodies = baseMPI->allreduceInt(bodies.size());
@@ -226,7 +233,7 @@ extern "C" void ewald_coulomb_(int & nglobal, int * icpumap, double * x, double
   }
   args->numBodies = nlocal;
   logger::printTitle("Ewald Parameters");
-  args->print(logger::stringLength, P);
+  args->print(logger::stringLength, P, std::cout);
   ewald->print(logger::stringLength);
   logger::printTitle("Ewald Profiling");
   logger::startTimer("Total Ewald");
@@ -269,7 +276,8 @@ extern "C" void ewald_coulomb_(int & nglobal, int * icpumap, double * x, double
     f[3*i+2] += B->TRG[3] * B->SRC * Celec;
   }
   treeMPI->allgatherBounds(localBounds);
-  treeMPI->setLET(cells, cycle);
+  Expansions M(cells.size());                                   // Only the bodies of the LET are used here
+  treeMPI->setLET(cells, M, cycle);
   treeMPI->commBodies();
   bodies = treeMPI->getRecvBodies();
   for (B_iter B=bodies.begin(); B!=bodies.end(); B++) {
@@ -389,7 +397,7 @@ extern "C" void fmm_vanderwaals_(int & nglobal, int * icpumap, int * atype,
   }
   args->numBodies = nlocal;
   logger::printTitle("VdW Parameters");
-  args->print(logger::stringLength, P);
+  args->print(logger::stringLength, P, std::cout);
   logger::printTitle("VdW Profiling");
   logger::startTimer("Total VdW");
   logger::startPAPI();
@@ -408,15 +416,18 @@ extern "C" void fmm_vanderwaals_(int & nglobal, int * icpumap, int * atype,
     }
   }
   Cells cells = localTree->buildTree(bodies, buffer, localBounds);
-  upDownPass->upwardPass(cells);
+  Expansions M, L;
+  upDownPass->upwardPass(cells, M, L);
   treeMPI->allgatherBounds(localBounds);
-  treeMPI->setLET(cells, cycle);
+  treeMPI->setLET(cells, M, cycle);
   treeMPI->commBodies();
   treeMPI->commCells();
   VDW->evaluate(cells, cells);
   Cells jcells;
+  Expansions jM, jL;
   for (int irank=1; irank<baseMPI->mpisize; irank++) {
-    treeMPI->getLET(jcells,(baseMPI->mpirank+irank)%baseMPI->mpisize);
+    treeMPI->getLET(jcells, jM, (baseMPI->mpirank+irank)%baseMPI->mpisize);
+    jL.resize(jcells.size());
     VDW->evaluate(cells, jcells);
   }
   logger::stopPAPI();
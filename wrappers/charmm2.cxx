@@ -19,6 +19,9 @@
 #endif
 using namespace exafmm;
 
+typedef HOTMPI<Bodies,Multipoles> BasicMPI;
+typedef Traversal<BasicMPI> TreeTraversal;                      // The LET comes from TreeMPI, not from a communicator
+
 static const double Celec = 332.0716;
 
 Args * args;
@@ -26,7 +29,7 @@ BaseMPI * baseMPI;
 BoundBox * boundBox;
 BuildTree * localTree, * globalTree;
 Partition * partition;
-Traversal * traversal;
+TreeTraversal * traversal;
 TreeMPI * treeMPI;
 UpDownPass * upDownPass;
 
@@ -53,8 +56,8 @@ extern "C" void fmm_init_(int & images, double & theta, int & verbose, int & ngl
   boundBox = new BoundBox(nspawn);
   localTree = new BuildTree(ncrit, nspawn);
   globalTree = new BuildTree(1, nspawn);
-  partition = new Partition(baseMPI->mpirank, baseMPI->mpisize);
-  traversal = new Traversal(nspawn, images);
+  ::partition = new Partition(baseMPI->mpirank, baseMPI->mpisize);
+  traversal = new TreeTraversal(nspawn, images);
   treeMPI = new TreeMPI(baseMPI->mpirank, baseMPI->mpisize, images);
   upDownPass = new UpDownPass(theta, useRmax, useRopt);
 #if EXAFMM_SERIAL
@@ -77,7 +80,7 @@ extern "C" void fmm_init_(int & images, double & theta, int & verbose, int & ngl
   args->useRmax = useRmax;
   logger::verbose = args->verbose;
   logger::printTitle("Initial Parameters");
-  args->print(logger::stringLength, P);
+  args->print(logger::stringLength, P, std::cout);
   if (baseMPI->mpirank == 0) {
     std::cout << "PP      : " << EXAFMM_PP << std::endl;
     std::cout << "DP2P    : " << DP2P << std::endl;
@@ -100,7 +103,7 @@ extern "C" void fmm_finalize_() {
   delete boundBox;
   delete localTree;
   delete globalTree;
-  delete partition;
+  delete ::partition;
   delete traversal;
   delete treeMPI;
   delete upDownPass;
@@ -213,7 +216,7 @@ extern "C" void fmm_coulomb_(int & nglobal, int * icpumap,
   assert(nlocal % 3 == 0);
   args->numBodies = nlocal;
   logger::printTitle("FMM Parameters");
-  args->print(logger::stringLength, P);
+  args->print(logger::stringLength, P, std::cout);
   logger::printTitle("FMM Profiling");
   logger::startTimer("Total FMM");
   logger::startPAPI();
@@ -273,30 +276,34 @@ extern "C" void fmm_coulomb_(int & nglobal, int * icpumap,
   FMM->downwardPass();
 
   Cells cells = localTree->buildTree(bodies, buffer, localBounds);
-  upDownPass->upwardPass(cells);
+  Expansions M, L;
+  upDownPass->upwardPass(cells, M, L);
   treeMPI->allgatherBounds(localBounds);
-  treeMPI->setLET(cells, cycle);
+  treeMPI->setLET(cells, M, cycle);
   treeMPI->commBodies();
   treeMPI->commCells();
   traversal->initListCount(cells);
   traversal->initWeight(cells);
-  traversal->traverse(cells, cells, cycle, args->dual, args->mutual);
+  traversal->traverse(cells, M, L, cells, M, L, cycle, args->dual, args->mutual);
   Cells jcells;
+  Expansions jM, jL;
   if (baseMPI->mpisize > 1) {
     if (args->graft) {
       treeMPI->linkLET();
       Bodies gbodies = treeMPI->root2body();
       jcells = globalTree->buildTree(gbodies, buffer, globalBounds);
-      treeMPI->attachRoot(jcells);
-      traversal->traverse(cells, jcells, cycle, args->dual, false);
+      treeMPI->attachRoot(jcells, jM);
+      jL.resize(jcells.size());
+      traversal->traverse(cells, M, L, jcells, jM, jL, cycle, args->dual, false);
     } else {
       for (int irank=0; irank<baseMPI->mpisize; irank++) {
-	treeMPI->getLET(jcells, (baseMPI->mpirank+irank)%baseMPI->mpisize);
-	traversal->traverse(cells, jcells, cycle, args->dual, false);
+	treeMPI->getLET(jcells, jM, (baseMPI->mpirank+irank)%baseMPI->mpisize);
+	jL.resize(jcells.size());
+	traversal->traverse(cells, M, L, jcells, jM, jL, cycle, args->dual, false);
       }
     }
   }
-  upDownPass->downwardPass(cells);
+  upDownPass->downwardPass(cells, M, L);
 
 #if 1
   b = 0;
@@ -360,7 +367,7 @@ extern "C" void ewald_coulomb_(int & nglobal, int * icpumap, double * x, double
   }
   args->numBodies = nlocal;
   logger::printTitle("Ewald Parameters");
-  args->print(logger::stringLength, P);
+  args->print(logger::stringLength, P, std::cout);
   ewald->print(logger::stringLength);
   logger::printTitle("Ewald Profiling");
   logger::startTimer("Total Ewald");
@@ -381,7 +388,7 @@ extern "C" void ewald_coulomb_(int & nglobal, int * icpumap, double * x, double
   }
   localBounds = boundBox->getBounds(bodies);
   globalBounds = baseMPI->allreduceBounds(localBounds);
-  localBounds = partition->octsection(bodies,globalBounds);
+  localBounds = ::partition->octsection(bodies,globalBounds);
   bodies = treeMPI->commBodies(bodies);
   Cells cells = localTree->buildTree(bodies, buffer, localBounds);
   Bodies jbodies = bodies;
@@ -394,7 +401,7 @@ extern "C" void ewald_coulomb_(int & nglobal, int * icpumap, double * x, double
     ewald->realPart(cells, jcells);
   }
   ewald->selfTerm(bodies);
-  partition->unpartition(bodies);
+  ::partition->unpartition(bodies);
   bodies = treeMPI->commBodies(bodies);
   logger::stopPAPI();
   logger::stopTimer("Total Ewald");
@@ -517,7 +524,7 @@ extern "C" void fmm_vanderwaals_(int & nglobal, int * icpumap, int * atype,
   }
   args->numBodies = nlocal;
   logger::printTitle("VdW Parameters");
-  args->print(logger::stringLength, P);
+  args->print(logger::stringLength, P, std::cout);
   logger::printTitle("VdW Profiling");
   logger::startTimer("Total VdW");
   logger::startPAPI();
@@ -537,21 +544,24 @@ extern "C" void fmm_vanderwaals_(int & nglobal, int * icpumap, int * atype,
   }
   localBounds = boundBox->getBounds(bodies);
   globalBounds = baseMPI->allreduceBounds(localBounds);
-  localBounds = partition->octsection(bodies,globalBounds);
+  localBounds = ::partition->octsection(bodies,globalBounds);
   bodies = treeMPI->commBodies(bodies);
   Cells cells = localTree->buildTree(bodies, buffer, localBounds);
-  upDownPass->upwardPass(cells);
+  Expansions M, L;
+  upDownPass->upwardPass(cells, M, L);
   treeMPI->allgatherBounds(localBounds);
-  treeMPI->setLET(cells, cycle);
+  treeMPI->setLET(cells, M, cycle);
   treeMPI->commBodies();
   treeMPI->commCells();
   VDW->evaluate(cells, cells);
   Cells jcells;
+  Expansions jM, jL;
   for (int irank=1; irank<baseMPI->mpisize; irank++) {
-    treeMPI->getLET(jcells,(baseMPI->mpirank+irank)%baseMPI->mpisize);
+    treeMPI->getLET(jcells, jM, (baseMPI->mpirank+irank)%baseMPI->mpisize);
+    jL.resize(jcells.size());
     VDW->evaluate(cells, jcells);
   }
-  partition->unpartition(bodies);
+  ::partition->unpartition(bodies);
   bodies = treeMPI->commBodies(bodies);
   logger::stopPAPI();
   logger::stopTimer("Total VdW");
@@ -5,6 +5,7 @@
 #include "ewald.h"
 #include "logger.h"
 #include "partition.h"
+#include "refit_tree.h"
 #include "traversal.h"
 #include "tree_mpi.h"
 #include "up_down_pass.h"
@@ -16,17 +17,22 @@
 #endif
 using namespace exafmm;
 
+typedef HOTMPI<Bodies,Multipoles> BasicMPI;
+typedef Traversal<BasicMPI> TreeTraversal;                      // The LET comes from TreeMPI, not from a communicator
+
 Args * args;
 BaseMPI * baseMPI;
 BoundBox * boundBox;
 BuildTreeFromCluster * clusterTree;
 BuildTree * localTree, * globalTree;
 Partition * partition;
-Traversal * traversal;
+RefitTree * refitTree;
+TreeTraversal * traversal;
 TreeMPI * treeMPI;
 UpDownPass * upDownPass;
 
 Bodies buffer;
+std::vector<int> treeOrder;                                     // Body index of each body in the last tree
 Bounds localBounds;
 Bounds globalBounds;
 
@@ -45,8 +51,9 @@ extern "C" void FMM_Init(int images, int threads, bool verbose) {
   clusterTree = new BuildTreeFromCluster();
   localTree = new BuildTree(ncrit, nspawn);
   globalTree = new BuildTree(1, nspawn);
-  partition = new Partition(baseMPI->mpirank, baseMPI->mpisize);
-  traversal = new Traversal(nspawn, images);
+  ::partition = new Partition(baseMPI->mpirank, baseMPI->mpisize);
+  refitTree = new RefitTree(ncrit);
+  traversal = new TreeTraversal(nspawn, images);
   treeMPI = new TreeMPI(baseMPI->mpirank, baseMPI->mpisize, images);
   upDownPass = new UpDownPass(theta, useRmax, useRopt);
 
@@ -65,7 +72,7 @@ extern "C" void FMM_Init(int images, int threads, bool verbose) {
   args->useRmax = useRmax;
   logger::verbose = args->verbose;
   logger::printTitle("Initial Parameters");
-  args->print(logger::stringLength, P);
+  args->print(logger::stringLength, P, std::cout);
 }
 
 extern "C" void FMM_Finalize() {
@@ -75,7 +82,8 @@ extern "C" void FMM_Finalize() {
   delete clusterTree;
   delete localTree;
   delete globalTree;
-  delete partition;
+  delete ::partition;
+  delete refitTree;
   delete traversal;
   delete treeMPI;
   delete upDownPass;
@@ -99,8 +107,9 @@ extern "C" void FMM_Partition(int & n, int * ibody, int * icell, float * x, floa
   }
   localBounds = boundBox->getBounds(bodies);
   globalBounds = baseMPI->allreduceBounds(localBounds);
-  localBounds = partition->octsection(bodies,globalBounds);
+  localBounds = ::partition->octsection(bodies,globalBounds);
   bodies = treeMPI->commBodies(bodies);
+  refitTree->clear();
 #if EXAFMM_CLUSTER
   Bodies clusters = clusterTree->setClusterCenter(bodies, cycle);
   Cells cells = globalTree->buildTree(clusters, buffer, localBounds);
@@ -108,7 +117,8 @@ extern "C" void FMM_Partition(int & n, int * ibody, int * icell, float * x, floa
 #else
   Cells cells = localTree->buildTree(bodies, buffer, localBounds);
 #endif
-  upDownPass->upwardPass(cells);
+  Expansions M, L;
+  upDownPass->upwardPass(cells, M, L);
 
 #if EXAFMM_CLUSTER
   clusterTree->shiftBackBodies(bodies, cycle);
@@ -131,13 +141,14 @@ extern "C" void FMM_Coulomb(int n, int * index, float * x, float * q, float * p,
   num_threads(args->threads);
   args->numBodies = n;
   logger::printTitle("FMM Parameters");
-  args->print(logger::stringLength, P);
+  args->print(logger::stringLength, P, std::cout);
   logger::printTitle("FMM Profiling");
   logger::startTimer("Total FMM");
   logger::startPAPI();
   Bodies bodies(n);
+  bool reuse = refitTree->size() == n;                          // Bodies can be laid out as in the last tree
   for (B_iter B=bodies.begin(); B!=bodies.end(); B++) {
-    int i = B-bodies.begin();
+    int i = reuse ? treeOrder[B-bodies.begin()] : B-bodies.begin();
     B->X[0] = x[3*i+0] - cycle / 2;
     B->X[1] = x[3*i+1] - cycle / 2;
     B->X[2] = x[3*i+2] - cycle / 2;
@@ -155,35 +166,45 @@ extern "C" void FMM_Coulomb(int n, int * index, float * x, float * q, float * p,
   Cells cells = globalTree->buildTree(clusters, buffer, localBounds);
   clusterTree->attachClusterBodies(bodies, cells, cycle);
 #else
-  Cells cells = localTree->buildTree(bodies, buffer, localBounds);
+  Cells cells;
+  if (!refitTree->refit(bodies, cells)) {                       // Refit the last tree if bodies moved little
+    cells = localTree->buildTree(bodies, buffer, localBounds);  //  Else rebuild it
+    refitTree->setTree(cells);                                  //  And refit this one in the next steps
+  }
+  treeOrder.resize(n);
+  for (B_iter B=bodies.begin(); B!=bodies.end(); B++) treeOrder[B-bodies.begin()] = B->IBODY;
 #endif
-  upDownPass->upwardPass(cells);
+  Expansions M, L;
+  upDownPass->upwardPass(cells, M, L);
   treeMPI->allgatherBounds(localBounds);
-  treeMPI->setLET(cells, cycle);
+  treeMPI->setLET(cells, M, cycle);
   treeMPI->commBodies();
   treeMPI->commCells();
   traversal->initListCount(cells);
   traversal->initWeight(cells);
-  traversal->traverse(cells, cells, cycle, args->dual, args->mutual);
+  traversal->traverse(cells, M, L, cells, M, L, cycle, args->dual, args->mutual);
 #if EXAFMM_COUNT_LIST
   traversal->writeList(cells, baseMPI->mpirank);
 #endif
   Cells jcells;
+  Expansions jM, jL;
   if (baseMPI->mpisize > 1) {
     if (args->graft) {
       treeMPI->linkLET();
       Bodies gbodies = treeMPI->root2body();
       jcells = globalTree->buildTree(gbodies, buffer, globalBounds);
-      treeMPI->attachRoot(jcells);
-      traversal->traverse(cells, jcells, cycle, args->dual, false);
+      treeMPI->attachRoot(jcells, jM);
+      jL.resize(jcells.size());
+      traversal->traverse(cells, M, L, jcells, jM, jL, cycle, args->dual, false);
     } else {
       for (int irank=0; irank<baseMPI->mpisize; irank++) {
-	treeMPI->getLET(jcells, (baseMPI->mpirank+irank)%baseMPI->mpisize);
-	traversal->traverse(cells, jcells, cycle, args->dual, false);
+	treeMPI->getLET(jcells, jM, (baseMPI->mpirank+irank)%baseMPI->mpisize);
+	jL.resize(jcells.size());
+	traversal->traverse(cells, M, L, jcells, jM, jL, cycle, args->dual, false);
       }
     }
   }
-  upDownPass->downwardPass(cells);
+  upDownPass->downwardPass(cells, M, L);
   vec3 localDipole = upDownPass->getDipole(bodies,0);
   vec3 globalDipole = baseMPI->allreduceVec3(localDipole);
   int numBodies = baseMPI->allreduceInt(bodies.size());
@@ -210,7 +231,7 @@ extern "C" void Ewald_Coulomb(int n, float * x, float * q, float * p, float * f,
   Ewald * ewald = new Ewald(ksize, alpha, sigma, cutoff, cycle);
   args->numBodies = n;
   logger::printTitle("Ewald Parameters");
-  args->print(logger::stringLength, P);
+  args->print(logger::stringLength, P, std::cout);
   ewald->print(logger::stringLength);
   logger::printTitle("Ewald Profiling");
   logger::startTimer("Total Ewald");
@@ -13,13 +13,16 @@
 #endif
 using namespace exafmm;
 
+typedef HOTMPI<Bodies,Multipoles> BasicMPI;
+typedef Traversal<BasicMPI> TreeTraversal;                      // The LET comes from TreeMPI, not from a communicator
+
 Args * args;
 BaseMPI * baseMPI;
 BoundBox * boundBox;
 BuildTreeFromCluster * clusterTree;
 BuildTree * localTree, * globalTree;
 Partition * partition;
-Traversal * traversal;
+TreeTraversal * traversal;
 TreeMPI * treeMPI;
 UpDownPass * upDownPass;
 
@@ -41,8 +44,8 @@ extern "C" void FMM_Init(int images, int threads, double theta, bool verbose) {
   clusterTree = new BuildTreeFromCluster();
   localTree = new BuildTree(ncrit, nspawn);
   globalTree = new BuildTree(1, nspawn);
-  partition = new Partition(baseMPI->mpirank, baseMPI->mpisize);
-  traversal = new Traversal(nspawn, images);
+  ::partition = new Partition(baseMPI->mpirank, baseMPI->mpisize);
+  traversal = new TreeTraversal(nspawn, images);
   treeMPI = new TreeMPI(baseMPI->mpirank, baseMPI->mpisize, images);
   upDownPass = new UpDownPass(theta, useRmax, useRopt);
 
@@ -61,7 +64,7 @@ extern "C" void FMM_Init(int images, int threads, double theta, bool verbose) {
   args->useRmax = useRmax;
   logger::verbose = args->verbose;
   logger::printTitle("Initial Parameters");
-  args->print(logger::stringLength, P);
+  args->print(logger::stringLength, P, std::cout);
 }
 
 extern "C" void FMM_Finalize() {
@@ -71,7 +74,7 @@ extern "C" void FMM_Finalize() {
   delete clusterTree;
   delete localTree;
   delete globalTree;
-  delete partition;
+  delete ::partition;
   delete traversal;
   delete treeMPI;
   delete upDownPass;
@@ -95,10 +98,11 @@ extern "C" void Partition(int & n, int * res_index, double * x, double * q, doub
   }
   localBounds = boundBox->getBounds(bodies);
   globalBounds = baseMPI->allreduceBounds(localBounds);
-  localBounds = partition->octsection(bodies,globalBounds);
+  localBounds = ::partition->octsection(bodies,globalBounds);
   bodies = treeMPI->commBodies(bodies);
   Cells cells = localTree->buildTree(bodies, buffer, localBounds);
-  upDownPass->upwardPass(cells);
+  Expansions M, L;
+  upDownPass->upwardPass(cells, M, L);
 
   for (B_iter B=bodies.begin(); B!=bodies.end(); B++) {
     int i = B-bodies.begin();
@@ -117,7 +121,7 @@ extern "C" void FMM(int n, double * x, double * q, double * p, double * f, doubl
   num_threads(args->threads);
   args->numBodies = n;
   logger::printTitle("FMM Parameters");
-  args->print(logger::stringLength, P);
+  args->print(logger::stringLength, P, std::cout);
   logger::printTitle("FMM Profiling");
   logger::startTimer("Total FMM");
   logger::startPAPI();
@@ -136,33 +140,37 @@ extern "C" void FMM(int n, double * x, double * q, double * p, double * f, doubl
     B->IBODY = i;
   }
   Cells cells = localTree->buildTree(bodies, buffer, localBounds);
-  upDownPass->upwardPass(cells);
+  Expansions M, L;
+  upDownPass->upwardPass(cells, M, L);
   treeMPI->allgatherBounds(localBounds);
-  treeMPI->setLET(cells, cycle);
+  treeMPI->setLET(cells, M, cycle);
   treeMPI->commBodies();
   treeMPI->commCells();
   traversal->initListCount(cells);
   traversal->initWeight(cells);
-  traversal->traverse(cells, cells, cycle, args->dual, args->mutual);
+  traversal->traverse(cells, M, L, cells, M, L, cycle, args->dual, args->mutual);
 #if EXAFMM_COUNT_LIST
   traversal->writeList(cells, baseMPI->mpirank);
 #endif
   Cells jcells;
+  Expansions jM, jL;
   if (baseMPI->mpisize > 1) {
     if (args->graft) {
       treeMPI->linkLET();
       Bodies gbodies = treeMPI->root2body();
       jcells = globalTree->buildTree(gbodies, buffer, globalBounds);
-      treeMPI->attachRoot(jcells);
-      traversal->traverse(cells, jcells, cycle, args->dual, false);
+      treeMPI->attachRoot(jcells, jM);
+      jL.resize(jcells.size());
+      traversal->traverse(cells, M, L, jcells, jM, jL, cycle, args->dual, false);
     } else {
       for (int irank=0; irank<baseMPI->mpisize; irank++) {
-	treeMPI->getLET(jcells, (baseMPI->mpirank+irank)%baseMPI->mpisize);
-	traversal->traverse(cells, jcells, cycle, args->dual, false);
+	treeMPI->getLET(jcells, jM, (baseMPI->mpirank+irank)%baseMPI->mpisize);
+	jL.resize(jcells.size());
+	traversal->traverse(cells, M, L, jcells, jM, jL, cycle, args->dual, false);
       }
     }
   }
-  upDownPass->downwardPass(cells);
+  upDownPass->downwardPass(cells, M, L);
   vec3 localDipole = upDownPass->getDipole(bodies,0);
   vec3 globalDipole = baseMPI->allreduceVec3(localDipole);
   int numBodies = baseMPI->allreduceInt(bodies.size());
@@ -186,7 +194,7 @@ extern "C" void FMM_Ewald(int n, double * x, double * q, double * p, double * f,
   Ewald * ewald = new Ewald(ksize, alpha, sigma, cutoff, cycle);
   args->numBodies = n;
   logger::printTitle("Ewald Parameters");
-  args->print(logger::stringLength, P);
+  args->print(logger::stringLength, P, std::cout);
   ewald->print(logger::stringLength);
   logger::printTitle("Ewald Profiling");
   logger::startTimer("Total Ewald");
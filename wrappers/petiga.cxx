@@ -9,6 +9,9 @@
 #include "up_down_pass.h"
 using namespace exafmm;
 
+typedef HOTMPI<Bodies,Multipoles> BasicMPI;
+typedef Traversal<BasicMPI> TreeTraversal;                      // The LET comes from TreeMPI, not from a communicator
+
 real_t cycle;
 Bodies buffer;
 Bounds globalBounds;
@@ -22,7 +25,7 @@ BaseMPI * baseMPI;
 BoundBox * boundBox;
 BuildTree * localTree, * globalTree;
 Partition * partition;
-Traversal * traversal;
+TreeTraversal * traversal;
 TreeMPI * treeMPI;
 UpDownPass * upDownPass;
 
@@ -30,7 +33,7 @@ void log_initialize() {
   args->verbose &= baseMPI->mpirank == 0;
   logger::verbose = args->verbose;
   logger::printTitle("FMM Parameters");
-  args->print(logger::stringLength, P);
+  args->print(logger::stringLength, P, std::cout);
   logger::printTitle("FMM Profiling");
   logger::startTimer("Total FMM");
   logger::startPAPI();
@@ -63,8 +66,8 @@ extern "C" void FMM_Init(double eps2, double kreal, double kimag, int ncrit, int
   boundBox = new BoundBox(nspawn);
   localTree = new BuildTree(ncrit, nspawn);
   globalTree = new BuildTree(1, nspawn);
-  partition = new Partition(baseMPI->mpirank, baseMPI->mpisize);
-  traversal = new Traversal(nspawn, images);
+  ::partition = new Partition(baseMPI->mpirank, baseMPI->mpisize);
+  traversal = new TreeTraversal(nspawn, images);
   treeMPI = new TreeMPI(baseMPI->mpirank, baseMPI->mpisize, images);
   upDownPass = new UpDownPass(theta, useRmax, useRopt);
   num_threads(threads);
@@ -108,7 +111,7 @@ extern "C" void FMM_Finalize() {
   delete boundBox;
   delete localTree;
   delete globalTree;
-  delete partition;
+  delete ::partition;
   delete traversal;
   delete treeMPI;
   delete upDownPass;
@@ -121,9 +124,9 @@ extern "C" void FMM_Partition(int & nb, double * xb, double * yb, double * zb, d
   localBounds = boundBox->getBounds(vbodies, localBounds);
   globalBounds = baseMPI->allreduceBounds(localBounds);
   cycle = max(globalBounds.Xmax - globalBounds.Xmin);
-  partition->bisection(bbodies, globalBounds);
+  ::partition->bisection(bbodies, globalBounds);
   bbodies = treeMPI->commBodies(bbodies);
-  partition->bisection(vbodies, globalBounds);
+  ::partition->bisection(vbodies, globalBounds);
   vbodies = treeMPI->commBodies(vbodies);
   treeMPI->allgatherBounds(localBounds);
 
@@ -169,29 +172,33 @@ extern "C" void FMM_B2B(double * vi, double * vb, bool verbose) {
     B->SRC    = vb[B->IBODY];
     B->TRG    = 0;
   }
-  upDownPass->upwardPass(bcells);
-  treeMPI->setLET(bcells, cycle);
+  Expansions bM, bL;
+  upDownPass->upwardPass(bcells, bM, bL);
+  treeMPI->setLET(bcells, bM, cycle);
   Cells jcells = bcells;
+  Expansions jM, jL;
   treeMPI->commBodies();
   treeMPI->commCells();
   traversal->initListCount(bcells);
   traversal->initWeight(bcells);
-  traversal->traverse(bcells, jcells, cycle, args->dual, args->mutual);
+  traversal->traverse(bcells, bM, bL, jcells, bM, bL, cycle, args->dual, args->mutual);
   if (baseMPI->mpisize > 1) {
     if (args->graft) {
       treeMPI->linkLET();
       Bodies gbodies = treeMPI->root2body();
       jcells = globalTree->buildTree(gbodies, buffer, globalBounds);
-      treeMPI->attachRoot(jcells);
-      traversal->traverse(bcells, jcells, cycle, args->dual, false);
+      treeMPI->attachRoot(jcells, jM);
+      jL.resize(jcells.size());
+      traversal->traverse(bcells, bM, bL, jcells, jM, jL, cycle, args->dual, false);
     } else {
       for (int irank=0; irank<baseMPI->mpisize; irank++) {
-	treeMPI->getLET(jcells, (baseMPI->mpirank+irank)%baseMPI->mpisize);
-	traversal->traverse(bcells, jcells, cycle, args->dual, false);
+	treeMPI->getLET(jcells, jM, (baseMPI->mpirank+irank)%baseMPI->mpisize);
+	jL.resize(jcells.size());
+	traversal->traverse(bcells, bM, bL, jcells, jM, jL, cycle, args->dual, false);
       }
     }
   }
-  upDownPass->downwardPass(bcells);
+  upDownPass->downwardPass(bcells, bM, bL);
   log_finalize();
   for (B_iter B=bbodies.begin(); B!=bbodies.end(); B++) {
 #if EXAFMM_HELMHOLTZ
@@ -213,30 +220,35 @@ extern "C" void FMM_V2B(double * vb, double * vv, bool verbose) {
     B->SRC    = vv[B->IBODY];
     B->TRG    = 0;
   }
-  upDownPass->upwardPass(bcells);
-  upDownPass->upwardPass(vcells);
-  treeMPI->setLET(vcells, cycle);
+  Expansions bM, bL;
+  upDownPass->upwardPass(bcells, bM, bL);
+  Expansions vM, vL;
+  upDownPass->upwardPass(vcells, vM, vL);
+  treeMPI->setLET(vcells, vM, cycle);
   treeMPI->commBodies();
   treeMPI->commCells();
   traversal->initListCount(bcells);
   traversal->initWeight(bcells);
-  traversal->traverse(bcells, vcells, cycle, args->dual, args->mutual);
+  traversal->traverse(bcells, bM, bL, vcells, vM, vL, cycle, args->dual, args->mutual);
+  Expansions jM, jL;
   if (baseMPI->mpisize > 1) {
     if (args->graft) {
       treeMPI->linkLET();
       Bodies gbodies = treeMPI->root2body();
       Cells jcells = globalTree->buildTree(gbodies, buffer, globalBounds);
-      treeMPI->attachRoot(jcells);
-      traversal->traverse(bcells, jcells, cycle, args->dual, false);
+      treeMPI->attachRoot(jcells, jM);
+      jL.resize(jcells.size());
+      traversal->traverse(bcells, bM, bL, jcells, jM, jL, cycle, args->dual, false);
     } else {
       for (int irank=0; irank<baseMPI->mpisize; irank++) {
 	Cells jcells;
-	treeMPI->getLET(jcells, (baseMPI->mpirank+irank)%baseMPI->mpisize);
-	traversal->traverse(bcells, jcells, cycle, args->dual, false);
+	treeMPI->getLET(jcells, jM, (baseMPI->mpirank+irank)%baseMPI->mpisize);
+	jL.resize(jcells.size());
+	traversal->traverse(bcells, bM, bL, jcells, jM, jL, cycle, args->dual, false);
       }
     }
   }
-  upDownPass->downwardPass(bcells);
+  upDownPass->downwardPass(bcells, bM, bL);
   log_finalize();
   for (B_iter B=bbodies.begin(); B!=bbodies.end(); B++) {
 #if EXAFMM_HELMHOLTZ
@@ -258,30 +270,35 @@ extern "C" void FMM_B2V(double * vv, double * vb, bool verbose) {
     B->SRC    = vb[B->IBODY];
     B->TRG    = 0;
   }
-  upDownPass->upwardPass(bcells);
-  upDownPass->upwardPass(vcells);
-  treeMPI->setLET(bcells, cycle);
+  Expansions bM, bL;
+  upDownPass->upwardPass(bcells, bM, bL);
+  Expansions vM, vL;
+  upDownPass->upwardPass(vcells, vM, vL);
+  treeMPI->setLET(bcells, bM, cycle);
   treeMPI->commBodies();
   treeMPI->commCells();
   traversal->initListCount(vcells);
   traversal->initWeight(vcells);
-  traversal->traverse(vcells, bcells, cycle, args->dual, args->mutual);
+  traversal->traverse(vcells, vM, vL, bcells, bM, bL, cycle, args->dual, args->mutual);
+  Expansions jM, jL;
   if (baseMPI->mpisize > 1) {
     if (args->graft) {
       treeMPI->linkLET();
       Bodies gbodies = treeMPI->root2body();
       Cells jcells = globalTree->buildTree(gbodies, buffer, globalBounds);
-      treeMPI->attachRoot(jcells);
-      traversal->traverse(vcells, jcells, cycle, args->dual, false);
+      treeMPI->attachRoot(jcells, jM);
+      jL.resize(jcells.size());
+      traversal->traverse(vcells, vM, vL, jcells, jM, jL, cycle, args->dual, false);
     } else {
       for (int irank=0; irank<baseMPI->mpisize; irank++) {
 	Cells jcells;
-	treeMPI->getLET(jcells, (baseMPI->mpirank+irank)%baseMPI->mpisize);
-	traversal->traverse(vcells, jcells, cycle, args->dual, false);
+	treeMPI->getLET(jcells, jM, (baseMPI->mpirank+irank)%baseMPI->mpisize);
+	jL.resize(jcells.size());
+	traversal->traverse(vcells, vM, vL, jcells, jM, jL, cycle, args->dual, false);
       }
     }
   }
-  upDownPass->downwardPass(vcells);
+  upDownPass->downwardPass(vcells, vM, vL);
   log_finalize();
   for (B_iter B=vbodies.begin(); B!=vbodies.end(); B++) {
 #if EXAFMM_HELMHOLTZ
@@ -299,29 +316,33 @@ extern "C" void FMM_V2V(double * vi, double * vv, bool verbose) {
     B->SRC    = vv[B->IBODY];
     B->TRG    = 0;
   }
-  upDownPass->upwardPass(vcells);
-  treeMPI->setLET(vcells, cycle);
+  Expansions vM, vL;
+  upDownPass->upwardPass(vcells, vM, vL);
+  treeMPI->setLET(vcells, vM, cycle);
   Cells jcells = vcells;
+  Expansions jM, jL;
   treeMPI->commBodies();
   treeMPI->commCells();
   traversal->initListCount(vcells);
   traversal->initWeight(vcells);
-  traversal->traverse(vcells, jcells, cycle, args->dual, args->mutual);
+  traversal->traverse(vcells, vM, vL, jcells, vM, vL, cycle, args->dual, args->mutual);
   if (baseMPI->mpisize > 1) {
     if (args->graft) {
       treeMPI->linkLET();
       Bodies gbodies = treeMPI->root2body();
       jcells = globalTree->buildTree(gbodies, buffer, globalBounds);
-      treeMPI->attachRoot(jcells);
-      traversal->traverse(vcells, jcells, cycle, args->dual, false);
+      treeMPI->attachRoot(jcells, jM);
+      jL.resize(jcells.size());
+      traversal->traverse(vcells, vM, vL, jcells, jM, jL, cycle, args->dual, false);
     } else {
       for (int irank=0; irank<baseMPI->mpisize; irank++) {
-	treeMPI->getLET(jcells, (baseMPI->mpirank+irank)%baseMPI->mpisize);
-	traversal->traverse(vcells, jcells, cycle, args->dual, false);
+	treeMPI->getLET(jcells, jM, (baseMPI->mpirank+irank)%baseMPI->mpisize);
+	jL.resize(jcells.size());
+	traversal->traverse(vcells, vM, vL, jcells, jM, jL, cycle, args->dual, false);
       }
     }
   }
-  upDownPass->downwardPass(vcells);
+  upDownPass->downwardPass(vcells, vM, vL);
   log_finalize();
   for (B_iter B=vbodies.begin(); B!=vbodies.end(); B++) {
 #if EXAFMM_HELMHOLTZ